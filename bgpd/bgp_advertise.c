@@ -36,6 +36,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
+#include "bgpd/bgp_updgrp.h"
 
 /* BGP advertise attribute is used for pack same attribute update into
    one packet.  To do that we maintain attribute hash in struct
@@ -161,6 +162,158 @@ bgp_adj_out_free (struct bgp_adj_out *adj)
   XFREE (MTYPE_BGP_ADJ_OUT, adj);
 }
 
+/* The entry of the route a peer shares with the other members of its
+   update group, if it shares one.  */
+static struct bgp_adj_shared *
+bgp_adj_shared_lookup (struct bgp_node *rn, struct peer *peer,
+		       afi_t afi, safi_t safi)
+{
+  struct update_group *group = peer->updgrp[afi][safi];
+  struct bgp_adj_shared *adjs;
+  unsigned int slot;
+
+  if (group == NULL || peer->adj_shared[afi][safi] == 0)
+    return NULL;
+
+  slot = peer->updgrp_slot[afi][safi];
+  for (adjs = rn->adj_shared; adjs; adjs = adjs->next)
+    if (adjs->group == group
+	&& slot / 32 < adjs->size
+	&& CHECK_FLAG (adjs->members[slot / 32], 1U << (slot % 32)))
+      return adjs;
+  return NULL;
+}
+
+/* Take the peer out of a shared entry, freeing it after the last.  */
+static void
+bgp_adj_shared_unset (struct bgp_node *rn, struct bgp_adj_shared *adjs,
+		      struct peer *peer, afi_t afi, safi_t safi)
+{
+  unsigned int slot = peer->updgrp_slot[afi][safi];
+
+  UNSET_FLAG (adjs->members[slot / 32], 1U << (slot % 32));
+  peer->adj_shared[afi][safi]--;
+  adjs->group->adj_shared_routes--;
+
+  if (--adjs->count)
+    return;
+
+  adjs->group->adj_shared--;
+  BGP_ADJ_SHARED_DEL (rn, adjs);
+  bgp_attr_unintern (&adjs->attr);
+  XFREE (MTYPE_BGP_ADJ_SHARED, adjs);
+  bgp_unlock_node (rn);
+}
+
+/* The peer was sent the route.  Rather than keep an adjacency of its
+   own, it shares one with the members of its update group that were
+   sent the same attribute.  Nothing is shared while an advertisement
+   is pending, so a member is only ever in one entry of a route.  */
+void
+bgp_adj_out_share (struct bgp_node *rn, struct bgp_adj_out *adj,
+		   struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct update_group *group = peer->updgrp[afi][safi];
+  struct bgp_adj_shared *adjs;
+  unsigned int slot;
+  unsigned int size;
+
+  if (group == NULL || adj->adv || adj->attr == NULL
+      || ! bgp_flag_check (peer->bgp, BGP_FLAG_ADJ_OUT_SHARED)
+      || (safi != SAFI_UNICAST && safi != SAFI_MULTICAST))
+    return;
+
+  for (adjs = rn->adj_shared; adjs; adjs = adjs->next)
+    if (adjs->group == group && adjs->attr == adj->attr)
+      break;
+
+  slot = peer->updgrp_slot[afi][safi];
+  size = (group->nslots + 31) / 32;
+
+  if (adjs == NULL)
+    {
+      adjs = XCALLOC (MTYPE_BGP_ADJ_SHARED, sizeof (struct bgp_adj_shared)
+		      + size * sizeof (u_int32_t));
+      adjs->group = group;
+      adjs->attr = bgp_attr_intern (adj->attr);
+      adjs->size = size;
+      BGP_ADJ_SHARED_ADD (rn, adjs);
+      bgp_lock_node (rn);
+      group->adj_shared++;
+    }
+  else if (slot / 32 >= adjs->size)
+    {
+      /* The group grew since the entry was made. */
+      adjs = XREALLOC (MTYPE_BGP_ADJ_SHARED, adjs,
+		       sizeof (struct bgp_adj_shared)
+		       + size * sizeof (u_int32_t));
+      memset (adjs->members + adjs->size, 0,
+	      (size - adjs->size) * sizeof (u_int32_t));
+      adjs->size = size;
+      if (adjs->next)
+	adjs->next->prev = adjs;
+      if (adjs->prev)
+	adjs->prev->next = adjs;
+      else
+	rn->adj_shared = adjs;
+    }
+  SET_FLAG (adjs->members[slot / 32], 1U << (slot % 32));
+  adjs->count++;
+  group->adj_shared_routes++;
+  peer->adj_shared[afi][safi]++;
+
+  bgp_attr_unintern (&adj->attr);
+  BGP_ADJ_OUT_DEL (rn, adj);
+  bgp_adj_out_free (adj);
+  bgp_unlock_node (rn);
+}
+
+/* Give the peer an adjacency of its own again, in place of its share
+   of an entry, say because the route is to be advertised anew.  */
+struct bgp_adj_out *
+bgp_adj_out_unshare (struct bgp_node *rn, struct peer *peer,
+		     afi_t afi, safi_t safi)
+{
+  struct bgp_adj_shared *adjs;
+  struct bgp_adj_out *adj;
+
+  adjs = bgp_adj_shared_lookup (rn, peer, afi, safi);
+  if (! adjs)
+    return NULL;
+
+  adj = XCALLOC (MTYPE_BGP_ADJ_OUT, sizeof (struct bgp_adj_out));
+  adj->peer = peer_lock (peer); /* adj_out peer reference */
+  adj->attr = bgp_attr_intern (adjs->attr);
+  BGP_ADJ_OUT_ADD (rn, adj);
+  bgp_lock_node (rn);
+
+  bgp_adj_shared_unset (rn, adjs, peer, afi, safi);
+  return adj;
+}
+
+/* Forget what the peer was sent, as bgp_adj_out_remove() does.  */
+void
+bgp_adj_out_shared_remove (struct bgp_node *rn, struct peer *peer,
+			   afi_t afi, safi_t safi)
+{
+  struct bgp_adj_shared *adjs;
+
+  adjs = bgp_adj_shared_lookup (rn, peer, afi, safi);
+  if (adjs)
+    bgp_adj_shared_unset (rn, adjs, peer, afi, safi);
+}
+
+/* The attribute the peer was sent, as far as its share tells.  */
+struct attr *
+bgp_adj_out_shared_attr (struct bgp_node *rn, struct peer *peer,
+			 afi_t afi, safi_t safi)
+{
+  struct bgp_adj_shared *adjs;
+
+  adjs = bgp_adj_shared_lookup (rn, peer, afi, safi);
+  return adjs ? adjs->attr : NULL;
+}
+
 int
 bgp_adj_out_lookup (struct peer *peer, struct prefix *p,
 		    afi_t afi, safi_t safi, struct bgp_node *rn)
@@ -172,7 +325,7 @@ bgp_adj_out_lookup (struct peer *peer, struct prefix *p,
       break;
 
   if (! adj)
-    return 0;
+    return bgp_adj_shared_lookup (rn, peer, afi, safi) != NULL;
 
   return (adj->adv 
 	  ? (adj->adv->baa ? 1 : 0)
@@ -234,6 +387,9 @@ bgp_adj_out_set (struct bgp_node *rn, struct peer *peer, struct prefix *p,
       for (adj = rn->adj_out; adj; adj = adj->next)
 	if (adj->peer == peer)
 	  break;
+
+      if (! adj)
+	adj = bgp_adj_out_unshare (rn, peer, afi, safi);
     }
 
   if (! adj)
@@ -286,6 +442,9 @@ bgp_adj_out_unset (struct bgp_node *rn, struct peer *peer, struct prefix *p,
     if (adj->peer == peer)
       break;
 
+  if (! adj)
+    adj = bgp_adj_out_unshare (rn, peer, afi, safi);
+
   if (! adj)
     return;
 
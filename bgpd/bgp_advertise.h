@@ -83,6 +83,24 @@ struct bgp_adj_out
   struct bgp_advertise *adv;
 };
 
+/* Adjacency out of the members of an update group that were all sent
+   the same attribute for a route, instead of one bgp_adj_out each.  */
+struct bgp_adj_shared
+{
+  /* Linked list pointer.  */
+  struct bgp_adj_shared *next;
+  struct bgp_adj_shared *prev;
+
+  /* Advertised attribute.  */
+  struct attr *attr;
+
+  /* Update group, and the slots of its members sharing the entry.  */
+  struct update_group *group;
+  unsigned int count;
+  unsigned int size;
+  u_int32_t members[];
+};
+
 /* BGP adjacency in. */
 struct bgp_adj_in
 {
@@ -131,6 +149,8 @@ struct bgp_synchronize
 #define BGP_ADJ_IN_DEL(N,A)    BGP_INFO_DEL(N,A,adj_in)
 #define BGP_ADJ_OUT_ADD(N,A)   BGP_INFO_ADD(N,A,adj_out)
 #define BGP_ADJ_OUT_DEL(N,A)   BGP_INFO_DEL(N,A,adj_out)
+#define BGP_ADJ_SHARED_ADD(N,A) BGP_INFO_ADD(N,A,adj_shared)
+#define BGP_ADJ_SHARED_DEL(N,A) BGP_INFO_DEL(N,A,adj_shared)
 
 #define BGP_ADV_FIFO_ADD(F, N)			\
   do {						\
@@ -160,6 +180,15 @@ extern void bgp_adj_out_remove (struct bgp_node *, struct bgp_adj_out *,
 extern int bgp_adj_out_lookup (struct peer *, struct prefix *, afi_t, safi_t,
 			struct bgp_node *);
 
+extern void bgp_adj_out_share (struct bgp_node *, struct bgp_adj_out *,
+			       struct peer *, afi_t, safi_t);
+extern struct bgp_adj_out *bgp_adj_out_unshare (struct bgp_node *,
+						struct peer *, afi_t, safi_t);
+extern void bgp_adj_out_shared_remove (struct bgp_node *, struct peer *,
+				       afi_t, safi_t);
+extern struct attr *bgp_adj_out_shared_attr (struct bgp_node *,
+					     struct peer *, afi_t, safi_t);
+
 extern void bgp_adj_in_set (struct bgp_node *, struct peer *, struct attr *);
 extern int bgp_adj_in_unset (struct bgp_node *, struct peer *);
 extern void bgp_adj_in_remove (struct bgp_node *, struct bgp_adj_in *);
@@ -246,6 +246,36 @@ int_cmp (const void *p1, const void *p2)
           ? 0 : ( (*as1 > *as2) ? 1 : -1);
 }
 
+/* Sort values SET segments, for determinism in paths to aid
+ * creation of hash values / path comparisons
+ * and because it helps other lesser implementations ;)
+ */
+static void
+assegment_sort_set (struct assegment *seg)
+{
+  int tail = 0;
+  int i;
+
+  if (seg->type != AS_SET && seg->type != AS_CONFED_SET)
+    return;
+
+  qsort (seg->as, seg->length, sizeof(as_t), int_cmp);
+
+  /* weed out dupes */
+  for (i=1; i < seg->length; i++)
+    {
+      if (seg->as[tail] == seg->as[i])
+        continue;
+
+      tail++;
+      if (tail < i)
+        seg->as[tail] = seg->as[i];
+    }
+  /* seg->length can be 0.. */
+  if (seg->length)
+    seg->length = tail + 1;
+}
+
 /* normalise the segment.
  * In particular, merge runs of AS_SEQUENCEs into one segment
  * Internally, we do not care about the wire segment length limit, and
@@ -265,31 +295,7 @@ assegment_normalise (struct assegment *head)
     {
       pin = seg;
       
-      /* Sort values SET segments, for determinism in paths to aid
-       * creation of hash values / path comparisons
-       * and because it helps other lesser implementations ;)
-       */
-      if (seg->type == AS_SET || seg->type == AS_CONFED_SET)
-      	{
-	  int tail = 0;
-	  int i;
-	  
-	  qsort (seg->as, seg->length, sizeof(as_t), int_cmp);
-	  
-	  /* weed out dupes */
-	  for (i=1; i < seg->length; i++)
-	    {
-	      if (seg->as[tail] == seg->as[i])
-	      	continue;
-	      
-	      tail++;
-	      if (tail < i)
-	      	seg->as[tail] = seg->as[i];
-	    }
-	  /* seg->length can be 0.. */
-	  if (seg->length)
-	    seg->length = tail + 1;
-	}
+      assegment_sort_set (seg);
 
       /* read ahead from the current, pinned segment while the segments
        * are packable/mergeable. Append all following packable segments
@@ -389,25 +395,6 @@ aspath_delimiter_char (u_char type, u_char which)
   return ' ';
 }
 
-/* countup asns from this segment and index onward */
-static int
-assegment_count_asns (struct assegment *seg, int from)
-{
-  int count = 0;
-  while (seg)
-    {
-      if (!from)
-        count += seg->length;
-      else
-        {
-          count += (seg->length - from);
-          from = 0;
-        }
-      seg = seg->next;
-    }
-  return count;
-}
-
 unsigned int
 aspath_count_confeds (struct aspath *aspath)
 {
@@ -513,39 +500,35 @@ aspath_has_as4 (struct aspath *aspath)
   return 0;
 }
 
-/* Convert aspath structure to string expression. */
-static void
-aspath_make_str_count (struct aspath *as)
+/* ASN takes 5 to 10 chars plus seperator.  A segment of a type other
+ * than AS_SEQUENCE needs an additional 2 chars for its delimiters, and
+ * there's a space between segments.
+ *
+ * This was changed to 10 after the well-known BGP assertion, which
+ * had hit some parts of the Internet in May of 2009.
+ */
+#define ASN_STR_LEN (10 + 1)
+#define SEGMENT_STR_LEN(X) (((X)->length * ASN_STR_LEN) + 2 + 1 + 1)
+
+/* Size of buffer needed for the string form of the segments. */
+static size_t
+assegments_str_size (struct assegment *seg)
 {
-  struct assegment *seg;
-  int str_size;
-  int len = 0;
-  char *str_buf;
+  size_t size = 1;
 
-  /* Empty aspath. */
-  if (!as->segments)
-    {
-      as->str = XMALLOC (MTYPE_AS_STR, 1);
-      as->str[0] = '\0';
-      as->str_len = 0;
-      return;
-    }
-  
-  seg = as->segments;
-  
-  /* ASN takes 5 to 10 chars plus seperator, see below.
-   * If there is one differing segment type, we need an additional
-   * 2 chars for segment delimiters, and the final '\0'.
-   * Hopefully this is large enough to avoid hitting the realloc
-   * code below for most common sequences.
-   *
-   * This was changed to 10 after the well-known BGP assertion, which
-   * had hit some parts of the Internet in May of 2009.
-   */
-#define ASN_STR_LEN (10 + 1)
-  str_size = MAX (assegment_count_asns (seg, 0) * ASN_STR_LEN + 2 + 1,
-                  ASPATH_STR_DEFAULT_LEN);
-  str_buf = XMALLOC (MTYPE_AS_STR, str_size);
+  for (; seg; seg = seg->next)
+    size += SEGMENT_STR_LEN (seg);
+  return size;
+}
+
+/* Write the string form of the segments to str_buf, of at least
+ * assegments_str_size() bytes.  Returns its length, or -1 if there is a
+ * segment of an unknown type.  Allocates nothing, see aspath_decode().
+ */
+static int
+assegments_format (struct assegment *seg, char *str_buf, size_t str_size)
+{
+  int len = 0;
 
   while (seg)
     {
@@ -564,29 +547,8 @@ aspath_make_str_count (struct aspath *as)
             seperator = ' ';
             break;
           default:
-            XFREE (MTYPE_AS_STR, str_buf);
-            as->str = NULL;
-            as->str_len = 0;
-            return;
-        }
-      
-      /* We might need to increase str_buf, particularly if path has
-       * differing segments types, our initial guesstimate above will
-       * have been wrong. Need 10 chars for ASN, a seperator each and
-       * potentially two segment delimiters, plus a space between each
-       * segment and trailing zero.
-       *
-       * This definitely didn't work with the value of 5 bytes and
-       * 32-bit ASNs.
-       */
-#define SEGMENT_STR_LEN(X) (((X)->length * ASN_STR_LEN) + 2 + 1 + 1)
-      if ( (len + SEGMENT_STR_LEN(seg)) > str_size)
-        {
-          str_size = len + SEGMENT_STR_LEN(seg);
-          str_buf = XREALLOC (MTYPE_AS_STR, str_buf, str_size);
+            return -1;
         }
-#undef ASN_STR_LEN
-#undef SEGMENT_STR_LEN
       
       if (seg->type != AS_SEQUENCE)
         len += snprintf (str_buf + len, str_size - len, 
@@ -611,9 +573,41 @@ aspath_make_str_count (struct aspath *as)
       seg = seg->next;
     }
   
-  assert (len < str_size);
+  assert ((size_t) len < str_size);
   
   str_buf[len] = '\0';
+  return len;
+}
+
+/* Convert aspath structure to string expression. */
+static void
+aspath_make_str_count (struct aspath *as)
+{
+  size_t str_size;
+  int len;
+  char *str_buf;
+
+  /* Empty aspath. */
+  if (!as->segments)
+    {
+      as->str = XMALLOC (MTYPE_AS_STR, 1);
+      as->str[0] = '\0';
+      as->str_len = 0;
+      return;
+    }
+  
+  str_size = MAX (assegments_str_size (as->segments), ASPATH_STR_DEFAULT_LEN);
+  str_buf = XMALLOC (MTYPE_AS_STR, str_size);
+
+  len = assegments_format (as->segments, str_buf, str_size);
+  if (len < 0)
+    {
+      XFREE (MTYPE_AS_STR, str_buf);
+      as->str = NULL;
+      as->str_len = 0;
+      return;
+    }
+  
   as->str = str_buf;
   as->str_len = len;
 
@@ -841,6 +835,159 @@ aspath_parse (struct stream *s, size_t length, int use32bit)
   return find;
 }
 
+/* Most segments and ASNs an AS path attribute of length bytes holds. */
+#define ASPATH_DECODE_SEGS(L) ((L) / (AS_HEADER_SIZE + AS16_VALUE_SIZE))
+#define ASPATH_DECODE_ASNS(L) ((L) / AS16_VALUE_SIZE)
+
+/* Size of the buffer aspath_decode() needs for an attribute of length
+ * bytes, whatever it holds. */
+size_t
+aspath_decode_size (size_t length)
+{
+  size_t segs = ASPATH_DECODE_SEGS (length);
+  size_t asns = ASPATH_DECODE_ASNS (length);
+
+  return segs * sizeof (struct assegment)
+         + asns * sizeof (as_t)
+         + asns * ASN_STR_LEN + segs * (2 + 1 + 1) + 1;
+}
+
+/* Decode AS path attribute data, as aspath_parse() does, but into the
+ * caller's buffer of at least aspath_decode_size() bytes: the segments,
+ * normalised, and the string are all put there.  Neither allocates nor
+ * logs, nor touches the AS path hash, so it may be run by a worker
+ * thread.  Returns 0, or -1 if the data is malformed.
+ *
+ * The result can then be looked up with aspath_intern_decoded().
+ */
+int
+aspath_decode (const u_char *pnt, size_t length, int use32bit,
+               struct aspath *as, void *buf, size_t size)
+{
+  struct assegment *segs = buf;
+  as_t *asns = (as_t *) (segs + ASPATH_DECODE_SEGS (length));
+  char *str = (char *) (asns + ASPATH_DECODE_ASNS (length));
+  struct assegment *seg, *pin, *prev = NULL;
+  size_t bytes = 0;
+  size_t str_size;
+  int nsegs = 0;
+  int nasns = 0;
+  int len;
+
+  memset (as, 0, sizeof (struct aspath));
+
+  if (length % AS16_VALUE_SIZE || size < aspath_decode_size (length))
+    return -1;
+
+  while (bytes < length)
+    {
+      u_char type, count;
+      int i;
+
+      if ((length - bytes) <= AS_HEADER_SIZE)
+        return -1;
+
+      type = pnt[bytes];
+      count = pnt[bytes + 1];
+      if (count == 0 || bytes + ASSEGMENT_SIZE (count, use32bit) > length)
+        return -1;
+
+      switch (type)
+        {
+          case AS_SEQUENCE:
+          case AS_SET:
+          case AS_CONFED_SEQUENCE:
+          case AS_CONFED_SET:
+            break;
+          default:
+            return -1;
+        }
+      bytes += AS_HEADER_SIZE;
+
+      seg = &segs[nsegs++];
+      seg->next = NULL;
+      seg->type = type;
+      seg->length = count;
+      seg->as = &asns[nasns];
+      for (i = 0; i < count; i++)
+        {
+          if (use32bit)
+            {
+              seg->as[i] = ((as_t) pnt[bytes] << 24) | (pnt[bytes + 1] << 16)
+                           | (pnt[bytes + 2] << 8) | pnt[bytes + 3];
+              bytes += AS_VALUE_SIZE;
+            }
+          else
+            {
+              seg->as[i] = (pnt[bytes] << 8) | pnt[bytes + 1];
+              bytes += AS16_VALUE_SIZE;
+            }
+        }
+      nasns += count;
+
+      if (prev)
+        prev->next = seg;
+      else
+        as->segments = seg;
+      prev = seg;
+    }
+
+  /* Normalise as assegment_normalise() does.  The ASNs of consecutive
+   * segments follow each other in the buffer, so packing sequences
+   * just means making the first one longer. */
+  for (seg = as->segments; seg; seg = pin->next)
+    {
+      pin = seg;
+      assegment_sort_set (seg);
+
+      while (pin->next && ASSEGMENT_TYPES_PACKABLE (pin, pin->next))
+        {
+          seg = pin->next;
+          if (pin->as + pin->length != seg->as)
+            memmove (pin->as + pin->length, seg->as,
+                     ASSEGMENT_DATA_SIZE (seg->length, 1));
+          pin->length += seg->length;
+          pin->next = seg->next;
+        }
+    }
+
+  str_size = (char *) buf + size - str;
+  if (assegments_str_size (as->segments) > str_size)
+    return -1;
+  len = assegments_format (as->segments, str, str_size);
+  if (len < 0)
+    return -1;
+  as->str = str;
+  as->str_len = len;
+
+  return 0;
+}
+
+static void *
+aspath_hash_alloc_decoded (void *arg)
+{
+  struct aspath *new;
+
+  new = aspath_dup (arg);
+  if (! new->str)
+    aspath_str_update (new);
+  return new;
+}
+
+/* The interned copy of an AS path from aspath_decode(), with a
+ * reference taken as aspath_parse() does.  Nothing is allocated when
+ * the path is already known. */
+struct aspath *
+aspath_intern_decoded (struct aspath *as)
+{
+  struct aspath *find;
+
+  find = hash_get (ashash, as, aspath_hash_alloc_decoded);
+  find->refcnt++;
+
+  return find;
+}
+
 static void
 assegment_data_put (struct stream *s, as_t *as, int num, int use32bit)
 {
@@ -2019,7 +2166,8 @@ aspath_cmp (const void *arg1, const void *arg2)
 void
 aspath_init (void)
 {
-  ashash = hash_create_size (32768, aspath_key_make, aspath_cmp);
+  ashash = hash_create_open_size (32768, aspath_key_make, aspath_cmp);
+  hash_set_name (ashash, "BGP AS paths");
 }
 
 void
@@ -75,6 +75,10 @@ struct aspath
 extern void aspath_init (void);
 extern void aspath_finish (void);
 extern struct aspath *aspath_parse (struct stream *, size_t, int);
+extern size_t aspath_decode_size (size_t);
+extern int aspath_decode (const u_char *, size_t, int, struct aspath *,
+                          void *, size_t);
+extern struct aspath *aspath_intern_decoded (struct aspath *);
 extern struct aspath *aspath_dup (struct aspath *);
 extern struct aspath *aspath_aggregate (struct aspath *, struct aspath *);
 extern struct aspath *aspath_aggregate_mpath (struct aspath *, struct aspath *);
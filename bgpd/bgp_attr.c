@@ -40,6 +40,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_decode.h"
 #include "table.h"
 #include "bgp_encap_types.h"
 
@@ -214,7 +215,8 @@ cluster_unintern (struct cluster_list *cluster)
 static void
 cluster_init (void)
 {
-  cluster_hash = hash_create (cluster_hash_key_make, cluster_hash_cmp);
+  cluster_hash = hash_create_open (cluster_hash_key_make, cluster_hash_cmp);
+  hash_set_name (cluster_hash, "BGP cluster lists");
 }
 
 static void
@@ -390,7 +392,8 @@ transit_hash_cmp (const void *p1, const void *p2)
 static void
 transit_init (void)
 {
-  transit_hash = hash_create (transit_hash_key_make, transit_hash_cmp);
+  transit_hash = hash_create_open (transit_hash_key_make, transit_hash_cmp);
+  hash_set_name (transit_hash, "BGP transitive attributes");
 }
 
 static void
@@ -581,7 +584,8 @@ attrhash_cmp (const void *p1, const void *p2)
 static void
 attrhash_init (void)
 {
-  attrhash = hash_create (attrhash_key_make, attrhash_cmp);
+  attrhash = hash_create_open (attrhash_key_make, attrhash_cmp);
+  hash_set_name (attrhash, "BGP attributes");
 }
 
 /*
@@ -1158,8 +1162,10 @@ bgp_attr_aspath (struct bgp_attr_parser_args *args)
    * peer with AS4 => will get 4Byte ASnums
    * otherwise, will get 16 Bit
    */
-  attr->aspath = aspath_parse (peer->ibuf, length, 
-                               CHECK_FLAG (peer->cap, PEER_CAP_AS4_RCV));
+  attr->aspath = bgp_update_decoded_aspath (peer, length);
+  if (! attr->aspath)
+    attr->aspath = aspath_parse (peer->ibuf, length, 
+                                 CHECK_FLAG (peer->cap, PEER_CAP_AS4_RCV));
 
   /* In case of IBGP, length will be zero. */
   if (! attr->aspath)
@@ -1570,11 +1576,15 @@ bgp_attr_community (struct bgp_attr_parser_args *args)
       return BGP_ATTR_PARSE_PROCEED;
     }
   
-  attr->community =
-    community_parse ((u_int32_t *)stream_pnt (peer->ibuf), length);
+  attr->community = bgp_update_decoded_community (peer, length);
+  if (! attr->community)
+    {
+      attr->community =
+        community_parse ((u_int32_t *)stream_pnt (peer->ibuf), length);
   
-  /* XXX: fix community_parse to use stream API and remove this */
-  stream_forward_getp (peer->ibuf, length);
+      /* XXX: fix community_parse to use stream API and remove this */
+      stream_forward_getp (peer->ibuf, length);
+    }
 
   if (!attr->community)
     return bgp_attr_malformed (args,
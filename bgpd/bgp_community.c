@@ -360,6 +360,61 @@ community_parse (u_int32_t *pnt, u_short length)
   return community_intern (new);
 }
 
+/* Sort and uniq the values of a communities attribute into val, of at
+   least length bytes, as community_parse() does.  Neither allocates
+   nor touches the hash, so it may be run by a worker thread.  Returns
+   the number of values, or -1 if length is malformed.  */
+int
+community_decode (const u_char *pnt, u_short length, u_int32_t *val)
+{
+  int size;
+  int i, tail;
+
+  if (length % 4)
+    return -1;
+
+  size = length / 4;
+  if (size == 0)
+    return 0;
+
+  memcpy (val, pnt, length);
+  qsort (val, size, sizeof (u_int32_t), community_compare);
+
+  for (i = 1, tail = 0; i < size; i++)
+    if (val[i] != val[tail])
+      val[++tail] = val[i];
+
+  return tail + 1;
+}
+
+static void *
+community_hash_alloc_decoded (void *p)
+{
+  return community_dup (p);
+}
+
+/* Intern values from community_decode().  Nothing is allocated when
+   the community is already known.  */
+struct community *
+community_intern_decoded (u_int32_t *val, int size)
+{
+  struct community tmp;
+  struct community *find;
+
+  memset (&tmp, 0, sizeof (struct community));
+  tmp.size = size;
+  tmp.val = val;
+
+  find = (struct community *) hash_get (comhash, &tmp,
+					community_hash_alloc_decoded);
+  find->refcnt++;
+
+  if (! find->str)
+    find->str = community_com2str (find);
+
+  return find;
+}
+
 struct community *
 community_dup (struct community *com)
 {
@@ -637,8 +692,9 @@ community_hash (void)
 void
 community_init (void)
 {
-  comhash = hash_create ((unsigned int (*) (void *))community_hash_make,
-			 (int (*) (const void *, const void *))community_cmp);
+  comhash = hash_create_open ((unsigned int (*) (void *))community_hash_make,
+			      (int (*) (const void *, const void *))community_cmp);
+  hash_set_name (comhash, "BGP communities");
 }
 
 void
@@ -56,6 +56,8 @@ extern void community_finish (void);
 extern void community_free (struct community *);
 extern struct community *community_uniq_sort (struct community *);
 extern struct community *community_parse (u_int32_t *, u_short);
+extern int community_decode (const u_char *, u_short, u_int32_t *);
+extern struct community *community_intern_decoded (u_int32_t *, int);
 extern struct community *community_intern (struct community *);
 extern void community_unintern (struct community **);
 extern char *community_str (struct community *);
@@ -0,0 +1,254 @@
+/* BGP UPDATE decoding in worker threads
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "log.h"
+#include "memory.h"
+#include "stream.h"
+#include "filter.h"
+#include "workpool.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_decode.h"
+
+/* The decoded AS path is built at the start of the buffer, followed
+ * by the community values, which take no more room than the message. */
+static size_t
+bgp_update_decode_aspath_size (bgp_size_t size)
+{
+  return (aspath_decode_size (size) + 7) & ~(size_t) 7;
+}
+
+/* In a worker: find the AS_PATH and COMMUNITIES attributes, and decode
+ * them.  Only the peer's decode state and the message may be used. */
+static void
+bgp_update_decode_work (void *arg)
+{
+  struct peer *peer = arg;
+  struct bgp_update_decode *d = peer->decode;
+  const u_char *pnt = d->pnt;
+  const u_char *end = pnt + d->size;
+  const u_char *attr_end;
+  size_t aspath_size = bgp_update_decode_aspath_size (d->size);
+  bgp_size_t length;
+  int count;
+
+  d->aspath_pnt = NULL;
+  d->community_pnt = NULL;
+  d->community = (u_int32_t *) ((char *) d->buf + aspath_size);
+
+  /* Withdrawn routes, then the attributes. */
+  if (end - pnt < 2)
+    return;
+  length = (pnt[0] << 8) | pnt[1];
+  pnt += 2;
+  if (end - pnt < length + 2)
+    return;
+  pnt += length;
+  length = (pnt[0] << 8) | pnt[1];
+  pnt += 2;
+  if (end - pnt < length)
+    return;
+  attr_end = pnt + length;
+
+  while (pnt < attr_end)
+    {
+      u_char flag, type;
+
+      if (attr_end - pnt < 3)
+	return;
+      flag = pnt[0];
+      type = pnt[1];
+      if (CHECK_FLAG (flag, BGP_ATTR_FLAG_EXTLEN))
+	{
+	  if (attr_end - pnt < 4)
+	    return;
+	  length = (pnt[2] << 8) | pnt[3];
+	  pnt += 4;
+	}
+      else
+	{
+	  length = pnt[2];
+	  pnt += 3;
+	}
+      if (attr_end - pnt < length)
+	return;
+
+      switch (type)
+	{
+	case BGP_ATTR_AS_PATH:
+	  if (! d->aspath_pnt
+	      && aspath_decode (pnt, length, d->use32bit, &d->aspath,
+				d->buf, aspath_size) == 0)
+	    d->aspath_pnt = pnt;
+	  break;
+	case BGP_ATTR_COMMUNITIES:
+	  if (! d->community_pnt
+	      && (count = community_decode (pnt, length, d->community)) > 0)
+	    {
+	      d->community_pnt = pnt;
+	      d->community_size = count;
+	    }
+	  break;
+	}
+      pnt += length;
+    }
+}
+
+/* Back in the master. */
+static int
+bgp_update_decode_done (struct thread *thread)
+{
+  struct peer *peer = THREAD_ARG (thread);
+  struct bgp_update_decode *d = peer->decode;
+
+  /* Cancelled after the job had finished. */
+  if (! d || ! d->pending)
+    return 0;
+  d->pending = 0;
+
+  d->decoded = 1;
+  bgp_read_decoded (peer, d->size);
+  d->decoded = 0;
+
+  return 0;
+}
+
+/* Hand the UPDATE the peer's input buffer holds to the worker pool, if
+ * there is one.  Returns 1 if so, and reading from the peer is then
+ * suspended until bgp_read_decoded() has processed the message. */
+int
+bgp_update_decode_submit (struct peer *peer, bgp_size_t size)
+{
+  struct bgp_update_decode *d;
+  size_t bufsize;
+
+  if (! bm->work_pool || peer->status != Established)
+    return 0;
+
+  if (! peer->decode)
+    peer->decode = XCALLOC (MTYPE_BGP_DECODE,
+			    sizeof (struct bgp_update_decode));
+  d = peer->decode;
+  assert (! d->pending);
+
+  bufsize = bgp_update_decode_aspath_size (size) + size;
+  if (d->bufsize < bufsize)
+    {
+      if (d->buf)
+	XFREE (MTYPE_BGP_DECODE, d->buf);
+      d->buf = XMALLOC (MTYPE_BGP_DECODE, bufsize);
+      d->bufsize = bufsize;
+    }
+
+  d->pnt = stream_pnt (peer->ibuf);
+  d->size = size;
+  d->use32bit = CHECK_FLAG (peer->cap, PEER_CAP_AS4_RCV) ? 1 : 0;
+  d->pending = 1;
+
+  BGP_READ_OFF (peer->t_read);
+  work_pool_submit (bm->work_pool, bgp_update_decode_work,
+		    bgp_update_decode_done, peer);
+  return 1;
+}
+
+/* Drop the UPDATE being decoded, the session is going down. */
+void
+bgp_update_decode_cancel (struct peer *peer)
+{
+  struct bgp_update_decode *d = peer->decode;
+
+  if (! d || ! d->pending)
+    return;
+
+  work_pool_cancel (bm->work_pool, peer);
+  d->pending = 0;
+}
+
+/* Process the UPDATE being decoded now, without the decoded
+ * attributes, before the worker pool goes away. */
+void
+bgp_update_decode_flush (struct peer *peer)
+{
+  struct bgp_update_decode *d = peer->decode;
+
+  if (! d || ! d->pending)
+    return;
+
+  work_pool_cancel (bm->work_pool, peer);
+  d->pending = 0;
+  bgp_read_decoded (peer, d->size);
+}
+
+void
+bgp_update_decode_free (struct peer *peer)
+{
+  struct bgp_update_decode *d = peer->decode;
+
+  if (! d)
+    return;
+
+  bgp_update_decode_cancel (peer);
+  if (d->buf)
+    XFREE (MTYPE_BGP_DECODE, d->buf);
+  XFREE (MTYPE_BGP_DECODE, d);
+  peer->decode = NULL;
+}
+
+/* For bgp_attr_parse(): the AS path, if the AS_PATH attribute at the
+ * peer's input stream position was decoded, with a reference taken as
+ * aspath_parse() does, and its data consumed.  NULL otherwise. */
+struct aspath *
+bgp_update_decoded_aspath (struct peer *peer, bgp_size_t length)
+{
+  struct bgp_update_decode *d = peer->decode;
+
+  /* aspath_parse() has something to say about each segment. */
+  if (BGP_DEBUG (as4, AS4_SEGMENT))
+    return NULL;
+
+  if (! d || ! d->decoded || d->aspath_pnt != stream_pnt (peer->ibuf))
+    return NULL;
+
+  stream_forward_getp (peer->ibuf, length);
+  return aspath_intern_decoded (&d->aspath);
+}
+
+/* Likewise for the COMMUNITIES attribute, interned as by
+ * community_parse(). */
+struct community *
+bgp_update_decoded_community (struct peer *peer, bgp_size_t length)
+{
+  struct bgp_update_decode *d = peer->decode;
+
+  if (! d || ! d->decoded || d->community_pnt != stream_pnt (peer->ibuf))
+    return NULL;
+
+  stream_forward_getp (peer->ibuf, length);
+  return community_intern_decoded (d->community, d->community_size);
+}
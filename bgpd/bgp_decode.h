@@ -0,0 +1,75 @@
+/* BGP UPDATE decoding in worker threads
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_BGP_DECODE_H
+#define _QUAGGA_BGP_DECODE_H
+
+#include "bgpd/bgp_aspath.h"
+
+/*
+ * With "bgp worker-threads" configured, an UPDATE read from an
+ * established peer is first handed to the worker pool, which checks
+ * the message framing and decodes the costly attributes, AS_PATH and
+ * COMMUNITIES, into the form below.  Once that is done, the UPDATE is
+ * processed as usual by bgp_update_receive() on the main thread, which
+ * then only has to look the decoded attributes up in their hashes, and
+ * install the routes.
+ *
+ * Only one UPDATE per peer is decoded at a time, and reading from the
+ * peer is suspended meanwhile, so the messages of a peer are still
+ * processed in order, the worker reading the message in place in the
+ * peer's input buffer.  Anything the decoder does not like is left to
+ * the usual parser, so errors are reported exactly as before.
+ */
+struct bgp_update_decode
+{
+  /* The message being decoded, excluding the header. */
+  const u_char *pnt;
+  bgp_size_t size;
+  int use32bit;
+
+  /* Set from submission until the result is processed. */
+  int pending;
+
+  /* Set while bgp_update_receive() processes the decoded message. */
+  int decoded;
+
+  /* The decoded attributes, with where their data starts. */
+  const u_char *aspath_pnt;
+  struct aspath aspath;
+  const u_char *community_pnt;
+  u_int32_t *community;
+  int community_size;
+
+  /* Where the above are built. */
+  void *buf;
+  size_t bufsize;
+};
+
+extern int bgp_update_decode_submit (struct peer *, bgp_size_t);
+extern void bgp_update_decode_cancel (struct peer *);
+extern void bgp_update_decode_flush (struct peer *);
+extern void bgp_update_decode_free (struct peer *);
+
+extern struct aspath *bgp_update_decoded_aspath (struct peer *, bgp_size_t);
+extern struct community *bgp_update_decoded_community (struct peer *,
+						       bgp_size_t);
+
+#endif /* _QUAGGA_BGP_DECODE_H */
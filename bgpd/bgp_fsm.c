@@ -43,6 +43,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_dump.h"
 #include "bgpd/bgp_open.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_decode.h"
 #ifdef HAVE_SNMP
 #include "bgpd/bgp_snmp.h"
 #endif /* HAVE_SNMP */
@@ -508,6 +510,12 @@ bgp_stop (struct peer *peer)
       peer->synctime = 0;
     }
   
+  /* Nothing more to share with other peers. */
+  update_group_leave_all (peer);
+
+  /* Nor any UPDATE to process. */
+  bgp_update_decode_cancel (peer);
+
   /* Stop read and write threads when exists. */
   BGP_READ_OFF (peer->t_read);
   BGP_WRITE_OFF (peer->t_write);
@@ -525,6 +533,8 @@ bgp_stop (struct peer *peer)
   /* Clear input and output buffer.  */
   if (peer->ibuf)
     stream_reset (peer->ibuf);
+  if (peer->rbuf)
+    stream_reset (peer->rbuf);
   if (peer->work)
     stream_reset (peer->work);
   if (peer->obuf)
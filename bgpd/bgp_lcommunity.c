@@ -281,7 +281,8 @@ lcommunity_hash (void)
 void
 lcommunity_init (void)
 {
-  lcomhash = hash_create (lcommunity_hash_make, lcommunity_cmp);
+  lcomhash = hash_create_open (lcommunity_hash_make, lcommunity_cmp);
+  hash_set_name (lcomhash, "BGP large communities");
 }
 
 void
@@ -234,6 +234,9 @@ bgp_exit (int status)
   /* it only makes sense for this to be called on a clean exit */
   assert (status == 0);
 
+  /* stop the worker threads */
+  bgp_worker_threads_set (0);
+
   /* reverse bgp_master_init */
   for (ALL_LIST_ELEMENTS (bm->bgp, node, nnode, bgp))
     bgp_delete (bgp);
@@ -258,6 +261,11 @@ bgp_exit (int status)
       work_queue_free (bm->process_rsclient_queue);
       bm->process_rsclient_queue = NULL;
     }
+  if (bm->process_batch_queue)
+    {
+      work_queue_free (bm->process_batch_queue);
+      bm->process_batch_queue = NULL;
+    }
   
   /* reverse bgp_master_init */
   for (ALL_LIST_ELEMENTS_RO(bm->listen_sockets, node, socket))
@@ -451,6 +459,9 @@ main (int argc, char **argv)
   cmd_init (1);
   vty_init (bm->master);
   memory_init ();
+  memory_slab_enable (MTYPE_BGP_NODE, sizeof (struct bgp_node));
+  memory_slab_enable (MTYPE_BGP_ROUTE, sizeof (struct bgp_info));
+  memory_slab_enable (MTYPE_ATTR, sizeof (struct attr));
   vrf_init ();
 
   /* BGP related initialization.  */
@@ -170,6 +170,7 @@ bgp_address_init (void)
 {
   bgp_address_hash = hash_create (bgp_address_hash_key_make,
                                   bgp_address_hash_cmp);
+  hash_set_name (bgp_address_hash, "BGP interface addresses");
 }
 
 void
@@ -41,6 +41,7 @@
 #include "bgpd/bgp_nht.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_zebra.h"
+#include "bgpd/bgp_pic.h"
 
 extern struct zclient *zclient;
 extern struct bgp_table *bgp_nexthop_cache_table[AFI_MAX];
@@ -534,6 +535,12 @@ evaluate_paths (struct bgp_nexthop_cache *bnc)
   int afi;
   struct peer *peer = (struct peer *)bnc->nht_info;
 
+  /* Forwarding first: the routes installed with nexthop groups follow
+   * their group to its backup nexthop, whereas the paths below only
+   * have their best paths recomputed as the process queue gets to
+   * them. */
+  bgp_pic_nexthop_update (bnc);
+
   LIST_FOREACH(path, &(bnc->paths), nh_thread)
     {
       if (!(path->type == ZEBRA_ROUTE_BGP &&
@@ -50,9 +50,13 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_encap.h"
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_decode.h"
 
 int stream_put_prefix (struct stream *, struct prefix *);
 
+static void bgp_read_on (struct peer *);
+
 /* Set up BGP packet marker and packet type. */
 static int
 bgp_packet_set_marker (struct stream *s, u_char type)
@@ -140,6 +144,52 @@ bgp_connect_check (struct peer *peer)
     }
 }
 
+/* Send an UPDATE built for another member of the update group, as if
+ * it had been built by bgp_update_packet(). */
+static struct stream *
+bgp_update_packet_shared (struct peer *peer, afi_t afi, safi_t safi,
+			  struct update_group *group, struct update_packet *up)
+{
+  struct bgp_advertise *adv;
+  struct bgp_adj_out *adj;
+  struct stream *packet;
+  unsigned int i;
+
+  adv = BGP_ADV_FIFO_HEAD (&peer->sync[afi][safi]->update);
+  for (i = 0; i < up->count; i++)
+    {
+      assert (adv && adv->rn == up->nlri[i].rn);
+      adj = adv->adj;
+
+      if (BGP_DEBUG (update, UPDATE_OUT))
+        {
+          char buf[INET6_BUFSIZ];
+
+          zlog (peer->log, LOG_DEBUG, "%s send UPDATE %s/%d",
+                peer->host,
+                inet_ntop (adv->rn->p.family, &(adv->rn->p.u.prefix),
+                           buf, INET6_BUFSIZ),
+                adv->rn->p.prefixlen);
+        }
+
+      if (adj->attr)
+	bgp_attr_unintern (&adj->attr);
+      else
+	peer->scount[afi][safi]++;
+
+      adj->attr = bgp_attr_intern (adv->baa->attr);
+
+      adv = bgp_advertise_clean (peer, adj, afi, safi);
+      bgp_adj_out_share (up->nlri[i].rn, adj, peer, afi, safi);
+    }
+
+  packet = stream_share (up->packet);
+  update_group_packet_sent (group, up);
+  bgp_packet_add (peer, packet);
+  BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
+  return packet;
+}
+
 /* Make BGP update packet.  */
 static struct stream *
 bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
@@ -157,13 +207,24 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
   int space_needed = 0;
   size_t mpattrlen_pos = 0;
   size_t mpattr_pos = 0;
+  struct update_group *group;
+  struct update_packet *up;
+  struct attr *attr = NULL;
+
+  adv = BGP_ADV_FIFO_HEAD (&peer->sync[afi][safi]->update);
+
+  /* Another member of the update group may already have built it. */
+  group = update_group_get (peer, afi, safi);
+  up = update_group_packet_find (group, adv);
+  if (up)
+    return bgp_update_packet_shared (peer, afi, safi, group, up);
 
   s = peer->work;
   stream_reset (s);
   snlri = peer->scratch;
   stream_reset (snlri);
 
-  adv = BGP_ADV_FIFO_HEAD (&peer->sync[afi][safi]->update);
+  update_group_packet_start (group);
 
   while (adv)
     {
@@ -216,6 +277,7 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
 	  mpattr_pos = stream_get_endp(s);
 
 	  /* 5: Encode all the attributes, except MP_REACH_NLRI attr. */
+	  attr = adv->baa->attr;
 	  total_attr_len = bgp_packet_attribute (NULL, peer, s,
 	                                         adv->baa->attr,
                                                  ((afi == AFI_IP && safi == SAFI_UNICAST) ?
@@ -268,6 +330,8 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
                 rn->p.prefixlen);
         }
 
+      update_group_packet_add (rn, adv->binfo);
+
       /* Synchnorize attribute.  */
       if (adj->attr)
 	bgp_attr_unintern (&adj->attr);
@@ -277,6 +341,7 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
       adj->attr = bgp_attr_intern (adv->baa->attr);
 
       adv = bgp_advertise_clean (peer, adj, afi, safi);
+      bgp_adj_out_share (rn, adj, peer, afi, safi);
     }
 
   if (! stream_empty (s))
@@ -295,6 +360,8 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
       else
 	packet = stream_dup (s);
       bgp_packet_set_size (packet);
+      /* The adj-out entries still hold the attribute. */
+      update_group_packet_end (group, attr, packet);
       bgp_packet_add (peer, packet);
       BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
       stream_reset (s);
@@ -603,7 +670,7 @@ bgp_default_withdraw_send (struct peer *peer, afi_t afi, safi_t safi)
   BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
 }
 
-/* Get next packet to be written.  */
+/* Make the next packet to be written, after those already queued.  */
 static struct stream *
 bgp_write_packet (struct peer *peer)
 {
@@ -612,10 +679,6 @@ bgp_write_packet (struct peer *peer)
   struct stream *s = NULL;
   struct bgp_advertise *adv;
 
-  s = stream_fifo_head (peer->obuf);
-  if (s)
-    return s;
-
   for (afi = AFI_IP; afi < AFI_MAX; afi++)
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
       {
@@ -661,7 +724,8 @@ bgp_write_packet (struct peer *peer)
 	  {
 	    if (peer->afc_nego[afi][safi] && peer->synctime
 		&& ! CHECK_FLAG (peer->af_sflags[afi][safi], PEER_STATUS_EOR_SEND)
-		&& safi != SAFI_MPLS_VPN)
+		&& safi != SAFI_MPLS_VPN
+		&& ! bgp_update_delay_eor_held (peer, safi))
 	      {
 		SET_FLAG (peer->af_sflags[afi][safi], PEER_STATUS_EOR_SEND);
 		return bgp_update_packet_eor (peer, afi, safi);
@@ -698,15 +762,21 @@ bgp_write_proceed (struct peer *peer)
   return 0;
 }
 
-/* Write packet to the peer. */
+/* Write packets to the peer: those queued, and as many more as the
+   socket has room for, up to BGP_WRITE_PACKET_MAX, are handed to the
+   kernel with a single writev().  Packets shared with other members of
+   an update group are written from the shared data.  */
 int
 bgp_write (struct thread *thread)
 {
   struct peer *peer;
+  struct iovec iov[BGP_WRITE_PACKET_MAX];
+  struct stream *s;
   u_char type;
-  struct stream *s; 
-  int num;
-  unsigned int count = 0;
+  int iovcnt = 0;
+  int space;
+  ssize_t num;
+  size_t len, total = 0;
 
   /* Yes first of all get peer pointer. */
   peer = THREAD_ARG (thread);
@@ -719,42 +789,57 @@ bgp_write (struct thread *thread)
       return 0;
     }
 
-  s = bgp_write_packet (peer);
-  if (!s)
-    return 0;	/* nothing to send */
-
-  sockopt_cork (peer->fd, 1);
+  /* Building packets the socket has no room for would only keep their
+   * routes from being updated again in the advertisement FIFOs. */
+  space = getsockopt_so_send_space (peer->fd);
 
-  /* Nonblocking write until TCP output buffer is full.  */
-  do
+  for (s = stream_fifo_head (peer->obuf); iovcnt < BGP_WRITE_PACKET_MAX;
+       s = s->next)
     {
-      int writenum;
+      if (iovcnt && space >= 0 && total >= (size_t) space)
+	break;
+      if (s == NULL && (s = bgp_write_packet (peer)) == NULL)
+	break;
 
-      /* Number of bytes to be sent.  */
-      writenum = stream_get_endp (s) - stream_get_getp (s);
+      len = stream_get_endp (s) - stream_get_getp (s);
+      iov[iovcnt].iov_base = STREAM_PNT (s);
+      iov[iovcnt].iov_len = len;
+      iovcnt++;
+      total += len;
 
-      /* Call write() system call.  */
-      num = write (peer->fd, STREAM_PNT (s), writenum);
-      if (num < 0)
-	{
-	  /* write failed either retry needed or error */
-	  if (ERRNO_IO_RETRY(errno))
-		break;
+      /* Nothing is to follow a NOTIFICATION. */
+      if (stream_getc_from (s, BGP_MARKER_SIZE + 2) == BGP_MSG_NOTIFY)
+	break;
+    }
 
-          BGP_EVENT_ADD (peer, TCP_fatal_error);
+  if (iovcnt == 0)
+    return 0;	/* nothing to send */
+
+  num = writev (peer->fd, iov, iovcnt);
+  if (num < 0)
+    {
+      /* write failed either retry needed or error */
+      if (! ERRNO_IO_RETRY (errno))
+	{
+	  BGP_EVENT_ADD (peer, TCP_fatal_error);
 	  return 0;
 	}
+      num = 0;
+    }
 
-      if (num != writenum)
+  /* Drop the packets written, and move on in the one partially so. */
+  while (num > 0 && (s = stream_fifo_head (peer->obuf)) != NULL)
+    {
+      len = stream_get_endp (s) - stream_get_getp (s);
+      if ((size_t) num < len)
 	{
-	  /* Partial write */
 	  stream_forward_getp (s, num);
 	  break;
 	}
+      num -= len;
 
       /* Retrieve BGP packet type. */
-      stream_set_getp (s, BGP_MARKER_SIZE + 2);
-      type = stream_getc (s);
+      type = stream_getc_from (s, BGP_MARKER_SIZE + 2);
 
       switch (type)
 	{
@@ -769,7 +854,7 @@ bgp_write (struct thread *thread)
 
 	  /* Flush any existing events */
 	  BGP_EVENT_ADD (peer, BGP_Stop_with_error);
-	  goto done;
+	  return 0;
 
 	case BGP_MSG_KEEPALIVE:
 	  peer->keepalive_out++;
@@ -786,14 +871,10 @@ bgp_write (struct thread *thread)
       /* OK we send packet so delete it. */
       bgp_packet_delete (peer);
     }
-  while (++count < BGP_WRITE_PACKET_MAX &&
-	 (s = bgp_write_packet (peer)) != NULL);
-  
+
   if (bgp_write_proceed (peer))
     BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
 
- done:
-  sockopt_cork (peer->fd, 0);
   return 0;
 }
 
@@ -1536,6 +1617,11 @@ bgp_open_receive (struct peer *peer, bgp_size_t size)
       realpeer->ibuf = peer->ibuf;
       realpeer->packet_size = peer->packet_size;
       peer->ibuf = NULL;
+
+      /* And whatever was read after the OPEN. */
+      stream_free (realpeer->rbuf);
+      realpeer->rbuf = peer->rbuf;
+      peer->rbuf = NULL;
       
       /* Transfer output buffer, there may be an OPEN queued to send */
       stream_fifo_free (realpeer->obuf);
@@ -1558,7 +1644,7 @@ bgp_open_receive (struct peer *peer, bgp_size_t size)
 		    peer->fd);
 	  return -1;
 	}
-      BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+      bgp_read_on (peer);
       if (stream_fifo_head (peer->obuf))
         BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
       
@@ -1995,6 +2081,8 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
 	  if (BGP_DEBUG (normal, NORMAL))
 	    zlog (peer->log, LOG_DEBUG, "rcvd End-of-RIB for %s from %s",
 		  peer->host, afi_safi_print (afi, safi));
+
+	  bgp_update_delay_peer_check (peer);
         }
     }
   
@@ -2103,6 +2191,12 @@ bgp_keepalive_receive (struct peer *peer, bgp_size_t size)
 {
   if (BGP_DEBUG (keepalive, KEEPALIVE))  
     zlog_debug ("%s KEEPALIVE rcvd", peer->host); 
+
+  /* A peer that does not send End-of-RIB is taken to have sent its
+     table by its first KEEPALIVE once established. */
+  if (peer->status == Established
+      && ! CHECK_FLAG (peer->cap, PEER_CAP_RESTART_RCV))
+    bgp_update_delay_peer_check (peer);
   
   BGP_EVENT_ADD (peer, Receive_KEEPALIVE_message);
 }
@@ -2460,21 +2554,18 @@ bgp_capability_receive (struct peer *peer, bgp_size_t size)
   return bgp_capability_msg_parse (peer, pnt, size);
 }
 
-/* BGP read utility function. */
+/* Read as much as there is room for in the read-ahead buffer. */
 static int
 bgp_read_packet (struct peer *peer)
 {
   int nbytes;
-  int readsize;
 
-  readsize = peer->packet_size - stream_get_endp (peer->ibuf);
-
-  /* If size is zero then return. */
-  if (! readsize)
-    return 0;
+  /* Make room after the messages not processed yet. */
+  stream_discard (peer->rbuf);
 
   /* Read packet from fd. */
-  nbytes = stream_read_try (peer->ibuf, peer->fd, readsize);
+  nbytes = stream_read_try (peer->rbuf, peer->fd,
+			    STREAM_WRITEABLE (peer->rbuf));
 
   /* If read byte is smaller than zero then error occured. */
   if (nbytes < 0) 
@@ -2523,13 +2614,43 @@ bgp_read_packet (struct peer *peer)
       return -1;
     }
 
-  /* We read partial packet. */
-  if (stream_get_endp (peer->ibuf) != peer->packet_size)
-    return -1;
-
   return 0;
 }
 
+/* Length of the next message in the read-ahead buffer if it was read
+   in full, 0 otherwise.  A header with a length that cannot be right
+   counts as a message, for bgp_read_message() to complain about. */
+static bgp_size_t
+bgp_read_ready (struct peer *peer)
+{
+  struct stream *s = peer->rbuf;
+  bgp_size_t size;
+
+  if (STREAM_READABLE (s) < BGP_HEADER_SIZE)
+    return 0;
+
+  size = stream_getw_from (s, stream_get_getp (s) + BGP_MARKER_SIZE);
+  if (size < BGP_HEADER_SIZE || size > BGP_MAX_PACKET_SIZE)
+    return BGP_HEADER_SIZE;
+
+  return STREAM_READABLE (s) >= size ? size : 0;
+}
+
+/* Go on reading from the peer: straight away if a message is waiting
+   in the read-ahead buffer, when the socket is readable otherwise. */
+static void
+bgp_read_on (struct peer *peer)
+{
+  if (peer->rbuf && bgp_read_ready (peer))
+    {
+      BGP_READ_OFF (peer->t_read);
+      if (peer->status != Deleted)
+	peer->t_read = thread_add_event (bm->master, bgp_read, peer, 0);
+    }
+  else
+    BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+}
+
 /* Marker check. */
 static int
 bgp_marker_all_one (struct stream *s, int length)
@@ -2543,6 +2664,22 @@ bgp_marker_all_one (struct stream *s, int length)
   return 1;
 }
 
+/* Process an UPDATE decoded by the worker pool, see bgp_decode.h, and
+   go on reading from the peer. */
+void
+bgp_read_decoded (struct peer *peer, bgp_size_t size)
+{
+  bgp_update_receive (peer, size);
+
+  /* Clear input buffer. */
+  peer->packet_size = 0;
+  if (peer->ibuf)
+    stream_reset (peer->ibuf);
+
+  if (peer->fd >= 0)
+    bgp_read_on (peer);
+}
+
 /* Recent thread time.
    On same clock base as bgp_clock (MONOTONIC)
    but can be time of last context switch to bgp_read thread. */
@@ -2552,121 +2689,78 @@ bgp_recent_clock (void)
   return recent_relative_time().tv_sec;
 }
 
-/* Starting point of packet process function. */
-int
-bgp_read (struct thread *thread)
+/* Check the header of the message in the input buffer and hand it to
+   the routine for its type.  Returns -1 if no more messages are to be
+   read for now. */
+static int
+bgp_read_message (struct peer *peer)
 {
-  int ret;
+  int ret = 0;
   u_char type = 0;
-  struct peer *peer;
   bgp_size_t size;
   char notify_data_length[2];
 
-  /* Yes first of all get peer pointer. */
-  peer = THREAD_ARG (thread);
-  peer->t_read = NULL;
+  /* Get size and type. */
+  stream_forward_getp (peer->ibuf, BGP_MARKER_SIZE);
+  memcpy (notify_data_length, stream_pnt (peer->ibuf), 2);
+  size = stream_getw (peer->ibuf);
+  type = stream_getc (peer->ibuf);
 
-  /* For non-blocking IO check. */
-  if (peer->status == Connect)
+  if (BGP_DEBUG (normal, NORMAL) && type != 2 && type != 0)
+    zlog_debug ("%s rcv message type %d, length (excl. header) %d",
+	       peer->host, type, size - BGP_HEADER_SIZE);
+
+  /* Marker check */
+  if (((type == BGP_MSG_OPEN) || (type == BGP_MSG_KEEPALIVE))
+      && ! bgp_marker_all_one (peer->ibuf, BGP_MARKER_SIZE))
     {
-      bgp_connect_check (peer);
-      goto done;
+      bgp_notify_send (peer,
+		       BGP_NOTIFY_HEADER_ERR, 
+		       BGP_NOTIFY_HEADER_NOT_SYNC);
+      return -1;
     }
-  else
+
+  /* BGP type check. */
+  if (type != BGP_MSG_OPEN && type != BGP_MSG_UPDATE 
+      && type != BGP_MSG_NOTIFY && type != BGP_MSG_KEEPALIVE 
+      && type != BGP_MSG_ROUTE_REFRESH_NEW
+      && type != BGP_MSG_ROUTE_REFRESH_OLD
+      && type != BGP_MSG_CAPABILITY)
     {
-      if (peer->fd < 0)
-	{
-	  zlog_err ("bgp_read peer's fd is negative value %d", peer->fd);
-	  return -1;
-	}
-      BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+      if (BGP_DEBUG (normal, NORMAL))
+	plog_debug (peer->log,
+		  "%s unknown message type 0x%02x",
+		  peer->host, type);
+      bgp_notify_send_with_data (peer,
+				 BGP_NOTIFY_HEADER_ERR,
+				 BGP_NOTIFY_HEADER_BAD_MESTYPE,
+				 &type, 1);
+      return -1;
     }
-
-  /* Read packet header to determine type of the packet */
-  if (peer->packet_size == 0)
-    peer->packet_size = BGP_HEADER_SIZE;
-
-  if (stream_get_endp (peer->ibuf) < BGP_HEADER_SIZE)
+  /* Mimimum packet length check. */
+  if ((size < BGP_HEADER_SIZE)
+      || (size > BGP_MAX_PACKET_SIZE)
+      || (type == BGP_MSG_OPEN && size < BGP_MSG_OPEN_MIN_SIZE)
+      || (type == BGP_MSG_UPDATE && size < BGP_MSG_UPDATE_MIN_SIZE)
+      || (type == BGP_MSG_NOTIFY && size < BGP_MSG_NOTIFY_MIN_SIZE)
+      || (type == BGP_MSG_KEEPALIVE && size != BGP_MSG_KEEPALIVE_MIN_SIZE)
+      || (type == BGP_MSG_ROUTE_REFRESH_NEW && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
+      || (type == BGP_MSG_ROUTE_REFRESH_OLD && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
+      || (type == BGP_MSG_CAPABILITY && size < BGP_MSG_CAPABILITY_MIN_SIZE))
     {
-      ret = bgp_read_packet (peer);
-
-      /* Header read error or partial read packet. */
-      if (ret < 0) 
-	goto done;
-
-      /* Get size and type. */
-      stream_forward_getp (peer->ibuf, BGP_MARKER_SIZE);
-      memcpy (notify_data_length, stream_pnt (peer->ibuf), 2);
-      size = stream_getw (peer->ibuf);
-      type = stream_getc (peer->ibuf);
-
-      if (BGP_DEBUG (normal, NORMAL) && type != 2 && type != 0)
-	zlog_debug ("%s rcv message type %d, length (excl. header) %d",
-		   peer->host, type, size - BGP_HEADER_SIZE);
-
-      /* Marker check */
-      if (((type == BGP_MSG_OPEN) || (type == BGP_MSG_KEEPALIVE))
-	  && ! bgp_marker_all_one (peer->ibuf, BGP_MARKER_SIZE))
-	{
-	  bgp_notify_send (peer,
-			   BGP_NOTIFY_HEADER_ERR, 
-			   BGP_NOTIFY_HEADER_NOT_SYNC);
-	  goto done;
-	}
-
-      /* BGP type check. */
-      if (type != BGP_MSG_OPEN && type != BGP_MSG_UPDATE 
-	  && type != BGP_MSG_NOTIFY && type != BGP_MSG_KEEPALIVE 
-	  && type != BGP_MSG_ROUTE_REFRESH_NEW
-	  && type != BGP_MSG_ROUTE_REFRESH_OLD
-	  && type != BGP_MSG_CAPABILITY)
-	{
-	  if (BGP_DEBUG (normal, NORMAL))
-	    plog_debug (peer->log,
-		      "%s unknown message type 0x%02x",
-		      peer->host, type);
-	  bgp_notify_send_with_data (peer,
-				     BGP_NOTIFY_HEADER_ERR,
-			 	     BGP_NOTIFY_HEADER_BAD_MESTYPE,
-				     &type, 1);
-	  goto done;
-	}
-      /* Mimimum packet length check. */
-      if ((size < BGP_HEADER_SIZE)
-	  || (size > BGP_MAX_PACKET_SIZE)
-	  || (type == BGP_MSG_OPEN && size < BGP_MSG_OPEN_MIN_SIZE)
-	  || (type == BGP_MSG_UPDATE && size < BGP_MSG_UPDATE_MIN_SIZE)
-	  || (type == BGP_MSG_NOTIFY && size < BGP_MSG_NOTIFY_MIN_SIZE)
-	  || (type == BGP_MSG_KEEPALIVE && size != BGP_MSG_KEEPALIVE_MIN_SIZE)
-	  || (type == BGP_MSG_ROUTE_REFRESH_NEW && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
-	  || (type == BGP_MSG_ROUTE_REFRESH_OLD && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
-	  || (type == BGP_MSG_CAPABILITY && size < BGP_MSG_CAPABILITY_MIN_SIZE))
-	{
-	  if (BGP_DEBUG (normal, NORMAL))
-	    plog_debug (peer->log,
-		      "%s bad message length - %d for %s",
-		      peer->host, size, 
-		      type == 128 ? "ROUTE-REFRESH" :
-		      bgp_type_str[(int) type]);
-	  bgp_notify_send_with_data (peer,
-				     BGP_NOTIFY_HEADER_ERR,
-			  	     BGP_NOTIFY_HEADER_BAD_MESLEN,
-				     (u_char *) notify_data_length, 2);
-	  goto done;
-	}
-
-      /* Adjust size to message length. */
-      peer->packet_size = size;
+      if (BGP_DEBUG (normal, NORMAL))
+	plog_debug (peer->log,
+		  "%s bad message length - %d for %s",
+		  peer->host, size, 
+		  type == 128 ? "ROUTE-REFRESH" :
+		  bgp_type_str[(int) type]);
+      bgp_notify_send_with_data (peer,
+				 BGP_NOTIFY_HEADER_ERR,
+				 BGP_NOTIFY_HEADER_BAD_MESLEN,
+				 (u_char *) notify_data_length, 2);
+      return -1;
     }
 
-  ret = bgp_read_packet (peer);
-  if (ret < 0) 
-    goto done;
-
-  /* Get size and type again. */
-  size = stream_getw_from (peer->ibuf, BGP_MARKER_SIZE);
-  type = stream_getc_from (peer->ibuf, BGP_MARKER_SIZE + 2);
-
   /* BGP packet dump function. */
   bgp_dump_packet (peer, type, peer->ibuf);
   
@@ -2681,10 +2775,14 @@ bgp_read (struct thread *thread)
       break;
     case BGP_MSG_UPDATE:
       peer->readtime = bgp_recent_clock ();
+      /* The input buffer is kept until the decoded UPDATE is processed. */
+      if (bgp_update_decode_submit (peer, size))
+	return -1;
       bgp_update_receive (peer, size);
       break;
     case BGP_MSG_NOTIFY:
       bgp_notify_receive (peer, size);
+      ret = -1;
       break;
     case BGP_MSG_KEEPALIVE:
       peer->readtime = bgp_recent_clock ();
@@ -2706,6 +2804,77 @@ bgp_read (struct thread *thread)
   if (peer->ibuf)
     stream_reset (peer->ibuf);
 
+  return ret;
+}
+
+/*
+ * Starting point of packet process function.
+ *
+ * Whatever the socket has to give is read into the read-ahead buffer at
+ * once, and up to "bgp read-quantum" of the messages in there are then
+ * processed, each copied into the input buffer first.  Once the session
+ * is not Established, one message at a time is processed: the FSM event
+ * it raised is to run before the next one is looked at.  If complete
+ * messages are left over, bgp_read() is scheduled again as an event,
+ * without waiting for the socket to become readable.
+ */
+int
+bgp_read (struct thread *thread)
+{
+  struct peer *peer;
+  bgp_size_t size;
+  u_int32_t notify_out;
+  unsigned int n;
+
+  /* Yes first of all get peer pointer. */
+  peer = THREAD_ARG (thread);
+  peer->t_read = NULL;
+
+  /* For non-blocking IO check. */
+  if (peer->status == Connect)
+    {
+      bgp_connect_check (peer);
+      goto done;
+    }
+  else
+    {
+      if (peer->fd < 0)
+	{
+	  zlog_err ("bgp_read peer's fd is negative value %d", peer->fd);
+	  return -1;
+	}
+      BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+    }
+
+  /* Messages left from the last read are processed first, so that one
+     followed by the connection being closed, a NOTIFICATION say, is not
+     lost. */
+  if (! bgp_read_ready (peer) && bgp_read_packet (peer) < 0)
+    goto done;
+
+  for (n = 0; n < bm->read_quantum; n++)
+    {
+      size = bgp_read_ready (peer);
+      if (! size)
+	break;
+
+      stream_reset (peer->ibuf);
+      stream_put (peer->ibuf, stream_pnt (peer->rbuf), size);
+      stream_forward_getp (peer->rbuf, size);
+      peer->packet_size = size;
+
+      /* Stop at any NOTIFICATION sent, the session is going down. */
+      notify_out = peer->notify_out;
+      if (bgp_read_message (peer) < 0
+	  || peer->fd < 0
+	  || peer->status != Established
+	  || peer->notify_out != notify_out)
+	break;
+    }
+
+  if (peer->t_read)
+    bgp_read_on (peer);
+
  done:
   if (CHECK_FLAG (peer->sflags, PEER_STATUS_ACCEPT_PEER))
     {
@@ -24,7 +24,11 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #define BGP_NLRI_LENGTH       1U
 #define BGP_TOTAL_ATTR_LEN    2U
 #define BGP_UNFEASIBLE_LEN    2U
-#define BGP_WRITE_PACKET_MAX 10U
+#define BGP_WRITE_PACKET_MAX 32
+
+/* Read-ahead buffer of a peer, and messages taken from it per read. */
+#define BGP_READ_BUFFER_SIZE     (BGP_MAX_PACKET_SIZE * 10)
+#define BGP_READ_QUANTUM_DEFAULT 10
 
 /* When to refresh */
 #define REFRESH_IMMEDIATE 1
@@ -39,6 +43,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 /* Packet send and receive function prototypes. */
 extern int bgp_read (struct thread *);
+extern void bgp_read_decoded (struct peer *, bgp_size_t);
 extern int bgp_write (struct thread *);
 
 extern void bgp_keepalive_send (struct peer *);
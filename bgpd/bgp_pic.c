@@ -0,0 +1,436 @@
+/* BGP Prefix Independent Convergence
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "prefix.h"
+#include "memory.h"
+#include "jhash.h"
+#include "hash.h"
+#include "log.h"
+#include "linklist.h"
+#include "zclient.h"
+#include "nexthop.h"
+#include "filter.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_zebra.h"
+#include "bgpd/bgp_pic.h"
+
+extern struct zclient *zclient;
+extern struct bgp_table *bgp_nexthop_cache_table[AFI_MAX];
+
+/* All groups, by nexthop and backup nexthop. */
+static struct hash *bgp_pic_hash;
+
+/* The groups using an address, as nexthop or backup nexthop. */
+struct bgp_pic_addr
+{
+  struct in_addr addr;
+  struct list *groups;
+};
+
+/* The addresses the groups use, so that a change of one's reachability
+ * only looks at the groups using it. */
+static struct hash *bgp_pic_addr_hash;
+
+static u_int32_t bgp_pic_id_last;
+
+static unsigned int
+bgp_pic_hash_key (void *arg)
+{
+  struct bgp_pic *pic = arg;
+
+  return jhash_2words (pic->nexthop.s_addr, pic->backup.s_addr, 0);
+}
+
+static int
+bgp_pic_hash_cmp (const void *arg1, const void *arg2)
+{
+  const struct bgp_pic *pic1 = arg1;
+  const struct bgp_pic *pic2 = arg2;
+
+  return IPV4_ADDR_SAME (&pic1->nexthop, &pic2->nexthop)
+    && IPV4_ADDR_SAME (&pic1->backup, &pic2->backup);
+}
+
+static unsigned int
+bgp_pic_addr_hash_key (void *arg)
+{
+  struct bgp_pic_addr *pa = arg;
+
+  return jhash_1word (pa->addr.s_addr, 0);
+}
+
+static int
+bgp_pic_addr_hash_cmp (const void *arg1, const void *arg2)
+{
+  const struct bgp_pic_addr *pa1 = arg1;
+  const struct bgp_pic_addr *pa2 = arg2;
+
+  return IPV4_ADDR_SAME (&pa1->addr, &pa2->addr);
+}
+
+static void *
+bgp_pic_addr_alloc (void *arg)
+{
+  struct bgp_pic_addr *lookup = arg;
+  struct bgp_pic_addr *pa;
+
+  pa = XCALLOC (MTYPE_BGP_PIC_ADDR, sizeof (struct bgp_pic_addr));
+  pa->addr = lookup->addr;
+  pa->groups = list_new ();
+  return pa;
+}
+
+static void
+bgp_pic_addr_add (struct in_addr *addr, struct bgp_pic *pic)
+{
+  struct bgp_pic_addr lookup;
+  struct bgp_pic_addr *pa;
+
+  lookup.addr = *addr;
+  pa = hash_get (bgp_pic_addr_hash, &lookup, bgp_pic_addr_alloc);
+  listnode_add (pa->groups, pic);
+}
+
+static void
+bgp_pic_addr_delete (struct in_addr *addr, struct bgp_pic *pic)
+{
+  struct bgp_pic_addr lookup;
+  struct bgp_pic_addr *pa;
+
+  lookup.addr = *addr;
+  pa = hash_lookup (bgp_pic_addr_hash, &lookup);
+  if (! pa)
+    return;
+
+  listnode_delete (pa->groups, pic);
+  if (! listcount (pa->groups))
+    {
+      hash_release (bgp_pic_addr_hash, pa);
+      list_delete (pa->groups);
+      XFREE (MTYPE_BGP_PIC_ADDR, pa);
+    }
+}
+
+/* Tell zebra which of its nexthops the group is to use. */
+static void
+bgp_pic_send (struct bgp_pic *pic)
+{
+  struct zapi_ipv4 api;
+  struct in_addr *nexthop;
+
+  if (zclient->sock < 0)
+    return;
+
+  nexthop = pic->use_backup ? &pic->backup : &pic->nexthop;
+
+  memset (&api, 0, sizeof (struct zapi_ipv4));
+  api.vrf_id = VRF_DEFAULT;
+  api.type = ZEBRA_ROUTE_BGP;
+  api.nexthop_num = 1;
+  api.nexthop = &nexthop;
+
+  if (BGP_DEBUG (zebra, ZEBRA))
+    {
+      char buf[INET_ADDRSTRLEN];
+      zlog_debug ("Zebra send: nexthop group %u nexthop %s", pic->id,
+		  inet_ntop (AF_INET, nexthop, buf, sizeof (buf)));
+    }
+
+  zapi_nexthop_group_add (zclient, pic->id, &api);
+}
+
+static void *
+bgp_pic_alloc (void *arg)
+{
+  struct bgp_pic *lookup = arg;
+  struct bgp_pic *pic;
+
+  pic = XCALLOC (MTYPE_BGP_PIC, sizeof (struct bgp_pic));
+  pic->nexthop = lookup->nexthop;
+  pic->backup = lookup->backup;
+
+  if (++bgp_pic_id_last == 0)
+    bgp_pic_id_last = 1;
+  pic->id = bgp_pic_id_last;
+
+  bgp_pic_addr_add (&pic->nexthop, pic);
+  if (! IPV4_ADDR_SAME (&pic->nexthop, &pic->backup))
+    bgp_pic_addr_add (&pic->backup, pic);
+
+  bgp_pic_send (pic);
+  return pic;
+}
+
+/* The backup nexthop of the selected path of a node, if it is to be
+ * installed with a group at all. */
+int
+bgp_pic_backup (struct bgp *bgp, struct bgp_info *selected, safi_t safi,
+		struct in_addr *backup)
+{
+  struct bgp_info *ri;
+
+  if (! bgp_flag_check (bgp, BGP_FLAG_PIC)
+      || safi != SAFI_UNICAST
+      || selected->net->p.family != AF_INET
+      || bgp_info_mpath_count (selected))
+    return 0;
+
+  ri = bgp_backup_selection (bgp, selected->net, selected, AFI_IP, safi);
+  if (! ri)
+    return 0;
+
+  *backup = ri->attr->nexthop;
+  return 1;
+}
+
+/* Whether the selected path of a node is not installed with the group
+ * it should be, say because its backup path changed. */
+int
+bgp_pic_changed (struct bgp *bgp, struct bgp_info *selected, safi_t safi)
+{
+  struct bgp_pic *pic;
+  struct in_addr backup;
+
+  pic = selected->extra ? selected->extra->pic : NULL;
+
+  if (! bgp_pic_backup (bgp, selected, safi, &backup))
+    return pic != NULL;
+
+  return pic == NULL
+    || ! IPV4_ADDR_SAME (&pic->nexthop, &selected->attr->nexthop)
+    || ! IPV4_ADDR_SAME (&pic->backup, &backup);
+}
+
+/* Take a reference to the group for a nexthop and backup nexthop,
+ * registering it with zebra if it is new. */
+struct bgp_pic *
+bgp_pic_get (struct in_addr *nexthop, struct in_addr *backup)
+{
+  struct bgp_pic lookup;
+  struct bgp_pic *pic;
+
+  lookup.nexthop = *nexthop;
+  lookup.backup = *backup;
+
+  pic = hash_get (bgp_pic_hash, &lookup, bgp_pic_alloc);
+  pic->refcnt++;
+  return pic;
+}
+
+void
+bgp_pic_release (struct bgp_pic *pic)
+{
+  assert (pic->refcnt);
+  if (--pic->refcnt)
+    return;
+
+  if (zclient->sock >= 0)
+    zapi_nexthop_group_delete (zclient, pic->id, VRF_DEFAULT);
+
+  bgp_pic_addr_delete (&pic->nexthop, pic);
+  if (! IPV4_ADDR_SAME (&pic->nexthop, &pic->backup))
+    bgp_pic_addr_delete (&pic->backup, pic);
+
+  hash_release (bgp_pic_hash, pic);
+  XFREE (MTYPE_BGP_PIC, pic);
+}
+
+/* Record that the route of info's node is installed with 'pic', which
+ * the caller holds a reference to, or with no group at all, letting
+ * go of the group it was installed with before. */
+void
+bgp_pic_set (struct bgp_info *info, struct bgp_pic *pic)
+{
+  struct bgp_info *ri;
+
+  /* Selection may have moved on since the route was installed. */
+  for (ri = info->net->info; ri; ri = ri->next)
+    if (ri->extra && ri->extra->pic)
+      {
+	bgp_pic_release (ri->extra->pic);
+	ri->extra->pic = NULL;
+      }
+
+  if (pic)
+    bgp_info_extra_get (info)->pic = pic;
+}
+
+/* Install the IPv4 unicast routes in zebra again, with or without
+ * groups, after "bgp pic" was changed. */
+void
+bgp_pic_reinstall (struct bgp *bgp)
+{
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+
+  if (bgp->name || bgp_option_check (BGP_OPT_NO_FIB))
+    return;
+
+  for (rn = bgp_table_top (bgp->rib[AFI_IP][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    for (ri = rn->info; ri; ri = ri->next)
+      if (CHECK_FLAG (ri->flags, BGP_INFO_SELECTED)
+	  && ri->type == ZEBRA_ROUTE_BGP
+	  && ri->sub_type == BGP_ROUTE_NORMAL)
+	bgp_zebra_announce (&rn->p, ri, bgp, SAFI_UNICAST);
+}
+
+static int
+bgp_pic_reachable (struct in_addr *addr)
+{
+  struct bgp_node *rn;
+  struct bgp_nexthop_cache *bnc;
+  struct prefix p;
+  int reachable = 0;
+
+  memset (&p, 0, sizeof (struct prefix));
+  p.family = AF_INET;
+  p.prefixlen = IPV4_MAX_BITLEN;
+  p.u.prefix4 = *addr;
+
+  rn = bgp_node_lookup (bgp_nexthop_cache_table[AFI_IP], &p);
+  if (rn)
+    {
+      bnc = rn->info;
+      reachable = bnc && CHECK_FLAG (bnc->flags, BGP_NEXTHOP_VALID);
+      bgp_unlock_node (rn);
+    }
+  return reachable;
+}
+
+/* Move the group over to its backup nexthop, or back, as their
+ * reachability says.  Returns whether it moved. */
+static int
+bgp_pic_update (struct bgp_pic *pic)
+{
+  u_char use_backup;
+
+  use_backup = ! bgp_pic_reachable (&pic->nexthop)
+    && bgp_pic_reachable (&pic->backup);
+  if (use_backup == pic->use_backup)
+    return 0;
+
+  pic->use_backup = use_backup;
+  if (use_backup)
+    pic->failovers++;
+  bgp_pic_send (pic);
+  return 1;
+}
+
+/*
+ * The reachability of a nexthop changed: move the groups using it over
+ * to their backup nexthop, or back, before the paths using it are
+ * processed.  This is one message to zebra per group, rather than one
+ * per route once best paths have been recomputed.
+ */
+void
+bgp_pic_nexthop_update (struct bgp_nexthop_cache *bnc)
+{
+  struct bgp_pic_addr lookup;
+  struct bgp_pic_addr *pa;
+  struct listnode *node;
+  struct bgp_pic *pic;
+  unsigned int moved = 0;
+
+  if (! bgp_pic_hash->count || bnc->node->p.family != AF_INET)
+    return;
+
+  lookup.addr = bnc->node->p.u.prefix4;
+  pa = hash_lookup (bgp_pic_addr_hash, &lookup);
+  if (! pa)
+    return;
+
+  for (ALL_LIST_ELEMENTS_RO (pa->groups, node, pic))
+    moved += bgp_pic_update (pic);
+
+  if (moved && BGP_DEBUG (nht, NHT))
+    {
+      char buf[INET_ADDRSTRLEN];
+      zlog_debug ("%s: %s %s, %u nexthop groups moved", __func__,
+		  inet_ntop (AF_INET, &lookup.addr, buf, sizeof (buf)),
+		  CHECK_FLAG (bnc->flags, BGP_NEXTHOP_VALID)
+		  ? "reachable" : "unreachable", moved);
+    }
+}
+
+static void
+bgp_pic_resend (struct hash_backet *backet, void *arg)
+{
+  bgp_pic_send (backet->data);
+}
+
+/* zebra forgot about the groups if it restarted. */
+void
+bgp_pic_zebra_connected (void)
+{
+  hash_iterate (bgp_pic_hash, bgp_pic_resend, NULL);
+}
+
+static void
+bgp_pic_show (struct hash_backet *backet, void *arg)
+{
+  struct bgp_pic *pic = backet->data;
+  struct vty *vty = arg;
+  char buf[2][INET_ADDRSTRLEN];
+
+  vty_out (vty, "Group %u, nexthop %s, backup %s%s", pic->id,
+	   inet_ntop (AF_INET, &pic->nexthop, buf[0], sizeof (buf[0])),
+	   inet_ntop (AF_INET, &pic->backup, buf[1], sizeof (buf[1])),
+	   VTY_NEWLINE);
+  vty_out (vty, "  Routes: %lu, using %s, %lu failover%s%s", pic->refcnt,
+	   pic->use_backup ? "backup" : "nexthop",
+	   pic->failovers, pic->failovers == 1 ? "" : "s", VTY_NEWLINE);
+}
+
+DEFUN (show_ip_bgp_pic,
+       show_ip_bgp_pic_cmd,
+       "show ip bgp pic",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       "Nexthop groups of routes with a backup path\n")
+{
+  vty_out (vty, "Nexthop groups: %lu%s", bgp_pic_hash->count, VTY_NEWLINE);
+  hash_iterate (bgp_pic_hash, bgp_pic_show, vty);
+  return CMD_SUCCESS;
+}
+
+void
+bgp_pic_init (void)
+{
+  bgp_pic_hash = hash_create (bgp_pic_hash_key, bgp_pic_hash_cmp);
+  hash_set_name (bgp_pic_hash, "BGP PIC nexthop groups");
+  bgp_pic_addr_hash = hash_create (bgp_pic_addr_hash_key,
+				   bgp_pic_addr_hash_cmp);
+  hash_set_name (bgp_pic_addr_hash, "BGP PIC nexthop group addresses");
+
+  install_element (VIEW_NODE, &show_ip_bgp_pic_cmd);
+  install_element (RESTRICTED_NODE, &show_ip_bgp_pic_cmd);
+}
@@ -0,0 +1,72 @@
+/* BGP Prefix Independent Convergence
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_BGP_PIC_H
+#define _QUAGGA_BGP_PIC_H
+
+struct bgp_nexthop_cache;
+
+/*
+ * Prefix Independent Convergence.
+ *
+ * With "bgp pic", an IPv4 unicast route whose selected path has a
+ * single nexthop, and which has a backup path with another nexthop,
+ * is installed in zebra with a nexthop group, shared by all the routes
+ * with the same nexthop and backup nexthop, rather than with its own
+ * nexthop.  zebra has the routes of a group point to one kernel
+ * nexthop object.
+ *
+ * When the nexthop of a group becomes unreachable, the group is moved
+ * over to its backup nexthop with a single message to zebra, which
+ * replaces the one kernel object: forwarding is repaired for all the
+ * routes of the group at once, however many there are.  Their best
+ * paths are then recomputed as usual, which moves them on to whatever
+ * group or nexthop they should be installed with next.
+ */
+struct bgp_pic
+{
+  /* Id of the group in zebra. */
+  u_int32_t id;
+
+  struct in_addr nexthop;
+  struct in_addr backup;
+
+  /* Routes installed with the group. */
+  unsigned long refcnt;
+
+  /* Whether zebra was told to use the backup nexthop. */
+  u_char use_backup;
+
+  /* Times the group moved over to its backup nexthop. */
+  unsigned long failovers;
+};
+
+extern int bgp_pic_backup (struct bgp *, struct bgp_info *, safi_t,
+			   struct in_addr *);
+extern int bgp_pic_changed (struct bgp *, struct bgp_info *, safi_t);
+extern struct bgp_pic *bgp_pic_get (struct in_addr *, struct in_addr *);
+extern void bgp_pic_release (struct bgp_pic *);
+extern void bgp_pic_set (struct bgp_info *, struct bgp_pic *);
+extern void bgp_pic_reinstall (struct bgp *);
+extern void bgp_pic_nexthop_update (struct bgp_nexthop_cache *);
+extern void bgp_pic_zebra_connected (void);
+extern void bgp_pic_init (void);
+
+#endif /* _QUAGGA_BGP_PIC_H */
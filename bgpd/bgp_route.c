@@ -35,6 +35,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "plist.h"
 #include "thread.h"
 #include "workqueue.h"
+#include "workpool.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -58,6 +59,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_pic.h"
 
 /* Extern from bgp_dump.c */
 extern const char *bgp_origin_str[];
@@ -111,6 +114,9 @@ bgp_info_extra_free (struct bgp_info_extra **extra)
         bgp_damp_info_free ((*extra)->damp_info, 0);
       
       (*extra)->damp_info = NULL;
+
+      if ((*extra)->pic)
+        bgp_pic_release ((*extra)->pic);
       
       XFREE (MTYPE_BGP_ROUTE_EXTRA, *extra);
       
@@ -796,6 +802,17 @@ bgp_import_modifier (struct peer *rsclient, struct peer *peer,
   return RMAP_PERMIT;
 }
 
+/* Does the route carry the peer's own router-id as originator-id? */
+static int
+bgp_announce_originator_check (struct bgp_info *ri, struct peer *peer)
+{
+  struct attr *riattr;
+
+  riattr = bgp_info_mpath_count (ri) ? bgp_info_mpath_attr (ri) : ri->attr;
+  return (riattr->flag & ATTR_FLAG_BIT (BGP_ATTR_ORIGINATOR_ID))
+	 && IPV4_ADDR_SAME (&peer->remote_id, &riattr->extra->originator_id);
+}
+
 static int
 bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
 		    struct attr *attr, afi_t afi, safi_t safi)
@@ -852,18 +869,15 @@ bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
 
   /* If the attribute has originator-id and it is same as remote
      peer's id. */
-  if (riattr->flag & ATTR_FLAG_BIT (BGP_ATTR_ORIGINATOR_ID))
+  if (bgp_announce_originator_check (ri, peer))
     {
-      if (IPV4_ADDR_SAME (&peer->remote_id, &riattr->extra->originator_id))
-	{
-	  if (BGP_DEBUG (filter, FILTER))  
-	    zlog (peer->log, LOG_DEBUG,
-		  "%s [Update:SEND] %s/%d originator-id is same as remote router-id",
-		  peer->host,
-		  inet_ntop(p->family, &p->u.prefix, buf, SU_ADDRSTRLEN),
-		  p->prefixlen);
-	  return 0;
-	}
+      if (BGP_DEBUG (filter, FILTER))  
+	zlog (peer->log, LOG_DEBUG,
+	      "%s [Update:SEND] %s/%d originator-id is same as remote router-id",
+	      peer->host,
+	      inet_ntop(p->family, &p->u.prefix, buf, SU_ADDRSTRLEN),
+	      p->prefixlen);
+      return 0;
     }
  
   /* ORF prefix-list filter check */
@@ -1301,10 +1315,15 @@ struct bgp_info_pair
   struct bgp_info *new;
 };
 
+/* Select the best path of rn.  In a worker (see bgp_process_batch_run),
+ * only the selection itself is done, which must then be finished by
+ * bgp_best_selection_finish() in the master: multipath must not be
+ * configured, and nothing is reaped or allocated.
+ */
 static void
-bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
-		    struct bgp_info_pair *result,
-		    afi_t afi, safi_t safi)
+bgp_best_selection_run (struct bgp *bgp, struct bgp_node *rn,
+			struct bgp_info_pair *result,
+			afi_t afi, safi_t safi, int worker)
 {
   struct bgp_info *new_select;
   struct bgp_info *old_select;
@@ -1320,6 +1339,9 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
   if (rn->info == NULL)
     {
       char buf[PREFIX_STRLEN];
+
+      if (worker)
+	return;
       zlog_warn ("%s: Called for route_node %s with no routing entries!",
                  __func__,
                  prefix2str (&(bgp_node_to_rnode (rn)->p), buf, sizeof(buf)));
@@ -1327,7 +1349,7 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
     }
   
   bgp_mp_list_init (&mp_list);
-  do_mpath = bgp_mpath_is_configured (bgp, afi, safi);
+  do_mpath = worker ? 0 : bgp_mpath_is_configured (bgp, afi, safi);
 
   /* bgp deterministic-med */
   new_select = NULL;
@@ -1387,6 +1409,8 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
 	bgp_info_set_flag (rn, new_select, BGP_INFO_DMED_CHECK);
 	bgp_info_set_flag (rn, new_select, BGP_INFO_DMED_SELECTED);
 
+	if (worker)
+	  continue;
 	bgp_info_mpath_update (rn, new_select, old_select, &mp_list, afi, safi);
 	bgp_mp_list_clear (&mp_list);
       }
@@ -1405,7 +1429,7 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
            * selected route must stay for a while longer though
            */
           if (CHECK_FLAG (ri->flags, BGP_INFO_REMOVED)
-              && (ri != old_select))
+              && (ri != old_select) && !worker)
               bgp_info_reap (rn, ri);
           
           continue;
@@ -1447,18 +1471,80 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
         }
     }
 
+  result->old = old_select;
+  result->new = new_select;
+
+  if (worker)
+    return;
+
   if (!bgp_flag_check (bgp, BGP_FLAG_DETERMINISTIC_MED))
     bgp_info_mpath_update (rn, new_select, old_select, &mp_list, afi, safi);
 
   bgp_info_mpath_aggregate_update (new_select, old_select);
   bgp_mp_list_clear (&mp_list);
 
-  result->old = old_select;
-  result->new = new_select;
-
   return;
 }
 
+static void
+bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
+		    struct bgp_info_pair *result,
+		    afi_t afi, safi_t safi)
+{
+  bgp_best_selection_run (bgp, rn, result, afi, safi, 0);
+}
+
+/* The path to fall back to should the nexthop of the selected one
+ * become unreachable: the best of the other paths with another
+ * nexthop, see bgp_pic.h. */
+struct bgp_info *
+bgp_backup_selection (struct bgp *bgp, struct bgp_node *rn,
+		      struct bgp_info *selected, afi_t afi, safi_t safi)
+{
+  struct bgp_info *ri;
+  struct bgp_info *backup = NULL;
+
+  for (ri = rn->info; ri; ri = ri->next)
+    {
+      if (ri == selected || BGP_INFO_HOLDDOWN (ri))
+	continue;
+      if (ri->type != ZEBRA_ROUTE_BGP || ri->sub_type != BGP_ROUTE_NORMAL)
+	continue;
+      if (ri->peer && ri->peer != bgp->peer_self
+	  && ri->peer->status != Established)
+	continue;
+      if (ri->attr->nexthop.s_addr == INADDR_ANY
+	  || IPV4_ADDR_SAME (&ri->attr->nexthop, &selected->attr->nexthop))
+	continue;
+
+      if (! backup || bgp_info_cmp (bgp, ri, backup, afi, safi) == -1)
+	backup = ri;
+    }
+  return backup;
+}
+
+/* What bgp_best_selection_run() left out in a worker. */
+static void
+bgp_best_selection_finish (struct bgp_node *rn,
+			   struct bgp_info_pair *result,
+			   afi_t afi, safi_t safi)
+{
+  struct bgp_info *ri;
+  struct bgp_info *nextri;
+  struct list mp_list;
+
+  for (ri = rn->info; ri; ri = nextri)
+    {
+      nextri = ri->next;
+      if (CHECK_FLAG (ri->flags, BGP_INFO_REMOVED) && ri != result->old)
+	bgp_info_reap (rn, ri);
+    }
+
+  bgp_mp_list_init (&mp_list);
+  bgp_info_mpath_update (rn, result->new, result->old, &mp_list, afi, safi);
+  bgp_info_mpath_aggregate_update (result->new, result->old);
+}
+
 static int
 bgp_process_announce_selected (struct peer *peer, struct bgp_info *selected,
                                struct bgp_node *rn, afi_t afi, safi_t safi)
@@ -1513,12 +1599,105 @@ bgp_process_announce_selected (struct peer *peer, struct bgp_info *selected,
   return 0;
 }
 
+/*
+ * Announce the selected route of a node of the main table to every
+ * peer.  The announce check, the costly part, is only run once for
+ * each update group, see bgp_updgrp.h.  Only the checks that depend
+ * on the peer itself rather than on its policy are done per member.
+ */
+static void
+bgp_process_announce_peers (struct bgp *bgp, struct bgp_info *selected,
+			    struct bgp_node *rn, afi_t afi, safi_t safi)
+{
+  struct update_group *group;
+  struct update_group *checked = NULL;
+  struct listnode *node, *nnode;
+  struct peer *peer;
+
+  for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
+    {
+      if (peer->status != Established
+	  || ! peer->afc_nego[afi][safi]
+	  || CHECK_FLAG (peer->af_sflags[afi][safi],
+			 PEER_STATUS_ORF_WAIT_REFRESH))
+	continue;
+
+      group = update_group_get (peer, afi, safi);
+      if (selected == NULL || group == NULL || listcount (group->peers) < 2)
+	{
+	  bgp_process_announce_selected (peer, selected, rn, afi, safi);
+	  continue;
+	}
+
+      /* Not sent back to where it came from. */
+      if (selected->peer == peer
+	  || bgp_announce_originator_check (selected, peer))
+	{
+	  bgp_adj_out_unset (rn, peer, &rn->p, afi, safi);
+	  continue;
+	}
+
+      if (group->rn != rn)
+	{
+	  memset (&group->attr, 0, sizeof (struct attr));
+	  memset (&group->extra, 0, sizeof (struct attr_extra));
+	  group->attr.extra = &group->extra;
+	  group->announce = bgp_announce_check (selected, peer, &rn->p,
+						&group->attr, afi, safi);
+	  group->rn = rn;
+	  group->next_checked = checked;
+	  checked = group;
+	  group->checks++;
+	}
+      else
+	group->checks_shared++;
+
+      if (group->announce)
+	bgp_adj_out_set (rn, peer, &rn->p, &group->attr, afi, safi, selected);
+      else
+	bgp_adj_out_unset (rn, peer, &rn->p, afi, safi);
+    }
+
+  for (group = checked; group; group = group->next_checked)
+    {
+      bgp_attr_flush (&group->attr);
+      group->rn = NULL;
+    }
+}
+
 struct bgp_process_queue 
 {
   struct bgp *bgp;
   struct bgp_node *rn;
   afi_t afi;
   safi_t safi;
+
+  /* For batches, with the best path selected in a worker. */
+  struct bgp_process_queue *next;
+  struct bgp_info_pair selected;
+  int is_selected;
+};
+
+/* With "bgp worker-threads", nodes of the main tables to be processed
+ * are collected in batches instead, one list per AFI/SAFI.  When a
+ * batch is run, the best path of the nodes of each AFI/SAFI is selected
+ * in a worker of its own, while the master waits.  Each AFI/SAFI only
+ * touches its own tables, and the master nothing at all meanwhile, so
+ * no locking is needed.  The rest of the processing, the announcements
+ * to peers and zebra, is then done in the master as usual.
+ */
+#define BGP_PROCESS_BATCH_MAX 1024
+
+struct bgp_process_select
+{
+  struct bgp_process_queue *head;
+  struct bgp_process_queue *tail;
+};
+
+struct bgp_process_batch
+{
+  struct bgp_process_select select[AFI_MAX][SAFI_MAX];
+  unsigned int count;
 };
 
 static wq_item_status
@@ -1583,10 +1762,11 @@ bgp_process_rsclient (struct work_queue *wq, void *data)
   return WQ_SUCCESS;
 }
 
-static wq_item_status
-bgp_process_main (struct work_queue *wq, void *data)
+static void bgp_update_delay_advertised (struct bgp *);
+
+static void
+bgp_process_main_node (struct bgp_process_queue *pq)
 {
-  struct bgp_process_queue *pq = data;
   struct bgp *bgp = pq->bgp;
   struct bgp_node *rn = pq->rn;
   afi_t afi = pq->afi;
@@ -1595,11 +1775,25 @@ bgp_process_main (struct work_queue *wq, void *data)
   struct bgp_info *new_select;
   struct bgp_info *old_select;
   struct bgp_info_pair old_and_new;
-  struct listnode *node, *nnode;
-  struct peer *peer;
+
+  /* The last of the nodes deferred by the update delay, see
+     bgp_update_delay_end(). */
+  if (CHECK_FLAG (rn->flags, BGP_NODE_UPDATE_DELAY))
+    {
+      UNSET_FLAG (rn->flags, BGP_NODE_UPDATE_DELAY);
+      if (bgp->update_delay == BGP_UPDATE_DELAY_ADVERTISING
+	  && --bgp->update_delay_pending == 0)
+	bgp_update_delay_advertised (bgp);
+    }
   
   /* Best path selection. */
-  bgp_best_selection (bgp, rn, &old_and_new, afi, safi);
+  if (pq->is_selected)
+    {
+      old_and_new = pq->selected;
+      bgp_best_selection_finish (rn, &old_and_new, afi, safi);
+    }
+  else
+    bgp_best_selection (bgp, rn, &old_and_new, afi, safi);
   old_select = old_and_new.old;
   new_select = old_and_new.new;
 
@@ -1610,12 +1804,13 @@ bgp_process_main (struct work_queue *wq, void *data)
       if (! CHECK_FLAG (old_select->flags, BGP_INFO_ATTR_CHANGED))
         {
           if (CHECK_FLAG (old_select->flags, BGP_INFO_IGP_CHANGED) ||
-	      CHECK_FLAG (old_select->flags, BGP_INFO_MULTIPATH_CHG))
+	      CHECK_FLAG (old_select->flags, BGP_INFO_MULTIPATH_CHG) ||
+	      bgp_pic_changed (bgp, old_select, safi))
             bgp_zebra_announce (p, old_select, bgp, safi);
           
 	  UNSET_FLAG (old_select->flags, BGP_INFO_MULTIPATH_CHG);
           UNSET_FLAG (rn->flags, BGP_NODE_PROCESS_SCHEDULED);
-          return WQ_SUCCESS;
+          return;
         }
     }
 
@@ -1633,10 +1828,7 @@ bgp_process_main (struct work_queue *wq, void *data)
 
 
   /* Check each BGP peer. */
-  for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
-    {
-      bgp_process_announce_selected (peer, new_select, rn, afi, safi);
-    }
+  bgp_process_announce_peers (bgp, new_select, rn, afi, safi);
 
   /* FIB update. */
   if ((safi == SAFI_UNICAST || safi == SAFI_MULTICAST) && (! bgp->name &&
@@ -1661,6 +1853,12 @@ bgp_process_main (struct work_queue *wq, void *data)
     bgp_info_reap (rn, old_select);
   
   UNSET_FLAG (rn->flags, BGP_NODE_PROCESS_SCHEDULED);
+}
+
+static wq_item_status
+bgp_process_main (struct work_queue *wq, void *data)
+{
+  bgp_process_main_node (data);
   return WQ_SUCCESS;
 }
 
@@ -1676,6 +1874,114 @@ bgp_processq_del (struct work_queue *wq, void *data)
   XFREE (MTYPE_BGP_PROCESS_QUEUE, pq);
 }
 
+/* In a worker: select the best paths of one AFI/SAFI of a batch. */
+static void
+bgp_process_select_work (void *arg)
+{
+  struct bgp_process_select *select = arg;
+  struct bgp_process_queue *pq;
+
+  for (pq = select->head; pq; pq = pq->next)
+    {
+      if (bgp_mpath_is_configured (pq->bgp, pq->afi, pq->safi))
+	continue;
+      bgp_best_selection_run (pq->bgp, pq->rn, &pq->selected,
+			      pq->afi, pq->safi, 1);
+      pq->is_selected = 1;
+    }
+}
+
+static wq_item_status
+bgp_process_batch_run (struct work_queue *wq, void *data)
+{
+  struct bgp_process_batch *batch = data;
+  struct bgp_process_select *select;
+  struct bgp_process_queue *pq;
+  afi_t afi;
+  safi_t safi;
+
+  /* Nodes scheduled from here on go into a new batch. */
+  if (bm->process_batch == batch)
+    bm->process_batch = NULL;
+
+  if (bm->work_pool)
+    {
+      for (afi = AFI_IP; afi < AFI_MAX; afi++)
+	for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+	  if (batch->select[afi][safi].head)
+	    work_pool_submit (bm->work_pool, bgp_process_select_work, NULL,
+			      &batch->select[afi][safi]);
+
+      for (afi = AFI_IP; afi < AFI_MAX; afi++)
+	for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+	  if (batch->select[afi][safi].head)
+	    work_pool_wait (bm->work_pool, &batch->select[afi][safi]);
+    }
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+      {
+	select = &batch->select[afi][safi];
+	while ((pq = select->head) != NULL)
+	  {
+	    select->head = pq->next;
+	    bgp_process_main_node (pq);
+	    bgp_processq_del (wq, pq);
+	  }
+	select->tail = NULL;
+      }
+  batch->count = 0;
+
+  return WQ_SUCCESS;
+}
+
+static void
+bgp_process_batch_del (struct work_queue *wq, void *data)
+{
+  struct bgp_process_batch *batch = data;
+  struct bgp_process_queue *pq;
+  afi_t afi;
+  safi_t safi;
+
+  if (bm->process_batch == batch)
+    bm->process_batch = NULL;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+      while ((pq = batch->select[afi][safi].head) != NULL)
+	{
+	  batch->select[afi][safi].head = pq->next;
+	  UNSET_FLAG (pq->rn->flags, BGP_NODE_PROCESS_SCHEDULED);
+	  bgp_processq_del (wq, pq);
+	}
+
+  XFREE (MTYPE_BGP_PROCESS_BATCH, batch);
+}
+
+/* Add a node to the batch being filled, starting a new one if need be. */
+static void
+bgp_process_batch_add (struct bgp_process_queue *pq)
+{
+  struct bgp_process_batch *batch = bm->process_batch;
+  struct bgp_process_select *select;
+
+  if (batch == NULL || batch->count >= BGP_PROCESS_BATCH_MAX)
+    {
+      batch = XCALLOC (MTYPE_BGP_PROCESS_BATCH,
+		       sizeof (struct bgp_process_batch));
+      work_queue_add (bm->process_batch_queue, batch);
+      bm->process_batch = batch;
+    }
+
+  select = &batch->select[pq->afi][pq->safi];
+  if (select->tail)
+    select->tail->next = pq;
+  else
+    select->head = pq;
+  select->tail = pq;
+  batch->count++;
+}
+
 static void
 bgp_process_queue_init (void)
 {
@@ -1683,8 +1989,11 @@ bgp_process_queue_init (void)
     = work_queue_new (bm->master, "process_main_queue");
   bm->process_rsclient_queue
     = work_queue_new (bm->master, "process_rsclient_queue");
+  bm->process_batch_queue
+    = work_queue_new (bm->master, "process_batch_queue");
   
-  if ( !(bm->process_main_queue && bm->process_rsclient_queue) )
+  if ( !(bm->process_main_queue && bm->process_rsclient_queue
+         && bm->process_batch_queue) )
     {
       zlog_err ("%s: Failed to allocate work queue", __func__);
       exit (1);
@@ -1699,6 +2008,11 @@ bgp_process_queue_init (void)
   bm->process_rsclient_queue->spec.del_item_data = &bgp_processq_del;
   bm->process_rsclient_queue->spec.max_retries = 0;
   bm->process_rsclient_queue->spec.hold = 50;
+
+  bm->process_batch_queue->spec.workfunc = &bgp_process_batch_run;
+  bm->process_batch_queue->spec.del_item_data = &bgp_process_batch_del;
+  bm->process_batch_queue->spec.max_retries = 0;
+  bm->process_batch_queue->spec.hold = 50;
 }
 
 void
@@ -1722,9 +2036,19 @@ bgp_process (struct bgp *bgp, struct bgp_node *rn, afi_t afi, safi_t safi)
                  prefix2str (&(bgp_node_to_rnode (rn)->p), buf, sizeof(buf)));
       return;
     }
+
+  /* Best path selection is to be run once the tables are in. */
+  if (bgp->update_delay == BGP_UPDATE_DELAY_ACTIVE
+      && bgp_node_table (rn)->type == BGP_TABLE_MAIN
+      && (safi == SAFI_UNICAST || safi == SAFI_MULTICAST))
+    {
+      bgp->update_delay_deferred++;
+      return;
+    }
   
   if ( (bm->process_main_queue == NULL) ||
-       (bm->process_rsclient_queue == NULL) )
+       (bm->process_rsclient_queue == NULL) ||
+       (bm->process_batch_queue == NULL) )
     bgp_process_queue_init ();
   
   pqnode = XCALLOC (MTYPE_BGP_PROCESS_QUEUE, 
@@ -1743,7 +2067,10 @@ bgp_process (struct bgp *bgp, struct bgp_node *rn, afi_t afi, safi_t safi)
   switch (bgp_node_table (rn)->type)
     {
       case BGP_TABLE_MAIN:
-        work_queue_add (bm->process_main_queue, pqnode);
+        if (bm->work_pool)
+          bgp_process_batch_add (pqnode);
+        else
+          work_queue_add (bm->process_main_queue, pqnode);
         break;
       case BGP_TABLE_RSCLIENT:
         work_queue_add (bm->process_rsclient_queue, pqnode);
@@ -1754,6 +2081,189 @@ bgp_process (struct bgp *bgp, struct bgp_node *rn, afi_t afi, safi_t safi)
   return;
 }
 
+/*
+ * BGP update delay.
+ *
+ * For "bgp update-delay" given at startup, best path selection in the
+ * unicast and multicast tables is deferred until the peers have sent
+ * their tables: an End-of-RIB marker for each of these address
+ * families, or a KEEPALIVE after the session came up if the peer does
+ * not do graceful restart, which End-of-RIB is part of.  Then the nodes
+ * are processed once each, rather than once for every path learnt, and
+ * the routes are advertised to the peers and zebra.
+ *
+ * All the peers are waited for, or only the ones established by the
+ * time the establish-wait timer expires if that is set.  The delay ends
+ * regardless when the update-delay timer expires.
+ *
+ * End-of-RIB markers for these address families are held until the
+ * routes have been advertised, as a peer takes them to mean it has the
+ * whole table.  Two routers with an update delay thus wait for each
+ * other, until the first of the update-delay timers expires.
+ */
+static int bgp_update_delay_timer (struct thread *);
+static int bgp_establish_wait_timer (struct thread *);
+
+void
+bgp_update_delay_start (struct bgp *bgp)
+{
+  bgp->update_delay = BGP_UPDATE_DELAY_ACTIVE;
+  bgp->update_delay_begin = bgp_clock ();
+  bgp->update_delay_end = 0;
+  bgp->update_delay_reason = NULL;
+  bgp->update_delay_deferred = 0;
+  bgp->update_delay_nodes = 0;
+
+  THREAD_TIMER_ON (bm->master, bgp->t_update_delay, bgp_update_delay_timer,
+		   bgp, bgp->v_update_delay);
+  if (bgp->v_establish_wait)
+    THREAD_TIMER_ON (bm->master, bgp->t_establish_wait,
+		     bgp_establish_wait_timer, bgp, bgp->v_establish_wait);
+
+  zlog_info ("BGP update delay of %u seconds started", bgp->v_update_delay);
+}
+
+/* Process all the nodes deferred, once each. */
+void
+bgp_update_delay_end (struct bgp *bgp, const char *reason)
+{
+  struct bgp_node *rn;
+  afi_t afi;
+  safi_t safi;
+
+  if (bgp->update_delay != BGP_UPDATE_DELAY_ACTIVE)
+    return;
+
+  THREAD_TIMER_OFF (bgp->t_update_delay);
+  THREAD_TIMER_OFF (bgp->t_establish_wait);
+
+  bgp->update_delay = BGP_UPDATE_DELAY_ADVERTISING;
+  bgp->update_delay_end = bgp_clock ();
+  bgp->update_delay_reason = reason;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi <= SAFI_MULTICAST; safi++)
+      for (rn = bgp_table_top (bgp->rib[afi][safi]); rn;
+	   rn = bgp_route_next (rn))
+	if (rn->info)
+	  {
+	    SET_FLAG (rn->flags, BGP_NODE_UPDATE_DELAY);
+	    bgp_process (bgp, rn, afi, safi);
+	    bgp->update_delay_nodes++;
+	  }
+
+  zlog_info ("BGP update delay over after %ld seconds, %s: %lu updates "
+	     "deferred, %lu routes to process",
+	     (long) (bgp->update_delay_end - bgp->update_delay_begin),
+	     reason, bgp->update_delay_deferred, bgp->update_delay_nodes);
+
+  bgp->update_delay_pending = bgp->update_delay_nodes;
+  if (! bgp->update_delay_pending)
+    bgp_update_delay_advertised (bgp);
+}
+
+/* The nodes deferred are all processed, their routes are in the peers'
+   Adj-RIBs-Out: End-of-RIB can follow them. */
+static void
+bgp_update_delay_advertised (struct bgp *bgp)
+{
+  struct listnode *node;
+  struct peer *peer;
+
+  bgp->update_delay = BGP_UPDATE_DELAY_NONE;
+
+  for (ALL_LIST_ELEMENTS_RO (bgp->peer, node, peer))
+    if (peer->status == Established)
+      BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
+}
+
+/* Whether End-of-RIB is to wait for the routes of the update delay:
+   until they are all selected, and then until the route advertisement
+   timer has run since the delay ended, for the updates queued to go
+   before End-of-RIB. */
+int
+bgp_update_delay_eor_held (struct peer *peer, safi_t safi)
+{
+  struct bgp *bgp = peer->bgp;
+
+  if (safi != SAFI_UNICAST && safi != SAFI_MULTICAST)
+    return 0;
+  if (bgp->update_delay != BGP_UPDATE_DELAY_NONE)
+    return 1;
+  return bgp->update_delay_end && peer->synctime <= bgp->update_delay_end;
+}
+
+/* End the delay if no peer that counts is still sending its table. */
+static void
+bgp_update_delay_check (struct bgp *bgp)
+{
+  struct listnode *node;
+  struct peer *peer;
+
+  if (bgp->update_delay != BGP_UPDATE_DELAY_ACTIVE)
+    return;
+
+  for (ALL_LIST_ELEMENTS_RO (bgp->peer, node, peer))
+    {
+      if (CHECK_FLAG (peer->sflags, PEER_STATUS_UPDATE_DELAY_DONE)
+	  || CHECK_FLAG (peer->flags, PEER_FLAG_SHUTDOWN))
+	continue;
+      if (bgp->v_establish_wait && ! bgp->t_establish_wait
+	  && peer->status != Established)
+	continue;
+      return;
+    }
+
+  bgp_update_delay_end (bgp, "all peers done");
+}
+
+/* An End-of-RIB or KEEPALIVE was received from an established peer:
+   see whether it has sent its table now. */
+void
+bgp_update_delay_peer_check (struct peer *peer)
+{
+  afi_t afi;
+  safi_t safi;
+
+  if (peer->bgp->update_delay != BGP_UPDATE_DELAY_ACTIVE
+      || CHECK_FLAG (peer->sflags, PEER_STATUS_UPDATE_DELAY_DONE))
+    return;
+
+  if (CHECK_FLAG (peer->cap, PEER_CAP_RESTART_RCV))
+    for (afi = AFI_IP; afi < AFI_MAX; afi++)
+      for (safi = SAFI_UNICAST; safi <= SAFI_MULTICAST; safi++)
+	if (peer->afc_nego[afi][safi]
+	    && ! CHECK_FLAG (peer->af_sflags[afi][safi],
+			     PEER_STATUS_EOR_RECEIVED))
+	  return;
+
+  SET_FLAG (peer->sflags, PEER_STATUS_UPDATE_DELAY_DONE);
+  if (BGP_DEBUG (events, EVENTS))
+    zlog_debug ("%s: table received, for the update delay", peer->host);
+
+  bgp_update_delay_check (peer->bgp);
+}
+
+static int
+bgp_update_delay_timer (struct thread *thread)
+{
+  struct bgp *bgp = THREAD_ARG (thread);
+
+  bgp->t_update_delay = NULL;
+  bgp_update_delay_end (bgp, "timer expired");
+  return 0;
+}
+
+static int
+bgp_establish_wait_timer (struct thread *thread)
+{
+  struct bgp *bgp = THREAD_ARG (thread);
+
+  bgp->t_establish_wait = NULL;
+  bgp_update_delay_check (bgp);
+  return 0;
+}
+
 static int
 bgp_maximum_prefix_restart_timer (struct thread *thread)
 {
@@ -2975,6 +3485,8 @@ bgp_clear_route_table (struct peer *peer, afi_t afi, safi_t safi,
             bgp_unlock_node (rn);
             break;
           }
+      if (rn->adj_shared)
+        bgp_adj_out_shared_remove (rn, peer, afi, safi);
 
       for (ri = rn->info; ri; ri = ri->next)
         if (ri->peer == peer || purpose == BGP_CLEAR_ROUTE_MY_RSCLIENT)
@@ -3123,6 +3635,7 @@ bgp_process_queues_drain_immediate(void)
 {
   bgp_drain_workqueue_immediate(bm->process_main_queue);
   bgp_drain_workqueue_immediate(bm->process_rsclient_queue);
+  bgp_drain_workqueue_immediate(bm->process_batch_queue);
 }
 
 void
@@ -13495,6 +14008,7 @@ show_adj_route (struct vty *vty, struct peer *peer, afi_t afi, safi_t safi,
   struct bgp_table *table;
   struct bgp_adj_in *ain;
   struct bgp_adj_out *adj;
+  struct attr *attr;
   unsigned long output_count;
   struct bgp_node *rn;
   int header1 = 1;
@@ -13551,25 +14065,31 @@ show_adj_route (struct vty *vty, struct peer *peer, afi_t afi, safi_t safi,
       {
 	for (adj = rn->adj_out; adj; adj = adj->next)
 	  if (adj->peer == peer)
-	    {
-	      if (header1)
-		{
-		  vty_out (vty, "BGP table version is 0, local router ID is %s%s", inet_ntoa (bgp->router_id), VTY_NEWLINE);
-		  vty_out (vty, BGP_SHOW_SCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
-		  vty_out (vty, BGP_SHOW_OCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
-		  header1 = 0;
-		}
-	      if (header2)
-		{
-		  vty_out (vty, BGP_SHOW_HEADER, VTY_NEWLINE);
-		  header2 = 0;
-		}
-	      if (adj->attr)
-		{	
-		  route_vty_out_tmp (vty, &rn->p, adj->attr, safi);
-		  output_count++;
-		}
-	    }
+	    break;
+
+	/* Or what it shares with the other members of its update group. */
+	if (adj)
+	  attr = adj->attr;
+	else if ((attr = bgp_adj_out_shared_attr (rn, peer, afi, safi)) == NULL)
+	  continue;
+
+	if (header1)
+	  {
+	    vty_out (vty, "BGP table version is 0, local router ID is %s%s", inet_ntoa (bgp->router_id), VTY_NEWLINE);
+	    vty_out (vty, BGP_SHOW_SCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
+	    vty_out (vty, BGP_SHOW_OCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
+	    header1 = 0;
+	  }
+	if (header2)
+	  {
+	    vty_out (vty, BGP_SHOW_HEADER, VTY_NEWLINE);
+	    header2 = 0;
+	  }
+	if (attr)
+	  {
+	    route_vty_out_tmp (vty, &rn->p, attr, safi);
+	    output_count++;
+	  }
       }
   
   if (output_count != 0)
@@ -30,6 +30,8 @@ struct bgp_nexthop_cache;
  * used for uncommonly used data (aggregation, MPLS, etc.)
  * and lazily allocated to save memory.
  */
+struct bgp_pic;
+
 struct bgp_info_extra
 {
   /* Pointer to dampening structure.  */
@@ -43,6 +45,9 @@ struct bgp_info_extra
 
   /* MPLS label.  */
   u_char tag[3];  
+
+  /* PIC nexthop group the route is installed in zebra with. */
+  struct bgp_pic *pic;
 };
 
 struct bgp_info
@@ -216,6 +221,9 @@ extern struct bgp_info *bgp_info_unlock (struct bgp_info *);
 extern void bgp_info_add (struct bgp_node *rn, struct bgp_info *ri);
 extern void bgp_info_delete (struct bgp_node *rn, struct bgp_info *ri);
 extern struct bgp_info_extra *bgp_info_extra_get (struct bgp_info *);
+extern struct bgp_info *bgp_backup_selection (struct bgp *, struct bgp_node *,
+					      struct bgp_info *,
+					      afi_t, safi_t);
 extern void bgp_info_set_flag (struct bgp_node *, struct bgp_info *, u_int32_t);
 extern void bgp_info_unset_flag (struct bgp_node *, struct bgp_info *, u_int32_t);
 
@@ -249,6 +257,10 @@ extern int bgp_withdraw (struct peer *, struct prefix *, struct attr *,
 
 /* for bgp_nexthop and bgp_damp */
 extern void bgp_process (struct bgp *, struct bgp_node *, afi_t, safi_t);
+extern void bgp_update_delay_start (struct bgp *);
+extern void bgp_update_delay_end (struct bgp *, const char *);
+extern void bgp_update_delay_peer_check (struct peer *);
+extern int bgp_update_delay_eor_held (struct peer *, safi_t);
 extern int bgp_config_write_network (struct vty *, struct bgp *, afi_t, safi_t, int *);
 extern int bgp_config_write_distance (struct vty *, struct bgp *, afi_t, safi_t, int *);
 
@@ -39,6 +39,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #endif /* HAVE_LIBPCREPOSIX */
 #include "buffer.h"
 #include "sockunion.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -2696,6 +2698,109 @@ bgp_route_set_delete (struct vty *vty, struct route_map_index *index,
   return CMD_SUCCESS;
 }
 
+/* Rules of an outbound route map whose outcome depends on the peer the
+   route is sent to, rather than on the route alone. */
+static const struct
+{
+  struct route_map_rule_cmd *cmd;
+  const char *arg;
+} bgp_route_map_peer_rules[] =
+{
+  { &route_match_peer_cmd, NULL },
+  { &route_match_ip_route_source_cmd, NULL },
+  { &route_match_ip_route_source_prefix_list_cmd, NULL },
+  { &route_set_ip_nexthop_cmd, "peer-address" },
+  { &route_set_ipv6_nexthop_peer_cmd, NULL },
+  { &route_set_metric_cmd, "rtt" },
+};
+
+/* What bgp_route_map_peer_dependent() found, until route maps change. */
+struct bgp_route_map_peer
+{
+  struct route_map *map;
+  int dependent;
+};
+
+static struct hash *bgp_route_map_peer_hash;
+
+static unsigned int
+bgp_route_map_peer_key (void *arg)
+{
+  struct bgp_route_map_peer *rp = arg;
+
+  return jhash (&rp->map, sizeof (rp->map), 0);
+}
+
+static int
+bgp_route_map_peer_cmp (const void *arg1, const void *arg2)
+{
+  const struct bgp_route_map_peer *rp1 = arg1;
+  const struct bgp_route_map_peer *rp2 = arg2;
+
+  return rp1->map == rp2->map;
+}
+
+static void *
+bgp_route_map_peer_alloc (void *arg)
+{
+  struct bgp_route_map_peer *lookup = arg;
+  struct bgp_route_map_peer *rp;
+  unsigned int i;
+
+  rp = XCALLOC (MTYPE_BGP_UPDGRP_RMAP, sizeof (struct bgp_route_map_peer));
+  rp->map = lookup->map;
+  for (i = 0; i < array_size (bgp_route_map_peer_rules); i++)
+    if (route_map_has_rule (rp->map, bgp_route_map_peer_rules[i].cmd,
+			    bgp_route_map_peer_rules[i].arg))
+      {
+	rp->dependent = 1;
+	break;
+      }
+  return rp;
+}
+
+static void
+bgp_route_map_peer_free (void *arg)
+{
+  XFREE (MTYPE_BGP_UPDGRP_RMAP, arg);
+}
+
+/* Would the route map, applied to the routes sent to a peer, treat them
+   differently for another peer with the same configuration?  Such peers
+   cannot be sent the same UPDATEs, see bgp_updgrp.c. */
+int
+bgp_route_map_peer_dependent (struct route_map *map)
+{
+  struct bgp_route_map_peer lookup, *rp;
+
+  if (map == NULL)
+    return 0;
+
+  if (! bgp_route_map_peer_hash)
+    bgp_route_map_peer_hash = hash_create (bgp_route_map_peer_key,
+					   bgp_route_map_peer_cmp);
+
+  lookup.map = map;
+  rp = hash_get (bgp_route_map_peer_hash, &lookup, bgp_route_map_peer_alloc);
+  return rp->dependent;
+}
+
+/* Route maps changed: a map may have been freed, or another one made
+   at its address. */
+static void
+bgp_route_map_peer_flush (void)
+{
+  if (bgp_route_map_peer_hash)
+    hash_clean (bgp_route_map_peer_hash, bgp_route_map_peer_free);
+}
+
+/* Hook function for changes to the rules of route maps. */
+static void
+bgp_route_map_event (route_map_event_t event, const char *name)
+{
+  bgp_route_map_peer_flush ();
+}
+
 /* Hook function for updating route_map assignment. */
 static void
 bgp_route_map_update (const char *unused)
@@ -2713,6 +2818,8 @@ bgp_route_map_update (const char *unused)
   struct bgp_node *bn;
   struct bgp_static *bgp_static;
 
+  bgp_route_map_peer_flush ();
+
   if (bm->bgp == NULL)          /* may be called during cleanup */
     return;
 
@@ -4503,6 +4610,7 @@ bgp_route_map_init (void)
   route_map_init_vty ();
   route_map_add_hook (bgp_route_map_update);
   route_map_delete_hook (bgp_route_map_update);
+  route_map_event_hook (bgp_route_map_event);
 
   route_map_install_match (&route_match_peer_cmd);
   route_map_install_match (&route_match_local_pref_cmd);
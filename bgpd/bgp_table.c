@@ -97,7 +97,8 @@ bgp_node_destroy (route_table_delegate_t *delegate,
  */
 route_table_delegate_t bgp_table_delegate = {
   .create_node = bgp_node_create,
-  .destroy_node = bgp_node_destroy
+  .destroy_node = bgp_node_destroy,
+  .lookup_index = 1
 };
 
 /*
@@ -57,15 +57,19 @@ struct bgp_node
    */
   ROUTE_NODE_FIELDS
 
+  /* Kept next to the lock, in what would otherwise be padding. */
+  u_char flags;
+#define BGP_NODE_PROCESS_SCHEDULED	(1 << 0)
+#define BGP_NODE_USER_CLEAR             (1 << 1)
+#define BGP_NODE_UPDATE_DELAY           (1 << 2) /* see bgp_update_delay_end() */
+
   struct bgp_adj_out *adj_out;
 
+  struct bgp_adj_shared *adj_shared;
+
   struct bgp_adj_in *adj_in;
 
   struct bgp_node *prn;
-
-  u_char flags;
-#define BGP_NODE_PROCESS_SCHEDULED	(1 << 0)
-#define BGP_NODE_USER_CLEAR             (1 << 1)
 };
 
 /*
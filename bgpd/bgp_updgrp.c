@@ -0,0 +1,545 @@
+/* BGP update groups
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "prefix.h"
+#include "linklist.h"
+#include "memory.h"
+#include "stream.h"
+#include "jhash.h"
+#include "hash.h"
+#include "filter.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_updgrp.h"
+
+static u_int32_t update_group_id;
+
+/* Routes of the packet being built, see update_group_packet_add(). */
+static struct
+{
+  struct bgp_node *rn;
+  struct bgp_info *binfo;
+} *building;
+static unsigned int building_count;
+static unsigned int building_size;
+static int building_on;
+
+/* Peer specific inputs to the announce check and packet encoding,
+ * that rule out sharing either with other peers. */
+static int
+update_group_eligible (struct peer *peer, afi_t afi, safi_t safi)
+{
+  /* Prefix list the peer sent us by ORF. */
+  if (peer->orf_plist[afi][safi])
+    return 0;
+
+  /* Route server clients are served from tables of their own. */
+  if (CHECK_FLAG (peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT))
+    return 0;
+
+  /* For EBGP, whether the next hop is kept depends on the subnet of
+   * the peer's own address, see bgp_multiaccess_check_v4(). */
+  if (peer->sort == BGP_PEER_EBGP
+      && ! CHECK_FLAG (peer->af_flags[afi][safi], PEER_FLAG_NEXTHOP_SELF))
+    return 0;
+
+  /* Outbound or unsuppress map rules such as "match peer" or "set ip
+   * next-hop peer-address", which are applied for the representative
+   * only. */
+  if (bgp_route_map_peer_dependent (peer->filter[afi][safi].map[RMAP_OUT].map)
+      || bgp_route_map_peer_dependent (peer->filter[afi][safi].usmap.map))
+    return 0;
+
+  return 1;
+}
+
+static unsigned int
+update_group_hash_name (const char *name, unsigned int key)
+{
+  return name ? jhash_1word (string_hash_make (name), key) : key;
+}
+
+static unsigned int
+update_group_hash (struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct bgp_filter *filter = &peer->filter[afi][safi];
+  unsigned int key;
+
+  key = jhash_3words (peer->sort, peer->as, peer->local_as, 0);
+  key = jhash_3words (peer->change_local_as, peer->flags,
+		      peer->af_flags[afi][safi], key);
+  key = jhash_1word (peer->nexthop.v4.s_addr, key);
+  key = update_group_hash_name (ROUTE_MAP_OUT_NAME (filter), key);
+  return key;
+}
+
+static int
+update_group_name_same (const char *a, const char *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+  return strcmp (a, b) == 0;
+}
+
+/* Would the two peers be sent the same thing, route by route? */
+static int
+update_group_policy_same (struct peer *a, struct peer *b,
+			  afi_t afi, safi_t safi)
+{
+  struct bgp_filter *fa = &a->filter[afi][safi];
+  struct bgp_filter *fb = &b->filter[afi][safi];
+
+  if (a == b)
+    return 1;
+
+  if (a->bgp != b->bgp
+      || a->sort != b->sort
+      || a->as != b->as
+      || a->local_as != b->local_as
+      || a->change_local_as != b->change_local_as
+      || a->flags != b->flags
+      || a->af_flags[afi][safi] != b->af_flags[afi][safi]
+      || CHECK_FLAG (a->af_sflags[afi][safi] ^ b->af_sflags[afi][safi],
+		     PEER_STATUS_DEFAULT_ORIGINATE)
+      || CHECK_FLAG (a->cap ^ b->cap, PEER_CAP_AS4_RCV)
+      || a->shared_network != b->shared_network)
+    return 0;
+
+  if (! IPV4_ADDR_SAME (&a->nexthop.v4, &b->nexthop.v4)
+      || ! IPV6_ADDR_SAME (&a->nexthop.v6_global, &b->nexthop.v6_global)
+      || ! IPV6_ADDR_SAME (&a->nexthop.v6_local, &b->nexthop.v6_local))
+    return 0;
+
+  return update_group_name_same (fa->dlist[FILTER_OUT].name,
+				 fb->dlist[FILTER_OUT].name)
+    && update_group_name_same (fa->plist[FILTER_OUT].name,
+			       fb->plist[FILTER_OUT].name)
+    && update_group_name_same (fa->aslist[FILTER_OUT].name,
+			       fb->aslist[FILTER_OUT].name)
+    && update_group_name_same (fa->map[RMAP_OUT].name,
+			       fb->map[RMAP_OUT].name)
+    && update_group_name_same (fa->usmap.name, fb->usmap.name);
+}
+
+static void
+update_packet_free (struct update_packet *up)
+{
+  unsigned int i;
+
+  for (i = 0; i < up->count; i++)
+    {
+      bgp_unlock_node (up->nlri[i].rn);
+      if (up->nlri[i].binfo)
+	bgp_info_unlock (up->nlri[i].binfo);
+    }
+  bgp_attr_unintern (&up->attr);
+  stream_free (up->packet);
+  XFREE (MTYPE_BGP_UPDGRP_PACKET, up);
+}
+
+static void
+update_packet_unlink (struct update_group *group, struct update_packet *up)
+{
+  struct update_packet **upp;
+
+  for (upp = &group->packets; *upp; upp = &(*upp)->next)
+    if (*upp == up)
+      {
+	*upp = up->next;
+	break;
+      }
+  if (group->packets_tail == up)
+    {
+      struct update_packet *last = group->packets;
+
+      while (last && last->next)
+	last = last->next;
+      group->packets_tail = last;
+    }
+  group->npackets--;
+  update_packet_free (up);
+}
+
+static struct update_group *
+update_group_new (struct peer *peer, afi_t afi, safi_t safi,
+		  unsigned int hash)
+{
+  struct update_group *group;
+
+  group = XCALLOC (MTYPE_BGP_UPDGRP, sizeof (struct update_group));
+  group->id = ++update_group_id;
+  group->bgp = peer->bgp;
+  group->afi = afi;
+  group->safi = safi;
+  group->peers = list_new ();
+  group->rep = peer;
+  group->hash = hash;
+  group->uptime = bgp_clock ();
+
+  if (peer->bgp->update_groups[afi][safi] == NULL)
+    peer->bgp->update_groups[afi][safi] = list_new ();
+  listnode_add (peer->bgp->update_groups[afi][safi], group);
+  return group;
+}
+
+static void
+update_group_free (struct update_group *group)
+{
+  while (group->packets)
+    update_packet_unlink (group, group->packets);
+
+  listnode_delete (group->bgp->update_groups[group->afi][group->safi], group);
+  list_delete (group->peers);
+  if (group->slots)
+    XFREE (MTYPE_BGP_UPDGRP, group->slots);
+  XFREE (MTYPE_BGP_UPDGRP, group);
+}
+
+static void
+update_group_join (struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct list *groups = peer->bgp->update_groups[afi][safi];
+  struct update_group *group = NULL;
+  struct update_group *match = NULL;
+  struct listnode *node;
+  unsigned int hash;
+  unsigned int slot;
+
+  hash = update_group_hash (peer, afi, safi);
+
+  if (groups)
+    for (ALL_LIST_ELEMENTS_RO (groups, node, group))
+      if (group->hash == hash
+	  && update_group_policy_same (peer, group->rep, afi, safi))
+	{
+	  match = group;
+	  break;
+	}
+
+  group = match ? match : update_group_new (peer, afi, safi, hash);
+
+  for (slot = 0; slot < group->nslots; slot++)
+    if (group->slots[slot] == NULL)
+      break;
+  if (slot == group->nslots)
+    {
+      group->nslots = group->nslots ? group->nslots * 2 : 32;
+      group->slots = XREALLOC (MTYPE_BGP_UPDGRP, group->slots,
+			       group->nslots * sizeof (struct peer *));
+      memset (group->slots + slot, 0,
+	      (group->nslots - slot) * sizeof (struct peer *));
+    }
+  group->slots[slot] = peer;
+
+  listnode_add (group->peers, peer_lock (peer)); /* group member reference */
+  peer->updgrp[afi][safi] = group;
+  peer->updgrp_slot[afi][safi] = slot;
+  group->joins++;
+}
+
+/* Take the member out of the Adj-RIB-Out entries it shares, giving it
+ * adjacencies of its own back if 'keep', as its slot may be reused.
+ *
+ * The entries a member shares are not indexed by member, which would
+ * take about the memory sharing saves: the table is walked instead, up
+ * to the last node the member shares an entry of.  That is once for
+ * a member leaving its group, on a policy change or the session going
+ * down, either of which has the table walked for the peer anyway, to
+ * announce its routes anew or clear those it sent. */
+static void
+update_group_unshare (struct peer *peer, afi_t afi, safi_t safi, int keep)
+{
+  struct bgp_node *rn;
+
+  for (rn = bgp_table_top (peer->bgp->rib[afi][safi]);
+       rn && peer->adj_shared[afi][safi]; rn = bgp_route_next (rn))
+    if (rn->adj_shared)
+      {
+	if (keep)
+	  bgp_adj_out_unshare (rn, peer, afi, safi);
+	else
+	  bgp_adj_out_shared_remove (rn, peer, afi, safi);
+      }
+  if (rn)
+    bgp_unlock_node (rn);
+}
+
+static void
+update_group_remove (struct peer *peer, afi_t afi, safi_t safi, int keep)
+{
+  struct update_group *group = peer->updgrp[afi][safi];
+
+  if (group == NULL)
+    return;
+
+  if (peer->adj_shared[afi][safi])
+    update_group_unshare (peer, afi, safi, keep);
+
+  group->slots[peer->updgrp_slot[afi][safi]] = NULL;
+  peer->updgrp[afi][safi] = NULL;
+  listnode_delete (group->peers, peer);
+
+  if (listcount (group->peers) == 0)
+    update_group_free (group);
+  else if (group->rep == peer)
+    group->rep = listgetdata (listhead (group->peers));
+
+  peer_unlock (peer); /* group member reference */
+}
+
+/* The peer leaves its group, keeping what it was sent if it is still
+ * established. */
+void
+update_group_leave (struct peer *peer, afi_t afi, safi_t safi)
+{
+  update_group_remove (peer, afi, safi, peer->status == Established);
+}
+
+/* The peer is going down, its Adj-RIB-Out with it. */
+void
+update_group_leave_all (struct peer *peer)
+{
+  afi_t afi;
+  safi_t safi;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+      update_group_remove (peer, afi, safi, 0);
+}
+
+/*
+ * The update group of an established peer, moving it to another one
+ * first if its policy changed since it joined.  NULL if the peer is
+ * not to share anything with others.
+ */
+struct update_group *
+update_group_get (struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct update_group *group = peer->updgrp[afi][safi];
+
+  if (peer->status != Established
+      || ! update_group_eligible (peer, afi, safi))
+    {
+      update_group_leave (peer, afi, safi);
+      return NULL;
+    }
+
+  if (group)
+    {
+      if (peer == group->rep
+	  ? group->hash == update_group_hash (peer, afi, safi)
+	  : update_group_policy_same (peer, group->rep, afi, safi))
+	return group;
+      update_group_leave (peer, afi, safi);
+    }
+
+  update_group_join (peer, afi, safi);
+  return peer->updgrp[afi][safi];
+}
+
+/* Is there anyone in the group to share packets with? */
+static int
+update_group_sharing (struct update_group *group)
+{
+  return group != NULL && listcount (group->peers) > 1;
+}
+
+/* Start recording the routes of an UPDATE about to be built by a
+ * member of the group, NULL if the peer is in none. */
+void
+update_group_packet_start (struct update_group *group)
+{
+  building_count = 0;
+  building_on = update_group_sharing (group);
+}
+
+void
+update_group_packet_add (struct bgp_node *rn, struct bgp_info *binfo)
+{
+  if (! building_on)
+    return;
+
+  if (building_count == building_size)
+    {
+      building_size = building_size ? building_size * 2 : 256;
+      building = XREALLOC (MTYPE_BGP_UPDGRP_PACKET, building,
+			   building_size * sizeof (*building));
+    }
+  building[building_count].rn = rn;
+  building[building_count].binfo = binfo;
+  building_count++;
+}
+
+/* Keep the UPDATE just built for the other members of the group. */
+void
+update_group_packet_end (struct update_group *group, struct attr *attr,
+			 struct stream *packet)
+{
+  struct update_packet *up;
+  unsigned int i;
+
+  if (! building_on || building_count == 0)
+    return;
+  building_on = 0;
+
+  up = XCALLOC (MTYPE_BGP_UPDGRP_PACKET,
+		sizeof (struct update_packet)
+		+ building_count * sizeof (up->nlri[0]));
+  up->packet = stream_share (packet);
+  up->attr = bgp_attr_intern (attr);
+  up->pending = listcount (group->peers) - 1;
+  up->count = building_count;
+  for (i = 0; i < building_count; i++)
+    {
+      up->nlri[i].rn = bgp_lock_node (building[i].rn);
+      up->nlri[i].binfo = building[i].binfo
+			  ? bgp_info_lock (building[i].binfo) : NULL;
+    }
+
+  if (group->packets_tail)
+    group->packets_tail->next = up;
+  else
+    group->packets = up;
+  group->packets_tail = up;
+  group->packets_built++;
+
+  if (++group->npackets > UPDATE_GROUP_PACKETS_MAX)
+    update_packet_unlink (group, group->packets);
+}
+
+/*
+ * A packet built for another member, that the peer can send as is to
+ * announce the routes at the head of its update FIFO.  That is, one
+ * whose routes, with the same attribute and the same paths, are the
+ * first ones bgp_update_packet() would take from the FIFO.
+ */
+struct update_packet *
+update_group_packet_find (struct update_group *group,
+			  struct bgp_advertise *head)
+{
+  struct update_packet *up;
+
+  if (! update_group_sharing (group) || head == NULL || head->baa == NULL)
+    return NULL;
+
+  for (up = group->packets; up; up = up->next)
+    {
+      struct bgp_advertise *adv;
+      unsigned int i;
+
+      if (up->attr != head->baa->attr
+	  || up->nlri[0].rn != head->rn || up->nlri[0].binfo != head->binfo)
+	continue;
+
+      /* After the head, bgp_update_packet() goes through the other
+       * advertisements of the same attribute, in list order. */
+      i = 1;
+      for (adv = head->baa->adv; adv && i < up->count; adv = adv->next)
+	{
+	  if (adv == head)
+	    continue;
+	  if (adv->rn != up->nlri[i].rn || adv->binfo != up->nlri[i].binfo)
+	    break;
+	  i++;
+	}
+      if (i == up->count)
+	return up;
+    }
+  return NULL;
+}
+
+/* A member sent the packet, drop it once all of them probably have. */
+void
+update_group_packet_sent (struct update_group *group,
+			  struct update_packet *up)
+{
+  group->packets_shared++;
+  if (up->pending)
+    up->pending--;
+  if (up->pending == 0)
+    update_packet_unlink (group, up);
+}
+
+static void
+update_group_show (struct vty *vty, struct update_group *group)
+{
+  char timebuf[BGP_UPTIME_LEN];
+  struct listnode *node;
+  struct peer *peer;
+
+  vty_out (vty, "Update group %u, %s, created %s%s", group->id,
+	   afi_safi_print (group->afi, group->safi),
+	   peer_uptime (group->uptime, timebuf, BGP_UPTIME_LEN),
+	   VTY_NEWLINE);
+  vty_out (vty, "  Members: %u (%lu joined in total)%s",
+	   listcount (group->peers), group->joins, VTY_NEWLINE);
+  for (ALL_LIST_ELEMENTS_RO (group->peers, node, peer))
+    vty_out (vty, "    %s%s", peer->host, VTY_NEWLINE);
+  vty_out (vty, "  Announce checks: %lu run, %lu shared%s",
+	   group->checks, group->checks_shared, VTY_NEWLINE);
+  vty_out (vty, "  UPDATE packets: %lu built, %lu shared, %u kept%s",
+	   group->packets_built, group->packets_shared, group->npackets,
+	   VTY_NEWLINE);
+  if (group->adj_shared)
+    vty_out (vty, "  Adj-RIB-Out: %lu shared entries for %lu routes%s",
+	     group->adj_shared, group->adj_shared_routes, VTY_NEWLINE);
+}
+
+DEFUN (show_bgp_update_groups,
+       show_bgp_update_groups_cmd,
+       "show bgp update-groups",
+       SHOW_STR
+       BGP_STR
+       "Update groups of peers with identical outbound policy\n")
+{
+  struct listnode *node, *gnode;
+  struct update_group *group;
+  struct bgp *bgp;
+  afi_t afi;
+  safi_t safi;
+
+  for (ALL_LIST_ELEMENTS_RO (bm->bgp, node, bgp))
+    {
+      if (bgp->name)
+	vty_out (vty, "BGP instance %s:%s", bgp->name, VTY_NEWLINE);
+      for (afi = AFI_IP; afi < AFI_MAX; afi++)
+	for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+	  if (bgp->update_groups[afi][safi])
+	    for (ALL_LIST_ELEMENTS_RO (bgp->update_groups[afi][safi],
+				       gnode, group))
+	      update_group_show (vty, group);
+    }
+  return CMD_SUCCESS;
+}
+
+void
+bgp_update_group_init (void)
+{
+  install_element (VIEW_NODE, &show_bgp_update_groups_cmd);
+  install_element (RESTRICTED_NODE, &show_bgp_update_groups_cmd);
+}
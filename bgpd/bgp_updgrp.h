@@ -0,0 +1,140 @@
+/* BGP update groups
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_BGP_UPDGRP_H
+#define _QUAGGA_BGP_UPDGRP_H
+
+struct bgp_advertise;
+
+/*
+ * Update groups.
+ *
+ * Established peers with the same outbound policy and capabilities for
+ * an address family are put in one update group, unless their policy
+ * tells peers apart, say with "match peer" in the outbound route map.
+ * Whatever is sent to one member would be sent to all of them, so:
+ *
+ *  - the announce check for a route is run once per group, rather
+ *    than once per peer, and
+ *
+ *  - an UPDATE built for one member is kept for a while, and sent as
+ *    is to any other member whose advertisement FIFO starts with the
+ *    same routes, sharing the stream data.
+ *
+ * Members that fall behind the others, say during a route refresh,
+ * simply stop finding packets to share and build their own until
+ * they catch up again, so every member keeps its own advertisement
+ * FIFOs.
+ *
+ * With "bgp adj-rib-out share", members also share their Adj-RIB-Out
+ * for the unicast and multicast tables: once a route was sent, a member
+ * that was sent the same attribute as others is only a bit, by its slot
+ * in the group, in an entry shared with them, see bgp_adj_shared.  It
+ * gets an adjacency of its own back when the route is advertised to it
+ * anew, or when it leaves the group while still established.
+ *
+ * Membership is kept up to date lazily, as routes are announced: a
+ * member whose policy no longer matches that of the group leaves it
+ * and looks for another.
+ */
+
+/* UPDATE packets kept per group for other members to share. */
+#define UPDATE_GROUP_PACKETS_MAX 64
+
+/* An UPDATE built for a member, and the routes it carries. */
+struct update_packet
+{
+  struct update_packet *next;
+
+  /* The packet, and the attribute all of its routes share. */
+  struct stream *packet;
+  struct attr *attr;
+
+  /* Members yet to send this, as far as we know. */
+  unsigned int pending;
+
+  /* The routes, in the order they were taken from the FIFO. */
+  unsigned int count;
+  struct
+  {
+    struct bgp_node *rn;
+    struct bgp_info *binfo;
+  } nlri[];
+};
+
+struct update_group
+{
+  u_int32_t id;
+
+  struct bgp *bgp;
+  afi_t afi;
+  safi_t safi;
+
+  /* Members, and the one whose policy the others must match. */
+  struct list *peers;
+  struct peer *rep;
+  unsigned int hash;
+
+  /* Members by slot, NULL for free ones. */
+  struct peer **slots;
+  unsigned int nslots;
+
+  /* Shared Adj-RIB-Out entries, and the routes they stand for. */
+  unsigned long adj_shared;
+  unsigned long adj_shared_routes;
+
+  time_t uptime;
+
+  /* Announce check result for the route being processed. */
+  struct bgp_node *rn;
+  int announce;
+  struct attr attr;
+  struct attr_extra extra;
+  struct update_group *next_checked;
+
+  /* Recently built packets, oldest first. */
+  struct update_packet *packets;
+  struct update_packet *packets_tail;
+  unsigned int npackets;
+
+  /* Statistics. */
+  unsigned long joins;
+  unsigned long checks;
+  unsigned long checks_shared;
+  unsigned long packets_built;
+  unsigned long packets_shared;
+};
+
+extern void bgp_update_group_init (void);
+
+extern struct update_group *update_group_get (struct peer *, afi_t, safi_t);
+extern void update_group_leave (struct peer *, afi_t, safi_t);
+extern void update_group_leave_all (struct peer *);
+
+extern void update_group_packet_start (struct update_group *);
+extern void update_group_packet_add (struct bgp_node *, struct bgp_info *);
+extern void update_group_packet_end (struct update_group *, struct attr *,
+				     struct stream *);
+extern struct update_packet *update_group_packet_find (struct update_group *,
+						       struct bgp_advertise *);
+extern void update_group_packet_sent (struct update_group *,
+				      struct update_packet *);
+
+#endif /* _QUAGGA_BGP_UPDGRP_H */
@@ -45,12 +45,14 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_open.h"
+#include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_regex.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_zebra.h"
 #include "bgpd/bgp_table.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_pic.h"
 
 /* Utility function to get address family from current node.  */
 afi_t
@@ -346,6 +348,74 @@ DEFUN (no_bgp_config_type,
   return CMD_SUCCESS;
 }
 
+DEFUN (bgp_worker_threads,
+       bgp_worker_threads_cmd,
+       "bgp worker-threads <1-64>",
+       BGP_STR
+       "Decode UPDATE messages in worker threads\n"
+       "Number of threads\n")
+{
+  unsigned int nthreads;
+
+  VTY_GET_INTEGER_RANGE ("worker threads", nthreads, argv[0], 1, 64);
+
+  if (bgp_worker_threads_set (nthreads) < 0)
+    {
+      vty_out (vty, "%% Unable to start the worker threads%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_worker_threads,
+       no_bgp_worker_threads_cmd,
+       "no bgp worker-threads",
+       NO_STR
+       BGP_STR
+       "Decode UPDATE messages in worker threads\n")
+{
+  bgp_worker_threads_set (0);
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_bgp_worker_threads,
+       no_bgp_worker_threads_val_cmd,
+       "no bgp worker-threads <1-64>",
+       NO_STR
+       BGP_STR
+       "Decode UPDATE messages in worker threads\n"
+       "Number of threads\n")
+
+DEFUN (bgp_read_quantum,
+       bgp_read_quantum_cmd,
+       "bgp read-quantum <1-100>",
+       BGP_STR
+       "Messages processed per read from a peer\n"
+       "Number of messages\n")
+{
+  VTY_GET_INTEGER_RANGE ("read quantum", bm->read_quantum, argv[0], 1, 100);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_read_quantum,
+       no_bgp_read_quantum_cmd,
+       "no bgp read-quantum",
+       NO_STR
+       BGP_STR
+       "Messages processed per read from a peer\n")
+{
+  bm->read_quantum = BGP_READ_QUANTUM_DEFAULT;
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_bgp_read_quantum,
+       no_bgp_read_quantum_val_cmd,
+       "no bgp read-quantum <1-100>",
+       NO_STR
+       BGP_STR
+       "Messages processed per read from a peer\n"
+       "Number of messages\n")
+
 DEFUN (no_synchronization,
        no_synchronization_cmd,
        "no synchronization",
@@ -994,6 +1064,149 @@ DEFUN (no_bgp_deterministic_med,
   return CMD_SUCCESS;
 }
 
+/* "bgp pic" configuration. */
+DEFUN (bgp_pic,
+       bgp_pic_cmd,
+       "bgp pic",
+       "BGP specific commands\n"
+       "Install routes with a backup path to switch to when their nexthop fails\n")
+{
+  struct bgp *bgp;
+
+  bgp = vty->index;
+  if (! bgp_flag_check (bgp, BGP_FLAG_PIC))
+    {
+      bgp_flag_set (bgp, BGP_FLAG_PIC);
+      bgp_pic_reinstall (bgp);
+    }
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_pic,
+       no_bgp_pic_cmd,
+       "no bgp pic",
+       NO_STR
+       "BGP specific commands\n"
+       "Install routes with a backup path to switch to when their nexthop fails\n")
+{
+  struct bgp *bgp;
+
+  bgp = vty->index;
+  if (bgp_flag_check (bgp, BGP_FLAG_PIC))
+    {
+      bgp_flag_unset (bgp, BGP_FLAG_PIC);
+      bgp_pic_reinstall (bgp);
+    }
+  return CMD_SUCCESS;
+}
+
+/* "bgp adj-rib-out share" configuration. */
+DEFUN (bgp_adj_rib_out_share,
+       bgp_adj_rib_out_share_cmd,
+       "bgp adj-rib-out share",
+       "BGP specific commands\n"
+       "Routes advertised to peers\n"
+       "Share them between update group members sent the same routes\n")
+{
+  struct bgp *bgp;
+
+  bgp = vty->index;
+  bgp_flag_set (bgp, BGP_FLAG_ADJ_OUT_SHARED);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_adj_rib_out_share,
+       no_bgp_adj_rib_out_share_cmd,
+       "no bgp adj-rib-out share",
+       NO_STR
+       "BGP specific commands\n"
+       "Routes advertised to peers\n"
+       "Share them between update group members sent the same routes\n")
+{
+  struct bgp *bgp;
+
+  bgp = vty->index;
+  bgp_flag_unset (bgp, BGP_FLAG_ADJ_OUT_SHARED);
+  return CMD_SUCCESS;
+}
+
+/* "bgp update-delay" configuration. */
+DEFUN (bgp_update_delay,
+       bgp_update_delay_cmd,
+       "bgp update-delay <1-3600>",
+       "BGP specific commands\n"
+       "At startup, defer best path selection until the peers sent their tables\n"
+       "Maximum delay in seconds\n")
+{
+  struct bgp *bgp;
+  u_int16_t delay;
+  u_int16_t wait = 0;
+
+  bgp = vty->index;
+
+  VTY_GET_INTEGER_RANGE ("update delay", delay, argv[0], 1, 3600);
+  if (argc == 2)
+    {
+      VTY_GET_INTEGER_RANGE ("establish wait", wait, argv[1], 1, 3600);
+      if (wait > delay)
+	{
+	  vty_out (vty, "%% Establish wait cannot exceed the update delay%s",
+		   VTY_NEWLINE);
+	  return CMD_WARNING;
+	}
+    }
+
+  bgp->v_update_delay = delay;
+  bgp->v_establish_wait = wait;
+
+  /* Only applies as bgpd starts up. */
+  if (bgp->t_startup && ! bgp->update_delay_begin)
+    bgp_update_delay_start (bgp);
+
+  return CMD_SUCCESS;
+}
+
+ALIAS (bgp_update_delay,
+       bgp_update_delay_establish_wait_cmd,
+       "bgp update-delay <1-3600> <1-3600>",
+       "BGP specific commands\n"
+       "At startup, defer best path selection until the peers sent their tables\n"
+       "Maximum delay in seconds\n"
+       "Seconds to wait for peers to be established, later ones are not waited for\n")
+
+DEFUN (no_bgp_update_delay,
+       no_bgp_update_delay_cmd,
+       "no bgp update-delay",
+       NO_STR
+       "BGP specific commands\n"
+       "At startup, defer best path selection until the peers sent their tables\n")
+{
+  struct bgp *bgp;
+
+  bgp = vty->index;
+  bgp->v_update_delay = 0;
+  bgp->v_establish_wait = 0;
+  bgp_update_delay_end (bgp, "unconfigured");
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_bgp_update_delay,
+       no_bgp_update_delay_val_cmd,
+       "no bgp update-delay <1-3600>",
+       NO_STR
+       "BGP specific commands\n"
+       "At startup, defer best path selection until the peers sent their tables\n"
+       "Maximum delay in seconds\n")
+
+ALIAS (no_bgp_update_delay,
+       no_bgp_update_delay_establish_wait_cmd,
+       "no bgp update-delay <1-3600> <1-3600>",
+       NO_STR
+       "BGP specific commands\n"
+       "At startup, defer best path selection until the peers sent their tables\n"
+       "Maximum delay in seconds\n"
+       "Seconds to wait for peers to be established, later ones are not waited for\n")
+
 /* "bgp graceful-restart" configuration. */
 DEFUN (bgp_graceful_restart,
        bgp_graceful_restart_cmd,
@@ -7361,6 +7574,7 @@ DEFUN (show_bgp_memory,
 {
   char memstrbuf[MTYPE_MEMSTR_LEN];
   unsigned long count;
+  size_t bytes;
   
   /* RIB related usage stats */
   count = mtype_stats_alloc (MTYPE_BGP_NODE);
@@ -7398,6 +7612,17 @@ DEFUN (show_bgp_memory,
                            count * sizeof (struct bgp_adj_out)),
              VTY_NEWLINE);
   
+  /* Shared entries carry a bitmap of the members, as long as their
+     update group is large. */
+  if ((count = mtype_stats_alloc (MTYPE_BGP_ADJ_SHARED)))
+    {
+      if (! (bytes = mtype_stats_bytes (MTYPE_BGP_ADJ_SHARED)))
+        bytes = count * (sizeof (struct bgp_adj_shared) + sizeof (u_int32_t));
+      vty_out (vty, "%ld Shared Adj-Out entries, using %s of memory%s", count,
+               mtype_memstr (memstrbuf, sizeof (memstrbuf), bytes),
+               VTY_NEWLINE);
+    }
+  
   if ((count = mtype_stats_alloc (MTYPE_BGP_NEXTHOP_CACHE)))
     vty_out (vty, "%ld Nexthop cache entries, using %s of memory%s", count,
              mtype_memstr (memstrbuf, sizeof (memstrbuf),
@@ -7551,6 +7776,21 @@ bgp_show_summary (struct vty *vty, struct bgp *bgp, int afi, int safi)
 
               if (CHECK_FLAG (bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING))
                 vty_out (vty, "Dampening enabled.%s", VTY_NEWLINE);
+
+              if (bgp->update_delay == BGP_UPDATE_DELAY_ACTIVE)
+                vty_out (vty, "Update delay in progress for %ld of %u "
+                         "seconds, %lu updates deferred%s",
+                         (long) (bgp_clock () - bgp->update_delay_begin),
+                         bgp->v_update_delay, bgp->update_delay_deferred,
+                         VTY_NEWLINE);
+              else if (bgp->update_delay_end)
+                vty_out (vty, "Update delay over after %ld seconds, %s, "
+                         "%lu updates deferred, %lu routes processed%s",
+                         (long) (bgp->update_delay_end
+                                 - bgp->update_delay_begin),
+                         bgp->update_delay_reason,
+                         bgp->update_delay_deferred,
+                         bgp->update_delay_nodes, VTY_NEWLINE);
               vty_out (vty, "%s", VTY_NEWLINE);
               vty_out (vty, "%s%s", header, VTY_NEWLINE);
             }
@@ -10045,6 +10285,14 @@ bgp_vty_init (void)
   install_element (CONFIG_NODE, &bgp_config_type_cmd);
   install_element (CONFIG_NODE, &no_bgp_config_type_cmd);
 
+  /* "bgp worker-threads" commands. */
+  install_element (CONFIG_NODE, &bgp_worker_threads_cmd);
+  install_element (CONFIG_NODE, &no_bgp_worker_threads_cmd);
+  install_element (CONFIG_NODE, &no_bgp_worker_threads_val_cmd);
+  install_element (CONFIG_NODE, &bgp_read_quantum_cmd);
+  install_element (CONFIG_NODE, &no_bgp_read_quantum_cmd);
+  install_element (CONFIG_NODE, &no_bgp_read_quantum_val_cmd);
+
   /* Dummy commands (Currently not supported) */
   install_element (BGP_NODE, &no_synchronization_cmd);
   install_element (BGP_NODE, &no_auto_summary_cmd);
@@ -10114,6 +10362,21 @@ bgp_vty_init (void)
   install_element (BGP_NODE, &bgp_deterministic_med_cmd);
   install_element (BGP_NODE, &no_bgp_deterministic_med_cmd);
 
+  /* "bgp pic" commands */
+  install_element (BGP_NODE, &bgp_pic_cmd);
+  install_element (BGP_NODE, &no_bgp_pic_cmd);
+
+  /* "bgp adj-rib-out share" commands */
+  install_element (BGP_NODE, &bgp_adj_rib_out_share_cmd);
+  install_element (BGP_NODE, &no_bgp_adj_rib_out_share_cmd);
+
+  /* "bgp update-delay" commands */
+  install_element (BGP_NODE, &bgp_update_delay_cmd);
+  install_element (BGP_NODE, &bgp_update_delay_establish_wait_cmd);
+  install_element (BGP_NODE, &no_bgp_update_delay_cmd);
+  install_element (BGP_NODE, &no_bgp_update_delay_val_cmd);
+  install_element (BGP_NODE, &no_bgp_update_delay_establish_wait_cmd);
+
   /* "bgp graceful-restart" commands */
   install_element (BGP_NODE, &bgp_graceful_restart_cmd);
   install_element (BGP_NODE, &no_bgp_graceful_restart_cmd);
@@ -41,6 +41,7 @@ Boston, MA 02111-1307, USA.  */
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_pic.h"
 
 /* All information about zebra. */
 struct zclient *zclient = NULL;
@@ -728,6 +729,8 @@ bgp_zebra_announce (struct prefix *p, struct bgp_info *info, struct bgp *bgp, sa
     {
       struct zapi_ipv4 api;
       struct in_addr *nexthop;
+      struct in_addr backup;
+      struct bgp_pic *pic = NULL;
 
       /* resize nexthop buffer size if necessary */
       if ((oldsize = stream_get_size (bgp_nexthop_buf)) <
@@ -757,10 +760,22 @@ bgp_zebra_announce (struct prefix *p, struct bgp_info *info, struct bgp *bgp, sa
       api.type = ZEBRA_ROUTE_BGP;
       api.message = 0;
       api.safi = safi;
-      SET_FLAG (api.message, ZAPI_MESSAGE_NEXTHOP);
       api.nexthop_num = nhcount;
       api.nexthop = (struct in_addr **)STREAM_DATA (bgp_nexthop_buf);
       api.ifindex_num = 0;
+
+      /* With a backup path, install it with the group for both. */
+      if (bgp_pic_backup (bgp, info, safi, &backup))
+	pic = bgp_pic_get (&info->attr->nexthop, &backup);
+      bgp_pic_set (info, pic);
+      if (pic)
+	{
+	  SET_FLAG (api.message, ZAPI_MESSAGE_NHG);
+	  api.nhg_id = pic->id;
+	}
+      else
+	SET_FLAG (api.message, ZAPI_MESSAGE_NEXTHOP);
+
       SET_FLAG (api.message, ZAPI_MESSAGE_METRIC);
       api.metric = info->attr->med;
 
@@ -788,14 +803,17 @@ bgp_zebra_announce (struct prefix *p, struct bgp_info *info, struct bgp *bgp, sa
 		     p->prefixlen,
 		     inet_ntop(AF_INET, api.nexthop[0], buf[1], sizeof(buf[1])),
 		     api.metric, api.tag, api.nexthop_num);
+	  if (pic)
+	    zlog_debug("Zebra send: IPv4 route add [backup] %s, group %u",
+		       inet_ntop(AF_INET, &backup, buf[1], sizeof(buf[1])),
+		       pic->id);
 	  for (i = 1; i < api.nexthop_num; i++)
 	    zlog_debug("Zebra send: IPv4 route add [nexthop %d] %s",
 		       i, inet_ntop(AF_INET, api.nexthop[i], buf[1],
 				    sizeof(buf[1])));
 	}
 
-      zapi_ipv4_route (ZEBRA_IPV4_ROUTE_ADD, zclient, 
-                       (struct prefix_ipv4 *) p, &api);
+      zapi_ipv4_route_batch (zclient, (struct prefix_ipv4 *) p, &api);
     }
 
   /* We have to think about a IPv6 link-local address curse. */
@@ -1001,6 +1019,8 @@ bgp_zebra_withdraw (struct prefix *p, struct bgp_info *info, safi_t safi)
     {
       struct zapi_ipv4 api;
 
+      bgp_pic_set (info, NULL);
+
       api.vrf_id = VRF_DEFAULT;
       api.flags = flags;
 
@@ -1177,6 +1197,7 @@ bgp_zebra_connected (struct zclient *zclient)
 {
   zclient_num_connects++;
   zclient_send_requests (zclient, VRF_DEFAULT);
+  bgp_pic_zebra_connected ();
 }
 
 void
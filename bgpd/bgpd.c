@@ -31,6 +31,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "memory.h"
 #include "filter.h"
 #include "routemap.h"
+#include "workpool.h"
 #include "str.h"
 #include "log.h"
 #include "plist.h"
@@ -62,6 +63,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_decode.h"
+#include "bgpd/bgp_pic.h"
 #ifdef HAVE_SNMP
 #include "bgpd/bgp_snmp.h"
 #endif /* HAVE_SNMP */
@@ -114,6 +118,40 @@ bgp_option_unset (int flag)
   return 0;
 }
 
+/* Start, resize or stop the worker threads.  */
+int
+bgp_worker_threads_set (unsigned int nthreads)
+{
+  struct bgp *bgp;
+  struct peer *peer;
+  struct listnode *node, *nnode;
+  struct listnode *mnode, *mnnode;
+
+  if (nthreads == bm->worker_threads)
+    return 0;
+
+  if (bm->work_pool)
+    {
+      /* Nothing may be left waiting for the pool going away. */
+      for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
+	for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
+	  bgp_update_decode_flush (peer);
+
+      work_pool_free (bm->work_pool);
+      bm->work_pool = NULL;
+      bm->worker_threads = 0;
+    }
+
+  if (nthreads)
+    {
+      bm->work_pool = work_pool_new (bm->master, "BGP workers", nthreads);
+      if (! bm->work_pool)
+	return -1;
+      bm->worker_threads = nthreads;
+    }
+  return 0;
+}
+
 int
 bgp_option_check (int flag)
 {
@@ -744,6 +782,7 @@ peer_free (struct peer *peer)
   BGP_READ_OFF (peer->t_read);
   BGP_WRITE_OFF (peer->t_write);
   BGP_EVENT_FLUSH (peer);
+  bgp_update_decode_free (peer);
   
   if (peer->desc)
     {
@@ -872,6 +911,7 @@ peer_new (struct bgp *bgp)
 
   /* Create buffers.  */
   peer->ibuf = stream_new (BGP_MAX_PACKET_SIZE);
+  peer->rbuf = stream_new (BGP_READ_BUFFER_SIZE);
   peer->obuf = stream_fifo_new ();
 
   /* We use a larger buffer for peer->work in the event that:
@@ -1342,6 +1382,12 @@ peer_delete (struct peer *peer)
       peer->ibuf = NULL;
     }
 
+  if (peer->rbuf)
+    {
+      stream_free (peer->rbuf);
+      peer->rbuf = NULL;
+    }
+
   if (peer->obuf)
     {
       stream_fifo_free (peer->obuf);
@@ -2224,6 +2270,8 @@ bgp_delete (struct bgp *bgp)
   SET_FLAG(bgp->flags, BGP_FLAG_DELETING);
 
   THREAD_OFF (bgp->t_startup);
+  THREAD_OFF (bgp->t_update_delay);
+  THREAD_OFF (bgp->t_establish_wait);
 
   for (ALL_LIST_ELEMENTS (bgp->peer, node, next, peer))
     {
@@ -2335,6 +2383,8 @@ bgp_free (struct bgp *bgp)
           bgp_table_finish (&bgp->aggregate[afi][safi]) ;
 	if (bgp->rib[afi][safi])
           bgp_table_finish (&bgp->rib[afi][safi]);
+	if (bgp->update_groups[afi][safi])
+	  list_delete (bgp->update_groups[afi][safi]);
       }
   XFREE (MTYPE_BGP, bgp);
 }
@@ -5336,6 +5386,20 @@ bgp_config_write (struct vty *vty)
       write++;
     }
 
+  /* BGP worker threads. */
+  if (bm->worker_threads)
+    {
+      vty_out (vty, "bgp worker-threads %u%s", bm->worker_threads,
+	       VTY_NEWLINE);
+      write++;
+    }
+
+  if (bm->read_quantum != BGP_READ_QUANTUM_DEFAULT)
+    {
+      vty_out (vty, "bgp read-quantum %u%s", bm->read_quantum, VTY_NEWLINE);
+      write++;
+    }
+
   /* BGP configuration. */
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
@@ -5417,6 +5481,23 @@ bgp_config_write (struct vty *vty)
       if (bgp_flag_check (bgp, BGP_FLAG_DETERMINISTIC_MED))
 	vty_out (vty, " bgp deterministic-med%s", VTY_NEWLINE);
 
+      /* BGP PIC. */
+      if (bgp_flag_check (bgp, BGP_FLAG_PIC))
+	vty_out (vty, " bgp pic%s", VTY_NEWLINE);
+
+      /* BGP adj-rib-out share. */
+      if (bgp_flag_check (bgp, BGP_FLAG_ADJ_OUT_SHARED))
+	vty_out (vty, " bgp adj-rib-out share%s", VTY_NEWLINE);
+
+      /* BGP update-delay. */
+      if (bgp->v_update_delay)
+	{
+	  vty_out (vty, " bgp update-delay %u", bgp->v_update_delay);
+	  if (bgp->v_establish_wait)
+	    vty_out (vty, " %u", bgp->v_establish_wait);
+	  vty_out (vty, "%s", VTY_NEWLINE);
+	}
+
       /* BGP graceful-restart. */
       if (bgp->stalepath_time != BGP_DEFAULT_STALEPATH_TIME)
 	vty_out (vty, " bgp graceful-restart stalepath-time %d%s",
@@ -5533,6 +5614,7 @@ bgp_master_init (void)
   bm->bgp = list_new ();
   bm->listen_sockets = list_new ();
   bm->port = BGP_PORT_DEFAULT;
+  bm->read_quantum = BGP_READ_QUANTUM_DEFAULT;
   bm->master = thread_master_create ();
   bm->start_time = bgp_clock ();
 }
@@ -5556,6 +5638,8 @@ bgp_init (void)
   bgp_debug_init ();
   bgp_dump_init ();
   bgp_route_init ();
+  bgp_update_group_init ();
+  bgp_pic_init ();
   bgp_route_map_init ();
   bgp_address_init ();
   bgp_scan_vty_init();
@@ -5611,4 +5695,9 @@ bgp_terminate (void)
       work_queue_free (bm->process_rsclient_queue);
       bm->process_rsclient_queue = NULL;
     }
+  if (bm->process_batch_queue)
+    {
+      work_queue_free (bm->process_batch_queue);
+      bm->process_batch_queue = NULL;
+    }
 }
@@ -41,6 +41,17 @@ struct bgp_master
   /* work queues */
   struct work_queue *process_main_queue;
   struct work_queue *process_rsclient_queue;
+  struct work_queue *process_batch_queue;
+
+  /* Batch of the process_batch_queue still being filled. */
+  struct bgp_process_batch *process_batch;
+
+  /* Worker threads, "bgp worker-threads", NULL if none. */
+  struct work_pool *work_pool;
+  unsigned int worker_threads;
+
+  /* Messages processed per read from a peer, "bgp read-quantum". */
+  unsigned int read_quantum;
   
   /* Listening sockets */
   struct list *listen_sockets;
@@ -106,6 +117,23 @@ struct bgp
 
   struct thread *t_startup;
 
+  /* BGP update delay, "bgp update-delay": at startup, best path
+     selection is deferred until the peers have sent their tables. */
+  u_int16_t v_update_delay;
+  u_int16_t v_establish_wait;
+  struct thread *t_update_delay;
+  struct thread *t_establish_wait;
+  u_char update_delay;
+#define BGP_UPDATE_DELAY_NONE             0
+#define BGP_UPDATE_DELAY_ACTIVE           1 /* bgp_process() deferred */
+#define BGP_UPDATE_DELAY_ADVERTISING      2 /* deferred nodes queued */
+  time_t update_delay_begin;
+  time_t update_delay_end;
+  const char *update_delay_reason;
+  unsigned long update_delay_deferred;
+  unsigned long update_delay_nodes;
+  unsigned long update_delay_pending;
+
   /* BGP flags. */
   u_int32_t flags;
 #define BGP_FLAG_ALWAYS_COMPARE_MED       (1 << 0)
@@ -125,6 +153,8 @@ struct bgp
 #define BGP_FLAG_ASPATH_MULTIPATH_RELAX   (1 << 14)
 #define BGP_FLAG_DELETING                 (1 << 15)
 #define BGP_FLAG_RR_ALLOW_OUTBOUND_POLICY (1 << 16)
+#define BGP_FLAG_PIC                      (1 << 17)
+#define BGP_FLAG_ADJ_OUT_SHARED           (1 << 18)
 
   /* BGP Per AF flags */
   u_int16_t af_flags[AFI_MAX][SAFI_MAX];
@@ -139,6 +169,9 @@ struct bgp
   /* BGP routing information base.  */
   struct bgp_table *rib[AFI_MAX][SAFI_MAX];
 
+  /* Update groups of the established peers.  */
+  struct list *update_groups[AFI_MAX][SAFI_MAX];
+
   /* BGP redistribute configuration. */
   u_char redist[AFI_MAX][ZEBRA_ROUTE_MAX];
 
@@ -319,6 +352,7 @@ struct peer
 
   /* Packet receive and send buffer. */
   struct stream *ibuf;
+  struct stream *rbuf;		/* read ahead, see bgp_read() */
   struct stream_fifo *obuf;
   struct stream *work;
 
@@ -446,6 +480,7 @@ struct peer
 #define PEER_STATUS_GROUP             (1 << 4) /* peer-group conf */
 #define PEER_STATUS_NSF_MODE          (1 << 5) /* NSF aware peer */
 #define PEER_STATUS_NSF_WAIT          (1 << 6) /* wait comeback peer */
+#define PEER_STATUS_UPDATE_DELAY_DONE (1 << 7) /* table in, see update-delay */
 
   /* Peer status af flags (reset in bgp_stop) */
   u_int16_t af_sflags[AFI_MAX][SAFI_MAX];
@@ -522,6 +557,15 @@ struct peer
   /* Announcement attribute hash.  */
   struct hash *hash[AFI_MAX][SAFI_MAX];
 
+  /* Update group, see bgp_updgrp.h, the peer's slot in it, and the
+     routes the peer shares Adj-RIB-Out entries for with others.  */
+  struct update_group *updgrp[AFI_MAX][SAFI_MAX];
+  unsigned int updgrp_slot[AFI_MAX][SAFI_MAX];
+  unsigned long adj_shared[AFI_MAX][SAFI_MAX];
+
+  /* UPDATE decoding by the worker threads, see bgp_decode.h.  */
+  struct bgp_update_decode *decode;
+
   /* Notify data. */
   struct bgp_notify notify;
 
@@ -876,10 +920,12 @@ extern void bgp_master_init (void);
 
 extern void bgp_init (void);
 extern void bgp_route_map_init (void);
+extern int bgp_route_map_peer_dependent (struct route_map *);
 
 extern int bgp_option_set (int);
 extern int bgp_option_unset (int);
 extern int bgp_option_check (int);
+extern int bgp_worker_threads_set (unsigned int);
 
 extern int bgp_get (struct bgp **, as_t *, const char *);
 extern int bgp_delete (struct bgp *);
@@ -39,6 +39,9 @@ struct buffer
   
   /* Size of each buffer_data chunk. */
   size_t size;
+
+  /* Bytes not flushed yet. */
+  size_t length;
 };
 
 /* Data container. */
@@ -127,6 +130,13 @@ buffer_empty (struct buffer *b)
   return (b->head == NULL);
 }
 
+/* Return the number of bytes not flushed yet. */
+size_t
+buffer_length (struct buffer *b)
+{
+  return b->length;
+}
+
 /* Clear and free all allocated data. */
 void
 buffer_reset (struct buffer *b)
@@ -140,6 +150,7 @@ buffer_reset (struct buffer *b)
       BUFFER_DATA_FREE(data);
     }
   b->head = b->tail = NULL;
+  b->length = 0;
 }
 
 /* Add buffer_data to the end of buffer. */
@@ -168,6 +179,8 @@ buffer_put(struct buffer *b, const void *p, size_t size)
   struct buffer_data *data = b->tail;
   const char *ptr = p;
 
+  b->length += size;
+
   /* We use even last one byte of data buffer. */
   while (size)    
     {
@@ -304,6 +317,7 @@ buffer_flush_window (struct buffer *b, int fd, int width, int height,
         }
       iov[iov_index].iov_base = (char *)(data->data + data->sp);
       iov[iov_index++].iov_len = cp-data->sp;
+      b->length -= cp-data->sp;
       data->sp = cp;
 
       if (iov_index == iov_alloc)
@@ -433,6 +447,7 @@ in one shot. */
     }
 
   /* Free printed buffer data. */
+  b->length -= written;
   while (written > 0)
     {
       struct buffer_data *d;
@@ -826,12 +826,45 @@ distribute_print (struct vty *vty, char *tab[], int is_prefix,
   return has_print;
 }
 
+struct distribute_show_arg
+{
+  struct vty *vty;
+  enum distribute_type v4;
+  enum distribute_type v6;
+};
+
+static void
+distribute_show_iterator (struct hash_backet *mp, void *arg)
+{
+  struct distribute_show_arg *show = arg;
+  struct vty *vty = show->vty;
+  struct distribute *dist = mp->data;
+  int has_print;
+
+  if (dist->ifname)
+    {
+      vty_out (vty, "    %s filtered by", dist->ifname);
+      has_print = 0;
+      has_print = distribute_print(vty, dist->list,   0,
+                                   show->v4, has_print);
+      has_print = distribute_print(vty, dist->prefix, 1,
+                                   show->v4, has_print);
+      has_print = distribute_print(vty, dist->list,   0,
+                                   show->v6, has_print);
+      has_print = distribute_print(vty, dist->prefix, 1,
+                                   show->v6, has_print);
+      if (has_print)
+        vty_out (vty, "%s", VTY_NEWLINE);
+      else
+        vty_out(vty, " nothing%s", VTY_NEWLINE);
+    }
+}
+
 int
 config_show_distribute (struct vty *vty)
 {
-  unsigned int i;
+  struct distribute_show_arg arg;
   int has_print = 0;
-  struct hash_backet *mp;
   struct distribute *dist;
 
   /* Output filter configuration. */
@@ -854,28 +887,10 @@ config_show_distribute (struct vty *vty)
   else
     vty_out (vty, " not set%s", VTY_NEWLINE);
 
-  for (i = 0; i < disthash->size; i++)
-    for (mp = disthash->index[i]; mp; mp = mp->next)
-      {
-	dist = mp->data;
-	if (dist->ifname)
-          {
-            vty_out (vty, "    %s filtered by", dist->ifname);
-            has_print = 0;
-            has_print = distribute_print(vty, dist->list,   0,
-                                         DISTRIBUTE_V4_OUT, has_print);
-            has_print = distribute_print(vty, dist->prefix, 1,
-                                         DISTRIBUTE_V4_OUT, has_print);
-            has_print = distribute_print(vty, dist->list,   0,
-                                         DISTRIBUTE_V6_OUT, has_print);
-            has_print = distribute_print(vty, dist->prefix, 1,
-                                         DISTRIBUTE_V6_OUT, has_print);
-            if (has_print)
-              vty_out (vty, "%s", VTY_NEWLINE);
-            else
-              vty_out(vty, " nothing%s", VTY_NEWLINE);
-          }
-      }
+  arg.vty = vty;
+  arg.v4 = DISTRIBUTE_V4_OUT;
+  arg.v6 = DISTRIBUTE_V6_OUT;
+  hash_iterate (disthash, distribute_show_iterator, &arg);
 
 
   /* Input filter configuration. */
@@ -898,75 +913,64 @@ config_show_distribute (struct vty *vty)
   else
     vty_out (vty, " not set%s", VTY_NEWLINE);
 
-  for (i = 0; i < disthash->size; i++)
-    for (mp = disthash->index[i]; mp; mp = mp->next)
-      {
-	dist = mp->data;
-        if (dist->ifname)
-          {
-            vty_out (vty, "    %s filtered by", dist->ifname);
-            has_print = 0;
-            has_print = distribute_print(vty, dist->list,   0,
-                                         DISTRIBUTE_V4_IN, has_print);
-            has_print = distribute_print(vty, dist->prefix, 1,
-                                         DISTRIBUTE_V4_IN, has_print);
-            has_print = distribute_print(vty, dist->list,   0,
-                                         DISTRIBUTE_V6_IN, has_print);
-            has_print = distribute_print(vty, dist->prefix, 1,
-                                         DISTRIBUTE_V6_IN, has_print);
-            if (has_print)
-              vty_out (vty, "%s", VTY_NEWLINE);
-            else
-              vty_out(vty, " nothing%s", VTY_NEWLINE);
-          }
-      }
+  arg.v4 = DISTRIBUTE_V4_IN;
+  arg.v6 = DISTRIBUTE_V6_IN;
+  hash_iterate (disthash, distribute_show_iterator, &arg);
   return 0;
 }
 
+struct distribute_write_arg
+{
+  struct vty *vty;
+  int write;
+};
+
+static void
+distribute_write_iterator (struct hash_backet *mp, void *arg)
+{
+  struct distribute_write_arg *w = arg;
+  struct vty *vty = w->vty;
+  struct distribute *dist = mp->data;
+  int j;
+  int output, v6;
+
+  for (j=0; j < DISTRIBUTE_MAX; j++)
+    if (dist->list[j]) {
+      output = j == DISTRIBUTE_V4_OUT || j == DISTRIBUTE_V6_OUT;
+      v6 = j == DISTRIBUTE_V6_IN || j == DISTRIBUTE_V6_OUT;
+      vty_out (vty, " %sdistribute-list %s %s %s%s",
+               v6 ? "ipv6 " : "",
+               dist->list[j],
+               output ? "out" : "in",
+               dist->ifname ? dist->ifname : "",
+               VTY_NEWLINE);
+      w->write++;
+    }
+
+  for (j=0; j < DISTRIBUTE_MAX; j++)
+    if (dist->prefix[j]) {
+      output = j == DISTRIBUTE_V4_OUT || j == DISTRIBUTE_V6_OUT;
+      v6 = j == DISTRIBUTE_V6_IN || j == DISTRIBUTE_V6_OUT;
+      vty_out (vty, " %sdistribute-list prefix %s %s %s%s",
+               v6 ? "ipv6 " : "",
+               dist->prefix[j],
+               output ? "out" : "in",
+               dist->ifname ? dist->ifname : "",
+               VTY_NEWLINE);
+      w->write++;
+    }
+}
+
 /* Configuration write function. */
 int
 config_write_distribute (struct vty *vty)
 {
-  unsigned int i;
-  int j;
-  int output, v6;
-  struct hash_backet *mp;
-  int write = 0;
-
-  for (i = 0; i < disthash->size; i++)
-    for (mp = disthash->index[i]; mp; mp = mp->next)
-      {
-	struct distribute *dist;
-
-	dist = mp->data;
-
-	for (j=0; j < DISTRIBUTE_MAX; j++)
-	  if (dist->list[j]) {
-	    output = j == DISTRIBUTE_V4_OUT || j == DISTRIBUTE_V6_OUT;
-            v6 = j == DISTRIBUTE_V6_IN || j == DISTRIBUTE_V6_OUT;
-	    vty_out (vty, " %sdistribute-list %s %s %s%s",
-                     v6 ? "ipv6 " : "",
-		     dist->list[j],
-		     output ? "out" : "in",
-		     dist->ifname ? dist->ifname : "",
-		     VTY_NEWLINE);
-	    write++;
-	  }
-
-	for (j=0; j < DISTRIBUTE_MAX; j++)
-	  if (dist->prefix[j]) {
-	    output = j == DISTRIBUTE_V4_OUT || j == DISTRIBUTE_V6_OUT;
-            v6 = j == DISTRIBUTE_V6_IN || j == DISTRIBUTE_V6_OUT;
-	    vty_out (vty, " %sdistribute-list prefix %s %s %s%s",
-                     v6 ? "ipv6 " : "",
-		     dist->prefix[j],
-		     output ? "out" : "in",
-		     dist->ifname ? dist->ifname : "",
-		     VTY_NEWLINE);
-	    write++;
-	  }
-      }
-  return write;
+  struct distribute_write_arg arg;
+
+  arg.vty = vty;
+  arg.write = 0;
+  hash_iterate (disthash, distribute_write_iterator, &arg);
+  return arg.write;
 }
 
 /* Clear all distribute list. */
@@ -982,6 +986,7 @@ distribute_list_init (int node)
 {
   disthash = hash_create (distribute_hash_make,
                           (int (*) (const void *, const void *)) distribute_cmp);
+  hash_set_name (disthash, "Distribute lists");
   /* install v4 */
   if (node == RIP_NODE || node == BABEL_NODE) {
     install_element (node, &distribute_list_all_cmd);
@@ -23,6 +23,12 @@
 
 #include "hash.h"
 #include "memory.h"
+#include "linklist.h"
+#include "vty.h"
+#include "command.h"
+
+/* Hash tables named with hash_set_name (). */
+static struct list *hash_list;
 
 /* Allocate a new hash.  */
 struct hash *
@@ -40,6 +46,12 @@ hash_create_size (unsigned int size, unsigned int (*hash_key) (void *),
   hash->hash_key = hash_key;
   hash->hash_cmp = hash_cmp;
   hash->count = 0;
+  hash->name = NULL;
+  hash->old_index = NULL;
+  hash->slots = hash->old_slots = NULL;
+  hash->old_size = hash->migrated = 0;
+  hash->losers = 0;
+  hash->iterating = hash->tombstones = 0;
 
   return hash;
 }
@@ -52,6 +64,317 @@ hash_create (unsigned int (*hash_key) (void *),
   return hash_create_size (HASH_INITIAL_SIZE, hash_key, hash_cmp);
 }
 
+/*
+ * Open addressing variant.
+ *
+ * Backets live inline in one array, so a lookup touches consecutive
+ * slots with the key cached next to the data instead of chasing a
+ * list of separately allocated backets.  Collisions are resolved by
+ * linear probing in Robin Hood order: an entry never sits further from
+ * its home slot than the entry it displaced, which bounds probe
+ * lengths and lets a miss stop early.  Deletion shifts the following
+ * entries back, so no tombstones are left behind, except while
+ * hash_iterate () is running, where they keep the walk stable and are
+ * swept when it ends.
+ *
+ * Growing allocates a table twice the size, inserts go there and
+ * every operation moves HASH_OPEN_MIGRATE slots over from the old
+ * table, which is only looked at while entries remain in it.
+ *
+ * Empty slots have NULL data, tombstones additionally point 'next'
+ * at hash_tombstone.  Entries must not be added from a hash_iterate
+ * callback, releasing them is fine.
+ */
+static struct hash_backet hash_tombstone;
+
+#define HASH_SLOT_FREE(S)  ((S)->data == NULL && (S)->next != &hash_tombstone)
+#define HASH_SLOT_DIST(K, I, MASK) (((I) - hash_open_home (K)) & (MASK))
+
+/* Home slot of a key, before masking.  Keys are mixed first since
+ * linear probing turns runs of neighbouring keys from a weak hash
+ * function into one long cluster.  */
+static inline unsigned int
+hash_open_home (unsigned int key)
+{
+  key ^= key >> 16;
+  key *= 0x85ebca6b;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35;
+  key ^= key >> 16;
+  return key;
+}
+
+struct hash *
+hash_create_open_size (unsigned int size, unsigned int (*hash_key) (void *),
+                       int (*hash_cmp) (const void *, const void *))
+{
+  struct hash *hash;
+
+  assert ((size & (size-1)) == 0 && size >= 8);
+  hash = XCALLOC (MTYPE_HASH, sizeof (struct hash));
+  hash->slots = XCALLOC (MTYPE_HASH_INDEX, sizeof (struct hash_backet) * size);
+  hash->size = size;
+  hash->hash_key = hash_key;
+  hash->hash_cmp = hash_cmp;
+
+  return hash;
+}
+
+struct hash *
+hash_create_open (unsigned int (*hash_key) (void *),
+                  int (*hash_cmp) (const void *, const void *))
+{
+  return hash_create_open_size (HASH_INITIAL_SIZE, hash_key, hash_cmp);
+}
+
+static struct hash_backet *
+hash_open_find (struct hash *hash, unsigned int key, void *data)
+{
+  unsigned int mask = hash->size - 1;
+  unsigned int i, dist;
+  struct hash_backet *hb;
+
+  for (i = hash_open_home (key) & mask, dist = 0; ; i = (i + 1) & mask, dist++)
+    {
+      hb = &hash->slots[i];
+      if (HASH_SLOT_FREE (hb) || HASH_SLOT_DIST (hb->key, i, mask) < dist)
+        break;
+      if (hb->data && hb->key == key && (*hash->hash_cmp) (hb->data, data))
+        return hb;
+    }
+
+  if (hash->old_slots == NULL)
+    return NULL;
+
+  /* Slots already migrated and entries released from the old table
+   * are passed over, the chain only ends at a slot never used. */
+  mask = hash->old_size - 1;
+  for (i = hash_open_home (key) & mask, dist = 0; dist < hash->old_size;
+       i = (i + 1) & mask, dist++)
+    {
+      hb = &hash->old_slots[i];
+      if (hb->data == NULL)
+        {
+          if (i < hash->migrated || hb->next == &hash_tombstone)
+            continue;
+          break;
+        }
+      if (hb->key == key && (*hash->hash_cmp) (hb->data, data))
+        return hb;
+    }
+  return NULL;
+}
+
+static void
+hash_open_insert (struct hash *hash, unsigned int key, void *data)
+{
+  unsigned int mask = hash->size - 1;
+  unsigned int i, dist, d;
+  struct hash_backet *hb, tmp;
+
+  for (i = hash_open_home (key) & mask, dist = 0; ; i = (i + 1) & mask, dist++)
+    {
+      hb = &hash->slots[i];
+      if (hb->data == NULL)
+        {
+          hb->next = NULL;
+          hb->key = key;
+          hb->data = data;
+          return;
+        }
+
+      /* Take the slot from an entry closer to its home. */
+      d = HASH_SLOT_DIST (hb->key, i, mask);
+      if (d < dist)
+        {
+          tmp = *hb;
+          hb->key = key;
+          hb->data = data;
+          key = tmp.key;
+          data = tmp.data;
+          dist = d;
+        }
+    }
+}
+
+/* Remove slot i, shifting following entries back towards home. */
+static void
+hash_open_remove (struct hash *hash, unsigned int i)
+{
+  unsigned int mask = hash->size - 1;
+  unsigned int j;
+  struct hash_backet *hb;
+
+  for (j = (i + 1) & mask; ; i = j, j = (j + 1) & mask)
+    {
+      hb = &hash->slots[j];
+      if (HASH_SLOT_FREE (hb) || HASH_SLOT_DIST (hb->key, j, mask) == 0)
+        break;
+      hash->slots[i] = *hb;
+    }
+  hash->slots[i].next = NULL;
+  hash->slots[i].data = NULL;
+}
+
+/* Sweep tombstones left by releases during hash_iterate (). */
+static void
+hash_open_sweep (struct hash *hash)
+{
+  unsigned int i;
+
+  while (hash->tombstones)
+    for (i = 0; i < hash->size; i++)
+      if (hash->slots[i].next == &hash_tombstone)
+        {
+          hash_open_remove (hash, i);
+          hash->tombstones--;
+        }
+}
+
+static void
+hash_open_migrate (struct hash *hash, unsigned int n)
+{
+  struct hash_backet *hb;
+
+  while (n-- && hash->migrated < hash->old_size)
+    {
+      hb = &hash->old_slots[hash->migrated++];
+      if (hb->data)
+        {
+          hash_open_insert (hash, hb->key, hb->data);
+          hb->data = NULL;
+        }
+    }
+
+  if (hash->migrated == hash->old_size)
+    {
+      XFREE (MTYPE_HASH_INDEX, hash->old_slots);
+      hash->old_size = hash->migrated = 0;
+    }
+}
+
+static void
+hash_open_grow (struct hash *hash)
+{
+  /* Still moving from the last growth, finish that first. */
+  if (hash->old_slots)
+    hash_open_migrate (hash, hash->old_size);
+
+  hash->old_slots = hash->slots;
+  hash->old_size = hash->size;
+  hash->migrated = 0;
+  hash->size *= 2;
+  hash->slots = XCALLOC (MTYPE_HASH_INDEX,
+                         sizeof (struct hash_backet) * hash->size);
+}
+
+static void *
+hash_open_get (struct hash *hash, void *data, void * (*alloc_func) (void *))
+{
+  struct hash_backet *hb;
+  unsigned int key;
+  void *newdata;
+
+  if (hash->old_slots && !hash->iterating)
+    hash_open_migrate (hash, HASH_OPEN_MIGRATE);
+
+  key = (*hash->hash_key) (data);
+  if ((hb = hash_open_find (hash, key, data)) != NULL)
+    return hb->data;
+
+  if (alloc_func == NULL)
+    return NULL;
+
+  newdata = (*alloc_func) (data);
+  if (newdata == NULL)
+    return NULL;
+
+  assert (!hash->iterating);
+  if ((hash->count + 1) * 8 > (unsigned long) hash->size * HASH_OPEN_LOAD)
+    hash_open_grow (hash);
+
+  hash_open_insert (hash, key, newdata);
+  hash->count++;
+  return newdata;
+}
+
+static void *
+hash_open_release (struct hash *hash, void *data)
+{
+  struct hash_backet *hb;
+  void *ret;
+
+  if (hash->old_slots && !hash->iterating)
+    hash_open_migrate (hash, HASH_OPEN_MIGRATE);
+
+  hb = hash_open_find (hash, (*hash->hash_key) (data), data);
+  if (hb == NULL)
+    return NULL;
+
+  ret = hb->data;
+  hash->count--;
+
+  if (hash->old_slots && hb >= hash->old_slots
+      && hb < hash->old_slots + hash->old_size)
+    {
+      hb->data = NULL;
+      hb->next = &hash_tombstone;
+    }
+  else if (hash->iterating)
+    {
+      hb->data = NULL;
+      hb->next = &hash_tombstone;
+      hash->tombstones++;
+    }
+  else
+    hash_open_remove (hash, hb - hash->slots);
+
+  return ret;
+}
+
+static void
+hash_open_iterate (struct hash *hash,
+                   void (*func) (struct hash_backet *, void *), void *arg)
+{
+  unsigned int i;
+
+  hash->iterating++;
+
+  for (i = hash->migrated; i < hash->old_size; i++)
+    if (hash->old_slots[i].data)
+      (*func) (&hash->old_slots[i], arg);
+
+  for (i = 0; i < hash->size; i++)
+    if (hash->slots[i].data)
+      (*func) (&hash->slots[i], arg);
+
+  if (--hash->iterating == 0)
+    hash_open_sweep (hash);
+}
+
+static void
+hash_open_clean (struct hash *hash, void (*free_func) (void *))
+{
+  unsigned int i;
+
+  if (free_func)
+    {
+      for (i = hash->migrated; i < hash->old_size; i++)
+        if (hash->old_slots[i].data)
+          (*free_func) (hash->old_slots[i].data);
+      for (i = 0; i < hash->size; i++)
+        if (hash->slots[i].data)
+          (*free_func) (hash->slots[i].data);
+    }
+
+  if (hash->old_slots)
+    XFREE (MTYPE_HASH_INDEX, hash->old_slots);
+  hash->old_size = hash->migrated = 0;
+  memset (hash->slots, 0, sizeof (struct hash_backet) * hash->size);
+  hash->tombstones = 0;
+  hash->count = 0;
+}
+
 /* Utility function for hash_get().  When this function is specified
    as alloc_func, return arugment as it is.  This function is used for
    intern already allocated value.  */
@@ -61,52 +384,98 @@ hash_alloc_intern (void *arg)
   return arg;
 }
 
-/* Expand hash if the chain length exceeds the threshold. */
-static void hash_expand (struct hash *hash)
+/*
+ * Chained tables grow incrementally as well.  Once a chain gets longer
+ * than HASH_THRESHOLD the index is doubled, and every later operation
+ * moves HASH_MIGRATE buckets from the old index over.  Old bucket b
+ * splits into new buckets b and b + old_size, so entries of a key stay
+ * in the old bucket until that has been moved, and in the new one
+ * after, and each lookup knows which one to look at.
+ */
+
+/* Chain holding the given key. */
+static inline struct hash_backet **
+hash_chain (struct hash *hash, unsigned int key)
 {
-  unsigned int i, new_size, losers;
-  struct hash_backet *hb, *hbnext, **new_index;
+  if (hash->old_index)
+    {
+      unsigned int old = key & (hash->old_size - 1);
 
-  new_size = hash->size * 2;
-  new_index = XCALLOC(MTYPE_HASH_INDEX, sizeof(struct hash_backet *) * new_size);
-  if (new_index == NULL)
-    return;
+      if (old >= hash->migrated)
+        return &hash->old_index[old];
+    }
+  return &hash->index[key & (hash->size - 1)];
+}
 
-  for (i = 0; i < hash->size; i++)
-    for (hb = hash->index[i]; hb; hb = hbnext)
-      {
-	unsigned int h = hb->key & (new_size - 1);
+/* Account chain lengths of a finished bucket of a grown index. */
+static void
+hash_expand_check (struct hash *hash, unsigned int i)
+{
+  struct hash_backet *hb;
+  unsigned int len = 0;
 
-	hbnext = hb->next;
-	hb->next = new_index[h];
-	new_index[h] = hb;
-      }
+  for (hb = hash->index[i]; hb; hb = hb->next)
+    {
+      if (++len > HASH_THRESHOLD/2)
+        hash->losers++;
+      if (len >= HASH_THRESHOLD)
+        hash->no_expand = 1;
+    }
+}
 
-  /* Switch to new table */
-  XFREE(MTYPE_HASH_INDEX, hash->index);
-  hash->size = new_size;
-  hash->index = new_index;
+static void
+hash_migrate (struct hash *hash, unsigned int n)
+{
+  struct hash_backet *hb, *hbnext;
+  unsigned int i, h;
 
-  /* Ideally, new index should have chains half as long as the original.
-     If expansion didn't help, then not worth expanding again,
-     the problem is the hash function. */
-  losers = 0;
-  for (i = 0; i < hash->size; i++)
+  while (n-- && hash->migrated < hash->old_size)
     {
-      unsigned int len = 0;
-      for (hb = hash->index[i]; hb; hb = hb->next)
-	{
-	  if (++len > HASH_THRESHOLD/2)
-	    ++losers;
-	  if (len >= HASH_THRESHOLD)
-	    hash->no_expand = 1;
-	}
+      i = hash->migrated++;
+      for (hb = hash->old_index[i]; hb; hb = hbnext)
+        {
+          h = hb->key & (hash->size - 1);
+          hbnext = hb->next;
+          hb->next = hash->index[h];
+          hash->index[h] = hb;
+        }
+      hash->old_index[i] = NULL;
+
+      hash_expand_check (hash, i);
+      hash_expand_check (hash, i + hash->old_size);
     }
 
-  if (losers > hash->count / 2)
+  if (hash->migrated < hash->old_size)
+    return;
+
+  XFREE (MTYPE_HASH_INDEX, hash->old_index);
+  hash->old_size = hash->migrated = 0;
+
+  /* Ideally, new index should have chains half as long as the original.
+     If expansion didn't help, then not worth expanding again,
+     the problem is the hash function. */
+  if (hash->losers > hash->count / 2)
     hash->no_expand = 1;
 }
 
+/* Expand hash if the chain length exceeds the threshold. */
+static void hash_expand (struct hash *hash)
+{
+  struct hash_backet **new_index;
+
+  new_index = XCALLOC(MTYPE_HASH_INDEX,
+                      sizeof(struct hash_backet *) * hash->size * 2);
+  if (new_index == NULL)
+    return;
+
+  hash->old_index = hash->index;
+  hash->old_size = hash->size;
+  hash->migrated = 0;
+  hash->losers = 0;
+  hash->index = new_index;
+  hash->size *= 2;
+}
+
 /* Lookup and return hash backet in hash.  If there is no
    corresponding hash backet and alloc_func is specified, create new
    hash backet.  */
@@ -114,16 +483,22 @@ void *
 hash_get (struct hash *hash, void *data, void * (*alloc_func) (void *))
 {
   unsigned int key;
-  unsigned int index;
   void *newdata;
   unsigned int len;
   struct hash_backet *backet;
+  struct hash_backet **chain;
+
+  if (hash->slots)
+    return hash_open_get (hash, data, alloc_func);
+
+  if (hash->old_index && !hash->iterating)
+    hash_migrate (hash, HASH_MIGRATE);
 
   key = (*hash->hash_key) (data);
-  index = key & (hash->size - 1);
+  chain = hash_chain (hash, key);
   len = 0;
 
-  for (backet = hash->index[index]; backet != NULL; backet = backet->next)
+  for (backet = *chain; backet != NULL; backet = backet->next)
     {
       if (backet->key == key && (*hash->hash_cmp) (backet->data, data))
 	return backet->data;
@@ -136,17 +511,18 @@ hash_get (struct hash *hash, void *data, void * (*alloc_func) (void *))
       if (newdata == NULL)
 	return NULL;
 
-      if (len > HASH_THRESHOLD && !hash->no_expand)
+      if (len > HASH_THRESHOLD && !hash->no_expand
+          && !hash->old_index && !hash->iterating)
 	{
 	  hash_expand (hash);
-	  index = key & (hash->size - 1);
+	  chain = hash_chain (hash, key);
 	}
 
       backet = XMALLOC (MTYPE_HASH_BACKET, sizeof (struct hash_backet));
       backet->data = newdata;
       backet->key = key;
-      backet->next = hash->index[index];
-      hash->index[index] = backet;
+      backet->next = *chain;
+      *chain = backet;
       hash->count++;
       return backet->data;
     }
@@ -179,19 +555,25 @@ hash_release (struct hash *hash, void *data)
 {
   void *ret;
   unsigned int key;
-  unsigned int index;
+  struct hash_backet **chain;
   struct hash_backet *backet;
   struct hash_backet *pp;
 
+  if (hash->slots)
+    return hash_open_release (hash, data);
+
+  if (hash->old_index && !hash->iterating)
+    hash_migrate (hash, HASH_MIGRATE);
+
   key = (*hash->hash_key) (data);
-  index = key & (hash->size - 1);
+  chain = hash_chain (hash, key);
 
-  for (backet = pp = hash->index[index]; backet; backet = backet->next)
+  for (backet = pp = *chain; backet; backet = backet->next)
     {
       if (backet->key == key && (*hash->hash_cmp) (backet->data, data)) 
 	{
 	  if (backet == pp) 
-	    hash->index[index] = backet->next;
+	    *chain = backet->next;
 	  else 
 	    pp->next = backet->next;
 
@@ -214,6 +596,22 @@ hash_iterate (struct hash *hash,
   struct hash_backet *hb;
   struct hash_backet *hbnext;
 
+  if (hash->slots)
+    {
+      hash_open_iterate (hash, func, arg);
+      return;
+    }
+
+  /* No buckets are moved while walking, so none is seen twice. */
+  hash->iterating++;
+
+  for (i = hash->migrated; i < hash->old_size; i++)
+    for (hb = hash->old_index[i]; hb; hb = hbnext)
+      {
+	hbnext = hb->next;
+	(*func) (hb, arg);
+      }
+
   for (i = 0; i < hash->size; i++)
     for (hb = hash->index[i]; hb; hb = hbnext)
       {
@@ -223,6 +621,8 @@ hash_iterate (struct hash *hash,
 	hbnext = hb->next;
 	(*func) (hb, arg);
       }
+
+  hash->iterating--;
 }
 
 /* Clean up hash.  */
@@ -233,6 +633,16 @@ hash_clean (struct hash *hash, void (*free_func) (void *))
   struct hash_backet *hb;
   struct hash_backet *next;
 
+  if (hash->slots)
+    {
+      hash_open_clean (hash, free_func);
+      return;
+    }
+
+  /* Finish growing first, so there is only the one index to clean. */
+  if (hash->old_index)
+    hash_migrate (hash, hash->old_size);
+
   for (i = 0; i < hash->size; i++)
     {
       for (hb = hash->index[i]; hb; hb = next)
@@ -254,6 +664,162 @@ hash_clean (struct hash *hash, void (*free_func) (void *))
 void
 hash_free (struct hash *hash)
 {
-  XFREE (MTYPE_HASH_INDEX, hash->index);
+  if (hash->name && hash_list)
+    listnode_delete (hash_list, hash);
+
+  if (hash->slots)
+    {
+      if (hash->old_slots)
+        XFREE (MTYPE_HASH_INDEX, hash->old_slots);
+      XFREE (MTYPE_HASH_INDEX, hash->slots);
+    }
+  else
+    {
+      if (hash->old_index)
+        XFREE (MTYPE_HASH_INDEX, hash->old_index);
+      XFREE (MTYPE_HASH_INDEX, hash->index);
+    }
   XFREE (MTYPE_HASH, hash);
 }
+
+/* Name a hash, listing it in "show hash statistics".  The name is not
+   copied.  */
+void
+hash_set_name (struct hash *hash, const char *name)
+{
+  if (hash_list == NULL)
+    hash_list = list_new ();
+  if (hash->name == NULL)
+    listnode_add (hash_list, hash);
+  hash->name = name;
+}
+
+/* Histogram of chain lengths, or probe distances: 0, 1, 2, 3, 4-7,
+   8-15 and 16 or more.  */
+#define HASH_STATS_BINS 7
+
+static void
+hash_stats_add (unsigned long *bins, unsigned int len)
+{
+  int bin;
+
+  if (len < 4)
+    bin = len;
+  else if (len < 8)
+    bin = 4;
+  else if (len < 16)
+    bin = 5;
+  else
+    bin = 6;
+  bins[bin]++;
+}
+
+static void
+hash_stats_chain (struct hash_backet *hb, unsigned long *bins,
+                  unsigned int *max)
+{
+  unsigned int len = 0;
+
+  for (; hb; hb = hb->next)
+    len++;
+  hash_stats_add (bins, len);
+  if (len > *max)
+    *max = len;
+}
+
+static void
+hash_stats_show (struct vty *vty, struct hash *hash)
+{
+  static const char *bin_names[HASH_STATS_BINS] =
+    { "0", "1", "2", "3", "4-7", "8-15", "16+" };
+  unsigned long bins[HASH_STATS_BINS];
+  unsigned long used = 0, total = 0;
+  unsigned int max = 0;
+  unsigned int i, d;
+  int bin;
+
+  memset (bins, 0, sizeof (bins));
+
+  if (hash->slots)
+    {
+      unsigned int mask = hash->size - 1;
+
+      /* Probe distance of every entry, from its home slot. */
+      for (i = 0; i < hash->size; i++)
+        if (hash->slots[i].data)
+          {
+            d = HASH_SLOT_DIST (hash->slots[i].key, i, mask);
+            hash_stats_add (bins, d);
+            total += d;
+            if (d > max)
+              max = d;
+          }
+      mask = hash->old_size - 1;
+      for (i = hash->migrated; i < hash->old_size; i++)
+        if (hash->old_slots[i].data)
+          {
+            d = HASH_SLOT_DIST (hash->old_slots[i].key, i, mask);
+            hash_stats_add (bins, d);
+            total += d;
+            if (d > max)
+              max = d;
+          }
+    }
+  else
+    {
+      for (i = 0; i < hash->size; i++)
+        hash_stats_chain (hash->index[i], bins, &max);
+      for (i = hash->migrated; i < hash->old_size; i++)
+        hash_stats_chain (hash->old_index[i], bins, &max);
+      used = hash->size + hash->old_size - hash->migrated - bins[0];
+    }
+
+  vty_out (vty, "%s (%s):%s", hash->name,
+           hash->slots ? "open addressing" : "chained", VTY_NEWLINE);
+  vty_out (vty, "  Entries: %lu, %s: %u, load %lu%%", hash->count,
+           hash->slots ? "slots" : "buckets", hash->size,
+           hash->count * 100 / hash->size);
+  if (hash->old_size)
+    vty_out (vty, ", growing from %u (%u%% moved)", hash->old_size,
+             hash->migrated * 100 / hash->old_size);
+  if (hash->no_expand)
+    vty_out (vty, ", not growing further");
+  vty_out (vty, "%s", VTY_NEWLINE);
+
+  if (hash->slots)
+    vty_out (vty, "  Probe distance: max %u, mean %lu.%02lu%s", max,
+             hash->count ? total / hash->count : 0,
+             hash->count ? total * 100 / hash->count % 100 : 0,
+             VTY_NEWLINE);
+  else
+    vty_out (vty, "  Chain length: max %u, mean %lu.%02lu (used buckets)%s",
+             max, used ? hash->count / used : 0,
+             used ? hash->count * 100 / used % 100 : 0, VTY_NEWLINE);
+
+  vty_out (vty, "  %s", hash->slots ? "Entries by distance:" : "Buckets by length:");
+  for (bin = 0; bin < HASH_STATS_BINS; bin++)
+    vty_out (vty, " %s: %lu", bin_names[bin], bins[bin]);
+  vty_out (vty, "%s", VTY_NEWLINE);
+}
+
+DEFUN (show_hash_stats,
+       show_hash_stats_cmd,
+       "show hash statistics",
+       SHOW_STR
+       "Hash tables\n"
+       "Size and chain length statistics\n")
+{
+  struct listnode *node;
+  struct hash *hash;
+
+  if (hash_list == NULL || list_isempty (hash_list))
+    {
+      vty_out (vty, "No named hash tables%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  for (ALL_LIST_ELEMENTS_RO (hash_list, node, hash))
+    hash_stats_show (vty, hash);
+
+  return CMD_SUCCESS;
+}
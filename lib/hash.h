@@ -24,6 +24,12 @@ Boston, MA 02111-1307, USA.  */
 /* Default hash table size.  */ 
 #define HASH_INITIAL_SIZE     256	/* initial number of backets. */
 #define HASH_THRESHOLD	      10	/* expand when backet. */
+#define HASH_MIGRATE          16	/* backets moved per operation. */
+
+/* Open addressing tables grow past this fill, in 1/8ths, and move at
+ * most this many slots to the grown table per operation.  */
+#define HASH_OPEN_LOAD         7
+#define HASH_OPEN_MIGRATE     32
 
 struct hash_backet
 {
@@ -39,15 +45,24 @@ struct hash_backet
 
 struct hash
 {
+  /* Name in "show hash statistics", or NULL.  */
+  const char *name;
+
   /* Hash backet. */
   struct hash_backet **index;
 
+  /* Index being grown out of, see 'migrated' below.  */
+  struct hash_backet **old_index;
+
   /* Hash table size. Must be power of 2 */
   unsigned int size;
 
   /* If expansion failed. */
   int no_expand;
 
+  /* Entries in overlong chains after the last expansion. */
+  unsigned long losers;
+
   /* Key make function. */
   unsigned int (*hash_key) (void *);
 
@@ -56,6 +71,19 @@ struct hash
 
   /* Backet alloc. */
   unsigned long count;
+
+  /* Open addressing tables keep their backets inline in 'slots'
+   * instead of chained off 'index', see hash_create_open ().  While
+   * growing, entries are moved over from 'old_index' or 'old_slots'
+   * a few at a time; those below 'migrated' are already done.  */
+  struct hash_backet *slots;
+  struct hash_backet *old_slots;
+  unsigned int old_size;
+  unsigned int migrated;
+
+  /* hash_iterate () running, and entries released meanwhile.  */
+  unsigned int iterating;
+  unsigned int tombstones;
 };
 
 extern struct hash *hash_create (unsigned int (*) (void *), 
@@ -63,6 +91,12 @@ extern struct hash *hash_create (unsigned int (*) (void *),
 extern struct hash *hash_create_size (unsigned int, unsigned int (*) (void *), 
                                              int (*) (const void *, const void *));
 
+extern struct hash *hash_create_open (unsigned int (*) (void *),
+				      int (*) (const void *, const void *));
+extern struct hash *hash_create_open_size (unsigned int,
+					   unsigned int (*) (void *),
+					   int (*) (const void *, const void *));
+
 extern void *hash_get (struct hash *, void *, void * (*) (void *));
 extern void *hash_alloc_intern (void *);
 extern void *hash_lookup (struct hash *, void *);
@@ -74,6 +108,9 @@ extern void hash_iterate (struct hash *,
 extern void hash_clean (struct hash *, void (*) (void *));
 extern void hash_free (struct hash *);
 
+extern void hash_set_name (struct hash *, const char *);
+extern struct cmd_element show_hash_stats_cmd;
+
 extern unsigned int string_hash_make (const char *);
 
 #endif /* _ZEBRA_HASH_H */
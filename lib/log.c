@@ -899,6 +899,10 @@ static const struct zebra_desc_table command_types[] = {
   DESC_ENTRY	(ZEBRA_NEXTHOP_REGISTER),
   DESC_ENTRY	(ZEBRA_NEXTHOP_UNREGISTER),
   DESC_ENTRY	(ZEBRA_NEXTHOP_UPDATE),
+  DESC_ENTRY	(ZEBRA_IPV4_ROUTE_ADD_BATCH),
+  DESC_ENTRY	(ZEBRA_NEXTHOP_GROUP_ADD),
+  DESC_ENTRY	(ZEBRA_NEXTHOP_GROUP_DELETE),
+  DESC_ENTRY	(ZEBRA_REDISTRIBUTE_BATCH),
 };
 #undef DESC_ENTRY
 
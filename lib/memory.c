@@ -26,11 +26,24 @@
 #include <malloc.h>
 #endif /* !HAVE_STDLIB_H || HAVE_MALLINFO */
 
+/* Asking the allocator for the size of a block gives byte accounting
+ * per type without having to carry the size along with each block. */
+#if defined(HAVE_MALLOC_USABLE_SIZE) || defined(HAVE_MALLOC_SIZE)
+#define MEMORY_BYTES
+#if defined(HAVE_MALLOC_H)
+#include <malloc.h>
+#elif defined(HAVE_MALLOC_NP_H)
+#include <malloc_np.h>
+#elif defined(HAVE_MALLOC_MALLOC_H)
+#include <malloc/malloc.h>
+#endif
+#endif /* HAVE_MALLOC_USABLE_SIZE || HAVE_MALLOC_SIZE */
+
 #include "log.h"
 #include "memory.h"
 
-static void alloc_inc (int);
-static void alloc_dec (int);
+static void alloc_inc (int, size_t);
+static void alloc_dec (int, size_t);
 static void log_memstats(int log_priority);
 
 static const struct message mstr [] =
@@ -43,6 +56,19 @@ static const struct message mstr [] =
   { 0, NULL },
 };
 
+/* Bytes taken by a block from the system allocator, 0 if unknown. */
+static inline size_t
+mtype_block_size (void *ptr)
+{
+#if defined(HAVE_MALLOC_USABLE_SIZE)
+  return malloc_usable_size (ptr);
+#elif defined(HAVE_MALLOC_SIZE)
+  return malloc_size (ptr);
+#else
+  return 0;
+#endif
+}
+
 /* Fatal memory allocation error occured. */
 static void __attribute__ ((noreturn))
 zerror (const char *fname, int type, size_t size)
@@ -58,6 +84,346 @@ zerror (const char *fname, int type, size_t size)
   abort();
 }
 
+/*
+ * Slab caches.
+ *
+ * Types which are allocated and freed at high rates with a single,
+ * fixed object size (routes, nodes, attributes, threads, streams) may
+ * be served from per-type slabs instead of the system allocator, see
+ * memory_slab_enable().  A slab is a MEM_SLAB_SIZE block, aligned to
+ * its own size, holding a header followed by equally sized objects.
+ * Free objects are chained through their first word.
+ *
+ * Allocations of any other size for a slab-enabled type still go to
+ * malloc, so zfree() must be able to tell the two apart: every cache
+ * keeps an index of the slabs it owns, which is probed with the
+ * address of the object rounded down to the slab size.
+ */
+#define MEM_SLAB_SHIFT 15
+#define MEM_SLAB_SIZE  (1 << MEM_SLAB_SHIFT)
+/* Enough for the structures kept in slabs, which hold nothing needing
+ * more than 8 byte alignment.  Unlike malloc's 16, this lets sizes
+ * that are an odd multiple of 8 pack without waste. */
+#define MEM_SLAB_ALIGN 8
+#define MEM_SLAB_ROUNDUP(S) (((S) + MEM_SLAB_ALIGN - 1) & ~(MEM_SLAB_ALIGN - 1))
+
+struct mem_slab
+{
+  struct mem_slab *next;
+  struct mem_slab *prev;
+
+  /* Objects returned to this slab. */
+  void *freelist;
+
+  /* Objects currently handed out. */
+  unsigned int inuse;
+
+  /* Objects never handed out start at this index. */
+  unsigned int bump;
+};
+
+#define MEM_SLAB_HDR MEM_SLAB_ROUNDUP (sizeof (struct mem_slab))
+
+struct mem_cache
+{
+  /* Size served from the slabs, and the size actually taken by an
+   * object within a slab. */
+  size_t size;
+  size_t objsize;
+  unsigned int perslab;
+
+  /* New allocations are only served while enabled. */
+  int enabled;
+
+  /* Slabs with free objects, and slabs without. */
+  struct mem_slab *partial;
+  struct mem_slab *full;
+
+  /* One empty slab is kept back to avoid thrashing at a boundary. */
+  struct mem_slab *spare;
+
+  /* Index of owned slabs, by address >> MEM_SLAB_SHIFT. */
+  uintptr_t *index;
+  unsigned int index_size;
+
+  unsigned long slabs;
+  unsigned long inuse;
+  unsigned long fallback;
+};
+
+static struct mem_cache *mslab[MTYPE_MAX];
+
+static unsigned int
+mem_slab_hash (const struct mem_cache *cache, uintptr_t key)
+{
+  return (unsigned int) (key * 2654435761UL) & (cache->index_size - 1);
+}
+
+static int
+mem_slab_owned (const struct mem_cache *cache, const void *ptr)
+{
+  uintptr_t key = (uintptr_t) ptr >> MEM_SLAB_SHIFT;
+  unsigned int i;
+
+  for (i = mem_slab_hash (cache, key); cache->index[i];
+       i = (i + 1) & (cache->index_size - 1))
+    if (cache->index[i] == key)
+      return 1;
+  return 0;
+}
+
+static void
+mem_slab_index_put (struct mem_cache *cache, uintptr_t key)
+{
+  unsigned int i;
+
+  for (i = mem_slab_hash (cache, key); cache->index[i];
+       i = (i + 1) & (cache->index_size - 1))
+    ;
+  cache->index[i] = key;
+}
+
+static void
+mem_slab_index_add (struct mem_cache *cache, struct mem_slab *slab)
+{
+  /* Keep the index at most half full. */
+  if ((cache->slabs + 1) * 2 > cache->index_size)
+    {
+      uintptr_t *old = cache->index;
+      unsigned int oldsize = cache->index_size;
+      unsigned int i;
+
+      cache->index_size = oldsize ? oldsize * 2 : 64;
+      cache->index = calloc (cache->index_size, sizeof (uintptr_t));
+      if (cache->index == NULL)
+        zerror ("calloc", MTYPE_MAX, cache->index_size * sizeof (uintptr_t));
+      for (i = 0; i < oldsize; i++)
+        if (old[i])
+          mem_slab_index_put (cache, old[i]);
+      free (old);
+    }
+  mem_slab_index_put (cache, (uintptr_t) slab >> MEM_SLAB_SHIFT);
+}
+
+static void
+mem_slab_index_del (struct mem_cache *cache, struct mem_slab *slab)
+{
+  uintptr_t key = (uintptr_t) slab >> MEM_SLAB_SHIFT;
+  unsigned int mask = cache->index_size - 1;
+  unsigned int i, j, home;
+
+  for (i = mem_slab_hash (cache, key); cache->index[i] != key;
+       i = (i + 1) & mask)
+    assert (cache->index[i]);
+
+  /* Backward shift deletion, keeps probe sequences unbroken. */
+  for (j = (i + 1) & mask; cache->index[j]; j = (j + 1) & mask)
+    {
+      home = mem_slab_hash (cache, cache->index[j]);
+      if (((j - home) & mask) >= ((j - i) & mask))
+        {
+          cache->index[i] = cache->index[j];
+          i = j;
+        }
+    }
+  cache->index[i] = 0;
+}
+
+static void
+mem_slab_list_add (struct mem_slab **head, struct mem_slab *slab)
+{
+  slab->prev = NULL;
+  slab->next = *head;
+  if (*head)
+    (*head)->prev = slab;
+  *head = slab;
+}
+
+static void
+mem_slab_list_del (struct mem_slab **head, struct mem_slab *slab)
+{
+  if (slab->prev)
+    slab->prev->next = slab->next;
+  else
+    *head = slab->next;
+  if (slab->next)
+    slab->next->prev = slab->prev;
+}
+
+static struct mem_slab *
+mem_slab_new (struct mem_cache *cache, int type)
+{
+  struct mem_slab *slab = NULL;
+
+#ifdef HAVE_POSIX_MEMALIGN
+  if (posix_memalign ((void **) &slab, MEM_SLAB_SIZE, MEM_SLAB_SIZE) != 0)
+    slab = NULL;
+#endif /* HAVE_POSIX_MEMALIGN */
+  if (slab == NULL)
+    zerror ("posix_memalign", type, MEM_SLAB_SIZE);
+
+  slab->freelist = NULL;
+  slab->inuse = 0;
+  slab->bump = 0;
+  mem_slab_index_add (cache, slab);
+  cache->slabs++;
+  return slab;
+}
+
+static void
+mem_slab_release (struct mem_cache *cache, struct mem_slab *slab)
+{
+  mem_slab_index_del (cache, slab);
+  cache->slabs--;
+  free (slab);
+}
+
+static void *
+mem_slab_alloc (struct mem_cache *cache, int type)
+{
+  struct mem_slab *slab = cache->partial;
+  void *obj;
+
+  if (slab == NULL)
+    {
+      if (cache->spare)
+        {
+          slab = cache->spare;
+          cache->spare = NULL;
+        }
+      else
+        slab = mem_slab_new (cache, type);
+      mem_slab_list_add (&cache->partial, slab);
+    }
+
+  if (slab->freelist)
+    {
+      obj = slab->freelist;
+      slab->freelist = *(void **) obj;
+    }
+  else
+    obj = (char *) slab + MEM_SLAB_HDR + slab->bump++ * cache->objsize;
+
+  cache->inuse++;
+  if (++slab->inuse == cache->perslab)
+    {
+      mem_slab_list_del (&cache->partial, slab);
+      mem_slab_list_add (&cache->full, slab);
+    }
+  return obj;
+}
+
+/* Return an object to its slab, or 0 if ptr did not come from one. */
+static int
+mem_slab_free (struct mem_cache *cache, void *ptr)
+{
+  struct mem_slab *slab;
+
+  if (!cache->slabs || !mem_slab_owned (cache, ptr))
+    return 0;
+
+  slab = (struct mem_slab *) ((uintptr_t) ptr & ~(uintptr_t) (MEM_SLAB_SIZE - 1));
+  if (slab->inuse == cache->perslab)
+    {
+      mem_slab_list_del (&cache->full, slab);
+      mem_slab_list_add (&cache->partial, slab);
+    }
+
+  *(void **) ptr = slab->freelist;
+  slab->freelist = ptr;
+  cache->inuse--;
+
+  if (--slab->inuse == 0)
+    {
+      mem_slab_list_del (&cache->partial, slab);
+      if (cache->enabled && cache->spare == NULL)
+        {
+          slab->freelist = NULL;
+          slab->bump = 0;
+          cache->spare = slab;
+        }
+      else
+        mem_slab_release (cache, slab);
+    }
+  return 1;
+}
+
+/* Slab cache serving allocations of the given size, if any. */
+static inline struct mem_cache *
+mem_slab_cache (int type, size_t size)
+{
+  struct mem_cache *cache = mslab[type];
+
+  if (cache == NULL || !cache->enabled)
+    return NULL;
+  if (size != cache->size)
+    {
+      cache->fallback++;
+      return NULL;
+    }
+  return cache;
+}
+
+/*
+ * Serve allocations of exactly 'size' bytes for the given type from
+ * slabs.  Allocations made before this, or of other sizes, keep going
+ * to the system allocator and may be freed as usual.
+ */
+void
+memory_slab_enable (int type, size_t size)
+{
+  struct mem_cache *cache;
+
+#ifndef HAVE_POSIX_MEMALIGN
+  return;
+#endif /* HAVE_POSIX_MEMALIGN */
+  assert (type > 0 && type < MTYPE_MAX);
+
+  if (size < sizeof (void *))
+    size = sizeof (void *);
+  if (MEM_SLAB_HDR + MEM_SLAB_ROUNDUP (size) > MEM_SLAB_SIZE)
+    return;
+
+  cache = mslab[type];
+  if (cache == NULL)
+    {
+      cache = calloc (1, sizeof (struct mem_cache));
+      if (cache == NULL)
+        zerror ("calloc", type, sizeof (struct mem_cache));
+      mslab[type] = cache;
+    }
+  else if (cache->size != size)
+    {
+      /* Objects of the old size stay in their slabs until freed,
+       * the spare one can go now. */
+      if (cache->spare)
+        mem_slab_release (cache, cache->spare);
+      cache->spare = NULL;
+      if (cache->slabs)
+        return;
+    }
+
+  cache->size = size;
+  cache->objsize = MEM_SLAB_ROUNDUP (size);
+  cache->perslab = (MEM_SLAB_SIZE - MEM_SLAB_HDR) / cache->objsize;
+  cache->enabled = 1;
+}
+
+/* Stop serving new allocations of the given type from slabs.  Objects
+ * still out are returned to their slabs as they are freed. */
+void
+memory_slab_disable (int type)
+{
+  struct mem_cache *cache = mslab[type];
+
+  if (cache == NULL)
+    return;
+  cache->enabled = 0;
+  if (cache->spare)
+    mem_slab_release (cache, cache->spare);
+  cache->spare = NULL;
+}
+
 /*
  * Allocate memory of a given size, to be tracked by a given type.
  * Effects: Returns a pointer to usable memory.  If memory cannot
@@ -66,14 +432,18 @@ zerror (const char *fname, int type, size_t size)
 void *
 zmalloc (int type, size_t size)
 {
+  struct mem_cache *cache;
   void *memory;
 
-  memory = malloc (size);
+  if ((cache = mem_slab_cache (type, size)) != NULL)
+    memory = mem_slab_alloc (cache, type);
+  else
+    memory = malloc (size);
 
   if (memory == NULL)
     zerror ("malloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, cache ? cache->objsize : mtype_block_size (memory));
 
   return memory;
 }
@@ -86,14 +456,21 @@ zmalloc (int type, size_t size)
 void *
 zzcalloc (int type, size_t size)
 {
+  struct mem_cache *cache;
   void *memory;
 
-  memory = calloc (1, size);
+  if ((cache = mem_slab_cache (type, size)) != NULL)
+    {
+      memory = mem_slab_alloc (cache, type);
+      memset (memory, 0, size);
+    }
+  else
+    memory = calloc (1, size);
 
   if (memory == NULL)
     zerror ("calloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, cache ? cache->objsize : mtype_block_size (memory));
 
   return memory;
 }
@@ -109,15 +486,28 @@ void *
 zrealloc (int type, void *ptr, size_t size)
 {
   void *memory;
+  size_t oldsize;
 
   if (ptr == NULL)              /* is really alloc */
       return zzcalloc(type, size);
 
+  /* Slab objects cannot grow in place, move them. */
+  if (mslab[type] && mslab[type]->slabs && mem_slab_owned (mslab[type], ptr))
+    {
+      oldsize = mslab[type]->size;
+      memory = zmalloc (type, size);
+      memcpy (memory, ptr, oldsize < size ? oldsize : size);
+      zfree (type, ptr);
+      return memory;
+    }
+
+  oldsize = mtype_block_size (ptr);
   memory = realloc (ptr, size);
   if (memory == NULL)
     zerror ("realloc", type, size);
-  if (ptr == NULL)
-    alloc_inc (type);
+
+  alloc_dec (type, oldsize);
+  alloc_inc (type, mtype_block_size (memory));
 
   return memory;
 }
@@ -133,8 +523,13 @@ zfree (int type, void *ptr)
 {
   if (ptr != NULL)
     {
-      alloc_dec (type);
-      free (ptr);
+      if (mslab[type] && mem_slab_free (mslab[type], ptr))
+        alloc_dec (type, mslab[type]->objsize);
+      else
+        {
+          alloc_dec (type, mtype_block_size (ptr));
+          free (ptr);
+        }
     }
 }
 
@@ -152,7 +547,7 @@ zstrdup (int type, const char *str)
   dup = strdup (str);
   if (dup == NULL)
     zerror ("strdup", type, strlen (str));
-  alloc_inc (type);
+  alloc_inc (type, mtype_block_size (dup));
   return dup;
 }
 
@@ -161,6 +556,8 @@ static struct
 {
   const char *name;
   long alloc;
+  size_t bytes;
+  size_t peak;
   unsigned long t_malloc;
   unsigned long c_malloc;
   unsigned long t_calloc;
@@ -248,27 +645,36 @@ static struct
 {
   char *name;
   long alloc;
+  size_t bytes;
+  size_t peak;
 } mstat [MTYPE_MAX];
 #endif /* MEMORY_LOG */
 
 /* Increment allocation counter. */
 static void
-alloc_inc (int type)
+alloc_inc (int type, size_t size)
 {
   mstat[type].alloc++;
+  mstat[type].bytes += size;
+  if (mstat[type].bytes > mstat[type].peak)
+    mstat[type].peak = mstat[type].bytes;
 }
 
 /* Decrement allocation counter. */
 static void
-alloc_dec (int type)
+alloc_dec (int type, size_t size)
 {
   mstat[type].alloc--;
+  mstat[type].bytes -= size;
 }
 
 /* Looking up memory status from vty interface. */
 #include "vector.h"
 #include "vty.h"
 #include "command.h"
+#include "thread.h"
+#include "stream.h"
+#include "table.h"
 
 static void
 log_memstats(int pri)
@@ -350,13 +756,31 @@ show_memory_vty (struct vty *vty, struct memory_list *list)
       }
     else if (mstat[m->index].alloc)
       {
+#ifdef MEMORY_BYTES
+	char bytes[MTYPE_MEMSTR_LEN], peak[MTYPE_MEMSTR_LEN];
+
+	vty_out (vty, "%-30s: %10ld %10s %10s\r\n", m->format,
+		 mstat[m->index].alloc,
+		 mtype_memstr (bytes, MTYPE_MEMSTR_LEN, mstat[m->index].bytes),
+		 mtype_memstr (peak, MTYPE_MEMSTR_LEN, mstat[m->index].peak));
+#else
 	vty_out (vty, "%-30s: %10ld\r\n", m->format, mstat[m->index].alloc);
+#endif /* MEMORY_BYTES */
 	needsep = 1;
       }
   return needsep;
 }
 
 #ifdef HAVE_MALLINFO
+/* mallinfo() counters are ints, and stop making sense past 2GB. */
+static const char *
+mallinfo_memstr (char *buf, size_t len, unsigned long bytes)
+{
+  if (bytes > 0x7fffffff)
+    return "> 2GB";
+  return mtype_memstr (buf, len, bytes);
+}
+
 static int
 show_memory_mallinfo (struct vty *vty)
 {
@@ -365,22 +789,22 @@ show_memory_mallinfo (struct vty *vty)
   
   vty_out (vty, "System allocator statistics:%s", VTY_NEWLINE);
   vty_out (vty, "  Total heap allocated:  %s%s",
-           mtype_memstr (buf, MTYPE_MEMSTR_LEN, minfo.arena),
+           mallinfo_memstr (buf, MTYPE_MEMSTR_LEN, minfo.arena),
            VTY_NEWLINE);
   vty_out (vty, "  Holding block headers: %s%s",
-           mtype_memstr (buf, MTYPE_MEMSTR_LEN, minfo.hblkhd),
+           mallinfo_memstr (buf, MTYPE_MEMSTR_LEN, minfo.hblkhd),
            VTY_NEWLINE);
   vty_out (vty, "  Used small blocks:     %s%s",
-           mtype_memstr (buf, MTYPE_MEMSTR_LEN, minfo.usmblks),
+           mallinfo_memstr (buf, MTYPE_MEMSTR_LEN, minfo.usmblks),
            VTY_NEWLINE);
   vty_out (vty, "  Used ordinary blocks:  %s%s",
-           mtype_memstr (buf, MTYPE_MEMSTR_LEN, minfo.uordblks),
+           mallinfo_memstr (buf, MTYPE_MEMSTR_LEN, minfo.uordblks),
            VTY_NEWLINE);
   vty_out (vty, "  Free small blocks:     %s%s",
-           mtype_memstr (buf, MTYPE_MEMSTR_LEN, minfo.fsmblks),
+           mallinfo_memstr (buf, MTYPE_MEMSTR_LEN, minfo.fsmblks),
            VTY_NEWLINE);
   vty_out (vty, "  Free ordinary blocks:  %s%s",
-           mtype_memstr (buf, MTYPE_MEMSTR_LEN, minfo.fordblks),
+           mallinfo_memstr (buf, MTYPE_MEMSTR_LEN, minfo.fordblks),
            VTY_NEWLINE);
   vty_out (vty, "  Ordinary blocks:       %ld%s",
            (unsigned long)minfo.ordblks,
@@ -397,6 +821,64 @@ show_memory_mallinfo (struct vty *vty)
 }
 #endif /* HAVE_MALLINFO */
 
+static const char *
+mtype_name (int type)
+{
+  struct mlist *ml;
+  struct memory_list *m;
+
+  for (ml = mlists; ml->list; ml++)
+    for (m = ml->list; m->index >= 0; m++)
+      if (m->index == type)
+        return m->format;
+  return "unknown";
+}
+
+static int
+show_memory_slab (struct vty *vty, int needsep)
+{
+  struct mem_cache *cache;
+  char buf[MTYPE_MEMSTR_LEN];
+  unsigned long slabs = 0;
+  int type;
+  int shown = 0;
+
+  for (type = 1; type < MTYPE_MAX; type++)
+    {
+      unsigned long capacity;
+
+      if ((cache = mslab[type]) == NULL)
+        continue;
+
+      if (!shown)
+        {
+          if (needsep)
+            show_separator (vty);
+          vty_out (vty, "Slab allocator statistics:%s", VTY_NEWLINE);
+          vty_out (vty, "  %-26s %6s %7s %10s %10s %5s %10s%s",
+                   "Type", "Size", "Slabs", "In use", "Capacity", "Util",
+                   "Fallback", VTY_NEWLINE);
+          shown = 1;
+        }
+
+      capacity = (cache->slabs - (cache->spare ? 1 : 0)) * cache->perslab;
+      vty_out (vty, "  %-26s %6lu %7lu %10lu %10lu %4lu%% %10lu%s%s",
+               mtype_name (type), (unsigned long) cache->size,
+               cache->slabs, cache->inuse, capacity,
+               capacity ? cache->inuse * 100 / capacity : 0,
+               cache->fallback, cache->enabled ? "" : " (disabled)",
+               VTY_NEWLINE);
+      slabs += cache->slabs;
+    }
+
+  if (!shown)
+    return needsep;
+  vty_out (vty, "  Total held in slabs:   %s%s",
+           mtype_memstr (buf, MTYPE_MEMSTR_LEN, slabs * MEM_SLAB_SIZE),
+           VTY_NEWLINE);
+  return 1;
+}
+
 DEFUN (show_memory,
        show_memory_cmd,
        "show memory",
@@ -409,6 +891,16 @@ DEFUN (show_memory,
 #ifdef HAVE_MALLINFO
   needsep = show_memory_mallinfo (vty);
 #endif /* HAVE_MALLINFO */
+
+  needsep = show_memory_slab (vty, needsep);
+
+#ifdef MEMORY_BYTES
+  if (needsep)
+    show_separator (vty);
+  vty_out (vty, "%-30s: %10s %10s %10s%s", "Memory type", "Allocs",
+           "Bytes", "Peak", VTY_NEWLINE);
+  needsep = 0;
+#endif /* MEMORY_BYTES */
   
   for (ml = mlists; ml->list; ml++)
     {
@@ -420,13 +912,102 @@ DEFUN (show_memory,
   return CMD_SUCCESS;
 }
 
+DEFUN (show_memory_dump,
+       show_memory_dump_cmd,
+       "show memory dump",
+       "Show running system information\n"
+       "Memory statistics\n"
+       "Per type counters as comma separated values\n")
+{
+  const char *daemon = zlog_default ?
+                       zlog_proto_names[zlog_default->protocol] : "";
+  struct mlist *ml;
+  struct memory_list *m;
+
+  vty_out (vty, "# daemon,module,type,allocations,bytes,peak_bytes%s",
+           VTY_NEWLINE);
+  for (ml = mlists; ml->list; ml++)
+    for (m = ml->list; m->index >= 0; m++)
+      if (m->index && (mstat[m->index].alloc || mstat[m->index].peak))
+        vty_out (vty, "%s,%s,\"%s\",%ld,%lu,%lu%s", daemon, ml->name,
+                 m->format, mstat[m->index].alloc,
+                 (unsigned long) mstat[m->index].bytes,
+                 (unsigned long) mstat[m->index].peak, VTY_NEWLINE);
+
+  return CMD_SUCCESS;
+}
+
+/* Types that route table nodes are allocated as. */
+static const int route_node_types[] =
+{
+  MTYPE_ROUTE_NODE,
+  MTYPE_BGP_NODE,
+  MTYPE_RIPNG_NODE,
+};
+
+DEFUN (show_memory_route_node,
+       show_memory_route_node_cmd,
+       "show memory route-node",
+       "Show running system information\n"
+       "Memory statistics\n"
+       "Memory used per route table node\n")
+{
+  char buf[MTYPE_MEMSTR_LEN];
+  unsigned int i;
+
+  vty_out (vty, "%-26s %10s %6s %10s %10s%s", "Node type", "Nodes",
+           "Size", "Bytes/node", "Total", VTY_NEWLINE);
+
+  for (i = 0; i < array_size (route_node_types); i++)
+    {
+      int type = route_node_types[i];
+      char size[16] = "-";
+
+      if (mstat[type].alloc == 0)
+        continue;
+      /* What the node itself takes, if known from its slab cache. */
+      if (mslab[type])
+        snprintf (size, sizeof (size), "%lu",
+                  (unsigned long) mslab[type]->size);
+#ifdef MEMORY_BYTES
+      vty_out (vty, "%-26s %10ld %6s %10lu %10s%s", mtype_name (type),
+               mstat[type].alloc, size,
+               (unsigned long) (mstat[type].bytes / mstat[type].alloc),
+               mtype_memstr (buf, MTYPE_MEMSTR_LEN, mstat[type].bytes),
+               VTY_NEWLINE);
+#else
+      vty_out (vty, "%-26s %10ld %6s %10s %10s%s", mtype_name (type),
+               mstat[type].alloc, size, "-", "-", VTY_NEWLINE);
+#endif /* MEMORY_BYTES */
+    }
+
+#ifdef MEMORY_BYTES
+  if (mstat[MTYPE_ROUTE_TABLE_INDEX].alloc)
+    vty_out (vty, "%-26s %10ld %6s %10s %10s%s",
+             mtype_name (MTYPE_ROUTE_TABLE_INDEX),
+             mstat[MTYPE_ROUTE_TABLE_INDEX].alloc, "", "",
+             mtype_memstr (buf, MTYPE_MEMSTR_LEN,
+                           mstat[MTYPE_ROUTE_TABLE_INDEX].bytes),
+             VTY_NEWLINE);
+#endif /* MEMORY_BYTES */
+
+  return CMD_SUCCESS;
+}
 
 void
 memory_init (void)
 {
+  memory_slab_enable (MTYPE_THREAD, sizeof (struct thread));
+  memory_slab_enable (MTYPE_STREAM, sizeof (struct stream));
+  memory_slab_enable (MTYPE_ROUTE_NODE, sizeof (struct route_node));
+
   install_element (RESTRICTED_NODE, &show_memory_cmd);
+  install_element (RESTRICTED_NODE, &show_memory_dump_cmd);
+  install_element (RESTRICTED_NODE, &show_memory_route_node_cmd);
 
   install_element (VIEW_NODE, &show_memory_cmd);
+  install_element (VIEW_NODE, &show_memory_dump_cmd);
+  install_element (VIEW_NODE, &show_memory_route_node_cmd);
 }
 
 /* Stats querying from users */
@@ -440,7 +1021,7 @@ memory_init (void)
 const char *
 mtype_memstr (char *buf, size_t len, unsigned long bytes)
 {
-  unsigned int m, k;
+  unsigned long g, m, k;
 
   /* easy cases */
   if (!bytes)
@@ -448,30 +1029,27 @@ mtype_memstr (char *buf, size_t len, unsigned long bytes)
   if (bytes == 1)
     return "1 byte";
 
-  /*
-   * When we pass the 2gb barrier mallinfo() can no longer report
-   * correct data so it just does something odd...
-   * Reporting like Terrabytes of data.  Which makes users...
-   * edgy.. yes edgy that's the term for it.
-   * So let's just give up gracefully
-   */
-  if (bytes > 0x7fffffff)
-    return "> 2GB";
-
+  g = bytes >> 30;
   m = bytes >> 20;
   k = bytes >> 10;
 
- if (m > 10)
+  if (g > 10)
+    {
+      if (bytes & (1 << 29))
+        g++;
+      snprintf (buf, len, "%lu GiB", g);
+    }
+  else if (m > 10)
     {
       if (bytes & (1 << 19))
         m++;
-      snprintf (buf, len, "%d MiB", m);
+      snprintf (buf, len, "%lu MiB", m);
     }
   else if (k > 10)
     {
       if (bytes & (1 << 9))
         k++;
-      snprintf (buf, len, "%d KiB", k);
+      snprintf (buf, len, "%lu KiB", k);
     }
   else
     snprintf (buf, len, "%ld bytes", bytes);
@@ -484,3 +1062,10 @@ mtype_stats_alloc (int type)
 {
   return mstat[type].alloc;
 }
+
+/* return bytes outstanding for the type, 0 if not known */
+size_t
+mtype_stats_bytes (int type)
+{
+  return mstat[type].bytes;
+}
@@ -85,11 +85,16 @@ extern void mtype_zfree (const char *file, int line, int type,
 extern char *mtype_zstrdup (const char *file, int line, int type,
 		            const char *str);
 extern void memory_init (void);
+extern void memory_slab_enable (int type, size_t size);
+extern void memory_slab_disable (int type);
 extern void log_memstats_stderr (const char *);
 
 /* return number of allocations outstanding for the type */
 extern unsigned long mtype_stats_alloc (int);
 
+/* return bytes outstanding for the type, 0 if not known */
+extern size_t mtype_stats_bytes (int);
+
 /* Human friendly string for given byte count */
 #define MTYPE_MEMSTR_LEN 20
 extern const char *mtype_memstr (char *, size_t, unsigned long);
@@ -21,6 +21,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_THREAD,		"Thread"			},
   { MTYPE_THREAD_MASTER,	"Thread master"			},
   { MTYPE_THREAD_STATS,		"Thread stats"			},
+  { MTYPE_THREAD_EVENT_INDEX,	"Thread event index"		},
   { MTYPE_VTY,			"VTY"				},
   { MTYPE_VTY_OUT_BUF,		"VTY output buffer"		},
   { MTYPE_VTY_HIST,		"VTY history"			},
@@ -40,6 +41,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_HASH_INDEX,		"Hash Index"			},
   { MTYPE_ROUTE_TABLE,		"Route table"			},
   { MTYPE_ROUTE_NODE,		"Route node"			},
+  { MTYPE_ROUTE_TABLE_INDEX,	"Route table lookup index"	},
   { MTYPE_DISTRIBUTE,		"Distribute list"		},
   { MTYPE_DISTRIBUTE_IFNAME,	"Dist-list ifname"		},
   { MTYPE_ACCESS_LIST,		"Access List"			},
@@ -66,6 +68,8 @@ struct memory_list memory_list_lib[] =
   { MTYPE_WORK_QUEUE,		"Work queue"			},
   { MTYPE_WORK_QUEUE_ITEM,	"Work queue item"		},
   { MTYPE_WORK_QUEUE_NAME,	"Work queue name string"	},
+  { MTYPE_WORK_POOL,		"Worker pool"			},
+  { MTYPE_WORK_POOL_JOB,	"Worker pool job"		},
   { MTYPE_PQUEUE,		"Priority queue"		},
   { MTYPE_PQUEUE_DATA,		"Priority queue data"		},
   { MTYPE_HOST,			"Host config"			},
@@ -88,7 +92,12 @@ struct memory_list memory_list_zebra[] =
   { MTYPE_RIB_TABLE_INFO,	"RIB table info"		},
   { MTYPE_NETLINK_NAME,	"Netlink name"			},
   { MTYPE_NETLINK_RCVBUF,	"Netlink receive buffer"	},
+  { MTYPE_NETLINK_BATCH,	"Netlink batch"			},
+  { MTYPE_NETLINK_PENDING,	"Netlink pending change"	},
   { MTYPE_RNH,		        "Nexthop tracking object"	},
+  { MTYPE_NHG,			"Nexthop group"			},
+  { MTYPE_ZSERV_NHG,		"Client nexthop group"		},
+  { MTYPE_ZSERV_REDIST,		"Client redistributed route"	},
   { -1, NULL },
 };
 
@@ -119,6 +128,13 @@ struct memory_list memory_list_bgp[] =
   { MTYPE_BGP_SYNCHRONISE,	"BGP synchronise"		},
   { MTYPE_BGP_ADJ_IN,		"BGP adj in"			},
   { MTYPE_BGP_ADJ_OUT,		"BGP adj out"			},
+  { MTYPE_BGP_ADJ_SHARED,	"BGP shared adj out"		},
+  { MTYPE_BGP_UPDGRP,		"BGP update group"		},
+  { MTYPE_BGP_UPDGRP_PACKET,	"BGP update group packet"	},
+  { MTYPE_BGP_UPDGRP_RMAP,	"BGP update group route map"	},
+  { MTYPE_BGP_DECODE,		"BGP UPDATE decode"		},
+  { MTYPE_BGP_PIC,		"BGP PIC nexthop group"		},
+  { MTYPE_BGP_PIC_ADDR,		"BGP PIC nexthop group address"	},
   { MTYPE_BGP_MPATH_INFO,	"BGP multipath info"		},
   { 0, NULL },
   { MTYPE_AS_LIST,		"BGP AS list"			},
@@ -143,6 +159,7 @@ struct memory_list memory_list_bgp[] =
   { MTYPE_CLUSTER_VAL,		"Cluster list val"		},
   { 0, NULL },
   { MTYPE_BGP_PROCESS_QUEUE,	"BGP Process queue"		},
+  { MTYPE_BGP_PROCESS_BATCH,	"BGP Process batch"		},
   { MTYPE_BGP_CLEAR_NODE_QUEUE, "BGP node clear queue"		},
   { 0, NULL },
   { MTYPE_TRANSIT,		"BGP transit attr"		},
@@ -180,6 +197,7 @@ struct memory_list memory_list_ripng[] =
   { MTYPE_RIPNG,              "RIPng structure"			},
   { MTYPE_RIPNG_ROUTE,        "RIPng route info"		},
   { MTYPE_RIPNG_AGGREGATE,    "RIPng aggregate"			},
+  { MTYPE_RIPNG_NODE,         "RIPng route node"		},
   { MTYPE_RIPNG_PEER,         "RIPng peer"			},
   { MTYPE_RIPNG_OFFSET_LIST,  "RIPng offset lst"		},
   { MTYPE_RIPNG_RTE_DATA,     "RIPng rte data"			},
@@ -22,6 +22,7 @@
  * 02111-1307, USA.  
  */
 #include <zebra.h>
+#include <pthread.h>
 #include "log.h"
 #include "privs.h"
 #include "memory.h"
@@ -62,6 +63,14 @@ typedef priv_set_t *pstorage_t;
  */
 static zebra_privs_current_t zprivs_null_state = ZPRIVS_RAISED;
 
+/* Privileges may be changed from worker threads too.  Capabilities are
+ * per thread, but changed through shared working storage; the effective
+ * uid is shared by all threads, so raises are counted, and privileges
+ * are only lowered by the last thread to lower them.
+ */
+static pthread_mutex_t zprivs_mtx = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int zprivs_raised;
+
 /* internal privileges state */
 static struct _zprivs_t
 {
@@ -186,6 +195,7 @@ int
 zprivs_change_caps (zebra_privs_ops_t op)
 {
   cap_flag_value_t cflag;
+  int ret = -1;
   
   /* should be no possibility of being called without valid caps */
   assert (zprivs_state.syscaps_p && zprivs_state.caps);
@@ -199,12 +209,14 @@ zprivs_change_caps (zebra_privs_ops_t op)
   else
     return -1;
 
+  pthread_mutex_lock (&zprivs_mtx);
   if ( !cap_set_flag (zprivs_state.caps, CAP_EFFECTIVE,
                        zprivs_state.syscaps_p->num, 
                        zprivs_state.syscaps_p->caps, 
                        cflag))
-    return cap_set_proc (zprivs_state.caps);
-  return -1;
+    ret = cap_set_proc (zprivs_state.caps);
+  pthread_mutex_unlock (&zprivs_mtx);
+  return ret;
 }
 
 zebra_privs_current_t
@@ -602,13 +614,24 @@ zprivs_caps_terminate (void)
 int
 zprivs_change_uid (zebra_privs_ops_t op)
 {
+  int ret = 0;
 
+  pthread_mutex_lock (&zprivs_mtx);
   if (op == ZPRIVS_RAISE)
-    return seteuid (zprivs_state.zsuid);
+    {
+      if (zprivs_raised++ == 0 && (ret = seteuid (zprivs_state.zsuid)) < 0)
+        zprivs_raised--;
+    }
   else if (op == ZPRIVS_LOWER)
-    return seteuid (zprivs_state.zuid);
+    {
+      if (zprivs_raised == 0 || --zprivs_raised == 0)
+        ret = seteuid (zprivs_state.zuid);
+    }
   else
-    return -1;
+    ret = -1;
+  pthread_mutex_unlock (&zprivs_mtx);
+
+  return ret;
 }
 
 zebra_privs_current_t
@@ -864,6 +864,52 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
   return RMAP_DENYMATCH;
 }
 
+static int
+route_map_rule_list_has (struct route_map_rule_list *list,
+                         struct route_map_rule_cmd *cmd, const char *arg)
+{
+  struct route_map_rule *rule;
+
+  for (rule = list->head; rule; rule = rule->next)
+    if (rule->cmd == cmd
+        && (arg == NULL || (rule->rule_str && strstr (rule->rule_str, arg))))
+      return 1;
+  return 0;
+}
+
+static int
+route_map_has_rule_depth (struct route_map *map,
+                          struct route_map_rule_cmd *cmd, const char *arg,
+                          int depth)
+{
+  struct route_map_index *index;
+
+  if (map == NULL || depth > RMAP_RECURSION_LIMIT)
+    return 0;
+
+  for (index = map->head; index; index = index->next)
+    {
+      if (route_map_rule_list_has (&index->match_list, cmd, arg)
+          || route_map_rule_list_has (&index->set_list, cmd, arg))
+        return 1;
+      if (index->nextrm
+          && route_map_has_rule_depth (route_map_lookup_by_name (index->nextrm),
+                                       cmd, arg, depth + 1))
+        return 1;
+    }
+  return 0;
+}
+
+/* Does the route map, or one it calls, have a match or set rule of the
+   given command?  With 'arg', only rules whose argument contains it
+   count. */
+int
+route_map_has_rule (struct route_map *map, struct route_map_rule_cmd *cmd,
+                    const char *arg)
+{
+  return route_map_has_rule_depth (map, cmd, arg, 0);
+}
+
 void
 route_map_add_hook (void (*func) (const char *))
 {
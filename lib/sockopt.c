@@ -71,6 +71,30 @@ getsockopt_so_sendbuf (const int sock)
   return optval;
 }
 
+/* Room left in the socket's send buffer, -1 if the system won't tell. */
+int
+getsockopt_so_send_space (const int sock)
+{
+#if defined (FIONSPACE)
+  int space;
+
+  if (ioctl (sock, FIONSPACE, &space) == 0)
+    return space;
+#elif defined (SIOCOUTQ)
+  int size, queued;
+
+  /* Linux reports twice the size that was set, keeping half of it for
+   * its own bookkeeping. */
+  if ((size = getsockopt_so_sendbuf (sock)) >= 0
+      && ioctl (sock, SIOCOUTQ, &queued) == 0)
+    {
+      size /= 2;
+      return queued < size ? size - queued : 0;
+    }
+#endif
+  return -1;
+}
+
 static void *
 getsockopt_cmsg_data (struct msghdr *msgh, int level, int type)
 {
@@ -120,6 +120,21 @@ stream_free (struct stream *s)
 {
   if (!s)
     return;
+
+  if (s->owner)
+    {
+      struct stream *owner = s->owner;
+
+      XFREE (MTYPE_STREAM, s);
+      s = owner;
+    }
+
+  /* Data still used by another stream. */
+  if (s->refcnt)
+    {
+      s->refcnt--;
+      return;
+    }
   
   XFREE (MTYPE_STREAM_DATA, s->data);
   XFREE (MTYPE_STREAM, s);
@@ -173,11 +188,30 @@ stream_dupcat (struct stream *s1, struct stream *s2, size_t offset)
   return new;
 }
 
+struct stream *
+stream_share (struct stream *s)
+{
+  struct stream *owner = s->owner ? s->owner : s;
+  struct stream *new;
+
+  STREAM_VERIFY_SANE (s);
+
+  new = XCALLOC (MTYPE_STREAM, sizeof (struct stream));
+  new->data = owner->data;
+  new->size = s->size;
+  new->endp = s->endp;
+  new->owner = owner;
+  owner->refcnt++;
+
+  return new;
+}
+
 size_t
 stream_resize (struct stream *s, size_t newsize)
 {
   u_char *newdata;
   STREAM_VERIFY_SANE (s);
+  assert (!s->owner && !s->refcnt);
   
   newdata = XREALLOC (MTYPE_STREAM_DATA, s->data, newsize);
   
@@ -980,6 +1014,8 @@ stream_discard (struct stream *s)
       return;
     }
   
+  /* Sharers see the data where it is. */
+  assert (!s->owner && !s->refcnt);
   s->data = memmove (s->data, s->data + s->getp, s->endp - s->getp);
   s->endp -= s->getp;
   s->getp = 0;
@@ -104,6 +104,10 @@ struct stream
   size_t endp;		/* last valid data position */
   size_t size;		/* size of data segment */
   unsigned char *data; /* data pointer */
+
+  /* Sharing of the data segment, see stream_share() */
+  struct stream *owner;	/* stream the data belongs to, if shared */
+  unsigned int refcnt;	/* other streams sharing this one's data */
 };
 
 /* First in first out queue structure. */
@@ -156,6 +160,14 @@ extern u_char *stream_get_data (struct stream *);
 extern struct stream *stream_dupcat(struct stream *s1, struct stream *s2,
 				    size_t offset);
 
+/*
+ * Create a new stream sharing the data of the given one, rather than
+ * copying it.  Both have their own getp, but from then on the data
+ * must not be written to through either.  It is released once every
+ * stream sharing it has been freed.
+ */
+extern struct stream *stream_share (struct stream *);
+
 extern void stream_set_getp (struct stream *, size_t);
 extern void stream_set_endp (struct stream *, size_t);
 extern void stream_forward_getp (struct stream *, size_t);
@@ -29,6 +29,8 @@
 
 static void route_node_delete (struct route_node *);
 static void route_table_free (struct route_table *);
+static void route_index_update (struct route_table *, const struct prefix *);
+static void route_index_build (struct route_table *);
 
 
 /*
@@ -129,6 +131,8 @@ route_table_free (struct route_table *rt)
  
   assert (rt->count == 0);
 
+  if (rt->index)
+    XFREE (MTYPE_ROUTE_TABLE_INDEX, rt->index);
   XFREE (MTYPE_ROUTE_TABLE, rt);
   return;
 }
@@ -183,6 +187,76 @@ set_link (struct route_node *node, struct route_node *new)
   new->parent = node;
 }
 
+/* First ROUTE_TABLE_INDEX_BITS bits of a prefix. */
+static inline unsigned int
+route_index_slot (const struct prefix *p)
+{
+  const u_char *bytes = &p->u.prefix;
+
+  return (bytes[0] << 8) | bytes[1];
+}
+
+/* Find the index entry for a slot by walking down the tree: the first
+   node at least ROUTE_TABLE_INDEX_BITS long if it covers the slot, or
+   else the last shorter node covering it. */
+static struct route_node *
+route_index_walk (const struct route_table *table, unsigned int slot)
+{
+  struct route_node *node = table->top;
+  struct route_node *prev = NULL;
+  unsigned int plen;
+
+  while (node && (plen = node->p.prefixlen) < ROUTE_TABLE_INDEX_BITS)
+    {
+      if (plen && ((route_index_slot (&node->p) ^ slot)
+                   >> (ROUTE_TABLE_INDEX_BITS - plen)))
+        return prev;
+      prev = node;
+      node = node->link[(slot >> (ROUTE_TABLE_INDEX_BITS - 1 - plen)) & 1];
+    }
+
+  if (node && route_index_slot (&node->p) == slot)
+    return node;
+  return prev;
+}
+
+/* Refresh the index entries of all slots the prefix covers, after
+   a node with this prefix was linked into or out of the tree. */
+static void
+route_index_update (struct route_table *table, const struct prefix *p)
+{
+  unsigned int slot, last;
+
+  if (table->index == NULL)
+    return;
+
+  slot = route_index_slot (p);
+  if (p->prefixlen >= ROUTE_TABLE_INDEX_BITS)
+    last = slot;
+  else
+    {
+      unsigned int span = 1 << (ROUTE_TABLE_INDEX_BITS - p->prefixlen);
+
+      slot &= ~(span - 1);
+      last = slot + span - 1;
+    }
+
+  for (; slot <= last; slot++)
+    table->index[slot] = route_index_walk (table, slot);
+}
+
+static void
+route_index_build (struct route_table *table)
+{
+  unsigned int slot;
+
+  table->index = XMALLOC (MTYPE_ROUTE_TABLE_INDEX,
+                          sizeof (struct route_node *)
+                          * ROUTE_TABLE_INDEX_SLOTS);
+  for (slot = 0; slot < ROUTE_TABLE_INDEX_SLOTS; slot++)
+    table->index[slot] = route_index_walk (table, slot);
+}
+
 /* Lock node. */
 struct route_node *
 route_lock_node (struct route_node *node)
@@ -208,10 +282,27 @@ route_node_match (const struct route_table *table, const struct prefix *p)
 {
   struct route_node *node;
   struct route_node *matched;
+  struct route_node *above;
 
   matched = NULL;
   node = table->top;
 
+  /* Skip the top of the tree through the index.  Nodes above the
+     entry all cover p, the best of them is found going up if there
+     is nothing better below. */
+  above = NULL;
+  if (table->index && p->prefixlen >= ROUTE_TABLE_INDEX_BITS)
+    {
+      node = table->index[route_index_slot (p)];
+      if (node && node->p.prefixlen < ROUTE_TABLE_INDEX_BITS)
+        {
+          above = node;
+          node = NULL;
+        }
+      else if (node)
+        above = node->parent;
+    }
+
   /* Walk down tree.  If there is matched route then store it to
      matched. */
   while (node && node->p.prefixlen <= p->prefixlen && 
@@ -226,6 +317,10 @@ route_node_match (const struct route_table *table, const struct prefix *p)
       node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
     }
 
+  if (matched == NULL)
+    for (matched = above; matched && !matched->info; matched = matched->parent)
+      ;
+
   /* If matched route found, return it. */
   if (matched)
     return route_lock_node (matched);
@@ -273,6 +368,15 @@ route_node_lookup (const struct route_table *table, const struct prefix *p)
 
   node = table->top;
 
+  /* A prefix covered by a single index slot can only be below the
+     long node of the slot. */
+  if (table->index && prefixlen >= ROUTE_TABLE_INDEX_BITS)
+    {
+      node = table->index[route_index_slot (p)];
+      if (node && node->p.prefixlen < ROUTE_TABLE_INDEX_BITS)
+        return NULL;
+    }
+
   while (node && node->p.prefixlen <= prefixlen &&
 	 prefix_match (&node->p, p))
     {
@@ -290,6 +394,7 @@ struct route_node *
 route_node_get (struct route_table *const table, const struct prefix *p)
 {
   struct route_node *new;
+  struct route_node *glue;
   struct route_node *node;
   struct route_node *match;
   u_char prefixlen = p->prefixlen;
@@ -297,6 +402,21 @@ route_node_get (struct route_table *const table, const struct prefix *p)
 
   match = NULL;
   node = table->top;
+
+  if (table->index && prefixlen >= ROUTE_TABLE_INDEX_BITS)
+    {
+      node = table->index[route_index_slot (p)];
+      if (node == NULL)
+        node = table->top;
+      else if (node->p.prefixlen >= ROUTE_TABLE_INDEX_BITS)
+        match = node->parent;
+      else
+        {
+          match = node;
+          node = node->link[prefix_bit(prefix, node->p.prefixlen)];
+        }
+    }
+
   while (node && node->p.prefixlen <= prefixlen &&
 	 prefix_match (&node->p, p))
     {
@@ -314,10 +434,11 @@ route_node_get (struct route_table *const table, const struct prefix *p)
 	set_link (match, new);
       else
 	table->top = new;
+      route_index_update (table, &new->p);
     }
   else
     {
-      new = route_node_new (table);
+      new = glue = route_node_new (table);
       route_common (&node->p, p, &new->p);
       new->p.family = p->family;
       new->table = table;
@@ -335,9 +456,14 @@ route_node_get (struct route_table *const table, const struct prefix *p)
 	  set_link (match, new);
 	  table->count++;
 	}
+      route_index_update (table, &glue->p);
     }
   table->count++;
   route_lock_node (new);
+
+  if (table->index == NULL && table->delegate->lookup_index
+      && table->count >= ROUTE_TABLE_INDEX_MIN)
+    route_index_build (table);
   
   return new;
 }
@@ -376,6 +502,7 @@ route_node_delete (struct route_node *node)
     node->table->top = child;
 
   node->table->count--;
+  route_index_update (node->table, &node->p);
 
   route_node_free (node->table, node);
 
@@ -520,6 +647,15 @@ static route_table_delegate_t default_delegate = {
   .destroy_node = route_node_destroy
 };
 
+/*
+ * Default delegate, with a lookup index for large tables.
+ */
+static route_table_delegate_t indexed_delegate = {
+  .create_node = route_node_create,
+  .destroy_node = route_node_destroy,
+  .lookup_index = 1
+};
+
 /*
  * route_table_init
  */
@@ -529,6 +665,18 @@ route_table_init (void)
   return route_table_init_with_delegate (&default_delegate);
 }
 
+/*
+ * route_table_init_indexed
+ *
+ * Route table using the default nodes and a lookup index, for tables
+ * expected to be large and searched a lot.
+ */
+struct route_table *
+route_table_init_indexed (void)
+{
+  return route_table_init_with_delegate (&indexed_delegate);
+}
+
 /**
  * route_table_prefix_iter_cmp
  *
@@ -47,8 +47,29 @@ struct route_table_delegate_t_
 {
   route_table_create_node_func_t create_node;
   route_table_destroy_node_func_t destroy_node;
+
+  /*
+   * Once the table grows past ROUTE_TABLE_INDEX_MIN nodes, keep a
+   * lookup index for it, see below.  Optional.
+   */
+  int lookup_index;
 };
 
+/*
+ * Lookup index.
+ *
+ * A level compressed jump table over the first ROUTE_TABLE_INDEX_BITS
+ * bits of the key.  For every value of those bits it points at the
+ * first node of the tree with a prefix at least that long covering
+ * it, or failing that, the deepest shorter node covering it.  Lookups
+ * for prefixes of at least ROUTE_TABLE_INDEX_BITS then skip the top
+ * levels of the tree.  The tree itself is unchanged, and so is
+ * iteration.
+ */
+#define ROUTE_TABLE_INDEX_BITS  16
+#define ROUTE_TABLE_INDEX_SLOTS (1 << ROUTE_TABLE_INDEX_BITS)
+#define ROUTE_TABLE_INDEX_MIN   1024
+
 /* Routing table top structure. */
 struct route_table
 {
@@ -60,6 +81,12 @@ struct route_table
   route_table_delegate_t *delegate;
   
   unsigned long count;
+
+  /*
+   * Lookup index, if the delegate asks for one and the table is
+   * large enough.
+   */
+  struct route_node **index;
   
   /*
    * User data.
@@ -69,6 +96,10 @@ struct route_table
 
 /*
  * Macro that defines all fields in a route node.
+ *
+ * There are a great many nodes in a full table, so keep this small.
+ * The lock comes last, so that users embedding these fields can pack
+ * small fields of their own into the space after it.
  */
 #define ROUTE_NODE_FIELDS			\
   /* Actual prefix of this radix. */		\
@@ -79,14 +110,11 @@ struct route_table
   struct route_node *parent;			\
   struct route_node *link[2];			\
 						\
-  /* Lock of this radix */			\
-  unsigned int lock;				\
-						\
   /* Each node of route. */			\
   void *info;					\
 						\
-  /* Aggregation. */				\
-  void *aggregate;
+  /* Lock of this radix */			\
+  unsigned int lock;
 
 
 /* Each routing entry. */
@@ -137,6 +165,7 @@ struct route_table_iter_t_
 
 /* Prototypes. */
 extern struct route_table *route_table_init (void);
+extern struct route_table *route_table_init_indexed (void);
 
 extern struct route_table *
 route_table_init_with_delegate (route_table_delegate_t *);
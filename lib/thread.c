@@ -28,9 +28,16 @@
 #include "memory.h"
 #include "log.h"
 #include "hash.h"
+#include "jhash.h"
+#include "linklist.h"
 #include "pqueue.h"
 #include "command.h"
 #include "sigevent.h"
+#include "workpool.h"
+
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #if defined(__APPLE__)
 #include <mach/mach.h>
@@ -48,9 +55,30 @@ static unsigned short timers_inited;
 
 static struct hash *cpu_record = NULL;
 
+/* All thread masters, for show thread timers */
+static struct list *masters = NULL;
+
 /* Struct timeval's tv_usec one second value.  */
 #define TIMER_SECOND_MICRO 1000000L
 
+#define WHEEL_MASK      (THREAD_WHEEL_SLOTS - 1)
+#define WHEEL_SHIFT(L)  ((L) * THREAD_WHEEL_BITS)
+/* Seconds ahead a timer can be and still go on level L */
+#define WHEEL_RANGE(L)  ((time_t) 1 << WHEEL_SHIFT ((L) + 1))
+
+#ifdef HAVE_EPOLL
+/* Most descriptors taken from the kernel per epoll_wait().  Any beyond
+ * this stay armed, and are simply reported next time round. */
+#define THREAD_EPOLL_MAXEVENTS 256
+
+/* Flag in epoll_mask, alongside EPOLLIN and EPOLLOUT. */
+#define THREAD_EPOLL_REGISTERED 0x80
+
+#define thread_use_epoll(M) ((M)->epoll_fd >= 0)
+#else
+#define thread_use_epoll(M) 0
+#endif /* HAVE_EPOLL */
+
 /* Adjust so that tv_usec is in the range [0,TIMER_SECOND_MICRO).
    And change negative values to 0. */
 static struct timeval
@@ -343,6 +371,10 @@ cpu_record_print(struct vty *vty, thread_type filter)
 
   if (tmp.total_calls > 0)
     vty_out_cpu_thread_history(vty, &tmp);
+
+  /* Worker pools hand their results back as events */
+  if (filter & (1 << THREAD_EVENT))
+    work_pool_cpu_print (vty);
 }
 
 DEFUN(show_thread_cpu,
@@ -426,6 +458,9 @@ cpu_record_clear (thread_type filter)
   hash_iterate (cpu_record,
 	        (void (*) (struct hash_backet*,void*)) cpu_record_hash_clear,
 	        tmp);
+
+  if (filter & (1 << THREAD_EVENT))
+    work_pool_cpu_clear ();
 }
 
 DEFUN(clear_thread_cpu,
@@ -488,6 +523,49 @@ DEFUN(clear_thread_cpu,
   return CMD_SUCCESS;
 }
 
+static void
+thread_timers_show (struct vty *vty, struct thread_master *m)
+{
+  struct thread_wheel *wheel = &m->wheel;
+  int level, i;
+
+  vty_out (vty, "Timer wheel: %u timers%s", wheel->count, VTY_NEWLINE);
+  vty_out (vty, "  Level  Granularity  Slots used  Timers%s", VTY_NEWLINE);
+  for (level = 0; level < THREAD_WHEEL_LEVELS; level++)
+    {
+      unsigned int used = 0, timers = 0;
+
+      for (i = 0; i < THREAD_WHEEL_SLOTS; i++)
+        if (wheel->slot[level][i].count)
+          {
+            used++;
+            timers += wheel->slot[level][i].count;
+          }
+      vty_out (vty, "  %5d  %10lds  %7u/%-3d %6u%s", level,
+               (long) 1 << WHEEL_SHIFT (level), used, THREAD_WHEEL_SLOTS,
+               timers, VTY_NEWLINE);
+    }
+  vty_out (vty, "Timer queue: %d timers%s", m->timer->size, VTY_NEWLINE);
+  vty_out (vty, "Background queue: %d timers%s",
+           m->background->size, VTY_NEWLINE);
+}
+
+DEFUN(show_thread_timers,
+      show_thread_timers_cmd,
+      "show thread timers",
+      SHOW_STR
+      "Thread information\n"
+      "Timer wheel and queue occupancy\n")
+{
+  struct listnode *node;
+  struct thread_master *m;
+
+  if (masters)
+    for (ALL_LIST_ELEMENTS_RO (masters, node, m))
+      thread_timers_show (vty, m);
+  return CMD_SUCCESS;
+}
+
 static int
 thread_timer_cmp(void *a, void *b)
 {
@@ -511,6 +589,45 @@ thread_timer_update(void *node, int actual_position)
   thread->index = actual_position;
 }
 
+/* Events pending against one argument, for thread_cancel_event() */
+struct thread_arg_events
+{
+  void *arg;
+  struct thread *head;
+};
+
+static unsigned int
+thread_arg_events_hash_key (void *p)
+{
+  uintptr_t arg = (uintptr_t) ((struct thread_arg_events *) p)->arg;
+
+  return jhash_2words ((u_int32_t) arg, (u_int32_t) ((u_int64_t) arg >> 32),
+                       0);
+}
+
+static int
+thread_arg_events_hash_cmp (const void *a, const void *b)
+{
+  return ((const struct thread_arg_events *) a)->arg
+         == ((const struct thread_arg_events *) b)->arg;
+}
+
+static void *
+thread_arg_events_hash_alloc (void *p)
+{
+  struct thread_arg_events *new;
+
+  new = XCALLOC (MTYPE_THREAD_EVENT_INDEX, sizeof (struct thread_arg_events));
+  new->arg = ((struct thread_arg_events *) p)->arg;
+  return new;
+}
+
+static void
+thread_arg_events_hash_free (void *p)
+{
+  XFREE (MTYPE_THREAD_EVENT_INDEX, p);
+}
+
 /* Allocate new thread master.  */
 struct thread_master *
 thread_master_create ()
@@ -521,9 +638,12 @@ thread_master_create ()
   getrlimit(RLIMIT_NOFILE, &limit);
 
   if (cpu_record == NULL) 
-    cpu_record 
-      = hash_create ((unsigned int (*) (void *))cpu_record_hash_key,
-		     (int (*) (const void *, const void *))cpu_record_hash_cmp);
+    {
+      cpu_record 
+        = hash_create ((unsigned int (*) (void *))cpu_record_hash_key,
+		       (int (*) (const void *, const void *))cpu_record_hash_cmp);
+      hash_set_name (cpu_record, "Thread CPU records");
+    }
 
   rv = XCALLOC (MTYPE_THREAD_MASTER, sizeof (struct thread_master));
   if (rv == NULL)
@@ -553,6 +673,31 @@ thread_master_create ()
   rv->timer->cmp = rv->background->cmp = thread_timer_cmp;
   rv->timer->update = rv->background->update = thread_timer_update;
 
+  quagga_get_relative (NULL);
+  rv->wheel.now = relative_time.tv_sec;
+
+  rv->event_index = hash_create (thread_arg_events_hash_key,
+                                 thread_arg_events_hash_cmp);
+  hash_set_name (rv->event_index, "Thread events by argument");
+
+  if (masters == NULL)
+    masters = list_new ();
+  listnode_add (masters, rv);
+
+#ifdef HAVE_EPOLL
+  /* select() remains available should the kernel not support epoll. */
+  rv->epoll_fd = epoll_create (rv->fd_limit);
+  if (rv->epoll_fd >= 0)
+    {
+      rv->epoll_mask = XCALLOC (MTYPE_THREAD, rv->fd_limit);
+      rv->epoll_events = XCALLOC (MTYPE_THREAD, sizeof (struct epoll_event)
+                                                * THREAD_EPOLL_MAXEVENTS);
+    }
+  else
+    zlog_warn ("epoll_create() failed, using select(): %s",
+               safe_strerror (errno));
+#endif /* HAVE_EPOLL */
+
   return rv;
 }
 
@@ -587,6 +732,76 @@ thread_list_delete (struct thread_list *list, struct thread *thread)
   return thread;
 }
 
+#ifdef HAVE_EPOLL
+/* Arm epoll for the read and write threads now pending on fd.
+ * Descriptors are registered one-shot: the kernel disarms them as it
+ * reports them, so dispatching a thread costs nothing and re-adding it
+ * costs a single EPOLL_CTL_MOD.  m->epoll_mask[fd] always holds exactly
+ * the events armed, which is why it can't go stale if the descriptor is
+ * closed and its number reused.
+ */
+static int
+thread_epoll_arm (struct thread_master *m, int fd)
+{
+  struct epoll_event ev;
+  unsigned char state = m->epoll_mask[fd];
+  unsigned char want = 0;
+  int op;
+
+  if (m->read[fd])
+    want |= EPOLLIN;
+  if (m->write[fd])
+    want |= EPOLLOUT;
+
+  if (want == (state & (EPOLLIN|EPOLLOUT)))
+    return 0;
+
+  if (!want)
+    op = EPOLL_CTL_DEL;
+  else if (state & THREAD_EPOLL_REGISTERED)
+    op = EPOLL_CTL_MOD;
+  else
+    op = EPOLL_CTL_ADD;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = want | EPOLLONESHOT;
+  ev.data.fd = fd;
+
+  if (epoll_ctl (m->epoll_fd, op, fd, &ev) < 0)
+    {
+      /* Closing a descriptor silently drops it from the interest set,
+       * and dup()ed ones may still be in it, so retry the other way.
+       */
+      if (op == EPOLL_CTL_ADD && errno == EEXIST)
+        op = EPOLL_CTL_MOD;
+      else if (op == EPOLL_CTL_MOD && errno == ENOENT)
+        op = EPOLL_CTL_ADD;
+      else if (op == EPOLL_CTL_DEL && (errno == ENOENT || errno == EBADF))
+        op = -1;
+      else
+        {
+          /* Regular files can't be polled, the caller deals with it. */
+          if (errno != EPERM)
+            zlog_warn ("epoll_ctl() on fd %d failed: %s",
+                       fd, safe_strerror (errno));
+          m->epoll_mask[fd] = 0;
+          return -1;
+        }
+
+      if (op >= 0 && epoll_ctl (m->epoll_fd, op, fd, &ev) < 0)
+        {
+          zlog_warn ("epoll_ctl() on fd %d failed: %s",
+                     fd, safe_strerror (errno));
+          m->epoll_mask[fd] = 0;
+          return -1;
+        }
+    }
+
+  m->epoll_mask[fd] = want ? (want | THREAD_EPOLL_REGISTERED) : 0;
+  return 0;
+}
+#endif /* HAVE_EPOLL */
+
 static void
 thread_delete_fd (struct thread **thread_array, struct thread *thread)
 {
@@ -657,6 +872,17 @@ thread_queue_free (struct thread_master *m, struct pqueue *queue)
   pqueue_delete(queue);
 }
 
+static void
+thread_wheel_free (struct thread_master *m)
+{
+  int level, i;
+
+  for (level = 0; level < THREAD_WHEEL_LEVELS; level++)
+    for (i = 0; i < THREAD_WHEEL_SLOTS; i++)
+      thread_list_free (m, &m->wheel.slot[level][i]);
+  m->wheel.count = 0;
+}
+
 /* Stop thread scheduler. */
 void
 thread_master_free (struct thread_master *m)
@@ -666,8 +892,27 @@ thread_master_free (struct thread_master *m)
   thread_queue_free (m, m->timer);
   thread_list_free (m, &m->event);
   thread_list_free (m, &m->ready);
+  hash_clean (m->event_index, thread_arg_events_hash_free);
+  hash_free (m->event_index);
   thread_list_free (m, &m->unuse);
   thread_queue_free (m, m->background);
+  thread_wheel_free (m);
+
+  listnode_delete (masters, m);
+  if (!listcount (masters))
+    {
+      list_delete (masters);
+      masters = NULL;
+    }
+
+#ifdef HAVE_EPOLL
+  if (thread_use_epoll (m))
+    {
+      close (m->epoll_fd);
+      XFREE (MTYPE_THREAD, m->epoll_mask);
+      XFREE (MTYPE_THREAD, m->epoll_events);
+    }
+#endif /* HAVE_EPOLL */
   
   XFREE (MTYPE_THREAD_MASTER, m);
 
@@ -736,6 +981,7 @@ thread_get (struct thread_master *m, u_char type,
   thread->func = func;
   thread->arg = arg;
   thread->index = -1;
+  thread->slot = NULL;
 
   thread->funcname = funcname;
   thread->schedfrom = schedfrom;
@@ -752,6 +998,30 @@ fd_select (int size, thread_fd_set *read, thread_fd_set *write, thread_fd_set *e
   return(select(size, read, write, except, t));
 }
 
+#ifdef HAVE_EPOLL
+static int
+fd_epoll_wait (struct thread_master *m, struct timeval *t)
+{
+  int timeout = -1;
+
+  if (t)
+    {
+      /* Round up, so we don't wake just short of the next timer.  A
+       * timer already due comes as a negative time, which epoll_wait()
+       * would take for no timeout at all. */
+      if (t->tv_sec < 0)
+        timeout = 0;
+      else if (t->tv_sec >= INT_MAX / 1000 - 1)
+        timeout = INT_MAX;
+      else
+        timeout = t->tv_sec * 1000 + (t->tv_usec + 999) / 1000;
+    }
+
+  return epoll_wait (m->epoll_fd, m->epoll_events, THREAD_EPOLL_MAXEVENTS,
+                     timeout);
+}
+#endif /* HAVE_EPOLL */
+
 static int
 fd_is_set (int fd, thread_fd_set *fdset)
 {
@@ -775,27 +1045,45 @@ funcname_thread_add_read_write (int dir, struct thread_master *m,
 {
   struct thread *thread = NULL;
   thread_fd_set *fdset = NULL;
+  struct thread **thread_array;
 
   if (dir == THREAD_READ)
-    fdset = &m->readfd;
+    {
+      fdset = &m->readfd;
+      thread_array = m->read;
+    }
   else
-    fdset = &m->writefd;
+    {
+      fdset = &m->writefd;
+      thread_array = m->write;
+    }
 
-  if (FD_ISSET (fd, fdset))
+  /* The fd_sets aren't used with epoll, but always mirror the arrays. */
+  if (thread_array[fd])
     {
       zlog (NULL, LOG_WARNING, "There is already %s fd [%d]",
 	    (dir = THREAD_READ) ? "read" : "write", fd);
       return NULL;
     }
 
-  FD_SET (fd, fdset);
+  if (!thread_use_epoll (m))
+    FD_SET (fd, fdset);
 
   thread = thread_get (m, dir, func, arg, debugargpass);
   thread->u.fd = fd;
-  if (dir == THREAD_READ)
-    thread_add_fd (m->read, thread);
-  else
-    thread_add_fd (m->write, thread);
+  thread_add_fd (thread_array, thread);
+
+#ifdef HAVE_EPOLL
+  if (thread_use_epoll (m) && thread_epoll_arm (m, fd) < 0)
+    {
+      /* select() reports descriptors it can't poll, such as regular
+       * files, as always ready, so do likewise.
+       */
+      thread_delete_fd (thread_array, thread);
+      thread->type = THREAD_READY;
+      thread_list_add (&m->ready, thread);
+    }
+#endif /* HAVE_EPOLL */
 
   return thread;
 }
@@ -820,12 +1108,127 @@ funcname_thread_add_write (struct thread_master *m,
                                          arg, fd, debugargpass);
 }
 
+/* Timers added with second granularity wait on the timing wheel, where
+ * adding and cancelling them is O(1), until the second they expire in
+ * comes round.  They are then moved onto the timer queue, so that they
+ * still run in exact order with the precise timers.  The wheel is a
+ * classic hierarchical one, higher levels being cascaded down into
+ * lower ones as it turns.
+ */
+static void
+thread_wheel_add (struct thread_master *m, struct thread *thread)
+{
+  struct thread_wheel *wheel = &m->wheel;
+  time_t expires = thread->u.sands.tv_sec;
+  time_t next = wheel->now + 1;
+  int level;
+
+  if (expires < next)
+    {
+      pqueue_enqueue (thread, m->timer);
+      return;
+    }
+
+  /* Too far ahead, it'll be cascaded down again when the top gets there */
+  if (expires - next >= WHEEL_RANGE (THREAD_WHEEL_LEVELS - 1))
+    expires = next + WHEEL_RANGE (THREAD_WHEEL_LEVELS - 1) - 1;
+
+  for (level = 0; expires - next >= WHEEL_RANGE (level); level++)
+    ;
+
+  thread->slot = &wheel->slot[level][(expires >> WHEEL_SHIFT (level))
+                                     & WHEEL_MASK];
+  thread_list_add (thread->slot, thread);
+  wheel->count++;
+}
+
+static void
+thread_wheel_delete (struct thread_master *m, struct thread *thread)
+{
+  thread_list_delete (thread->slot, thread);
+  thread->slot = NULL;
+  m->wheel.count--;
+}
+
+/* Redistribute the timers in a higher level slot whose time has come. */
+static void
+thread_wheel_cascade (struct thread_master *m, int level, time_t second)
+{
+  struct thread_list *slot;
+  struct thread *thread;
+
+  slot = &m->wheel.slot[level][(second >> WHEEL_SHIFT (level)) & WHEEL_MASK];
+  while ((thread = slot->head) != NULL)
+    {
+      thread_wheel_delete (m, thread);
+      thread_wheel_add (m, thread);
+    }
+}
+
+/* Turn the wheel up to the given second, moving the timers expiring in
+ * the seconds passed onto the timer queue.
+ */
+static void
+thread_wheel_advance (struct thread_master *m, time_t to)
+{
+  struct thread_wheel *wheel = &m->wheel;
+  struct thread_list *slot;
+  struct thread *thread;
+  int level;
+
+  while (wheel->count && wheel->now < to)
+    {
+      time_t second = wheel->now + 1;
+
+      for (level = 1;
+           level < THREAD_WHEEL_LEVELS
+           && !((second >> WHEEL_SHIFT (level - 1)) & WHEEL_MASK);
+           level++)
+        thread_wheel_cascade (m, level, second);
+
+      slot = &wheel->slot[0][second & WHEEL_MASK];
+      while ((thread = slot->head) != NULL)
+        {
+          thread_wheel_delete (m, thread);
+          pqueue_enqueue (thread, m->timer);
+        }
+
+      wheel->now = second;
+    }
+
+  if (wheel->now < to)
+    wheel->now = to;
+}
+
+/* Time until the wheel next needs turning: the next second with timers
+ * in it, or the next cascade, whichever comes first.
+ */
+static struct timeval *
+thread_wheel_wait (struct thread_wheel *wheel, struct timeval *timer_val)
+{
+  struct timeval next = { .tv_sec = 0, .tv_usec = 0 };
+  time_t second;
+
+  if (!wheel->count)
+    return NULL;
+
+  for (second = wheel->now + 1;
+       (second & WHEEL_MASK) && !wheel->slot[0][second & WHEEL_MASK].count;
+       second++)
+    ;
+
+  next.tv_sec = second;
+  *timer_val = timeval_subtract (next, relative_time);
+  return timer_val;
+}
+
 static struct thread *
 funcname_thread_add_timer_timeval (struct thread_master *m,
                                    int (*func) (struct thread *), 
                                   int type,
                                   void *arg, 
                                   struct timeval *time_relative,
+				  int coarse,
 				  debugargdef)
 {
   struct thread *thread;
@@ -846,7 +1249,10 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   alarm_time.tv_usec = relative_time.tv_usec + time_relative->tv_usec;
   thread->u.sands = timeval_adjust(alarm_time);
 
-  pqueue_enqueue(thread, queue);
+  if (coarse)
+    thread_wheel_add (m, thread);
+  else
+    pqueue_enqueue(thread, queue);
   return thread;
 }
 
@@ -866,7 +1272,7 @@ funcname_thread_add_timer (struct thread_master *m,
   trel.tv_usec = 0;
 
   return funcname_thread_add_timer_timeval (m, func, THREAD_TIMER, arg, 
-                                            &trel, debugargpass);
+                                            &trel, 1, debugargpass);
 }
 
 /* Add timer event thread with "millisecond" resolution */
@@ -884,7 +1290,7 @@ funcname_thread_add_timer_msec (struct thread_master *m,
   trel.tv_usec = 1000*(timer % 1000);
 
   return funcname_thread_add_timer_timeval (m, func, THREAD_TIMER, 
-                                            arg, &trel, debugargpass);
+                                            arg, &trel, 0, debugargpass);
 }
 
 /* Add timer event thread with "millisecond" resolution */
@@ -895,7 +1301,7 @@ funcname_thread_add_timer_tv (struct thread_master *m,
                               debugargdef)
 {
   return funcname_thread_add_timer_timeval (m, func, THREAD_TIMER,
-                                            arg, tv, debugargpass);
+                                            arg, tv, 0, debugargpass);
 }
 
 /* Add a background thread, with an optional millisec delay */
@@ -921,7 +1327,50 @@ funcname_thread_add_background (struct thread_master *m,
     }
 
   return funcname_thread_add_timer_timeval (m, func, THREAD_BACKGROUND,
-                                            arg, &trel, debugargpass);
+                                            arg, &trel, 0, debugargpass);
+}
+
+/* Events are indexed by their argument while they are on the event or
+ * ready lists, so thread_cancel_event() need not search those.
+ */
+static void
+thread_event_index_add (struct thread_master *m, struct thread *thread)
+{
+  struct thread_arg_events tmp;
+  struct thread_arg_events *ae;
+
+  tmp.arg = thread->arg;
+  ae = hash_get (m->event_index, &tmp, thread_arg_events_hash_alloc);
+
+  thread->arg_prev = NULL;
+  thread->arg_next = ae->head;
+  if (ae->head)
+    ae->head->arg_prev = thread;
+  ae->head = thread;
+}
+
+static void
+thread_event_index_delete (struct thread_master *m, struct thread *thread)
+{
+  if (thread->arg_next)
+    thread->arg_next->arg_prev = thread->arg_prev;
+  if (thread->arg_prev)
+    thread->arg_prev->arg_next = thread->arg_next;
+  else
+    {
+      struct thread_arg_events tmp;
+      struct thread_arg_events *ae;
+
+      tmp.arg = thread->arg;
+      ae = hash_lookup (m->event_index, &tmp);
+      assert (ae && ae->head == thread);
+      if ((ae->head = thread->arg_next) == NULL)
+        {
+          hash_release (m->event_index, ae);
+          thread_arg_events_hash_free (ae);
+        }
+    }
+  thread->arg_next = thread->arg_prev = NULL;
 }
 
 /* Add simple event thread. */
@@ -937,6 +1386,7 @@ funcname_thread_add_event (struct thread_master *m,
   thread = thread_get (m, THREAD_EVENT, func, arg, debugargpass);
   thread->u.val = val;
   thread_list_add (&m->event, thread);
+  thread_event_index_add (m, thread);
 
   return thread;
 }
@@ -952,15 +1402,24 @@ thread_cancel (struct thread *thread)
   switch (thread->type)
     {
     case THREAD_READ:
-      assert (fd_clear_read_write (thread->u.fd, &thread->master->readfd));
+      assert (thread_use_epoll (thread->master)
+              || fd_clear_read_write (thread->u.fd, &thread->master->readfd));
       thread_array = thread->master->read;
       break;
     case THREAD_WRITE:
-      assert (fd_clear_read_write (thread->u.fd, &thread->master->writefd));
+      assert (thread_use_epoll (thread->master)
+              || fd_clear_read_write (thread->u.fd, &thread->master->writefd));
       thread_array = thread->master->write;
       break;
     case THREAD_TIMER:
-      queue = thread->master->timer;
+      if (thread->slot)
+        {
+          list = thread->slot;
+          thread->slot = NULL;
+          thread->master->wheel.count--;
+        }
+      else
+        queue = thread->master->timer;
       break;
     case THREAD_EVENT:
       list = &thread->master->event;
@@ -985,10 +1444,16 @@ thread_cancel (struct thread *thread)
   else if (list)
     {
       thread_list_delete (list, thread);
+      if (thread->add_type == THREAD_EVENT)
+        thread_event_index_delete (thread->master, thread);
     }
   else if (thread_array)
     {
       thread_delete_fd (thread_array, thread);
+#ifdef HAVE_EPOLL
+      if (thread_use_epoll (thread->master))
+        thread_epoll_arm (thread->master, thread->u.fd);
+#endif /* HAVE_EPOLL */
     }
   else
     {
@@ -999,47 +1464,39 @@ thread_cancel (struct thread *thread)
   thread_add_unuse (thread->master, thread);
 }
 
-/* Delete all events which has argument value arg. */
+/* Delete all events which has argument value arg.  Only threads added
+ * as events are looked for, I/O and timer threads which have become ready
+ * must be cancelled through their own thread pointers.
+ */
 unsigned int
 thread_cancel_event (struct thread_master *m, void *arg)
 {
   unsigned int ret = 0;
+  struct thread_arg_events tmp;
+  struct thread_arg_events *ae;
   struct thread *thread;
 
-  thread = m->event.head;
-  while (thread)
-    {
-      struct thread *t;
-
-      t = thread;
-      thread = t->next;
-
-      if (t->arg == arg)
-        {
-          ret++;
-          thread_list_delete (&m->event, t);
-          t->type = THREAD_UNUSED;
-          thread_add_unuse (m, t);
-        }
-    }
+  tmp.arg = arg;
+  if ((ae = hash_release (m->event_index, &tmp)) == NULL)
+    return 0;
 
-  /* thread can be on the ready list too */
-  thread = m->ready.head;
+  thread = ae->head;
   while (thread)
     {
       struct thread *t;
 
       t = thread;
-      thread = t->next;
-
-      if (t->arg == arg)
-        {
-          ret++;
-          thread_list_delete (&m->ready, t);
-          t->type = THREAD_UNUSED;
-          thread_add_unuse (m, t);
-        }
+      thread = t->arg_next;
+
+      ret++;
+      t->arg_next = t->arg_prev = NULL;
+      /* thread can be on the ready list too */
+      thread_list_delete (t->type == THREAD_EVENT ? &m->event : &m->ready, t);
+      t->type = THREAD_UNUSED;
+      thread_add_unuse (m, t);
     }
+
+  thread_arg_events_hash_free (ae);
   return ret;
 }
 
@@ -1059,6 +1516,8 @@ static struct thread *
 thread_run (struct thread_master *m, struct thread *thread,
 	    struct thread *fetch)
 {
+  if (thread->add_type == THREAD_EVENT)
+    thread_event_index_delete (m, thread);
   *fetch = *thread;
   thread->type = THREAD_UNUSED;
   thread_add_unuse (m, thread);
@@ -1109,6 +1568,49 @@ thread_process_fds (struct thread_master *m, thread_fd_set *rset, thread_fd_set
   return num - ready;
 }
 
+#ifdef HAVE_EPOLL
+/* Move the threads on descriptors epoll found ready to the ready list.
+ * Unlike thread_process_fds() this only ever looks at those descriptors.
+ */
+static void
+thread_process_epoll (struct thread_master *m, int num)
+{
+  int i;
+
+  for (i = 0; i < num; i++)
+    {
+      struct epoll_event *ev = &m->epoll_events[i];
+      int fd = ev->data.fd;
+      struct thread *thread;
+
+      /* Reporting it disarmed the descriptor. */
+      m->epoll_mask[fd] &= THREAD_EPOLL_REGISTERED;
+
+      /* As with select(), errors and hangups make an fd both readable
+       * and writable, leaving the handler to find out what happened.
+       */
+      if ((ev->events & (EPOLLIN|EPOLLERR|EPOLLHUP))
+          && (thread = m->read[fd]) != NULL)
+        {
+          thread_delete_fd (m->read, thread);
+          thread_list_add (&m->ready, thread);
+          thread->type = THREAD_READY;
+        }
+      if ((ev->events & (EPOLLOUT|EPOLLERR|EPOLLHUP))
+          && (thread = m->write[fd]) != NULL)
+        {
+          thread_delete_fd (m->write, thread);
+          thread_list_add (&m->ready, thread);
+          thread->type = THREAD_READY;
+        }
+
+      /* Re-arm for whichever direction didn't fire. */
+      if (m->read[fd] || m->write[fd])
+        thread_epoll_arm (m, fd);
+    }
+}
+#endif /* HAVE_EPOLL */
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int
 thread_timer_process (struct pqueue *queue, struct timeval *timenow)
@@ -1159,8 +1661,10 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
   thread_fd_set exceptfd;
   struct timeval timer_val = { .tv_sec = 0, .tv_usec = 0 };
   struct timeval timer_val_bg;
+  struct timeval timer_val_wheel;
   struct timeval *timer_wait = &timer_val;
   struct timeval *timer_wait_bg;
+  struct timeval *timer_wait_wheel;
 
   while (1)
     {
@@ -1192,22 +1696,36 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
       if (m->ready.count == 0)
         {
           quagga_get_relative (NULL);
+          thread_wheel_advance (m, relative_time.tv_sec);
           timer_wait = thread_timer_wait (m->timer, &timer_val);
           timer_wait_bg = thread_timer_wait (m->background, &timer_val_bg);
+          timer_wait_wheel = thread_wheel_wait (&m->wheel, &timer_val_wheel);
           
           if (timer_wait_bg &&
               (!timer_wait || (timeval_cmp (*timer_wait, *timer_wait_bg) > 0)))
             timer_wait = timer_wait_bg;
+          if (timer_wait_wheel &&
+              (!timer_wait
+               || (timeval_cmp (*timer_wait, *timer_wait_wheel) > 0)))
+            timer_wait = timer_wait_wheel;
         }
       
-      num = fd_select (FD_SETSIZE, &readfd, &writefd, &exceptfd, timer_wait);
+#ifdef HAVE_EPOLL
+      if (thread_use_epoll (m))
+        num = fd_epoll_wait (m, timer_wait);
+      else
+#endif /* HAVE_EPOLL */
+        num = fd_select (FD_SETSIZE, &readfd, &writefd, &exceptfd,
+                         timer_wait);
       
       /* Signals should get quick treatment */
       if (num < 0)
         {
           if (errno == EINTR)
             continue; /* signal received - process it */
-          zlog_warn ("select() error: %s", safe_strerror (errno));
+          zlog_warn ("%s error: %s",
+                     thread_use_epoll (m) ? "epoll_wait()" : "select()",
+                     safe_strerror (errno));
           return NULL;
         }
 
@@ -1215,9 +1733,15 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
          priority than I/O threads, so let's push them onto the ready
 	 list in front of the I/O threads. */
       quagga_get_relative (NULL);
+      thread_wheel_advance (m, relative_time.tv_sec);
       thread_timer_process (m->timer, &relative_time);
       
       /* Got IO, process it */
+#ifdef HAVE_EPOLL
+      if (num > 0 && thread_use_epoll (m))
+        thread_process_epoll (m, num);
+      else
+#endif /* HAVE_EPOLL */
       if (num > 0)
         thread_process_fds (m, &readfd, &writefd, num);
 
@@ -44,6 +44,8 @@ struct thread_list
 };
 
 struct pqueue;
+struct hash;
+struct epoll_event;
 
 /*
  * Abstract it so we can use different methodologies to
@@ -51,13 +53,30 @@ struct pqueue;
  */
 typedef fd_set thread_fd_set;
 
+/* Hierarchical timing wheel, holding timers of second granularity
+ * until they are nearly due.  Level 0 has a slot per second, and each
+ * level above has slots as wide as the whole of the level below.
+ */
+#define THREAD_WHEEL_LEVELS   4
+#define THREAD_WHEEL_BITS     6
+#define THREAD_WHEEL_SLOTS    (1 << THREAD_WHEEL_BITS)
+
+struct thread_wheel
+{
+  time_t now;			/* last second the wheel was turned to */
+  unsigned int count;
+  struct thread_list slot[THREAD_WHEEL_LEVELS][THREAD_WHEEL_SLOTS];
+};
+
 /* Master of the theads. */
 struct thread_master
 {
   struct thread **read;
   struct thread **write;
   struct pqueue *timer;
+  struct thread_wheel wheel;
   struct thread_list event;
+  struct hash *event_index;	/* pending events by arg */
   struct thread_list ready;
   struct thread_list unuse;
   struct pqueue *background;
@@ -65,6 +84,11 @@ struct thread_master
   thread_fd_set readfd;
   thread_fd_set writefd;
   thread_fd_set exceptfd;
+#ifdef HAVE_EPOLL
+  int epoll_fd;			/* -1 when falling back to select() */
+  unsigned char *epoll_mask;	/* events registered with the kernel, by fd */
+  struct epoll_event *epoll_events;
+#endif /* HAVE_EPOLL */
   unsigned long alloc;
 };
 
@@ -86,6 +110,9 @@ struct thread
     struct timeval sands;	/* rest of time sands value. */
   } u;
   int index;			/* used for timers to store position in queue */
+  struct thread_list *slot;	/* timer wheel slot, if on the wheel */
+  struct thread *arg_next;	/* pending events with the same arg */
+  struct thread *arg_prev;
   struct timeval real;
   struct cpu_thread_history *hist; /* cache pointer to cpu_history */
   const char *funcname;
@@ -229,6 +256,7 @@ extern unsigned long timeval_elapsed (struct timeval a, struct timeval b);
 extern void thread_getrusage (RUSAGE_T *);
 extern struct cmd_element show_thread_cpu_cmd;
 extern struct cmd_element clear_thread_cpu_cmd;
+extern struct cmd_element show_thread_timers_cmd;
 
 /* replacements for the system gettimeofday(), clock_gettime() and
  * time() functions, providing support for non-decrementing clock on
@@ -0,0 +1,422 @@
+/*
+ * Quagga Worker Pool Support.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "workpool.h"
+#include "linklist.h"
+#include "network.h"
+#include "vty.h"
+#include "log.h"
+
+/* master list of work_pools */
+static struct list _work_pools;
+static struct list *work_pools = &_work_pools;
+
+struct work_pool_job
+{
+  struct work_pool_job *next;
+  void (*work) (void *);
+  int (*done) (struct thread *);
+  void *arg;
+
+  /* for the done event */
+  const char *funcname;
+  const char *schedfrom;
+  int schedfrom_line;
+};
+
+struct work_pool_worker
+{
+  struct work_pool *pool;
+  pthread_t thread;
+  struct work_pool_job *running;
+};
+
+/* Workers can't use quagga_gettime(), it updates globals. */
+static unsigned long
+work_pool_usec (void)
+{
+#ifdef HAVE_CLOCK_MONOTONIC
+  struct timespec tp;
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+  return tp.tv_sec * 1000000UL + tp.tv_nsec / 1000;
+#else
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+#endif /* HAVE_CLOCK_MONOTONIC */
+}
+
+static void *
+work_pool_worker_run (void *arg)
+{
+  struct work_pool_worker *worker = arg;
+  struct work_pool *pool = worker->pool;
+  struct work_pool_job *job;
+  unsigned long start, elapsed;
+
+  pthread_mutex_lock (&pool->mtx);
+  while (1)
+    {
+      while (!pool->queue_head && !pool->shutdown)
+        pthread_cond_wait (&pool->work_cond, &pool->mtx);
+      if (pool->shutdown)
+        break;
+
+      job = pool->queue_head;
+      if ((pool->queue_head = job->next) == NULL)
+        pool->queue_tail = NULL;
+      job->next = NULL;
+      pool->stats.queued--;
+      worker->running = job;
+      pthread_mutex_unlock (&pool->mtx);
+
+      start = work_pool_usec ();
+      job->work (job->arg);
+      elapsed = work_pool_usec () - start;
+
+      pthread_mutex_lock (&pool->mtx);
+      worker->running = NULL;
+      pool->stats.completed++;
+      pool->stats.total += elapsed;
+      if (pool->stats.max < elapsed)
+        pool->stats.max = elapsed;
+
+      /* Only the first completion since the master last looked needs to
+       * wake it, and a full pipe means it's already been woken. */
+      if (pool->done_tail)
+        pool->done_tail->next = job;
+      else
+        {
+          pool->done_head = job;
+          if (write (pool->wakeup[1], "", 1) < 0
+              && errno != EAGAIN && errno != EWOULDBLOCK)
+            zlog_warn ("%s: wakeup of %s failed: %s", __func__,
+                       pool->name, safe_strerror (errno));
+        }
+      pool->done_tail = job;
+      pthread_cond_broadcast (&pool->idle_cond);
+    }
+  pthread_mutex_unlock (&pool->mtx);
+
+  return NULL;
+}
+
+/* In the master: schedule the done events for all finished jobs */
+static int
+work_pool_complete (struct thread *thread)
+{
+  struct work_pool *pool = THREAD_ARG (thread);
+  struct work_pool_job *job, *next;
+  char buf[64];
+
+  pool->t_wakeup = NULL;
+  while (read (pool->wakeup[0], buf, sizeof (buf)) > 0)
+    ;
+
+  pthread_mutex_lock (&pool->mtx);
+  job = pool->done_head;
+  pool->done_head = pool->done_tail = NULL;
+  pthread_mutex_unlock (&pool->mtx);
+
+  for (; job; job = next)
+    {
+      next = job->next;
+      funcname_thread_add_event (pool->master, job->done, job->arg, 0,
+                                 job->funcname, job->schedfrom,
+                                 job->schedfrom_line);
+      XFREE (MTYPE_WORK_POOL_JOB, job);
+    }
+
+  pool->t_wakeup = thread_add_read (pool->master, work_pool_complete, pool,
+                                    pool->wakeup[0]);
+  return 0;
+}
+
+static void
+work_pool_job_list_free (struct work_pool_job *job)
+{
+  struct work_pool_job *next;
+
+  for (; job; job = next)
+    {
+      next = job->next;
+      XFREE (MTYPE_WORK_POOL_JOB, job);
+    }
+}
+
+/* create new worker pool */
+struct work_pool *
+work_pool_new (struct thread_master *m, const char *name,
+               unsigned int nthreads)
+{
+  struct work_pool *new;
+  sigset_t all, old;
+  unsigned int i;
+
+  assert (nthreads > 0);
+
+  new = XCALLOC (MTYPE_WORK_POOL, sizeof (struct work_pool));
+  new->name = XSTRDUP (MTYPE_WORK_POOL, name);
+  new->master = m;
+
+  if (pipe (new->wakeup) < 0)
+    {
+      zlog_err ("%s: pipe failed: %s", __func__, safe_strerror (errno));
+      XFREE (MTYPE_WORK_POOL, new->name);
+      XFREE (MTYPE_WORK_POOL, new);
+      return NULL;
+    }
+  set_nonblocking (new->wakeup[0]);
+  set_nonblocking (new->wakeup[1]);
+
+  pthread_mutex_init (&new->mtx, NULL);
+  pthread_cond_init (&new->work_cond, NULL);
+  pthread_cond_init (&new->idle_cond, NULL);
+
+  new->workers = XCALLOC (MTYPE_WORK_POOL,
+                          sizeof (struct work_pool_worker) * nthreads);
+
+  /* Signals must be taken by the main thread, where sigevent handles
+   * them, so the workers are started with everything blocked.
+   */
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &old);
+  for (i = 0; i < nthreads; i++)
+    {
+      new->workers[i].pool = new;
+      if (pthread_create (&new->workers[i].thread, NULL,
+                          work_pool_worker_run, &new->workers[i]) != 0)
+        break;
+      new->nthreads++;
+    }
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+
+  listnode_add (work_pools, new);
+
+  if (new->nthreads != nthreads)
+    {
+      zlog_err ("%s: unable to start workers for %s", __func__, name);
+      work_pool_free (new);
+      return NULL;
+    }
+
+  new->t_wakeup = thread_add_read (m, work_pool_complete, new,
+                                   new->wakeup[0]);
+  return new;
+}
+
+void
+work_pool_free (struct work_pool *pool)
+{
+  unsigned int i;
+
+  pthread_mutex_lock (&pool->mtx);
+  pool->shutdown = 1;
+  pthread_cond_broadcast (&pool->work_cond);
+  pthread_mutex_unlock (&pool->mtx);
+
+  for (i = 0; i < pool->nthreads; i++)
+    pthread_join (pool->workers[i].thread, NULL);
+
+  THREAD_OFF (pool->t_wakeup);
+  work_pool_job_list_free (pool->queue_head);
+  work_pool_job_list_free (pool->done_head);
+
+  close (pool->wakeup[0]);
+  close (pool->wakeup[1]);
+  pthread_cond_destroy (&pool->idle_cond);
+  pthread_cond_destroy (&pool->work_cond);
+  pthread_mutex_destroy (&pool->mtx);
+
+  listnode_delete (work_pools, pool);
+
+  XFREE (MTYPE_WORK_POOL, pool->workers);
+  XFREE (MTYPE_WORK_POOL, pool->name);
+  XFREE (MTYPE_WORK_POOL, pool);
+}
+
+int
+funcname_work_pool_submit (struct work_pool *pool,
+                           void (*work) (void *),
+                           int (*done) (struct thread *),
+                           void *arg, const char *funcname,
+                           const char *schedfrom, int fromln)
+{
+  struct work_pool_job *job;
+
+  job = XCALLOC (MTYPE_WORK_POOL_JOB, sizeof (struct work_pool_job));
+  job->work = work;
+  job->done = done;
+  job->arg = arg;
+  job->funcname = funcname;
+  job->schedfrom = schedfrom;
+  job->schedfrom_line = fromln;
+
+  pthread_mutex_lock (&pool->mtx);
+  if (pool->queue_tail)
+    pool->queue_tail->next = job;
+  else
+    pool->queue_head = job;
+  pool->queue_tail = job;
+  pool->stats.submitted++;
+  if (++pool->stats.queued > pool->stats.max_queued)
+    pool->stats.max_queued = pool->stats.queued;
+  pthread_cond_signal (&pool->work_cond);
+  pthread_mutex_unlock (&pool->mtx);
+
+  return 0;
+}
+
+/* Unlink the jobs for arg from a list, onto another */
+static unsigned int
+work_pool_job_list_take (struct work_pool_job **head,
+                         struct work_pool_job **tail,
+                         void *arg, struct work_pool_job **taken)
+{
+  struct work_pool_job **jp = head;
+  struct work_pool_job *job, *prev = NULL;
+  unsigned int count = 0;
+
+  while ((job = *jp) != NULL)
+    {
+      if (job->arg != arg)
+        {
+          prev = job;
+          jp = &job->next;
+          continue;
+        }
+      *jp = job->next;
+      job->next = *taken;
+      *taken = job;
+      count++;
+    }
+  *tail = prev;
+  return count;
+}
+
+unsigned int
+work_pool_cancel (struct work_pool *pool, void *arg)
+{
+  struct work_pool_job *taken = NULL;
+  unsigned int count, i;
+
+  pthread_mutex_lock (&pool->mtx);
+
+  count = work_pool_job_list_take (&pool->queue_head, &pool->queue_tail,
+                                   arg, &taken);
+  pool->stats.queued -= count;
+
+  for (i = 0; i < pool->nthreads; i++)
+    while (pool->workers[i].running && pool->workers[i].running->arg == arg)
+      pthread_cond_wait (&pool->idle_cond, &pool->mtx);
+
+  count += work_pool_job_list_take (&pool->done_head, &pool->done_tail,
+                                    arg, &taken);
+
+  pthread_mutex_unlock (&pool->mtx);
+
+  work_pool_job_list_free (taken);
+  return count;
+}
+
+/* Is a job for arg still queued, or running? */
+static int
+work_pool_busy (struct work_pool *pool, void *arg)
+{
+  struct work_pool_job *job;
+  unsigned int i;
+
+  for (job = pool->queue_head; job; job = job->next)
+    if (job->arg == arg)
+      return 1;
+  for (i = 0; i < pool->nthreads; i++)
+    if (pool->workers[i].running && pool->workers[i].running->arg == arg)
+      return 1;
+  return 0;
+}
+
+unsigned int
+work_pool_wait (struct work_pool *pool, void *arg)
+{
+  struct work_pool_job *taken = NULL;
+  unsigned int count;
+
+  pthread_mutex_lock (&pool->mtx);
+
+  while (work_pool_busy (pool, arg))
+    pthread_cond_wait (&pool->idle_cond, &pool->mtx);
+
+  count = work_pool_job_list_take (&pool->done_head, &pool->done_tail,
+                                   arg, &taken);
+
+  pthread_mutex_unlock (&pool->mtx);
+
+  work_pool_job_list_free (taken);
+  return count;
+}
+
+void
+work_pool_cpu_print (struct vty *vty)
+{
+  struct listnode *node;
+  struct work_pool *pool;
+
+  if (!listcount (work_pools))
+    return;
+
+  vty_out (vty, "%sWorker pool       Threads Queued MaxQ   Completed"
+           " Runtime(ms) Avg uSec Max uSecs%s", VTY_NEWLINE, VTY_NEWLINE);
+  for (ALL_LIST_ELEMENTS_RO (work_pools, node, pool))
+    {
+      pthread_mutex_lock (&pool->mtx);
+      vty_out (vty, "%-17s %7u %6u %4u %11lu %7lu.%03lu %8lu %9lu%s",
+               pool->name, pool->nthreads, pool->stats.queued,
+               pool->stats.max_queued, pool->stats.completed,
+               pool->stats.total / 1000, pool->stats.total % 1000,
+               pool->stats.completed
+                 ? pool->stats.total / pool->stats.completed : 0,
+               pool->stats.max, VTY_NEWLINE);
+      pthread_mutex_unlock (&pool->mtx);
+    }
+}
+
+void
+work_pool_cpu_clear (void)
+{
+  struct listnode *node;
+  struct work_pool *pool;
+
+  for (ALL_LIST_ELEMENTS_RO (work_pools, node, pool))
+    {
+      pthread_mutex_lock (&pool->mtx);
+      pool->stats.submitted = pool->stats.completed = 0;
+      pool->stats.max_queued = pool->stats.queued;
+      pool->stats.total = pool->stats.max = 0;
+      pthread_mutex_unlock (&pool->mtx);
+    }
+}
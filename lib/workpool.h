@@ -0,0 +1,112 @@
+/*
+ * Quagga Worker Pools.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_WORK_POOL_H
+#define _QUAGGA_WORK_POOL_H
+
+#include <pthread.h>
+
+/* A worker pool runs pure computation on a set of POSIX threads, off
+ * the daemon's thread_master, and hands each finished job back to that
+ * thread_master as an ordinary event.  So everything outside of the
+ * work function itself still runs on the one cooperative thread.
+ *
+ * Work functions must not touch anything shared with the main thread
+ * while they run: no XMALLOC/XFREE (the per-type counters aren't
+ * locked), no zlog, no vty and no thread_* calls.  Allocate what the
+ * job needs before submitting it, and deal with results in the done
+ * event.
+ */
+
+struct work_pool_job;
+struct work_pool_worker;
+struct vty;
+
+struct work_pool
+{
+  /* Everything is private, but the following may be read */
+  struct thread_master *master;
+  char *name;
+  unsigned int nthreads;
+
+  /* remaining fields should be opaque to users */
+  pthread_mutex_t mtx;
+  pthread_cond_t work_cond;	/* work queued, or shutting down */
+  pthread_cond_t idle_cond;	/* a job finished */
+  struct work_pool_job *queue_head, *queue_tail;
+  struct work_pool_job *done_head, *done_tail;
+  struct work_pool_worker *workers;
+  int shutdown;
+
+  /* completion wakeup, written by workers, read in master */
+  int wakeup[2];
+  struct thread *t_wakeup;
+
+  /* statistics, under mtx */
+  struct {
+    unsigned long submitted;
+    unsigned long completed;
+    unsigned int queued;
+    unsigned int max_queued;
+    unsigned long total;	/* usecs spent in work functions */
+    unsigned long max;
+  } stats;
+};
+
+/* User API */
+
+/* Create a new pool of nthreads workers, completing to the given
+ * thread_master.  Returns NULL if the threads can't be started.
+ */
+extern struct work_pool *work_pool_new (struct thread_master *,
+                                        const char *, unsigned int);
+/* Stop the workers, discarding any jobs not yet completed. */
+extern void work_pool_free (struct work_pool *);
+
+/* Run work(arg) on one of the pool's threads, then schedule done as an
+ * event with arg in the pool's thread_master.
+ */
+#define work_pool_submit(p,w,d,a) \
+  funcname_work_pool_submit(p,w,d,a,#d,__FILE__,__LINE__)
+extern int funcname_work_pool_submit (struct work_pool *,
+                                      void (*) (void *),
+                                      int (*) (struct thread *),
+                                      void *, const char *,
+                                      const char *, int);
+
+/* Forget all jobs for arg, waiting for any already running to finish.
+ * Their done events won't be scheduled; ones which already have been
+ * are cancelled along with any other events by thread_cancel_event().
+ * Returns the number of jobs forgotten.
+ */
+extern unsigned int work_pool_cancel (struct work_pool *, void *);
+
+/* Wait for all jobs for arg to have run, in the calling thread.  Their
+ * done events won't be scheduled, the caller deals with the results
+ * itself.  Returns the number of jobs waited for.
+ */
+extern unsigned int work_pool_wait (struct work_pool *, void *);
+
+/* Helpers, exported for thread.c */
+extern void work_pool_cpu_print (struct vty *);
+extern void work_pool_cpu_clear (void);
+
+#endif /* _QUAGGA_WORK_POOL_H */
@@ -73,6 +73,8 @@ zclient_free (struct zclient *zclient)
     stream_free(zclient->obuf);
   if (zclient->wb)
     buffer_free(zclient->wb);
+  if (zclient->batch)
+    stream_free(zclient->batch);
 
   XFREE (MTYPE_ZCLIENT, zclient);
 }
@@ -121,10 +123,14 @@ zclient_stop (struct zclient *zclient)
   THREAD_OFF(zclient->t_read);
   THREAD_OFF(zclient->t_connect);
   THREAD_OFF(zclient->t_write);
+  THREAD_OFF(zclient->t_batch);
 
   /* Reset streams. */
   stream_reset(zclient->ibuf);
   stream_reset(zclient->obuf);
+  if (zclient->batch)
+    stream_reset(zclient->batch);
+  zclient->batch_count = 0;
 
   /* Empty the write buffer. */
   buffer_reset(zclient->wb);
@@ -278,13 +284,11 @@ zclient_flush_data(struct thread *thread)
   return 0;
 }
 
-int
-zclient_send_message(struct zclient *zclient)
+static int
+zclient_send_stream(struct zclient *zclient, struct stream *s)
 {
-  if (zclient->sock < 0)
-    return -1;
-  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(zclient->obuf),
-		       stream_get_endp(zclient->obuf)))
+  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+		       stream_get_endp(s)))
     {
     case BUFFER_ERROR:
       zlog_warn("%s: buffer_write failed to zclient fd %d, closing",
@@ -302,6 +306,47 @@ zclient_send_message(struct zclient *zclient)
   return 0;
 }
 
+int
+zclient_send_message(struct zclient *zclient)
+{
+  if (zclient->sock < 0)
+    return -1;
+
+  /* Routes batched up so far go first. */
+  if (zclient_batch_flush(zclient) < 0)
+    return -1;
+
+  return zclient_send_stream(zclient, zclient->obuf);
+}
+
+/* Send the pending ZEBRA_IPV4_ROUTE_ADD_BATCH message, if any. */
+int
+zclient_batch_flush(struct zclient *zclient)
+{
+  struct stream *s = zclient->batch;
+
+  if (!zclient->batch_count)
+    return 0;
+
+  THREAD_OFF(zclient->t_batch);
+  stream_putw_at (s, 0, stream_get_endp (s));
+  stream_putw_at (s, zclient->batch_count_pos, zclient->batch_count);
+  zclient->batch_count = 0;
+
+  if (zclient->sock < 0)
+    return -1;
+  return zclient_send_stream(zclient, s);
+}
+
+static int
+zclient_batch_event(struct thread *thread)
+{
+  struct zclient *zclient = THREAD_ARG(thread);
+
+  zclient->t_batch = NULL;
+  return zclient_batch_flush(zclient);
+}
+
 void
 zclient_create_header (struct stream *s, uint16_t command, vrf_id_t vrf_id)
 {
@@ -524,6 +569,10 @@ zclient_connect (struct thread *t)
   * nexthop information is provided, and the message describes a prefix
   * to blackhole or reject route.
   *
+  * If ZAPI_MESSAGE_NHG is set instead of ZAPI_MESSAGE_NEXTHOP, a 4 byte
+  * nexthop group id, see zapi_nexthop_group_add(), takes the place of
+  * the nexthops.
+  *
   * If ZAPI_MESSAGE_DISTANCE is set, the distance value is written as a 1
   * byte value.
   * 
@@ -534,11 +583,59 @@ zclient_connect (struct thread *t)
   *
   * XXX: No attention paid to alignment.
   */ 
+static void
+zapi_ipv4_put_nexthop_list (struct stream *s, struct zapi_ipv4 *api)
+{
+  int i;
+
+  if (CHECK_FLAG (api->flags, ZEBRA_FLAG_BLACKHOLE))
+    {
+      stream_putc (s, 1);
+      stream_putc (s, ZEBRA_NEXTHOP_BLACKHOLE);
+      /* XXX assert(api->nexthop_num == 0); */
+      /* XXX assert(api->ifindex_num == 0); */
+    }
+  else
+    stream_putc (s, api->nexthop_num + api->ifindex_num);
+
+  for (i = 0; i < api->nexthop_num; i++)
+    {
+      stream_putc (s, ZEBRA_NEXTHOP_IPV4);
+      stream_put_in_addr (s, api->nexthop[i]);
+    }
+  for (i = 0; i < api->ifindex_num; i++)
+    {
+      stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
+      stream_putl (s, api->ifindex[i]);
+    }
+}
+
+static void
+zapi_ipv4_put_nexthops (struct stream *s, struct zapi_ipv4 *api)
+{
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_NEXTHOP))
+    zapi_ipv4_put_nexthop_list (s, api);
+  else if (CHECK_FLAG (api->message, ZAPI_MESSAGE_NHG))
+    stream_putl (s, api->nhg_id);
+}
+
+static void
+zapi_ipv4_put_values (struct stream *s, struct zapi_ipv4 *api)
+{
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_DISTANCE))
+    stream_putc (s, api->distance);
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_METRIC))
+    stream_putl (s, api->metric);
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_MTU))
+    stream_putl (s, api->mtu);
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_TAG))
+    stream_putl (s, api->tag);
+}
+
 int
 zapi_ipv4_route (u_char cmd, struct zclient *zclient, struct prefix_ipv4 *p,
                  struct zapi_ipv4 *api)
 {
-  int i;
   int psize;
   struct stream *s;
 
@@ -560,40 +657,137 @@ zapi_ipv4_route (u_char cmd, struct zclient *zclient, struct prefix_ipv4 *p,
   stream_write (s, (u_char *) & p->prefix, psize);
 
   /* Nexthop, ifindex, distance and metric information. */
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_NEXTHOP))
-    {
-      if (CHECK_FLAG (api->flags, ZEBRA_FLAG_BLACKHOLE))
-        {
-          stream_putc (s, 1);
-          stream_putc (s, ZEBRA_NEXTHOP_BLACKHOLE);
-          /* XXX assert(api->nexthop_num == 0); */
-          /* XXX assert(api->ifindex_num == 0); */
-        }
-      else
-        stream_putc (s, api->nexthop_num + api->ifindex_num);
+  zapi_ipv4_put_nexthops (s, api);
+  zapi_ipv4_put_values (s, api);
 
-      for (i = 0; i < api->nexthop_num; i++)
-        {
-          stream_putc (s, ZEBRA_NEXTHOP_IPV4);
-          stream_put_in_addr (s, api->nexthop[i]);
-        }
-      for (i = 0; i < api->ifindex_num; i++)
-        {
-          stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
-          stream_putl (s, api->ifindex[i]);
-        }
+  /* Put length at the first point of the stream. */
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  return zclient_send_message(zclient);
+}
+
+/* Largest per route part of a ZEBRA_IPV4_ROUTE_ADD_BATCH message. */
+#define ZAPI_IPV4_BATCH_ROUTE_MAX (1 + IPV4_MAX_BYTELEN + 1 + 4 + 4 + 4)
+
+/*
+ * Add an IPv4 route the way zapi_ipv4_route (ZEBRA_IPV4_ROUTE_ADD) does,
+ * but batched up with other routes sharing the same type, flags and
+ * nexthops into a single ZEBRA_IPV4_ROUTE_ADD_BATCH message:
+ *
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * | Route Type    | ZEBRA Flags   | Message Flags |     SAFI      |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |    SAFI       | Nexthops, as for ZEBRA_IPV4_ROUTE_ADD ...     |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |         Route count           |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ * followed by each route: its prefix length and prefix, then distance,
+ * metric, MTU and tag as per the message flags.
+ *
+ * The message goes out when one with another nexthop set is started,
+ * when it is full, before any other message to zebra, or otherwise once
+ * the current task is done.
+ */
+int
+zapi_ipv4_route_batch (struct zclient *zclient, struct prefix_ipv4 *p,
+                       struct zapi_ipv4 *api)
+{
+  struct stream *key, *s;
+  int psize;
+
+  if (zclient->sock < 0)
+    return -1;
+
+  if (!zclient->batch)
+    zclient->batch = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  s = zclient->batch;
+
+  /* The part shared by all routes of the message. */
+  key = zclient->obuf;
+  stream_reset (key);
+  zclient_create_header (key, ZEBRA_IPV4_ROUTE_ADD_BATCH, api->vrf_id);
+  stream_putc (key, api->type);
+  stream_putc (key, api->flags);
+  stream_putc (key, api->message);
+  stream_putw (key, api->safi);
+  zapi_ipv4_put_nexthops (key, api);
+
+  if (zclient->batch_count
+      && (stream_get_endp (key) != zclient->batch_count_pos
+          || memcmp (STREAM_DATA (key), STREAM_DATA (s),
+                     zclient->batch_count_pos)
+          || STREAM_WRITEABLE (s) < ZAPI_IPV4_BATCH_ROUTE_MAX
+          || zclient->batch_count == UINT16_MAX))
+    if (zclient_batch_flush (zclient) < 0)
+      return -1;
+
+  if (!zclient->batch_count)
+    {
+      stream_reset (s);
+      stream_put (s, STREAM_DATA (key), stream_get_endp (key));
+      zclient->batch_count_pos = stream_get_endp (s);
+      stream_putw (s, 0);
+      if (!zclient->t_batch)
+        zclient->t_batch = thread_add_event (zclient->master,
+                                             zclient_batch_event, zclient, 0);
     }
 
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_DISTANCE))
-    stream_putc (s, api->distance);
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_METRIC))
-    stream_putl (s, api->metric);
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_MTU))
-    stream_putl (s, api->mtu);
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_TAG))
-    stream_putl (s, api->tag);
+  psize = PSIZE (p->prefixlen);
+  stream_putc (s, p->prefixlen);
+  stream_write (s, (u_char *) & p->prefix, psize);
+  zapi_ipv4_put_values (s, api);
+  zclient->batch_count++;
+
+  return 0;
+}
+
+/*
+ * Register the IPv4 nexthops in 'api' with zebra as nexthop group 'id'
+ * of the client, replacing any group with that id:
+ *
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |                       Nexthop group id                        |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * | Nexthops, as for ZEBRA_IPV4_ROUTE_ADD ...
+ * +-+-+-+-+-+-+-+-+
+ *
+ * Routes then given with ZAPI_MESSAGE_NHG, rather than
+ * ZAPI_MESSAGE_NEXTHOP, only carry the 4 byte group id, and get the
+ * group's nexthops.  Replacing the group moves the routes added with it
+ * to its new nexthops, which zebra does by replacing the one kernel
+ * nexthop object they share, without touching the routes themselves.
+ */
+int
+zapi_nexthop_group_add (struct zclient *zclient, u_int32_t id,
+                        struct zapi_ipv4 *api)
+{
+  struct stream *s;
+
+  s = zclient->obuf;
+  stream_reset (s);
+
+  zclient_create_header (s, ZEBRA_NEXTHOP_GROUP_ADD, api->vrf_id);
+  stream_putl (s, id);
+  zapi_ipv4_put_nexthop_list (s, api);
+
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  return zclient_send_message(zclient);
+}
+
+int
+zapi_nexthop_group_delete (struct zclient *zclient, u_int32_t id,
+                           vrf_id_t vrf_id)
+{
+  struct stream *s;
+
+  s = zclient->obuf;
+  stream_reset (s);
+
+  zclient_create_header (s, ZEBRA_NEXTHOP_GROUP_DELETE, vrf_id);
+  stream_putl (s, id);
 
-  /* Put length at the first point of the stream. */
   stream_putw_at (s, 0, stream_get_endp (s));
 
   return zclient_send_message(zclient);
@@ -1042,6 +1236,120 @@ zebra_interface_address_read (int type, struct stream *s, vrf_id_t vrf_id)
 }
 
 
+static void zclient_read_batch (struct zclient *, zebra_size_t);
+
+/* Hand a message read into zclient->ibuf to its callback. */
+static void
+zclient_dispatch (u_int16_t command, struct zclient *zclient,
+		  zebra_size_t length, vrf_id_t vrf_id)
+{
+  switch (command)
+    {
+    case ZEBRA_ROUTER_ID_UPDATE:
+      if (zclient->router_id_update)
+	(*zclient->router_id_update) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_ADD:
+      if (zclient->interface_add)
+	(*zclient->interface_add) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_DELETE:
+      if (zclient->interface_delete)
+	(*zclient->interface_delete) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_ADDRESS_ADD:
+      if (zclient->interface_address_add)
+	(*zclient->interface_address_add) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_ADDRESS_DELETE:
+      if (zclient->interface_address_delete)
+	(*zclient->interface_address_delete) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_UP:
+      if (zclient->interface_up)
+	(*zclient->interface_up) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_DOWN:
+      if (zclient->interface_down)
+	(*zclient->interface_down) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_IPV4_ROUTE_ADD:
+      if (zclient->ipv4_route_add)
+	(*zclient->ipv4_route_add) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_IPV4_ROUTE_DELETE:
+      if (zclient->ipv4_route_delete)
+	(*zclient->ipv4_route_delete) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_IPV6_ROUTE_ADD:
+      if (zclient->ipv6_route_add)
+	(*zclient->ipv6_route_add) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_IPV6_ROUTE_DELETE:
+      if (zclient->ipv6_route_delete)
+	(*zclient->ipv6_route_delete) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_INTERFACE_LINK_PARAMS:
+      if (zclient->interface_link_params)
+        (*zclient->interface_link_params) (command, zclient, length);
+    case ZEBRA_NEXTHOP_UPDATE:
+      if (zclient->nexthop_update)
+	(*zclient->nexthop_update) (command, zclient, length, vrf_id);
+      break;
+    case ZEBRA_REDISTRIBUTE_BATCH:
+      zclient_read_batch (zclient, length);
+      break;
+    default:
+      break;
+    }
+}
+
+/*
+ * A ZEBRA_REDISTRIBUTE_BATCH message is nothing but complete messages,
+ * each with its own header, one after the other.  zebra sends routes
+ * redistributed to the client in those, so that many share one
+ * message.  Each goes to its callback as if it had come on its own.
+ */
+static void
+zclient_read_batch (struct zclient *zclient, zebra_size_t length)
+{
+  struct stream *s = zclient->ibuf;
+  size_t start, end;
+  u_int16_t size, command;
+  vrf_id_t vrf_id;
+
+  end = stream_get_getp (s) + length;
+
+  while (stream_get_getp (s) + ZEBRA_HEADER_SIZE <= end)
+    {
+      start = stream_get_getp (s);
+      size = stream_getw (s);
+      stream_forward_getp (s, 2);	/* marker, version */
+      vrf_id = stream_getw (s);
+      command = stream_getw (s);
+
+      if (size < ZEBRA_HEADER_SIZE || start + size > end
+	  || command == ZEBRA_REDISTRIBUTE_BATCH)
+	{
+	  zlog_warn ("%s: socket %d malformed message in batch",
+		     __func__, zclient->sock);
+	  return;
+	}
+
+      if (zclient_debug)
+	zlog_debug ("zclient 0x%p batched command 0x%x VRF %u",
+		    (void *)zclient, command, vrf_id);
+
+      zclient_dispatch (command, zclient, size - ZEBRA_HEADER_SIZE, vrf_id);
+
+      /* Connection was closed during packet processing. */
+      if (zclient->sock < 0)
+	return;
+
+      stream_set_getp (s, start + size);
+    }
+}
+
 /* Zebra client message read function. */
 static int
 zclient_read (struct thread *thread)
@@ -1138,62 +1446,7 @@ zclient_read (struct thread *thread)
   if (zclient_debug)
     zlog_debug("zclient 0x%p command 0x%x VRF %u\n", (void *)zclient, command, vrf_id);
 
-  switch (command)
-    {
-    case ZEBRA_ROUTER_ID_UPDATE:
-      if (zclient->router_id_update)
-	(*zclient->router_id_update) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_ADD:
-      if (zclient->interface_add)
-	(*zclient->interface_add) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_DELETE:
-      if (zclient->interface_delete)
-	(*zclient->interface_delete) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_ADDRESS_ADD:
-      if (zclient->interface_address_add)
-	(*zclient->interface_address_add) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_ADDRESS_DELETE:
-      if (zclient->interface_address_delete)
-	(*zclient->interface_address_delete) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_UP:
-      if (zclient->interface_up)
-	(*zclient->interface_up) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_DOWN:
-      if (zclient->interface_down)
-	(*zclient->interface_down) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_IPV4_ROUTE_ADD:
-      if (zclient->ipv4_route_add)
-	(*zclient->ipv4_route_add) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_IPV4_ROUTE_DELETE:
-      if (zclient->ipv4_route_delete)
-	(*zclient->ipv4_route_delete) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_IPV6_ROUTE_ADD:
-      if (zclient->ipv6_route_add)
-	(*zclient->ipv6_route_add) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_IPV6_ROUTE_DELETE:
-      if (zclient->ipv6_route_delete)
-	(*zclient->ipv6_route_delete) (command, zclient, length, vrf_id);
-      break;
-    case ZEBRA_INTERFACE_LINK_PARAMS:
-      if (zclient->interface_link_params)
-        (*zclient->interface_link_params) (command, zclient, length);
-    case ZEBRA_NEXTHOP_UPDATE:
-      if (zclient->nexthop_update)
-	(*zclient->nexthop_update) (command, zclient, length, vrf_id);
-      break;
-    default:
-      break;
-    }
+  zclient_dispatch (command, zclient, length, vrf_id);
 
   if (zclient->sock < 0)
     /* Connection was closed during packet processing. */
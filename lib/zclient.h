@@ -69,6 +69,13 @@ struct zclient
   /* Thread to write buffered data to zebra. */
   struct thread *t_write;
 
+  /* ZEBRA_IPV4_ROUTE_ADD_BATCH message being built, the number of
+     routes in it, where that goes, and the event to send it. */
+  struct stream *batch;
+  u_int16_t batch_count;
+  size_t batch_count_pos;
+  struct thread *t_batch;
+
   /* Redistribute information. */
   u_char redist_default;
   vrf_bitmap_t redist[ZEBRA_ROUTE_MAX];
@@ -100,6 +107,7 @@ struct zclient
 #define ZAPI_MESSAGE_METRIC   0x08
 #define ZAPI_MESSAGE_MTU      0x10
 #define ZAPI_MESSAGE_TAG      0x20
+#define ZAPI_MESSAGE_NHG      0x40
 
 /* Zserv protocol message header */
 struct zserv_header
@@ -131,6 +139,9 @@ struct zapi_ipv4
   u_char ifindex_num;
   ifindex_t *ifindex;
 
+  /* Nexthop group, in place of the nexthops with ZAPI_MESSAGE_NHG. */
+  u_int32_t nhg_id;
+
   u_char distance;
 
   route_tag_t tag;
@@ -188,6 +199,12 @@ extern void zebra_interface_if_set_value (struct stream *, struct interface *);
 extern void zebra_router_id_update_read (struct stream *s, struct prefix *rid);
 extern int zapi_ipv4_route (u_char, struct zclient *, struct prefix_ipv4 *, 
                             struct zapi_ipv4 *);
+extern int zapi_ipv4_route_batch (struct zclient *, struct prefix_ipv4 *,
+                                  struct zapi_ipv4 *);
+extern int zclient_batch_flush (struct zclient *);
+extern int zapi_nexthop_group_add (struct zclient *, u_int32_t,
+                                   struct zapi_ipv4 *);
+extern int zapi_nexthop_group_delete (struct zclient *, u_int32_t, vrf_id_t);
 
 extern struct interface *zebra_interface_link_params_read (struct stream *);
 extern size_t zebra_interface_link_params_write (struct stream *,
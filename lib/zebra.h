@@ -429,7 +429,11 @@ struct in_pktinfo
 #define ZEBRA_NEXTHOP_REGISTER            27
 #define ZEBRA_NEXTHOP_UNREGISTER          28
 #define ZEBRA_NEXTHOP_UPDATE              29
-#define ZEBRA_MESSAGE_MAX                 30
+#define ZEBRA_IPV4_ROUTE_ADD_BATCH        30
+#define ZEBRA_NEXTHOP_GROUP_ADD           31
+#define ZEBRA_NEXTHOP_GROUP_DELETE        32
+#define ZEBRA_REDISTRIBUTE_BATCH          33
+#define ZEBRA_MESSAGE_MAX                 34
 
 /* Marker value used in new Zserv, in the byte location corresponding
  * the command value in the old zserv header. To allow old and new
@@ -24,6 +24,7 @@
 
 #include <zebra.h>
 #include "linklist.h"
+#include "table.h"
 #include "ripngd/ripng_route.h"
 #include "ripngd/ripngd.h"
 
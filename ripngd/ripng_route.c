@@ -46,6 +46,29 @@ ripng_aggregate_free (struct ripng_aggregate *aggregate)
   XFREE (MTYPE_RIPNG_AGGREGATE, aggregate);
 }
 
+static struct route_node *
+ripng_node_create (route_table_delegate_t *delegate,
+		   struct route_table *table)
+{
+  struct ripng_node *node;
+
+  node = XCALLOC (MTYPE_RIPNG_NODE, sizeof (struct ripng_node));
+  return (struct route_node *) node;
+}
+
+static void
+ripng_node_destroy (route_table_delegate_t *delegate,
+		    struct route_table *table, struct route_node *node)
+{
+  XFREE (MTYPE_RIPNG_NODE, node);
+}
+
+/* Delegate for the RIPng routing table. */
+route_table_delegate_t ripng_table_delegate = {
+  .create_node = ripng_node_create,
+  .destroy_node = ripng_node_destroy
+};
+
 /* Aggregate count increment check. */
 void
 ripng_aggregate_increment (struct route_node *child, struct ripng_info *rinfo)
@@ -54,7 +77,7 @@ ripng_aggregate_increment (struct route_node *child, struct ripng_info *rinfo)
   struct ripng_aggregate *aggregate;
 
   for (np = child; np; np = np->parent)
-    if ((aggregate = np->aggregate) != NULL)
+    if ((aggregate = RIPNG_NODE_AGGREGATE (np)) != NULL)
       {
 	aggregate->count++;
 	rinfo->suppress++;
@@ -69,7 +92,7 @@ ripng_aggregate_decrement (struct route_node *child, struct ripng_info *rinfo)
   struct ripng_aggregate *aggregate;
 
   for (np = child; np; np = np->parent)
-    if ((aggregate = np->aggregate) != NULL)
+    if ((aggregate = RIPNG_NODE_AGGREGATE (np)) != NULL)
       {
 	aggregate->count--;
 	rinfo->suppress--;
@@ -86,7 +109,7 @@ ripng_aggregate_decrement_list (struct route_node *child, struct list *list)
   struct listnode *node = NULL;
 
   for (np = child; np; np = np->parent)
-    if ((aggregate = np->aggregate) != NULL)
+    if ((aggregate = RIPNG_NODE_AGGREGATE (np)) != NULL)
       aggregate->count -= listcount (list);
 
   for (ALL_LIST_ELEMENTS_RO (list, node, rinfo))
@@ -112,7 +135,7 @@ ripng_aggregate_add (struct prefix *p)
   aggregate = ripng_aggregate_new ();
   aggregate->metric = 1;
 
-  top->aggregate = aggregate;
+  RIPNG_NODE_AGGREGATE (top) = aggregate;
 
   /* Suppress routes match to the aggregate. */
   for (rp = route_lock_node (top); rp; rp = route_next_until (rp, top))
@@ -125,7 +148,7 @@ ripng_aggregate_add (struct prefix *p)
             rinfo->suppress++;
           }
       /* Suppress aggregate route.  This may not need. */
-      if (rp != top && (sub = rp->aggregate) != NULL)
+      if (rp != top && (sub = RIPNG_NODE_AGGREGATE (rp)) != NULL)
 	{
 	  aggregate->count++;
 	  sub->suppress++;
@@ -151,7 +174,7 @@ ripng_aggregate_delete (struct prefix *p)
   top = route_node_get (ripng->table, p);
 
   /* Allocate new aggregate. */
-  aggregate = top->aggregate;
+  aggregate = RIPNG_NODE_AGGREGATE (top);
 
   /* Suppress routes match to the aggregate. */
   for (rp = route_lock_node (top); rp; rp = route_next_until (rp, top))
@@ -164,14 +187,14 @@ ripng_aggregate_delete (struct prefix *p)
             rinfo->suppress--;
           }
 
-      if (rp != top && (sub = rp->aggregate) != NULL)
+      if (rp != top && (sub = RIPNG_NODE_AGGREGATE (rp)) != NULL)
 	{
 	  aggregate->count--;
 	  sub->suppress--;
 	}
     }
 
-  top->aggregate = NULL;
+  RIPNG_NODE_AGGREGATE (top) = NULL;
   ripng_aggregate_free (aggregate);
 
   route_unlock_node (top);
@@ -44,6 +44,19 @@ struct ripng_aggregate
   u_int16_t tag_out;
 };
 
+/* Node of the RIPng routing table, carrying any aggregate configured
+ * for its prefix along with the routes. */
+struct ripng_node
+{
+  ROUTE_NODE_FIELDS
+
+  struct ripng_aggregate *aggregate;
+};
+
+#define RIPNG_NODE_AGGREGATE(rp) (((struct ripng_node *) (rp))->aggregate)
+
+extern route_table_delegate_t ripng_table_delegate;
+
 extern void ripng_aggregate_increment (struct route_node *rp,
                                        struct ripng_info *rinfo);
 extern void ripng_aggregate_decrement (struct route_node *rp,
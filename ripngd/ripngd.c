@@ -1726,7 +1726,7 @@ ripng_output_process (struct interface *ifp, struct sockaddr_in6 *to,
 	}
 
       /* Process the aggregated RTE entry */
-      if ((aggregate = rp->aggregate) != NULL && 
+      if ((aggregate = RIPNG_NODE_AGGREGATE (rp)) != NULL && 
 	  aggregate->count > 0 && 
 	  aggregate->suppress == 0)
 	{
@@ -1825,7 +1825,7 @@ ripng_create (void)
   ripng->obuf = stream_new (RIPNG_MAX_PACKET_SIZE);
 
   /* Initialize RIPng routig table. */
-  ripng->table = route_table_init ();
+  ripng->table = route_table_init_with_delegate (&ripng_table_delegate);
   ripng->route = route_table_init ();
   ripng->aggregate = route_table_init ();
  
@@ -2002,7 +2002,7 @@ DEFUN (show_ipv6_ripng,
   
   for (rp = route_top (ripng->table); rp; rp = route_next (rp))
     {
-      if ((aggregate = rp->aggregate) != NULL)
+      if ((aggregate = RIPNG_NODE_AGGREGATE (rp)) != NULL)
 	{
 	  p = (struct prefix_ipv6 *) &rp->p;
 
@@ -2864,10 +2864,10 @@ ripng_clean()
             route_unlock_node (rp);
           }
 
-        if ((aggregate = rp->aggregate) != NULL)
+        if ((aggregate = RIPNG_NODE_AGGREGATE (rp)) != NULL)
           {
             ripng_aggregate_free (aggregate);
-            rp->aggregate = NULL;
+            RIPNG_NODE_AGGREGATE (rp) = NULL;
             route_unlock_node (rp);
           }
     }
@@ -1093,6 +1093,70 @@ parse_test (struct test_segment *t)
     aspath_unintern (&asp);
 }
 
+/* decoding must give what parsing does, as 2 and 4 byte data */
+static void
+decode_test (struct test_segment *t)
+{
+  static u_char buf[65536];
+  struct stream *s;
+  struct aspath *asp, *asp4, *decoded;
+  struct aspath as;
+  size_t bytes4;
+  int fails = 0;
+  
+  printf ("decode %s: %s\n", t->name, t->desc);
+  
+  asp = make_aspath (t->asdata, t->len, 0);
+  
+  if (aspath_decode (t->asdata, t->len, 0, &as, buf, sizeof (buf)) < 0)
+    {
+      if (asp)
+        {
+          printf ("failed to decode\n");
+          fails++;
+        }
+      else
+        printf ("Correctly failed to decode\n");
+    }
+  else if (!asp)
+    {
+      printf ("decoded invalid data: %s\n", as.str);
+      fails++;
+    }
+  else
+    {
+      printf ("decoded: %s\n", as.str);
+      
+      decoded = aspath_intern_decoded (&as);
+      if (decoded != asp
+          || strcmp (as.str, aspath_print (asp))
+          || !aspath_cmp (&as, asp))
+        {
+          printf ("decoded path differs from %s\n", aspath_print (asp));
+          fails++;
+        }
+      aspath_unintern (&decoded);
+      
+      s = stream_new (4096);
+      bytes4 = aspath_put (s, asp, 1);
+      asp4 = make_aspath (STREAM_DATA (s), bytes4, 1);
+      if (aspath_decode (STREAM_DATA (s), bytes4, 1, &as, buf, sizeof (buf)) < 0
+          || strcmp (as.str, aspath_print (asp4)) || !aspath_cmp (&as, asp4))
+        {
+          printf ("4 byte data decoded differently\n");
+          fails++;
+        }
+      aspath_unintern (&asp4);
+      stream_free (s);
+    }
+  
+  printf ("%s\n\n", fails ? FAILED : OK);
+  failed += fails;
+  
+  if (asp)
+    aspath_unintern (&asp);
+}
+
 /* prepend testing */
 static void
 prepend_test (struct tests *t)
@@ -1342,6 +1406,13 @@ main (void)
       empty_prepend_test (&test_segments[i++]);
     }
   
+  i = 0;
+  while (test_segments[i].name)
+    {
+      printf ("decode test %u\n", i);
+      decode_test (&test_segments[i++]);
+    }
+  
   i = 0;
   while (prepend_tests[i].test1)
     {
@@ -534,6 +534,120 @@ test_iter_pause (void)
   route_table_finish (table);
 }
 
+/*
+ * Random prefix, with lengths around those of a real table and some
+ * shorter than ROUTE_TABLE_INDEX_BITS.
+ */
+static void
+random_prefix (struct prefix_ipv4 *p)
+{
+  static const u_char lengths[] = { 0, 4, 8, 12, 14, 15, 16, 16, 17, 19,
+                                    20, 22, 23, 24, 24, 24, 28, 32 };
+
+  memset (p, 0, sizeof (*p));
+  p->family = AF_INET;
+  p->prefixlen = lengths[random () % (sizeof (lengths) / sizeof (lengths[0]))];
+  /* Keep to a few /8s, so the tree gets deep enough. */
+  p->prefix.s_addr = htonl ((10 + random () % 4) << 24 | (random () & 0xffffff));
+  apply_mask_ipv4 (p);
+}
+
+/*
+ * Same result from both tables for a longest match, or for an exact
+ * lookup.
+ */
+static void
+verify_same (struct route_node *rn1, struct route_node *rn2)
+{
+  assert ((rn1 == NULL) == (rn2 == NULL));
+  if (rn1)
+    {
+      assert (prefix_same (&rn1->p, &rn2->p));
+      route_unlock_node (rn1);
+      route_unlock_node (rn2);
+    }
+}
+
+/*
+ * test_lookup_index
+ *
+ * Churn a plain and an indexed table the same way, and compare
+ * lookups between them.
+ */
+static void
+test_lookup_index (void)
+{
+  struct route_table *plain, *indexed;
+  struct route_table *tables[2];
+  struct route_node *rn;
+  struct prefix_ipv4 p;
+  struct in_addr addr;
+  char buf[INET_ADDRSTRLEN + 4];
+  test_node_t *node;
+  int i, t;
+
+  srandom (1);
+  plain = tables[0] = route_table_init ();
+  indexed = tables[1] = route_table_init_indexed ();
+
+  for (i = 0; i < 60000; i++)
+    {
+      random_prefix (&p);
+
+      for (t = 0; t < 2; t++)
+	{
+	  /* Every third operation removes a route again, if present. */
+	  if (i % 3 == 2)
+	    {
+	      rn = route_node_lookup (tables[t], (struct prefix *) &p);
+	      if (rn == NULL)
+		continue;
+	      node = rn->info;
+	      rn->info = NULL;
+	      route_unlock_node (rn);
+	      route_unlock_node (rn);
+	      free (node->prefix_str);
+	      free (node);
+	      continue;
+	    }
+
+	  rn = route_node_get (tables[t], (struct prefix *) &p);
+	  if (rn->info)
+	    {
+	      route_unlock_node (rn);
+	      continue;
+	    }
+	  node = malloc (sizeof (test_node_t));
+	  assert (node);
+	  node->prefix_str = strdup (prefix2str (&p, buf, sizeof (buf)));
+	  rn->info = node;
+	}
+    }
+
+  assert (indexed->index != NULL);
+  assert (route_table_count (plain) == route_table_count (indexed));
+
+  for (i = 0; i < 200000; i++)
+    {
+      addr.s_addr = htonl ((10 + random () % 4) << 24 | (random () & 0xffffff));
+      verify_same (route_node_match_ipv4 (plain, &addr),
+		   route_node_match_ipv4 (indexed, &addr));
+
+      random_prefix (&p);
+      verify_same (route_node_lookup (plain, (struct prefix *) &p),
+		   route_node_lookup (indexed, (struct prefix *) &p));
+      verify_same (route_node_match (plain, (struct prefix *) &p),
+		   route_node_match (indexed, (struct prefix *) &p));
+    }
+
+  printf ("Verified lookup index\n");
+
+  clear_table (plain);
+  clear_table (indexed);
+  route_table_finish (plain);
+  route_table_finish (indexed);
+}
+
 /*
  * run_tests
  */
@@ -543,6 +657,7 @@ run_tests (void)
   test_prefix_iter_cmp ();
   test_get_next ();
   test_iter_pause ();
+  test_lookup_index ();
 }
 
 /*
@@ -0,0 +1,88 @@
+/*
+ * Test program which measures the time it takes to queue events and
+ * cancel them again by argument with thread_cancel_event().
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "thread.h"
+#include "prng.h"
+
+#define QUEUE_EVENTS   100000
+/* Several events per argument, as when a peer has a few FSM events
+ * pending while it is torn down */
+#define EVENT_ARGS     (QUEUE_EVENTS / 4)
+
+struct thread_master *master;
+
+static int dummy_func(struct thread *thread)
+{
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  struct prng *prng;
+  int i;
+  char *args;
+  struct timeval tv_start, tv_lap, tv_stop;
+  unsigned long t_queue, t_cancel;
+  unsigned int cancelled = 0;
+
+  master = thread_master_create();
+  prng = prng_new(0);
+  args = calloc(EVENT_ARGS, 1);
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &tv_start);
+
+  for (i = 0; i < QUEUE_EVENTS; i++)
+    thread_add_event(master, dummy_func,
+                     &args[prng_rand(prng) % EVENT_ARGS], 0);
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &tv_lap);
+
+  for (i = 0; i < EVENT_ARGS; i++)
+    cancelled += thread_cancel_event(master, &args[i]);
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &tv_stop);
+
+  t_queue = 1000 * (tv_lap.tv_sec - tv_start.tv_sec);
+  t_queue += (tv_lap.tv_usec - tv_start.tv_usec) / 1000;
+
+  t_cancel = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
+  t_cancel += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
+
+  printf("Queueing %d events took %ld.%03ld seconds.\n",
+         QUEUE_EVENTS, t_queue/1000, t_queue%1000);
+  printf("Cancelling them for %d arguments took %ld.%03ld seconds.\n",
+         EVENT_ARGS, t_cancel/1000, t_cancel%1000);
+  fflush(stdout);
+
+  assert(cancelled == QUEUE_EVENTS);
+  assert(master->event.count == 0);
+
+  free(args);
+  thread_master_free(master);
+  prng_free(prng);
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Test hash table consistency, chained and open addressing.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "hash.h"
+#include "memory.h"
+
+#include "prng.h"
+
+struct thread_master *master;
+
+#define ENTRIES 100000
+
+struct item
+{
+  unsigned int value;
+  int present;
+  int seen;
+};
+
+static struct item items[ENTRIES];
+static int failed;
+
+/* Deliberately poor, so long collision chains get exercised too. */
+static unsigned int
+item_key_poor (void *p)
+{
+  return ((struct item *) p)->value % 997;
+}
+
+static unsigned int
+item_key (void *p)
+{
+  return ((struct item *) p)->value * 2654435761U;
+}
+
+static int
+item_cmp (const void *a, const void *b)
+{
+  return ((const struct item *) a)->value == ((const struct item *) b)->value;
+}
+
+static void
+item_seen (struct hash_backet *hb, void *arg)
+{
+  struct item *item = hb->data;
+
+  if (item->seen++ || !item->present)
+    failed = 1;
+}
+
+/* Release every third entry from within the walk. */
+static void
+item_seen_release (struct hash_backet *hb, void *arg)
+{
+  struct hash *hash = arg;
+  struct item *item = hb->data;
+
+  item_seen (hb, arg);
+  if (item->value % 3 == 0)
+    {
+      if (hash_release (hash, item) != item)
+        failed = 1;
+      item->present = 0;
+    }
+}
+
+static void
+check_all (struct hash *hash, const char *what)
+{
+  unsigned long count = 0;
+  int i;
+
+  for (i = 0; i < ENTRIES; i++)
+    {
+      struct item *found = hash_lookup (hash, &items[i]);
+
+      if (items[i].present != (found == &items[i]))
+        {
+          printf ("%s: entry %d %s\n", what, i,
+                  found ? "should be gone" : "missing");
+          failed = 1;
+        }
+      count += items[i].present;
+      items[i].seen = 0;
+    }
+  if (count != hash->count)
+    {
+      printf ("%s: count %lu, expected %lu\n", what, hash->count, count);
+      failed = 1;
+    }
+}
+
+static void
+test_hash (struct hash *hash, const char *name, struct prng *prng)
+{
+  int i, j;
+
+  for (i = 0; i < ENTRIES; i++)
+    {
+      items[i].value = i;
+      items[i].present = 0;
+      items[i].seen = 0;
+    }
+
+  /* Random inserts and releases, lookups checked along the way. */
+  for (j = 0; j < 4 * ENTRIES; j++)
+    {
+      i = prng_rand (prng) % ENTRIES;
+      if (items[i].present)
+        {
+          if (hash_release (hash, &items[i]) != &items[i])
+            failed = 1;
+          items[i].present = 0;
+        }
+      else
+        {
+          if (hash_get (hash, &items[i], hash_alloc_intern) != &items[i])
+            failed = 1;
+          items[i].present = 1;
+        }
+    }
+  check_all (hash, name);
+
+  hash_iterate (hash, item_seen, NULL);
+  for (i = 0; i < ENTRIES; i++)
+    if (items[i].present && items[i].seen != 1)
+      failed = 1;
+  check_all (hash, name);
+
+  hash_iterate (hash, item_seen_release, hash);
+  check_all (hash, name);
+
+  /* Fill up completely, then drain. */
+  for (i = 0; i < ENTRIES; i++)
+    if (!items[i].present)
+      {
+        hash_get (hash, &items[i], hash_alloc_intern);
+        items[i].present = 1;
+      }
+  check_all (hash, name);
+  for (i = 0; i < ENTRIES; i += 2)
+    {
+      hash_release (hash, &items[i]);
+      items[i].present = 0;
+    }
+  check_all (hash, name);
+
+  hash_clean (hash, NULL);
+  if (hash->count)
+    failed = 1;
+  hash_free (hash);
+
+  printf ("%s: %s\n", name, failed ? "FAILED" : "OK");
+}
+
+int
+main (int argc, char **argv)
+{
+  struct prng *prng = prng_new (0);
+
+  test_hash (hash_create (item_key, item_cmp), "chained", prng);
+  test_hash (hash_create (item_key_poor, item_cmp), "chained poor", prng);
+  test_hash (hash_create_open (item_key, item_cmp), "open", prng);
+  test_hash (hash_create_open_size (8, item_key_poor, item_cmp),
+             "open poor", prng);
+
+  prng_free (prng);
+
+  if (failed)
+    return 1;
+
+  printf ("Hash tests passed.\n");
+  return 0;
+}
@@ -41,9 +41,10 @@ struct thread_master *master;
 #endif
 
 #define TIMES 10
+#define SLAB_OBJECTS 5000
 
-int
-main(int argc, char **argv)
+static void
+torture (void)
 {
   void *a[10];
   int i;
@@ -118,5 +119,67 @@ main(int argc, char **argv)
       XFREE(MTYPE_VTY, a[2]);
       /* alloc == 0, cache valid next request */
     }
+}
+
+/* Fill several slabs, free them out of order and check nothing
+ * was handed out twice along the way. */
+static int
+slab_torture (void)
+{
+  static unsigned long *a[SLAB_OBJECTS];
+  int i, j;
+
+  for (i = 0; i < SLAB_OBJECTS; i++)
+    {
+      a[i] = XCALLOC (MTYPE_VTY, 1024);
+      a[i][0] = i;
+    }
+  for (i = 0; i < SLAB_OBJECTS; i += 3)
+    XFREE (MTYPE_VTY, a[i]);
+  for (i = 0; i < SLAB_OBJECTS; i += 3)
+    {
+      a[i] = XMALLOC (MTYPE_VTY, 1024);
+      a[i][0] = i;
+    }
+  for (i = 0; i < SLAB_OBJECTS; i++)
+    if (a[i][0] != (unsigned long) i)
+      {
+        printf ("slab object %d overwritten\n", i);
+        return 1;
+      }
+  for (j = 0; j < 2; j++)
+    for (i = j; i < SLAB_OBJECTS; i += 2)
+      XFREE (MTYPE_VTY, a[i]);
+
+  if (mtype_stats_alloc (MTYPE_VTY) != 0
+      || mtype_stats_bytes (MTYPE_VTY) != 0)
+    {
+      printf ("%lu objects, %lu bytes leaked\n", mtype_stats_alloc (MTYPE_VTY),
+              (unsigned long) mtype_stats_bytes (MTYPE_VTY));
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  printf ("system allocator\n\n");
+  torture ();
+  if (mtype_stats_bytes (MTYPE_VTY) != 0)
+    {
+      printf ("%lu bytes still accounted\n",
+              (unsigned long) mtype_stats_bytes (MTYPE_VTY));
+      return 1;
+    }
+
+  /* Same again with 1024 byte objects from slabs, other sizes and
+   * reallocs fall back to the system allocator */
+  printf ("slab allocator\n\n");
+  memory_slab_enable (MTYPE_VTY, 1024);
+  torture ();
+  if (slab_torture ())
+    return 1;
+  memory_slab_disable (MTYPE_VTY);
   return 0;
 }
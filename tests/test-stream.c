@@ -52,7 +52,7 @@ print_stream (struct stream *s)
 int
 main (void)
 {
-  struct stream *s;
+  struct stream *s, *t;
   
   s = stream_new (1024);
   
@@ -70,7 +70,17 @@ main (void)
   printf ("c: 0x%hhx\n", stream_getc (s));
   printf ("w: 0x%hx\n", stream_getw (s));
   printf ("l: 0x%x\n", stream_getl (s));
-  printf ("q: 0x%" PRIu64 "\n", stream_getq (s));
+  printf ("q: 0x%" PRIx64 "\n", stream_getq (s));
+
+  /* Shared data, read independently, outliving the original. */
+  t = stream_share (s);
+  stream_set_getp (s, 0);
+  printf ("shared c: 0x%hhx", stream_getc (s));
+  printf (" 0x%hhx\n", stream_getc (t));
+  stream_free (s);
+  printf ("shared w: 0x%hx\n", stream_getw (t));
+  print_stream (t);
+  stream_free (t);
   
   return 0;
 }
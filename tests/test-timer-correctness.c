@@ -136,10 +136,16 @@ int main(int argc, char **argv)
       int ret;
       char *arg;
 
-      /* Schedule timers to expire in 0..5 seconds */
+      /* Schedule timers to expire in 0..5 seconds, every fourth one
+       * with second granularity so that it goes via the timer wheel */
       interval_msec = prng_rand(prng) % 5000;
       arg = XMALLOC(MTYPE_TMP, TIMESTR_LEN + 1);
-      timers[i] = thread_add_timer_msec(master, timer_func, arg, interval_msec);
+      if (i % 4)
+        timers[i] = thread_add_timer_msec(master, timer_func, arg,
+                                          interval_msec);
+      else
+        timers[i] = thread_add_timer(master, timer_func, arg,
+                                     interval_msec / 1000);
       ret = snprintf(arg, TIMESTR_LEN + 1, "%lld.%06lld",
                      (long long)timers[i]->u.sands.tv_sec,
                      (long long)timers[i]->u.sands.tv_usec);
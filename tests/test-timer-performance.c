@@ -98,6 +98,47 @@ int main(int argc, char **argv)
          REMOVE_TIMERS, t_remove/1000, t_remove%1000);
   fflush(stdout);
 
+  /* Same again for timers of second granularity, on the timer wheel */
+  for (i = 0; i < SCHEDULE_TIMERS; i++)
+    if (timers[i])
+      thread_cancel(timers[i]);
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &tv_start);
+
+  for (i = 0; i < SCHEDULE_TIMERS; i++)
+    {
+      long interval_sec;
+
+      interval_sec = prng_rand(prng) % (100 * SCHEDULE_TIMERS / 1000);
+      timers[i] = thread_add_timer(master, dummy_func, NULL, interval_sec);
+    }
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &tv_lap);
+
+  for (i = 0; i < REMOVE_TIMERS; i++)
+    {
+      int index;
+
+      index = prng_rand(prng) % SCHEDULE_TIMERS;
+      if (timers[index])
+        thread_cancel(timers[index]);
+      timers[index] = NULL;
+    }
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &tv_stop);
+
+  t_schedule = 1000 * (tv_lap.tv_sec - tv_start.tv_sec);
+  t_schedule += (tv_lap.tv_usec - tv_start.tv_usec) / 1000;
+
+  t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
+  t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
+
+  printf("Scheduling %d random second timers took %ld.%03ld seconds.\n",
+         SCHEDULE_TIMERS, t_schedule/1000, t_schedule%1000);
+  printf("Removing %d random second timers took %ld.%03ld seconds.\n",
+         REMOVE_TIMERS, t_remove/1000, t_remove%1000);
+  fflush(stdout);
+
   free(timers);
   thread_master_free(master);
   prng_free(prng);
@@ -0,0 +1,128 @@
+/*
+ * Test program which checks that every job submitted to a worker pool
+ * is run exactly once and completed back in the thread master, except
+ * for those cancelled.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "thread.h"
+#include "workpool.h"
+
+#define POOL_THREADS  4
+#define JOBS          10000
+#define CANCEL_JOBS   100
+#define WAIT_JOBS     100
+
+struct thread_master *master;
+
+struct job
+{
+  unsigned long input;
+  unsigned long result;
+  int worked;
+  int completed;
+};
+
+static struct job *jobs;
+static int jobs_pending;
+
+/* Runs in a worker: no allocation, logging or thread calls */
+static void work_func(void *arg)
+{
+  struct job *job = arg;
+  unsigned long i;
+
+  job->result = 0;
+  for (i = 0; i <= job->input; i++)
+    job->result += i;
+  job->worked++;
+}
+
+static int done_func(struct thread *thread)
+{
+  struct job *job = THREAD_ARG(thread);
+
+  assert(job->worked == 1);
+  assert(job->result == job->input * (job->input + 1) / 2);
+  job->completed++;
+  jobs_pending--;
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  struct work_pool *pool;
+  struct thread t;
+  int i;
+
+  master = thread_master_create();
+  pool = work_pool_new(master, "test", POOL_THREADS);
+  assert(pool);
+
+  jobs = XCALLOC(MTYPE_TMP, JOBS * sizeof(*jobs));
+  for (i = 0; i < JOBS; i++)
+    {
+      jobs[i].input = i;
+      work_pool_submit(pool, work_func, done_func, &jobs[i]);
+      jobs_pending++;
+    }
+
+  /* Some of these will be queued, running or done by now */
+  for (i = 0; i < CANCEL_JOBS; i++)
+    {
+      struct job *job = &jobs[(i * 97) % JOBS];
+
+      if (work_pool_cancel(pool, job))
+        jobs_pending--;
+      thread_cancel_event(master, job);
+    }
+
+  while (jobs_pending && thread_fetch(master, &t))
+    thread_call(&t);
+
+  for (i = 0; i < JOBS; i++)
+    assert(jobs[i].completed <= 1 && jobs[i].worked <= 1);
+
+  printf("Worker pool completed all jobs.\n");
+
+  /* Waited for jobs are the caller's to complete */
+  memset(jobs, 0, WAIT_JOBS * sizeof(*jobs));
+  for (i = 0; i < WAIT_JOBS; i++)
+    {
+      jobs[i].input = i * 1000;
+      work_pool_submit(pool, work_func, done_func, &jobs[i]);
+    }
+  for (i = WAIT_JOBS - 1; i >= 0; i--)
+    {
+      assert(work_pool_wait(pool, &jobs[i]) == 1);
+      assert(jobs[i].worked == 1);
+      assert(jobs[i].result == jobs[i].input * (jobs[i].input + 1) / 2);
+    }
+  assert(work_pool_wait(pool, &jobs[0]) == 0);
+
+  printf("Worker pool waited for all jobs.\n");
+
+  work_pool_free(pool);
+  XFREE(MTYPE_TMP, jobs);
+  thread_master_free(master);
+  return 0;
+}
@@ -1557,6 +1557,72 @@ DEFUN (vtysh_show_thread,
   return ret;
 }
 
+DEFUN (vtysh_show_thread_timers,
+       vtysh_show_thread_timers_cmd,
+       "show thread timers",
+      SHOW_STR
+      "Thread information\n"
+      "Timer wheel and queue occupancy\n")
+{
+  unsigned int i;
+  int ret = CMD_SUCCESS;
+  char line[] = "show thread timers\n";
+
+  for (i = 0; i < array_size(vtysh_client); i++)
+    if ( vtysh_client[i].fd >= 0 )
+      {
+        fprintf (stdout, "Thread timers for %s:\n",
+                 vtysh_client[i].name);
+        ret = vtysh_client_execute (&vtysh_client[i], line, stdout);
+        fprintf (stdout,"\n");
+      }
+  return ret;
+}
+
+DEFUN (vtysh_show_hash_stats,
+       vtysh_show_hash_stats_cmd,
+       "show hash statistics",
+       SHOW_STR
+       "Hash tables\n"
+       "Size and chain length statistics\n")
+{
+  unsigned int i;
+  int ret = CMD_SUCCESS;
+  char line[] = "show hash statistics\n";
+
+  for (i = 0; i < array_size(vtysh_client); i++)
+    if ( vtysh_client[i].fd >= 0 )
+      {
+        fprintf (stdout, "Hash tables for %s:\n",
+                 vtysh_client[i].name);
+        ret = vtysh_client_execute (&vtysh_client[i], line, stdout);
+        fprintf (stdout,"\n");
+      }
+  return ret;
+}
+
+DEFUN (vtysh_show_memory_route_node,
+       vtysh_show_memory_route_node_cmd,
+       "show memory route-node",
+       SHOW_STR
+       "Memory statistics\n"
+       "Memory used per route table node\n")
+{
+  unsigned int i;
+  int ret = CMD_SUCCESS;
+  char line[] = "show memory route-node\n";
+
+  for (i = 0; i < array_size(vtysh_client); i++)
+    if ( vtysh_client[i].fd >= 0 )
+      {
+        fprintf (stdout, "Route table nodes for %s:\n",
+                 vtysh_client[i].name);
+        ret = vtysh_client_execute (&vtysh_client[i], line, stdout);
+        fprintf (stdout,"\n");
+      }
+  return ret;
+}
+
 DEFUN (vtysh_show_work_queues,
        vtysh_show_work_queues_cmd,
        "show work-queues",
@@ -1651,6 +1717,24 @@ DEFUN (vtysh_show_memory,
   return ret;
 }
 
+DEFUN (vtysh_show_memory_dump,
+       vtysh_show_memory_dump_cmd,
+       "show memory dump",
+       SHOW_STR
+       "Memory statistics\n"
+       "Per type counters as comma separated values\n")
+{
+  unsigned int i;
+  int ret = CMD_SUCCESS;
+  char line[] = "show memory dump\n";
+
+  for (i = 0; i < array_size(vtysh_client); i++)
+    if ( vtysh_client[i].fd >= 0 )
+      ret = vtysh_client_execute (&vtysh_client[i], line, stdout);
+
+  return ret;
+}
+
 /* Logging commands. */
 DEFUN (vtysh_show_logging,
        vtysh_show_logging_cmd,
@@ -2830,6 +2914,10 @@ vtysh_init_vty (void)
   
   install_element (VIEW_NODE, &vtysh_show_memory_cmd);
   install_element (ENABLE_NODE, &vtysh_show_memory_cmd);
+  install_element (VIEW_NODE, &vtysh_show_memory_dump_cmd);
+  install_element (ENABLE_NODE, &vtysh_show_memory_dump_cmd);
+  install_element (VIEW_NODE, &vtysh_show_memory_route_node_cmd);
+  install_element (ENABLE_NODE, &vtysh_show_memory_route_node_cmd);
 
   install_element (VIEW_NODE, &vtysh_show_work_queues_cmd);
   install_element (ENABLE_NODE, &vtysh_show_work_queues_cmd);
@@ -2838,6 +2926,10 @@ vtysh_init_vty (void)
 
   install_element (VIEW_NODE, &vtysh_show_thread_cmd);
   install_element (ENABLE_NODE, &vtysh_show_thread_cmd);
+  install_element (VIEW_NODE, &vtysh_show_thread_timers_cmd);
+  install_element (ENABLE_NODE, &vtysh_show_thread_timers_cmd);
+  install_element (VIEW_NODE, &vtysh_show_hash_stats_cmd);
+  install_element (ENABLE_NODE, &vtysh_show_hash_stats_cmd);
 
   /* Logging */
   install_element (ENABLE_NODE, &vtysh_show_logging_cmd);
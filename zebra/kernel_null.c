@@ -30,11 +30,20 @@
 #include "zebra/connected.h"
 #include "zebra/rib.h"
 
-int kernel_route_rib (struct prefix *a, struct rib *old, struct rib *new) { return 0; }
+int kernel_route_rib (struct route_node *a, struct rib *old, struct rib *new)
+{ return 0; }
+void kernel_route_flush (struct zebra_vrf *a) { return; }
+void kernel_route_wait (struct zebra_vrf *a) { return; }
+void kernel_dataplane_show (struct vty *a) { return; }
 
 int kernel_add_route (struct prefix_ipv4 *a, struct in_addr *b, int c, int d)
 { return 0; }
 
+int kernel_nexthop_leg_add (struct nhg *a, struct nhg_leg *b) { return 0; }
+int kernel_nexthop_group_add (struct nhg *a, struct nhg_leg *b, int c)
+{ return 0; }
+int kernel_nexthop_delete (vrf_id_t a, u_int32_t b) { return 0; }
+
 int kernel_address_add_ipv4 (struct interface *a, struct connected *b)
 {
   zlog_debug ("%s", __func__);
@@ -41,6 +41,7 @@
 #include "zebra/irdp.h"
 #include "zebra/rtadv.h"
 #include "zebra/zebra_fpm.h"
+#include "zebra/zebra_nhg.h"
 
 /* Zebra instance */
 struct zebra_t zebrad =
@@ -405,6 +406,7 @@ main (int argc, char **argv)
   /* Zebra related initialize. */
   zebra_init ();
   rib_init ();
+  zebra_nhg_init ();
   zebra_if_init ();
   zebra_debug_init ();
   router_id_cmd_init ();
@@ -476,7 +478,10 @@ main (int argc, char **argv)
   * we have to have route_read() called before.
   */
   if (! keep_kernel_mode)
-    rib_sweep_route ();
+    {
+      rib_sweep_route ();
+      zebra_nhg_sweep ();
+    }
 
   /* Needed for BSD routing socket. */
   pid = getpid ();
@@ -181,6 +181,114 @@ zebra_redistribute (struct zserv *client, int type, vrf_id_t vrf_id)
 #endif /* HAVE_IPV6 */
 }
 
+/* Whether a walk of a route table visits prefix 'a' before, or at, 'b':
+ * the one with a 0 where they first differ, or the shorter one if
+ * either covers the other. */
+static int
+route_table_order (struct prefix *a, struct prefix *b)
+{
+  u_char *pa = (u_char *) &a->u.prefix;
+  u_char *pb = (u_char *) &b->u.prefix;
+  int len = MIN (a->prefixlen, b->prefixlen);
+  int ret;
+  u_char mask;
+
+  if ((ret = memcmp (pa, pb, len / 8)))
+    return ret < 0;
+
+  if (len % 8)
+    {
+      mask = 0xff << (8 - len % 8);
+      if ((pa[len / 8] & mask) != (pb[len / 8] & mask))
+	return (pa[len / 8] & mask) < (pb[len / 8] & mask);
+    }
+
+  return a->prefixlen <= b->prefixlen;
+}
+
+/* Whether the replay of redistributed routes to the client already went
+ * past route 'p' of VRF 'vrf_id'. */
+int
+zebra_redistribute_replayed (struct zserv *client, vrf_id_t vrf_id,
+			     struct prefix *p)
+{
+  afi_t afi = family2afi (p->family);
+
+  if (vrf_id != client->replay_vrf)
+    return vrf_id < client->replay_vrf;
+  if (afi != client->replay_afi)
+    return afi < client->replay_afi;
+
+  return client->replay_p.family && route_table_order (p, &client->replay_p);
+}
+
+/*
+ * Send the client the routes it redistributes, all over again, carrying
+ * on from where the previous call left off.  Stops after 'limit' route
+ * nodes, or once the client falls behind again.  Returns 1 when done.
+ */
+int
+zebra_redistribute_replay (struct zserv *client, int limit)
+{
+  vrf_iter_t iter;
+  vrf_id_t vrf_id;
+  struct route_table *table;
+  struct route_node *rn;
+  struct rib *rib;
+
+  for (iter = vrf_first (); iter != VRF_ITER_INVALID; iter = vrf_next (iter))
+    {
+      vrf_id = vrf_iter2id (iter);
+      if (vrf_id < client->replay_vrf)
+	continue;
+      if (vrf_id > client->replay_vrf)
+	{
+	  client->replay_vrf = vrf_id;
+	  client->replay_afi = AFI_IP;
+	  client->replay_p.family = 0;
+	}
+
+      for (; client->replay_afi < AFI_MAX; client->replay_afi++)
+	{
+	  table = zebra_vrf_table (client->replay_afi, SAFI_UNICAST, vrf_id);
+	  if (! table)
+	    rn = NULL;
+	  else if (client->replay_p.family)
+	    rn = route_next (route_node_get (table, &client->replay_p));
+	  else
+	    rn = route_top (table);
+
+	  for (; rn; rn = route_next (rn))
+	    {
+	      RNODE_FOREACH_RIB (rn, rib)
+		if (CHECK_FLAG (rib->flags, ZEBRA_FLAG_SELECTED)
+		    && rib->distance != DISTANCE_INFINITY
+		    && (vrf_bitmap_check (client->redist[rib->type], vrf_id)
+			|| (is_default (&rn->p)
+			    && vrf_bitmap_check (client->redist_default,
+						 vrf_id))))
+		  {
+		    client->replay_cnt++;
+		    zsend_route_multipath (rn->p.family == AF_INET
+					   ? ZEBRA_IPV4_ROUTE_ADD
+					   : ZEBRA_IPV6_ROUTE_ADD,
+					   client, &rn->p, rib);
+		  }
+
+	      if (--limit <= 0 || client->catchup != ZSERV_CATCHUP_REPLAY)
+		{
+		  prefix_copy (&client->replay_p, &rn->p);
+		  route_unlock_node (rn);
+		  return 0;
+		}
+	    }
+	  client->replay_p.family = 0;
+	}
+    }
+
+  return 1;
+}
+
 void
 redistribute_add (struct prefix *p, struct rib *rib)
 {
@@ -224,10 +332,16 @@ redistribute_delete (struct prefix *p, struct rib *rib)
           || vrf_bitmap_check (client->redist[rib->type], rib->vrf_id))
 	{
 	  if (p->family == AF_INET)
-	    zsend_route_multipath (ZEBRA_IPV4_ROUTE_DELETE, client, p, rib);
+	    {
+	      client->redist_v4_del_cnt++;
+	      zsend_route_multipath (ZEBRA_IPV4_ROUTE_DELETE, client, p, rib);
+	    }
 #ifdef HAVE_IPV6
 	  if (p->family == AF_INET6)
-	    zsend_route_multipath (ZEBRA_IPV6_ROUTE_DELETE, client, p, rib);
+	    {
+	      client->redist_v6_del_cnt++;
+	      zsend_route_multipath (ZEBRA_IPV6_ROUTE_DELETE, client, p, rib);
+	    }
 #endif /* HAVE_IPV6 */
 	}
     }
@@ -263,6 +377,7 @@ zebra_redistribute_delete (int command, struct zserv *client, int length,
     return;
 
   vrf_bitmap_unset (client->redist[type], vrf_id);
+  zserv_redist_purge (client);
 }
 
 void
@@ -278,6 +393,7 @@ zebra_redistribute_default_delete (int command, struct zserv *client,
     int length, vrf_id_t vrf_id)
 {
   vrf_bitmap_unset (client->redist_default, vrf_id);
+  zserv_redist_purge (client);
 }     
 
 /* Interface up information. */
@@ -34,6 +34,10 @@ extern void zebra_redistribute_default_add (int, struct zserv *, int,
 extern void zebra_redistribute_default_delete (int, struct zserv *, int,
     vrf_id_t);
 
+extern int zebra_redistribute_replayed (struct zserv *, vrf_id_t,
+					struct prefix *);
+extern int zebra_redistribute_replay (struct zserv *, int);
+
 extern void redistribute_add (struct prefix *, struct rib *);
 extern void redistribute_delete (struct prefix *, struct rib *);
 
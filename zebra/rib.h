@@ -85,6 +85,25 @@ struct rib
   u_char nexthop_num;
   u_char nexthop_active_num;
   u_char nexthop_fib_num;
+
+  /* Nexthop group the route is installed with, if any. */
+  struct nhg *nhg;
+
+  /* Nexthop group the route's nexthops belong to, if any: 'nexthop' is
+   * then the group's list, unless the route has a copy of its own, see
+   * nexthop_active_update().  The generation of the group the route
+   * was last processed with, or made its copy from, see struct nhg. */
+  struct nhg *group;
+  u_int32_t group_gen;
+
+  /* Client's nexthop group the route was added with, 0 if none.  The
+   * routes of a client group share its nexthops, as those of 'group',
+   * see zebra_nhg_client_new(). */
+  u_int32_t client_nhg;
+
+  /* Sequence number of the last change made to install the route that
+   * the kernel has yet to answer for, 0 if none.  See rib_kernel_done(). */
+  u_int32_t kernel_seq;
 };
 
 /* meta-queue structure:
@@ -123,6 +142,12 @@ typedef struct rib_dest_t_
    */
   u_int32_t flags;
 
+  /*
+   * Changes made for this prefix the kernel has not answered for yet,
+   * see rib_kernel_queued().
+   */
+  unsigned int kernel_pending;
+
   /*
    * Linkage to put dest on the FPM processing queue.
    */
@@ -310,7 +335,9 @@ struct zebra_vrf
 #ifdef HAVE_NETLINK
   struct nlsock netlink;     /* kernel messages */
   struct nlsock netlink_cmd; /* command channel */
+  struct nlsock netlink_dplane; /* route changes, dataplane thread */
   struct thread *t_netlink;
+  struct nl_batch *netlink_batch; /* route changes, see rt_netlink.c */
 #endif
 
   /* 2nd pointer type used primarily to quell a warning on
@@ -328,6 +355,9 @@ struct zebra_vrf
 
   /* Recursive Nexthop table */
   struct route_table *rnh_table[AFI_MAX];
+
+  /* Nexthops to evaluate, see zebra_rnh_route_changed() */
+  struct list *rnh_dirty[AFI_MAX];
 };
 
 /*
@@ -442,6 +472,7 @@ extern struct rib *rib_match_ipv4_multicast (struct in_addr addr,
 extern struct rib *rib_lookup_ipv4 (struct prefix_ipv4 *, vrf_id_t);
 
 extern void rib_update (vrf_id_t);
+extern void rib_update_nhg (struct nhg *);
 extern void rib_weed_tables (void);
 extern void rib_sweep_route (void);
 extern void rib_close_table (struct route_table *);
@@ -488,6 +519,9 @@ static_delete_ipv6 (struct prefix *p, u_char type, struct in6_addr *gate,
 		    vrf_id_t vrf_id);
 
 extern int rib_gc_dest (struct route_node *rn);
+extern void rib_kernel_queued (struct route_node *, struct rib *, u_int32_t);
+extern void rib_kernel_done (struct route_node *, struct rib *, u_int32_t,
+			     int);
 extern struct route_table *rib_tables_iter_next (rib_tables_iter_t *iter);
 
 /*
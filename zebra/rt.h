@@ -27,9 +27,19 @@
 #include "if.h"
 #include "zebra/rib.h"
 
-extern int kernel_route_rib (struct prefix *, struct rib *, struct rib *);
+extern int kernel_route_rib (struct route_node *, struct rib *, struct rib *);
+extern void kernel_route_flush (struct zebra_vrf *);
+extern void kernel_route_wait (struct zebra_vrf *);
+struct vty;
+extern void kernel_dataplane_show (struct vty *);
 extern int kernel_add_route (struct prefix_ipv4 *, struct in_addr *, int, int);
 extern int kernel_address_add_ipv4 (struct interface *, struct connected *);
 extern int kernel_address_delete_ipv4 (struct interface *, struct connected *);
 
+struct nhg;
+struct nhg_leg;
+extern int kernel_nexthop_leg_add (struct nhg *, struct nhg_leg *);
+extern int kernel_nexthop_group_add (struct nhg *, struct nhg_leg *, int);
+extern int kernel_nexthop_delete (vrf_id_t, u_int32_t);
+
 #endif /* _ZEBRA_RT_H */
@@ -39,6 +39,8 @@
 #include "privs.h"
 #include "vrf.h"
 #include "nexthop.h"
+#include "workpool.h"
+#include "vty.h"
 
 #include "zebra/zserv.h"
 #include "zebra/rt.h"
@@ -46,8 +48,19 @@
 #include "zebra/interface.h"
 #include "zebra/debug.h"
 
+#include "zebra/zebra_nhg.h"
+
 #include "rt_netlink.h"
 
+#ifdef RTM_NEWNEXTHOP
+#include <linux/nexthop.h>
+
+#define NHA_RTA(r) \
+  ((struct rtattr *) (((char *) (r)) + NLMSG_ALIGN (sizeof (struct nhmsg))))
+
+static void netlink_nexthop_read (struct zebra_vrf *);
+#endif /* RTM_NEWNEXTHOP */
+
 static const struct message nlmsg_str[] = {
   {RTM_NEWROUTE, "RTM_NEWROUTE"},
   {RTM_DELROUTE, "RTM_DELROUTE"},
@@ -58,6 +71,11 @@ static const struct message nlmsg_str[] = {
   {RTM_NEWADDR,  "RTM_NEWADDR"},
   {RTM_DELADDR,  "RTM_DELADDR"},
   {RTM_GETADDR,  "RTM_GETADDR"},
+#ifdef RTM_NEWNEXTHOP
+  {RTM_NEWNEXTHOP, "RTM_NEWNEXTHOP"},
+  {RTM_DELNEXTHOP, "RTM_DELNEXTHOP"},
+  {RTM_GETNEXTHOP, "RTM_GETNEXTHOP"},
+#endif /* RTM_NEWNEXTHOP */
   {0, NULL}
 };
 
@@ -401,6 +419,11 @@ netlink_parse_info (int (*filter) (struct sockaddr_nl *, struct nlmsghdr *,
               continue;
             }
 
+          /* Nor the route changes made by the dataplane thread. */
+          if (nl == &zvrf->netlink
+              && h->nlmsg_pid == zvrf->netlink_dplane.snl.nl_pid)
+            continue;
+
           error = (*filter) (&snl, h, zvrf->vrf_id);
           if (error < 0)
             {
@@ -778,6 +801,13 @@ netlink_routing_table (struct sockaddr_nl *snl, struct nlmsghdr *h,
   if (rtm->rtm_protocol == RTPROT_ZEBRA)
     flags |= ZEBRA_FLAG_SELFROUTE;
 
+#ifdef RTM_NEWNEXTHOP
+  /* Goes away with its nexthop object, see zebra_nhg_sweep(). */
+  if (tb[RTA_NH_ID]
+      && zebra_nhg_kernel_stale (*(u_int32_t *) RTA_DATA (tb[RTA_NH_ID])))
+    return 0;
+#endif /* RTM_NEWNEXTHOP */
+
   index = 0;
   dest = NULL;
   gate = NULL;
@@ -1315,6 +1345,12 @@ netlink_route_read (struct zebra_vrf *zvrf)
 {
   int ret;
 
+#ifdef RTM_NEWNEXTHOP
+  /* Only the default VRF's routes use nexthop objects. */
+  if (zvrf->vrf_id == VRF_DEFAULT)
+    netlink_nexthop_read (zvrf);
+#endif /* RTM_NEWNEXTHOP */
+
   /* Get IPv4 routing table. */
   ret = netlink_request (AF_INET, RTM_GETROUTE, &zvrf->netlink_cmd);
   if (ret < 0)
@@ -1401,6 +1437,486 @@ addattr32 (struct nlmsghdr *n, size_t maxlen, int type, int data)
   return 0;
 }
 
+/*
+ * Batched route changes, and the dataplane thread.
+ *
+ * Route changes are not sent one at a time, each waiting for the kernel
+ * to answer, but packed into a batch, which is handed to the dataplane
+ * thread once the RIB work queue runs dry, as soon as it is full, or at
+ * the latest NL_BATCH_FLUSH_MSEC after the first change went in.
+ * That thread sends the batch on a netlink socket of its own and picks
+ * up the kernel's answers, so that a slow kernel holds up neither the
+ * zserv clients nor RIB processing.  Only the last message of a batch
+ * asks for an acknowledgement: the kernel handles the messages of a
+ * socket in order, before sendmsg() returns, and reports those that
+ * fail, so its answer to the last one settles the others.  Back on the
+ * main thread, the answers are matched by sequence number to the route
+ * nodes the changes were made for, see rib_kernel_done().
+ *
+ * Any message sent by netlink_talk() waits for the batches before it,
+ * so that, say, a nexthop object is not deleted before the routes using
+ * it are moved off it.
+ */
+#define NL_BATCH_BUF_SIZE 65536
+#define NL_BATCH_FLUSH_MSEC 10
+
+struct nl_pending
+{
+  struct nl_pending *next;
+  u_int32_t seq;
+  int cmd;
+  int error;
+  struct timeval queued;
+  struct route_node *rn;
+  struct rib *rib;		/* route installed, NULL for a deletion */
+};
+
+/* A batch handed to the dataplane thread. */
+struct nl_job
+{
+  struct nl_job *next;
+  struct zebra_vrf *zvrf;
+  int sock;
+
+  char *buf;
+  size_t len;
+  u_int32_t first;		/* sequence numbers of the messages */
+  u_int32_t last;
+
+  /* Written by the dataplane thread. */
+  int *errors;			/* per message, from first on */
+  int send_errno;
+  int recv_errno;
+  int lost;			/* the last answer never came */
+};
+
+/* Latency from a change being queued to the kernel answering for it,
+ * in buckets of below 1ms, 10ms, 100ms, 1s and the rest. */
+#define NL_LATENCY_BUCKETS 5
+static const unsigned long nl_latency_bound[NL_LATENCY_BUCKETS - 1] =
+  { 1000, 10000, 100000, 1000000 };
+
+struct nl_batch
+{
+  /* Messages not handed over yet, the last one at offset 'last', the
+   * first one with sequence number 'first'. */
+  char *buf;
+  size_t len;
+  size_t last;
+  u_int32_t first;
+
+  /* Changes the kernel has not answered for, oldest first. */
+  struct nl_pending *head;
+  struct nl_pending *tail;
+  unsigned int pending;
+
+  /* Batches with the dataplane thread, oldest first. */
+  struct nl_job *jobs;
+  struct nl_job *jobs_tail;
+  unsigned int jobs_count;
+
+  /* Changes answered for, to be handed to rib_kernel_done(). */
+  struct nl_pending *done;
+  struct nl_pending *done_tail;
+
+  struct thread *t_flush;
+  struct thread *t_done;
+
+  /* Statistics. */
+  unsigned long batches;
+  unsigned long messages;
+  unsigned long errors;
+  unsigned long lost;
+  unsigned int max_pending;
+  unsigned int max_jobs;
+  unsigned long latency[NL_LATENCY_BUCKETS];
+  unsigned long latency_max;	/* usecs */
+};
+
+/* The dataplane thread, NULL if it could not be started, in which case
+ * batches are sent from the main thread. */
+static struct work_pool *nl_dplane_pool;
+
+/* Where the dataplane thread reads answers into. */
+static char *nl_dplane_rcvbuf;
+
+/* Send a batch and pick up the answers, in the dataplane thread. */
+static void
+netlink_dplane_work (void *arg)
+{
+  struct nl_job *job = arg;
+  struct sockaddr_nl snl;
+  struct iovec iov;
+  struct msghdr msg;
+  int status;
+
+  memset (&snl, 0, sizeof snl);
+  snl.nl_family = AF_NETLINK;
+  iov.iov_base = job->buf;
+  iov.iov_len = job->len;
+  memset (&msg, 0, sizeof msg);
+  msg.msg_name = (void *) &snl;
+  msg.msg_namelen = sizeof snl;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  /* Privilege changes are safe from any thread, see privs.c. */
+  zserv_privs.change (ZPRIVS_RAISE);
+  status = sendmsg (job->sock, &msg, 0);
+  job->send_errno = status < 0 ? errno : 0;
+  zserv_privs.change (ZPRIVS_LOWER);
+
+  if (status < 0)
+    return;
+
+  /* The kernel has answered by now. */
+  while (1)
+    {
+      struct nlmsghdr *h;
+
+      iov.iov_base = nl_dplane_rcvbuf;
+      iov.iov_len = NL_BATCH_BUF_SIZE;
+      status = recvmsg (job->sock, &msg, MSG_DONTWAIT);
+      if (status < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno == EWOULDBLOCK || errno == EAGAIN)
+            {
+              job->lost = 1;
+              return;
+            }
+          /* Some answers were dropped, read on for the others. */
+          job->recv_errno = errno;
+          if (errno == ENOBUFS)
+            continue;
+          job->lost = 1;
+          return;
+        }
+
+      for (h = (struct nlmsghdr *) nl_dplane_rcvbuf;
+           NLMSG_OK (h, (unsigned int) status);
+           h = NLMSG_NEXT (h, status))
+        {
+          struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA (h);
+          u_int32_t seq;
+
+          if (h->nlmsg_type != NLMSG_ERROR
+              || h->nlmsg_len < NLMSG_LENGTH (sizeof (struct nlmsgerr)))
+            continue;
+
+          /* Answers left over from a batch whose last one was lost.
+           * Sequence numbers wrap around. */
+          seq = err->msg.nlmsg_seq;
+          if (seq - job->first > job->last - job->first)
+            continue;
+
+          job->errors[seq - job->first] = -err->error;
+          if (seq == job->last)
+            return;
+        }
+    }
+}
+
+static int
+netlink_batch_done_event (struct thread *thread)
+{
+  struct zebra_vrf *zvrf = THREAD_ARG (thread);
+  struct nl_batch *b = zvrf->netlink_batch;
+  struct nl_pending *pend;
+
+  b->t_done = NULL;
+  while ((pend = b->done) != NULL)
+    {
+      b->done = pend->next;
+      rib_kernel_done (pend->rn, pend->rib, pend->seq, pend->error);
+      XFREE (MTYPE_NETLINK_PENDING, pend);
+    }
+  b->done_tail = NULL;
+  return 0;
+}
+
+/* The kernel answered for the oldest change.  The route node is dealt
+ * with from an event: answers may be picked up while netlink_talk()
+ * is about to send, which rib_kernel_done() could call again. */
+static void
+netlink_batch_settle (struct zebra_vrf *zvrf, int error)
+{
+  struct nl_batch *b = zvrf->netlink_batch;
+  struct nl_pending *pend = b->head;
+  struct timeval now;
+  unsigned long usec;
+  int bucket;
+
+  b->head = pend->next;
+  if (b->head == NULL)
+    b->tail = NULL;
+  b->pending--;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  usec = timeval_elapsed (now, pend->queued);
+  for (bucket = 0; bucket < NL_LATENCY_BUCKETS - 1; bucket++)
+    if (usec < nl_latency_bound[bucket])
+      break;
+  b->latency[bucket]++;
+  if (usec > b->latency_max)
+    b->latency_max = usec;
+
+  /* Races with the kernel, as in netlink_parse_info(). */
+  if ((pend->cmd == RTM_DELROUTE && (error == ENODEV || error == ESRCH))
+      || (pend->cmd == RTM_NEWROUTE && error == EEXIST))
+    error = 0;
+
+  if (error)
+    {
+      char buf[PREFIX_STRLEN];
+
+      b->errors++;
+      zlog_err ("%s error: %s, type=%s(%u), seq=%u, %s",
+		zvrf->netlink_dplane.name, safe_strerror (error),
+		lookup (nlmsg_str, pend->cmd), pend->cmd, pend->seq,
+		prefix2str (&pend->rn->p, buf, sizeof (buf)));
+    }
+
+  pend->error = error;
+  pend->next = NULL;
+  if (b->done_tail)
+    b->done_tail->next = pend;
+  else
+    b->done = pend;
+  b->done_tail = pend;
+
+  if (! b->t_done)
+    b->t_done = thread_add_event (zebrad.master, netlink_batch_done_event,
+				  zvrf, 0);
+}
+
+/* The dataplane thread is done with a batch, always the oldest one. */
+static void
+netlink_batch_complete (struct nl_job *job)
+{
+  struct zebra_vrf *zvrf = job->zvrf;
+  struct nl_batch *b = zvrf->netlink_batch;
+  const char *name = zvrf->netlink_dplane.name;
+
+  assert (b->jobs == job);
+  b->jobs = job->next;
+  if (b->jobs == NULL)
+    b->jobs_tail = NULL;
+  b->jobs_count--;
+
+  if (job->send_errno)
+    zlog_err ("%s sendmsg() error: %s", name, safe_strerror (job->send_errno));
+  else if (job->recv_errno)
+    zlog_err ("%s recvmsg error: %s", name, safe_strerror (job->recv_errno));
+  if (job->lost)
+    {
+      b->lost++;
+      zlog_err ("%s: answers for seq %u-%u lost, taking the changes as made",
+                name, job->first, job->last);
+    }
+
+  while (b->head && (int32_t) (b->head->seq - job->last) <= 0)
+    netlink_batch_settle (zvrf, job->send_errno ? job->send_errno
+                          : job->errors[b->head->seq - job->first]);
+
+  XFREE (MTYPE_NETLINK_BATCH, job->errors);
+  XFREE (MTYPE_NETLINK_BATCH, job->buf);
+  XFREE (MTYPE_NETLINK_BATCH, job);
+}
+
+static int
+netlink_batch_complete_event (struct thread *thread)
+{
+  netlink_batch_complete (THREAD_ARG (thread));
+  return 0;
+}
+
+/* Hand the batch over to the dataplane thread. */
+static void
+netlink_batch_flush (struct zebra_vrf *zvrf)
+{
+  struct nl_batch *b = zvrf->netlink_batch;
+  struct nl_job *job;
+
+  if (b == NULL || b->len == 0)
+    return;
+
+  THREAD_OFF (b->t_flush);
+
+  ((struct nlmsghdr *) (b->buf + b->last))->nlmsg_flags |= NLM_F_ACK;
+
+  job = XCALLOC (MTYPE_NETLINK_BATCH, sizeof (struct nl_job));
+  job->zvrf = zvrf;
+  job->sock = zvrf->netlink_dplane.sock;
+  job->buf = b->buf;
+  job->len = b->len;
+  job->first = b->first;
+  job->last = zvrf->netlink_dplane.seq;
+  job->errors = XCALLOC (MTYPE_NETLINK_BATCH,
+                         (job->last - job->first + 1) * sizeof (int));
+
+  b->buf = NULL;
+  b->len = 0;
+  b->batches++;
+
+  if (b->jobs_tail)
+    b->jobs_tail->next = job;
+  else
+    b->jobs = job;
+  b->jobs_tail = job;
+  if (++b->jobs_count > b->max_jobs)
+    b->max_jobs = b->jobs_count;
+
+  if (nl_dplane_pool)
+    work_pool_submit (nl_dplane_pool, netlink_dplane_work,
+                      netlink_batch_complete_event, job);
+  else
+    {
+      netlink_dplane_work (job);
+      netlink_batch_complete (job);
+    }
+}
+
+static int
+netlink_batch_flush_event (struct thread *thread)
+{
+  struct zebra_vrf *zvrf = THREAD_ARG (thread);
+
+  zvrf->netlink_batch->t_flush = NULL;
+  netlink_batch_flush (zvrf);
+  return 0;
+}
+
+/* Have all the route changes made so far answered for. */
+static void
+netlink_batch_wait (struct zebra_vrf *zvrf)
+{
+  struct nl_batch *b = zvrf->netlink_batch;
+
+  if (b == NULL)
+    return;
+
+  netlink_batch_flush (zvrf);
+  while (b->jobs)
+    {
+      struct nl_job *job = b->jobs;
+
+      if (nl_dplane_pool)
+        {
+          work_pool_wait (nl_dplane_pool, job);
+          thread_cancel_event (zebrad.master, job);
+        }
+      netlink_batch_complete (job);
+    }
+}
+
+/* Add a route change to the batch, to be answered for later. */
+static void
+netlink_batch_add (struct zebra_vrf *zvrf, struct nlmsghdr *n,
+                   struct route_node *rn, struct rib *rib)
+{
+  struct nl_batch *b = zvrf->netlink_batch;
+  struct nl_pending *pend;
+
+  if (b == NULL)
+    b = zvrf->netlink_batch = XCALLOC (MTYPE_NETLINK_BATCH,
+                                       sizeof (struct nl_batch));
+
+  if (b->len + NLMSG_ALIGN (n->nlmsg_len) > NL_BATCH_BUF_SIZE)
+    netlink_batch_flush (zvrf);
+
+  if (b->buf == NULL)
+    b->buf = XMALLOC (MTYPE_NETLINK_BATCH, NL_BATCH_BUF_SIZE);
+
+  /* 0 stands for no change, see rib_kernel_queued(). */
+  if (++zvrf->netlink_dplane.seq == 0)
+    zvrf->netlink_dplane.seq++;
+  n->nlmsg_seq = zvrf->netlink_dplane.seq;
+  if (b->len == 0)
+    b->first = n->nlmsg_seq;
+
+  if (IS_ZEBRA_DEBUG_KERNEL)
+    zlog_debug ("%s: %s type %s(%u), seq=%u", __func__,
+                zvrf->netlink_dplane.name, lookup (nlmsg_str, n->nlmsg_type),
+                n->nlmsg_type, n->nlmsg_seq);
+
+  memcpy (b->buf + b->len, n, n->nlmsg_len);
+  b->last = b->len;
+  b->len += NLMSG_ALIGN (n->nlmsg_len);
+  b->messages++;
+
+  pend = XCALLOC (MTYPE_NETLINK_PENDING, sizeof (struct nl_pending));
+  pend->seq = n->nlmsg_seq;
+  pend->cmd = n->nlmsg_type;
+  pend->rn = rn;
+  pend->rib = rib;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &pend->queued);
+  if (b->tail)
+    b->tail->next = pend;
+  else
+    b->head = pend;
+  b->tail = pend;
+  if (++b->pending > b->max_pending)
+    b->max_pending = b->pending;
+  rib_kernel_queued (rn, rib, pend->seq);
+
+  if (! b->t_flush)
+    b->t_flush = thread_add_timer_msec (zebrad.master,
+                                        netlink_batch_flush_event, zvrf,
+                                        NL_BATCH_FLUSH_MSEC);
+}
+
+/* Send the route changes not sent yet. */
+void
+kernel_route_flush (struct zebra_vrf *zvrf)
+{
+  netlink_batch_flush (zvrf);
+}
+
+/* Send the route changes not sent yet, and wait for the kernel to
+ * answer for them. */
+void
+kernel_route_wait (struct zebra_vrf *zvrf)
+{
+  netlink_batch_wait (zvrf);
+}
+
+void
+kernel_dataplane_show (struct vty *vty)
+{
+  static const char *bucket_str[NL_LATENCY_BUCKETS] =
+    { "<1ms", "<10ms", "<100ms", "<1s", ">=1s" };
+  vrf_iter_t iter;
+  struct zebra_vrf *zvrf;
+  struct nl_batch *b;
+  int i;
+
+  vty_out (vty, "Route changes are sent to the kernel in batches of up to"
+           " %u bytes, by %s%s", NL_BATCH_BUF_SIZE,
+           nl_dplane_pool ? "the dataplane thread" : "the main thread",
+           VTY_NEWLINE);
+
+  for (iter = vrf_first (); iter != VRF_ITER_INVALID; iter = vrf_next (iter))
+    {
+      if ((zvrf = vrf_iter2info (iter)) == NULL
+          || (b = zvrf->netlink_batch) == NULL)
+        continue;
+
+      vty_out (vty, "%sVRF %u:%s", VTY_NEWLINE, zvrf->vrf_id, VTY_NEWLINE);
+      vty_out (vty, "  Batches: %lu, changes: %lu, errors: %lu,"
+               " answers lost: %lu%s", b->batches, b->messages, b->errors,
+               b->lost, VTY_NEWLINE);
+      vty_out (vty, "  Queued changes: %u (max %u), batches with the"
+               " dataplane: %u (max %u)%s", b->pending, b->max_pending,
+               b->jobs_count, b->max_jobs, VTY_NEWLINE);
+      vty_out (vty, "  Latency:");
+      for (i = 0; i < NL_LATENCY_BUCKETS; i++)
+        vty_out (vty, " %s %lu,", bucket_str[i], b->latency[i]);
+      vty_out (vty, " max %lu usecs%s", b->latency_max, VTY_NEWLINE);
+    }
+}
+
 static int
 netlink_talk_filter (struct sockaddr_nl *snl, struct nlmsghdr *h,
     vrf_id_t vrf_id)
@@ -1428,6 +1944,10 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl, struct zebra_vrf *zvrf)
   };
   int save_errno;
 
+  /* Route changes made before go first. */
+  if (nl == &zvrf->netlink_cmd)
+    netlink_batch_wait (zvrf);
+
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
@@ -1672,8 +2192,9 @@ _netlink_route_debug(
 
 /* Routing table change via netlink interface. */
 static int
-netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib)
+netlink_route_multipath (int cmd, struct route_node *rn, struct rib *rib)
 {
+  struct prefix *p = &rn->p;
   int bytelen;
   struct sockaddr_nl snl;
   struct nexthop *nexthop = NULL, *tnexthop;
@@ -1759,6 +2280,45 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib)
       goto skip;
     }
 
+#ifdef RTM_NEWNEXTHOP
+  /* The route points to its group's nexthop object. */
+  if (rib->nhg)
+    {
+      struct nhg *nhg = rib->nhg;
+      int i;
+
+      for (i = 0; i < nhg->leg_num; i++)
+        if (nhg->leg[i].family)
+          req.r.rtm_scope = RT_SCOPE_UNIVERSE;
+
+      addattr32 (&req.n, sizeof req, RTA_NH_ID, nhg->id);
+
+      if (family == AF_INET)
+        for (ALL_NEXTHOPS_RO(rib->nexthop, nexthop, tnexthop, recursing))
+          if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE)
+              && ! CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_RECURSIVE)
+              && nexthop->src.ipv4.s_addr)
+            {
+              addattr_l (&req.n, sizeof req, RTA_PREFSRC,
+                         &nexthop->src.ipv4, bytelen);
+              break;
+            }
+
+      if (IS_ZEBRA_DEBUG_KERNEL)
+        {
+          char buf[PREFIX_STRLEN];
+          zlog_debug ("netlink_route_multipath() (group): %s %s vrf %u "
+                      "nexthop id %u", lookup (nlmsg_str, cmd),
+                      prefix2str (p, buf, sizeof (buf)), zvrf->vrf_id,
+                      nhg->id);
+        }
+
+      if (cmd == RTM_NEWROUTE)
+        zebra_nhg_fib_set (rib);
+      goto skip;
+    }
+#endif /* RTM_NEWNEXTHOP */
+
   /* Count overall nexthops so we can decide whether to use singlepath
    * or multipath case. */
   nexthop_num = 0;
@@ -1867,24 +2427,232 @@ skip:
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
-  /* Talk to netlink socket. */
-  return netlink_talk (&req.n, &zvrf->netlink_cmd, zvrf);
+  /* Queue for the netlink socket, the answer comes later. */
+  netlink_batch_add (zvrf, &req.n, rn, cmd == RTM_NEWROUTE ? rib : NULL);
+  return 0;
 }
 
 int
-kernel_route_rib (struct prefix *p, struct rib *old, struct rib *new)
+kernel_route_rib (struct route_node *rn, struct rib *old, struct rib *new)
 {
   if (!old && new)
-    return netlink_route_multipath (RTM_NEWROUTE, p, new);
+    return netlink_route_multipath (RTM_NEWROUTE, rn, new);
   if (old && !new)
-    return netlink_route_multipath (RTM_DELROUTE, p, old);
+    return netlink_route_multipath (RTM_DELROUTE, rn, old);
 
    /* Replace, can be done atomically if metric does not change;
     * netlink uses [prefix, tos, priority] to identify prefix.
     * Now metric is not sent to kernel, so we can just do atomic replace. */
-  return netlink_route_multipath (RTM_NEWROUTE, p, new);
+  return netlink_route_multipath (RTM_NEWROUTE, rn, new);
+}
+
+#ifdef RTM_NEWNEXTHOP
+/* Nexthop object of one nexthop of a group. */
+int
+kernel_nexthop_leg_add (struct nhg *nhg, struct nhg_leg *leg)
+{
+  struct
+  {
+    struct nlmsghdr n;
+    struct nhmsg nhm;
+    char buf[NL_PKT_BUF_SIZE];
+  } req;
+
+  struct zebra_vrf *zvrf = vrf_info_lookup (nhg->vrf_id);
+
+  if (! zvrf)
+    return -1;
+
+  memset (&req, 0, sizeof req - NL_PKT_BUF_SIZE);
+
+  req.n.nlmsg_len = NLMSG_LENGTH (sizeof (struct nhmsg));
+  req.n.nlmsg_flags = NLM_F_CREATE | NLM_F_REPLACE | NLM_F_REQUEST;
+  req.n.nlmsg_type = RTM_NEWNEXTHOP;
+  req.nhm.nh_family = leg->family ? leg->family : nhg->family;
+  req.nhm.nh_protocol = RTPROT_ZEBRA;
+  if (leg->onlink)
+    req.nhm.nh_flags |= RTNH_F_ONLINK;
+
+  addattr32 (&req.n, sizeof req, NHA_ID, leg->id);
+  addattr32 (&req.n, sizeof req, NHA_OIF, leg->ifindex);
+  if (leg->family)
+    addattr_l (&req.n, sizeof req, NHA_GATEWAY, &leg->gate,
+               leg->family == AF_INET ? 4 : 16);
+
+  return netlink_talk (&req.n, &zvrf->netlink_cmd, zvrf);
+}
+
+/* Nexthop object of a group, over those of its nexthops, created or
+ * replaced. */
+int
+kernel_nexthop_group_add (struct nhg *nhg, struct nhg_leg *leg, int num)
+{
+  struct
+  {
+    struct nlmsghdr n;
+    struct nhmsg nhm;
+    char buf[NL_PKT_BUF_SIZE];
+  } req;
+  struct nexthop_grp grp[MULTIPATH_NUM];
+  int i;
+
+  struct zebra_vrf *zvrf = vrf_info_lookup (nhg->vrf_id);
+
+  if (! zvrf)
+    return -1;
+
+  memset (&req, 0, sizeof req - NL_PKT_BUF_SIZE);
+  memset (grp, 0, sizeof grp);
+
+  req.n.nlmsg_len = NLMSG_LENGTH (sizeof (struct nhmsg));
+  req.n.nlmsg_flags = NLM_F_CREATE | NLM_F_REPLACE | NLM_F_REQUEST;
+  req.n.nlmsg_type = RTM_NEWNEXTHOP;
+  req.nhm.nh_family = AF_UNSPEC;
+  req.nhm.nh_protocol = RTPROT_ZEBRA;
+
+  for (i = 0; i < num; i++)
+    grp[i].id = leg[i].id;
+
+  addattr32 (&req.n, sizeof req, NHA_ID, nhg->id);
+  addattr_l (&req.n, sizeof req, NHA_GROUP, grp,
+             num * sizeof (struct nexthop_grp));
+
+  return netlink_talk (&req.n, &zvrf->netlink_cmd, zvrf);
+}
+
+int
+kernel_nexthop_delete (vrf_id_t vrf_id, u_int32_t id)
+{
+  struct
+  {
+    struct nlmsghdr n;
+    struct nhmsg nhm;
+    char buf[NL_PKT_BUF_SIZE];
+  } req;
+
+  struct zebra_vrf *zvrf = vrf_info_lookup (vrf_id);
+
+  if (! zvrf)
+    return -1;
+
+  memset (&req, 0, sizeof req - NL_PKT_BUF_SIZE);
+
+  req.n.nlmsg_len = NLMSG_LENGTH (sizeof (struct nhmsg));
+  req.n.nlmsg_flags = NLM_F_REQUEST;
+  req.n.nlmsg_type = RTM_DELNEXTHOP;
+  req.nhm.nh_family = AF_UNSPEC;
+
+  addattr32 (&req.n, sizeof req, NHA_ID, id);
+
+  return netlink_talk (&req.n, &zvrf->netlink_cmd, zvrf);
 }
 
+/* Highest nexthop object id seen while reading them. */
+static u_int32_t nexthop_id_max;
+
+static int
+netlink_nexthop_table (struct sockaddr_nl *snl, struct nlmsghdr *h,
+    vrf_id_t vrf_id)
+{
+  int len;
+  struct nhmsg *nhm;
+  struct rtattr *tb[NHA_MAX + 1];
+  u_int32_t id;
+
+  if (h->nlmsg_type != RTM_NEWNEXTHOP)
+    return 0;
+
+  nhm = NLMSG_DATA (h);
+  len = h->nlmsg_len - NLMSG_LENGTH (sizeof (struct nhmsg));
+  if (len < 0)
+    return -1;
+
+  memset (tb, 0, sizeof tb);
+  netlink_parse_rtattr (tb, NHA_MAX, NHA_RTA (nhm), len);
+
+  if (tb[NHA_ID])
+    {
+      id = *(u_int32_t *) RTA_DATA (tb[NHA_ID]);
+      if (id > nexthop_id_max)
+        nexthop_id_max = id;
+      zebra_nhg_kernel_object (id, nhm->nh_protocol == RTPROT_ZEBRA,
+                               tb[NHA_GROUP] != NULL);
+    }
+  return 0;
+}
+
+/* Find out whether the kernel has nexthop objects, and which ids are
+ * taken, by some earlier zebra or anyone else.  Those of an earlier
+ * zebra are removed later on, see zebra_nhg_sweep(). */
+static void
+netlink_nexthop_read (struct zebra_vrf *zvrf)
+{
+  struct nlsock *nl = &zvrf->netlink_cmd;
+  struct sockaddr_nl snl;
+  int ret;
+  int save_errno;
+
+  struct
+  {
+    struct nlmsghdr n;
+    struct nhmsg nhm;
+  } req;
+
+  memset (&snl, 0, sizeof snl);
+  snl.nl_family = AF_NETLINK;
+
+  memset (&req, 0, sizeof req);
+  req.n.nlmsg_len = NLMSG_LENGTH (sizeof (struct nhmsg));
+  req.n.nlmsg_type = RTM_GETNEXTHOP;
+  req.n.nlmsg_flags = NLM_F_DUMP | NLM_F_REQUEST;
+  req.n.nlmsg_pid = nl->snl.nl_pid;
+  req.n.nlmsg_seq = ++nl->seq;
+
+  if (zserv_privs.change (ZPRIVS_RAISE))
+    zlog (NULL, LOG_ERR, "Can't raise privileges");
+  ret = sendto (nl->sock, (void *) &req, sizeof req, 0,
+                (struct sockaddr *) &snl, sizeof snl);
+  save_errno = errno;
+  if (zserv_privs.change (ZPRIVS_LOWER))
+    zlog (NULL, LOG_ERR, "Can't lower privileges");
+
+  if (ret < 0)
+    {
+      zlog (NULL, LOG_ERR, "%s sendto failed: %s", nl->name,
+            safe_strerror (save_errno));
+      return;
+    }
+
+  nexthop_id_max = 0;
+  if (netlink_parse_info (netlink_nexthop_table, nl, zvrf) < 0)
+    {
+      zlog_info ("Kernel nexthop objects not available, routes are "
+                 "installed with their own nexthops");
+      return;
+    }
+
+  zebra_nhg_kernel_init (1, nexthop_id_max);
+}
+#else
+int
+kernel_nexthop_leg_add (struct nhg *nhg, struct nhg_leg *leg)
+{
+  return -1;
+}
+
+int
+kernel_nexthop_group_add (struct nhg *nhg, struct nhg_leg *leg, int num)
+{
+  return -1;
+}
+
+int
+kernel_nexthop_delete (vrf_id_t vrf_id, u_int32_t id)
+{
+  return -1;
+}
+#endif /* RTM_NEWNEXTHOP */
+
 /* Interface address modification. */
 static int
 netlink_address (int cmd, int family, struct interface *ifp,
@@ -1967,22 +2735,24 @@ kernel_read (struct thread *thread)
 /* Filter out messages from self that occur on listener socket,
    caused by our actions on the command socket
  */
-static void netlink_install_filter (int sock, __u32 pid)
+static void netlink_install_filter (int sock, __u32 pid, __u32 dplane_pid)
 {
   struct sock_filter filter[] = {
     /* 0: ldh [4]	          */
     BPF_STMT(BPF_LD|BPF_ABS|BPF_H, offsetof(struct nlmsghdr, nlmsg_type)),
-    /* 1: jeq 0x18 jt 3 jf 6  */
+    /* 1: jeq 0x18 jt 3 jf 7  */
     BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htons(RTM_NEWROUTE), 1, 0),
-    /* 2: jeq 0x19 jt 3 jf 6  */
-    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htons(RTM_DELROUTE), 0, 3),
+    /* 2: jeq 0x19 jt 3 jf 7  */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htons(RTM_DELROUTE), 0, 4),
     /* 3: ldw [12]		  */
     BPF_STMT(BPF_LD|BPF_ABS|BPF_W, offsetof(struct nlmsghdr, nlmsg_pid)),
-    /* 4: jeq XX  jt 5 jf 6   */
-    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htonl(pid), 0, 1),
-    /* 5: ret 0    (skip)     */
+    /* 4: jeq XX  jt 6 jf 5   */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htonl(pid), 1, 0),
+    /* 5: jeq YY  jt 6 jf 7   */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htonl(dplane_pid), 0, 1),
+    /* 6: ret 0    (skip)     */
     BPF_STMT(BPF_RET|BPF_K, 0),
-    /* 6: ret 0xffff (keep)   */
+    /* 7: ret 0xffff (keep)   */
     BPF_STMT(BPF_RET|BPF_K, 0xffff),
   };
 
@@ -2008,6 +2778,20 @@ kernel_init (struct zebra_vrf *zvrf)
 #endif /* HAVE_IPV6 */
   netlink_socket (&zvrf->netlink, groups, zvrf->vrf_id);
   netlink_socket (&zvrf->netlink_cmd, 0, zvrf->vrf_id);
+  netlink_socket (&zvrf->netlink_dplane, 0, zvrf->vrf_id);
+
+  /* Route changes are made by the dataplane thread, which is started
+   * with the first VRF.  See netlink_batch_flush(). */
+  if (! nl_dplane_rcvbuf)
+    {
+      nl_dplane_rcvbuf = XMALLOC (MTYPE_NETLINK_RCVBUF, NL_BATCH_BUF_SIZE);
+      nl_dplane_pool = work_pool_new (zebrad.master, "zebra dataplane", 1);
+      if (! nl_dplane_pool)
+        zlog_warn ("Can't start the dataplane thread, route changes will"
+                   " be sent from the main thread");
+    }
+  if (zvrf->netlink_dplane.sock >= 0 && nl_rcvbufsize)
+    netlink_recvbuf (&zvrf->netlink_dplane, nl_rcvbufsize);
 
   /* Register kernel socket. */
   if (zvrf->netlink.sock > 0)
@@ -2026,7 +2810,8 @@ kernel_init (struct zebra_vrf *zvrf)
       nl_rcvbuf.p = XMALLOC (MTYPE_NETLINK_RCVBUF, bufsize);
       nl_rcvbuf.size = bufsize;
       
-      netlink_install_filter (zvrf->netlink.sock, zvrf->netlink_cmd.snl.nl_pid);
+      netlink_install_filter (zvrf->netlink.sock, zvrf->netlink_cmd.snl.nl_pid,
+                              zvrf->netlink_dplane.snl.nl_pid);
       zvrf->t_netlink = thread_add_read (zebrad.master, kernel_read, zvrf,
                                          zvrf->netlink.sock);
     }
@@ -2035,8 +2820,32 @@ kernel_init (struct zebra_vrf *zvrf)
 void
 kernel_terminate (struct zebra_vrf *zvrf)
 {
+  struct nl_batch *b = zvrf->netlink_batch;
+
   THREAD_READ_OFF (zvrf->t_netlink);
 
+  if (b)
+    {
+      netlink_batch_wait (zvrf);
+      assert (b->head == NULL);
+      if (b->t_done)
+        {
+          THREAD_OFF (b->t_done);
+          while (b->done)
+            {
+              struct nl_pending *pend = b->done;
+
+              b->done = pend->next;
+              rib_kernel_done (pend->rn, pend->rib, pend->seq,
+                               pend->error);
+              XFREE (MTYPE_NETLINK_PENDING, pend);
+            }
+        }
+
+      XFREE (MTYPE_NETLINK_BATCH, b);
+      zvrf->netlink_batch = NULL;
+    }
+
   if (zvrf->netlink.sock >= 0)
     {
       close (zvrf->netlink.sock);
@@ -2048,6 +2857,12 @@ kernel_terminate (struct zebra_vrf *zvrf)
       close (zvrf->netlink_cmd.sock);
       zvrf->netlink_cmd.sock = -1;
     }
+
+  if (zvrf->netlink_dplane.sock >= 0)
+    {
+      close (zvrf->netlink_dplane.sock);
+      zvrf->netlink_dplane.sock = -1;
+    }
 }
 
 /*
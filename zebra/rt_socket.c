@@ -28,6 +28,7 @@
 #include "log.h"
 #include "str.h"
 #include "privs.h"
+#include "vty.h"
 
 #include "zebra/debug.h"
 #include "zebra/rib.h"
@@ -377,8 +378,9 @@ kernel_rtm (int cmd, struct prefix *p, struct rib *rib)
 }
 
 int
-kernel_route_rib (struct prefix *p, struct rib *old, struct rib *new)
+kernel_route_rib (struct route_node *rn, struct rib *old, struct rib *new)
 {
+  struct prefix *p = &rn->p;
   int route = 0;
 
   if (zserv_privs.change(ZPRIVS_RAISE))
@@ -395,3 +397,41 @@ kernel_route_rib (struct prefix *p, struct rib *old, struct rib *new)
 
   return route;
 }
+
+/* Changes are made synchronously, there is nothing to flush. */
+void
+kernel_route_flush (struct zebra_vrf *zvrf)
+{
+}
+
+void
+kernel_route_wait (struct zebra_vrf *zvrf)
+{
+}
+
+void
+kernel_dataplane_show (struct vty *vty)
+{
+  vty_out (vty, "Route changes are sent to the kernel one at a time,"
+           " through the routing socket%s", VTY_NEWLINE);
+}
+
+/* Routing sockets have no nexthop objects, zebra_nhg_kernel_init () is
+ * never called and these are not used. */
+int
+kernel_nexthop_leg_add (struct nhg *nhg, struct nhg_leg *leg)
+{
+  return -1;
+}
+
+int
+kernel_nexthop_group_add (struct nhg *nhg, struct nhg_leg *leg, int num)
+{
+  return -1;
+}
+
+int
+kernel_nexthop_delete (vrf_id_t vrf_id, u_int32_t id)
+{
+  return -1;
+}
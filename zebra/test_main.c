@@ -36,6 +36,7 @@
 #include "zebra/debug.h"
 #include "zebra/router-id.h"
 #include "zebra/interface.h"
+#include "zebra/zebra_nhg.h"
 
 /* Zebra instance */
 struct zebra_t zebrad =
@@ -52,6 +53,9 @@ extern int rib_process_hold_time;
 /* Pacify zclient.o in libzebra, which expects this variable. */
 struct thread_master *master;
 
+/* Don't delete kernel route. */
+int keep_kernel_mode = 0;
+
 /* Command line options. */
 struct option longopts[] = 
 {
@@ -356,6 +360,7 @@ main (int argc, char **argv)
 
   /* Zebra related initialize. */
   rib_init ();
+  zebra_nhg_init ();
   access_list_init ();
 
   /* Make kernel routing socket. */
@@ -0,0 +1,909 @@
+/*
+ * Zebra shared nexthop groups
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "prefix.h"
+#include "table.h"
+#include "memory.h"
+#include "hash.h"
+#include "jhash.h"
+#include "if.h"
+#include "log.h"
+#include "vty.h"
+#include "vrf.h"
+#include "nexthop.h"
+#include "linklist.h"
+
+#include "zebra/rib.h"
+#include "zebra/rt.h"
+#include "zebra/debug.h"
+#include "zebra/zebra_nhg.h"
+
+/* All groups, by what their routes have in common. */
+static struct hash *nhg_hash;
+
+/* The groups by the address of each of their gateways, one table for
+ * each address family, see zebra_nhg_route_changed(). */
+static struct route_table *nhg_gate_table[AFI_MAX];
+
+/* Whether the kernel has nexthop objects, and the last object id used. */
+static int nhg_kernel;
+static u_int32_t nhg_id_last;
+
+/* Object ids in use: those of the groups and of their nexthops, and
+ * those found in the kernel at startup, until swept if they are ours. */
+static struct hash *nhg_id_hash;
+
+/* Ids of the groups, and of their nexthops, an earlier zebra left in
+ * the kernel, see zebra_nhg_sweep(). */
+static struct hash *nhg_stale_groups;
+static struct hash *nhg_stale_legs;
+
+extern int keep_kernel_mode;
+
+extern char *proto_rm[AFI_MAX][ZEBRA_ROUTE_MAX+1];
+
+/* The interface a nexthop is configured with, rather than the one it
+ * resolved to. */
+static ifindex_t
+nhg_nexthop_ifindex (struct nexthop *nexthop)
+{
+  switch (nexthop->type)
+    {
+    case NEXTHOP_TYPE_IFINDEX:
+    case NEXTHOP_TYPE_IPV4_IFINDEX:
+    case NEXTHOP_TYPE_IPV6_IFINDEX:
+      return nexthop->ifindex;
+    default:
+      return 0;
+    }
+}
+
+static unsigned int
+nhg_key (struct nhg *nhg)
+{
+  struct nexthop *nexthop;
+  unsigned int key;
+
+  key = jhash_3words (nhg->vrf_id, nhg->family,
+                      (nhg->type << 8) | nhg->flags, nhg->client_nhg);
+  if (nhg->client_nhg)
+    return key;
+
+  for (nexthop = nhg->nexthop; nexthop; nexthop = nexthop->next)
+    {
+      key = jhash_3words (nexthop->type, nhg_nexthop_ifindex (nexthop),
+                          CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ONLINK),
+                          key);
+      key = jhash (&nexthop->gate, sizeof (union g_addr), key);
+      key = jhash (&nexthop->src, sizeof (union g_addr), key);
+    }
+  return key;
+}
+
+static unsigned int
+nhg_hash_key (void *arg)
+{
+  struct nhg *nhg = arg;
+
+  return nhg->key;
+}
+
+static int
+nhg_hash_cmp (const void *arg1, const void *arg2)
+{
+  const struct nhg *nhg1 = arg1;
+  const struct nhg *nhg2 = arg2;
+  struct nexthop *nh1, *nh2;
+
+  if (nhg1->vrf_id != nhg2->vrf_id
+      || nhg1->family != nhg2->family
+      || nhg1->type != nhg2->type
+      || nhg1->flags != nhg2->flags
+      || nhg1->client_nhg != nhg2->client_nhg)
+    return 0;
+
+  /* The group of a client group is found through it only, as its id
+   * may be used again, see zebra_nhg_client_new(). */
+  if (nhg1->client_nhg)
+    return nhg1 == nhg2;
+
+  for (nh1 = nhg1->nexthop, nh2 = nhg2->nexthop;
+       nh1 && nh2;
+       nh1 = nh1->next, nh2 = nh2->next)
+    {
+      if (nh1->type != nh2->type
+          || nhg_nexthop_ifindex (nh1) != nhg_nexthop_ifindex (nh2)
+          || CHECK_FLAG (nh1->flags, NEXTHOP_FLAG_ONLINK)
+             != CHECK_FLAG (nh2->flags, NEXTHOP_FLAG_ONLINK)
+          || memcmp (&nh1->gate, &nh2->gate, sizeof (union g_addr))
+          || memcmp (&nh1->src, &nh2->src, sizeof (union g_addr)))
+        return 0;
+      if ((nh1->ifname || nh2->ifname)
+          && (! nh1->ifname || ! nh2->ifname
+              || strcmp (nh1->ifname, nh2->ifname)))
+        return 0;
+    }
+  return nh1 == nh2;
+}
+
+static unsigned int
+nhg_id_key (void *arg)
+{
+  return jhash_1word ((u_int32_t) (uintptr_t) arg, 0);
+}
+
+static int
+nhg_id_cmp (const void *arg1, const void *arg2)
+{
+  return arg1 == arg2;
+}
+
+/* Object ids are not reused until they wrap around, and then only those
+ * no longer in use. */
+static u_int32_t
+nhg_id_alloc (void)
+{
+  do
+    if (++nhg_id_last == 0)
+      nhg_id_last = 1;
+  while (hash_lookup (nhg_id_hash, (void *) (uintptr_t) nhg_id_last));
+
+  hash_get (nhg_id_hash, (void *) (uintptr_t) nhg_id_last, hash_alloc_intern);
+  return nhg_id_last;
+}
+
+static void
+nhg_id_free (u_int32_t id)
+{
+  hash_release (nhg_id_hash, (void *) (uintptr_t) id);
+}
+
+/* Remove a group's object, or that of one of its nexthops, from the
+ * kernel, and let its id be used again. */
+static void
+nhg_id_delete (struct nhg *nhg, u_int32_t id)
+{
+  kernel_nexthop_delete (nhg->vrf_id, id);
+  nhg_id_free (id);
+}
+
+/* A copy of the nexthops: only what identifies them, or with how they
+ * resolved too if 'resolved'. */
+static struct nexthop *
+nhg_nexthops_copy (struct nexthop *head, int resolved)
+{
+  struct nexthop *nexthop, *copy;
+  struct nexthop *list = NULL;
+
+  for (nexthop = head; nexthop; nexthop = nexthop->next)
+    {
+      copy = nexthop_new ();
+      copy->type = nexthop->type;
+      if (nexthop->ifname)
+        copy->ifname = XSTRDUP (0, nexthop->ifname);
+      copy->gate = nexthop->gate;
+      copy->src = nexthop->src;
+      if (resolved)
+        {
+          copy->ifindex = nexthop->ifindex;
+          copy->flags = nexthop->flags & ~NEXTHOP_FLAG_FIB;
+          if (nexthop->resolved)
+            copy->resolved = nhg_nexthops_copy (nexthop->resolved, 1);
+        }
+      else
+        {
+          copy->ifindex = nhg_nexthop_ifindex (nexthop);
+          copy->flags = nexthop->flags & NEXTHOP_FLAG_ONLINK;
+        }
+      nexthop_add (&list, copy);
+    }
+  return list;
+}
+
+/* The gateway address of a nexthop zebra resolves through the RIB. */
+static int
+nhg_nexthop_gate (struct nexthop *nexthop, struct prefix *p)
+{
+  memset (p, 0, sizeof (struct prefix));
+  switch (nexthop->type)
+    {
+    case NEXTHOP_TYPE_IPV4:
+    case NEXTHOP_TYPE_IPV4_IFINDEX:
+      p->family = AF_INET;
+      p->prefixlen = IPV4_MAX_BITLEN;
+      p->u.prefix4 = nexthop->gate.ipv4;
+      return 1;
+#ifdef HAVE_IPV6
+    case NEXTHOP_TYPE_IPV6:
+    case NEXTHOP_TYPE_IPV6_IFINDEX:
+      p->family = AF_INET6;
+      p->prefixlen = IPV6_MAX_BITLEN;
+      p->u.prefix6 = nexthop->gate.ipv6;
+      return 1;
+#endif /* HAVE_IPV6 */
+    default:
+      return 0;
+    }
+}
+
+/* Index the group by its gateways, for the changes of the routes it may
+ * resolve through to find it. */
+static void
+nhg_gate_add (struct nhg *nhg)
+{
+  struct nexthop *nexthop;
+  struct route_table *table;
+  struct route_node *rn;
+  struct prefix p;
+
+  for (nexthop = nhg->nexthop; nexthop; nexthop = nexthop->next)
+    {
+      if (! nhg_nexthop_gate (nexthop, &p))
+        continue;
+
+      table = nhg_gate_table[family2afi (p.family)];
+      rn = route_node_get (table, &p);
+      if (rn->info)
+        route_unlock_node (rn);
+      else
+        rn->info = list_new ();
+      listnode_add (rn->info, nhg);
+    }
+}
+
+static void
+nhg_gate_delete (struct nhg *nhg)
+{
+  struct nexthop *nexthop;
+  struct route_node *rn;
+  struct prefix p;
+
+  for (nexthop = nhg->nexthop; nexthop; nexthop = nexthop->next)
+    {
+      if (! nhg_nexthop_gate (nexthop, &p))
+        continue;
+
+      rn = route_node_lookup (nhg_gate_table[family2afi (p.family)], &p);
+      if (! rn)
+        continue;
+      route_unlock_node (rn);
+
+      listnode_delete (rn->info, nhg);
+      if (! listcount ((struct list *) rn->info))
+        {
+          list_delete (rn->info);
+          rn->info = NULL;
+          route_unlock_node (rn);
+        }
+    }
+}
+
+static void *
+nhg_alloc (void *arg)
+{
+  struct nhg *lookup = arg;
+  struct nhg *nhg;
+  struct nexthop *nexthop;
+
+  nhg = XCALLOC (MTYPE_NHG, sizeof (struct nhg));
+  nhg->id = nhg_id_alloc ();
+  nhg->vrf_id = lookup->vrf_id;
+  nhg->family = lookup->family;
+  nhg->type = lookup->type;
+  nhg->flags = lookup->flags;
+  nhg->key = lookup->key;
+  nhg->client_nhg = lookup->client_nhg;
+  nhg->gen = 1;
+
+  /* Only what identifies the nexthops, not how they resolved. */
+  nhg->nexthop = nhg_nexthops_copy (lookup->nexthop, 0);
+  for (nexthop = nhg->nexthop; nexthop; nexthop = nexthop->next)
+    nhg->nexthop_num++;
+  nhg_gate_add (nhg);
+  return nhg;
+}
+
+/* A route whose nexthops depend on more than its nexthops cannot share
+ * them: those a route-map may deny, and those resolving through the
+ * route itself. */
+int
+zebra_nhg_route_private (struct route_node *rn, struct rib *rib)
+{
+  struct nexthop *nexthop;
+  struct prefix p;
+  afi_t afi;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    if ((rib->type < ZEBRA_ROUTE_MAX && proto_rm[afi][rib->type])
+        || proto_rm[afi][ZEBRA_ROUTE_MAX])
+      return 1;
+
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    if (nhg_nexthop_gate (nexthop, &p) && prefix_match (&rn->p, &p))
+      return 1;
+  return 0;
+}
+
+/* The nexthops a rib with these resolved nexthops would have
+ * installed, as the kernel object needs them.  Returns their number, 0
+ * if they cannot be installed as a nexthop object. */
+static int
+nhg_legs (struct nexthop *head, struct nhg_leg *leg)
+{
+  struct nexthop *nexthop, *tnexthop;
+  int recursing;
+  int num = 0;
+
+  for (ALL_NEXTHOPS_RO(head, nexthop, tnexthop, recursing))
+    {
+      if (num >= MULTIPATH_NUM)
+        break;
+      if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_RECURSIVE)
+          || ! CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE))
+        continue;
+
+      memset (&leg[num], 0, sizeof (struct nhg_leg));
+      switch (nexthop->type)
+        {
+        case NEXTHOP_TYPE_IPV4:
+        case NEXTHOP_TYPE_IPV4_IFINDEX:
+          leg[num].family = AF_INET;
+          leg[num].gate.ipv4 = nexthop->gate.ipv4;
+          break;
+#ifdef HAVE_IPV6
+        case NEXTHOP_TYPE_IPV6:
+        case NEXTHOP_TYPE_IPV6_IFINDEX:
+        case NEXTHOP_TYPE_IPV6_IFNAME:
+          leg[num].family = AF_INET6;
+          leg[num].gate.ipv6 = nexthop->gate.ipv6;
+          break;
+#endif /* HAVE_IPV6 */
+        case NEXTHOP_TYPE_IFINDEX:
+        case NEXTHOP_TYPE_IFNAME:
+          break;
+        default:
+          return 0;
+        }
+
+      /* The kernel wants the interface of every nexthop object. */
+      if (! nexthop->ifindex)
+        return 0;
+      leg[num].ifindex = nexthop->ifindex;
+      leg[num].onlink = CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ONLINK) ? 1 : 0;
+      num++;
+    }
+  return num;
+}
+
+static int
+nhg_legs_same (struct nhg *nhg, struct nhg_leg *leg, int num)
+{
+  int i;
+
+  if (nhg->leg_num != num)
+    return 0;
+  for (i = 0; i < num; i++)
+    if (nhg->leg[i].family != leg[i].family
+        || nhg->leg[i].onlink != leg[i].onlink
+        || nhg->leg[i].ifindex != leg[i].ifindex
+        || memcmp (&nhg->leg[i].gate, &leg[i].gate, sizeof (union g_addr)))
+      return 0;
+  return 1;
+}
+
+/* Install the group's object with the given nexthops, which get
+ * objects of their own, replacing what it held. */
+static int
+nhg_kernel_update (struct nhg *nhg, struct nhg_leg *leg, int num)
+{
+  int i, j;
+
+  for (i = 0; i < num; i++)
+    {
+      leg[i].id = nhg_id_alloc ();
+      if (kernel_nexthop_leg_add (nhg, &leg[i]) < 0)
+        {
+          nhg_id_free (leg[i].id);
+          for (j = 0; j < i; j++)
+            nhg_id_delete (nhg, leg[j].id);
+          return -1;
+        }
+    }
+
+  if (kernel_nexthop_group_add (nhg, leg, num) < 0)
+    {
+      for (i = 0; i < num; i++)
+        nhg_id_delete (nhg, leg[i].id);
+      return -1;
+    }
+
+  if (CHECK_FLAG (nhg->status, NHG_INSTALLED))
+    for (i = 0; i < nhg->leg_num; i++)
+      nhg_id_delete (nhg, nhg->leg[i].id);
+
+  if (IS_ZEBRA_DEBUG_RIB)
+    zlog_debug ("%s: group %u now has %d nexthops", __func__, nhg->id, num);
+
+  memcpy (nhg->leg, leg, num * sizeof (struct nhg_leg));
+  nhg->leg_num = num;
+  SET_FLAG (nhg->status, NHG_INSTALLED);
+  return 0;
+}
+
+static void
+nhg_lookup_init (struct nhg *lookup, struct rib *rib, u_char family)
+{
+  memset (lookup, 0, sizeof (struct nhg));
+  lookup->vrf_id = rib->vrf_id;
+  lookup->family = family;
+  lookup->type = rib->type;
+  lookup->flags = rib->flags & ZEBRA_FLAG_INTERNAL;
+  lookup->nexthop = rib->nexthop;
+  lookup->client_nhg = rib->client_nhg;
+  lookup->key = nhg_key (lookup);
+}
+
+/*
+ * Find the group the rib, with its nexthops resolved, should be
+ * installed with, and take a reference to it.  The group's kernel
+ * object is made to hold the rib's nexthops if it did not already, so
+ * that the route only needs to point to it.  Returns NULL if the route
+ * has to be installed with its own nexthops.
+ */
+struct nhg *
+zebra_nhg_install (struct route_node *rn, struct rib *rib)
+{
+  struct nhg lookup;
+  struct nhg *nhg;
+  struct nhg_leg leg[MULTIPATH_NUM];
+  int num;
+
+  if (! nhg_kernel || rib->vrf_id != VRF_DEFAULT)
+    return NULL;
+
+  if (CHECK_FLAG (rib->flags, ZEBRA_FLAG_BLACKHOLE)
+      || CHECK_FLAG (rib->flags, ZEBRA_FLAG_REJECT)
+      || zebra_nhg_route_private (rn, rib))
+    return NULL;
+
+  num = nhg_legs (rib->nexthop, leg);
+  if (! num)
+    return NULL;
+
+  if (rib->group)
+    nhg = rib->group;
+  else
+    {
+      nhg_lookup_init (&lookup, rib, PREFIX_FAMILY (&rn->p));
+      nhg = hash_get (nhg_hash, &lookup, nhg_alloc);
+    }
+  nhg->refcnt++;
+  nhg->fib_refcnt++;
+
+  if (! CHECK_FLAG (nhg->status, NHG_INSTALLED)
+      || ! nhg_legs_same (nhg, leg, num))
+    if (nhg_kernel_update (nhg, leg, num) < 0)
+      {
+        zebra_nhg_release (nhg);
+        return NULL;
+      }
+
+  return nhg;
+}
+
+/* Drop the reference of a route installed with the group, removing
+ * the kernel object once no route is. */
+void
+zebra_nhg_release (struct nhg *nhg)
+{
+  struct nexthop *nexthop, *tnexthop;
+  int recursing;
+  int i;
+
+  assert (nhg->fib_refcnt);
+  if (--nhg->fib_refcnt == 0 && CHECK_FLAG (nhg->status, NHG_INSTALLED))
+    {
+      kernel_nexthop_delete (nhg->vrf_id, nhg->id);
+      for (i = 0; i < nhg->leg_num; i++)
+        nhg_id_delete (nhg, nhg->leg[i].id);
+      nhg->leg_num = 0;
+      UNSET_FLAG (nhg->status, NHG_INSTALLED);
+
+      for (ALL_NEXTHOPS_RO(nhg->nexthop, nexthop, tnexthop, recursing))
+        UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+    }
+  zebra_nhg_unref (nhg);
+}
+
+static void
+nhg_private_unlock (void *arg)
+{
+  route_unlock_node (arg);
+}
+
+/* Drop a reference to the group, freeing it once unused. */
+void
+zebra_nhg_unref (struct nhg *nhg)
+{
+  assert (nhg->refcnt);
+  if (--nhg->refcnt)
+    return;
+
+  assert (! nhg->fib_refcnt);
+  if (nhg->private)
+    {
+      hash_clean (nhg->private, nhg_private_unlock);
+      hash_free (nhg->private);
+    }
+  nhg_id_free (nhg->id);
+  nhg_gate_delete (nhg);
+  hash_release (nhg_hash, nhg);
+  nexthops_free (nhg->nexthop);
+  XFREE (MTYPE_NHG, nhg);
+}
+
+/* Have the rib share the nexthops of the group, in place of its own,
+ * which are freed. */
+void
+zebra_nhg_share (struct nhg *nhg, struct rib *rib)
+{
+  if (rib->nexthop != nhg->nexthop)
+    nexthops_free (rib->nexthop);
+
+  nhg->refcnt++;
+  rib->group = nhg;
+  rib->group_gen = 0;
+  rib->nexthop = nhg->nexthop;
+}
+
+/* Have the rib, of a route of 'family', share its nexthops with the
+ * other routes with the same, as the group of them all. */
+void
+zebra_nhg_intern (struct rib *rib, u_char family)
+{
+  struct nhg lookup;
+
+  nhg_lookup_init (&lookup, rib, family);
+  zebra_nhg_share (hash_get (nhg_hash, &lookup, nhg_alloc), rib);
+}
+
+/* The group for the nexthops of a rib added with a client group, for
+ * the other routes of its VRF, type and flags added with it to share.
+ * The client group holds the first reference, and only it finds the
+ * group, the rib's being taken too. */
+struct nhg *
+zebra_nhg_client_new (struct rib *rib, u_char family)
+{
+  struct nhg lookup;
+  struct nhg *nhg;
+
+  nhg_lookup_init (&lookup, rib, family);
+  nhg = hash_get (nhg_hash, &lookup, nhg_alloc);
+  nhg->refcnt++;
+  zebra_nhg_share (nhg, rib);
+  return nhg;
+}
+
+static void *
+nhg_private_alloc (void *arg)
+{
+  return route_lock_node (arg);
+}
+
+static unsigned int
+nhg_private_key (void *arg)
+{
+  return jhash_1word ((u_int32_t) (uintptr_t) arg, 0);
+}
+
+/* Give the rib of the route node a copy of its group's nexthops, which
+ * it can then resolve, and have installed, on its own: only what
+ * identifies them, or as they resolved for the group if 'resolved'.
+ * The copy is kept until the group changes, see rib->group_gen. */
+void
+zebra_nhg_private (struct route_node *rn, struct rib *rib, int resolved)
+{
+  struct nhg *nhg = rib->group;
+
+  rib->nexthop = nhg_nexthops_copy (nhg->nexthop, resolved);
+  rib->group_gen = nhg->gen;
+
+  if (! nhg->client_nhg)
+    return;
+  if (! nhg->private)
+    nhg->private = hash_create (nhg_private_key, nhg_id_cmp);
+  hash_get (nhg->private, rn, nhg_private_alloc);
+}
+
+/* Have the group of a client group hold the nexthops 'nexthop', 'num'
+ * of them, in place of its own.  Its first nexthop, which the routes
+ * sharing them point to, takes the contents of the first new one.  The
+ * nexthops are to be resolved again. */
+void
+zebra_nhg_replace (struct nhg *nhg, struct nexthop *nexthop, u_char num)
+{
+  struct nexthop *head = nhg->nexthop;
+
+  nhg_gate_delete (nhg);
+
+  nexthops_free (head->next);
+  if (head->resolved)
+    nexthops_free (head->resolved);
+  if (head->ifname)
+    XFREE (0, head->ifname);
+
+  *head = *nexthop;
+  head->prev = NULL;
+  if (head->next)
+    head->next->prev = head;
+  XFREE (MTYPE_NEXTHOP, nexthop);
+
+  nhg->nexthop_num = num;
+  nhg_gate_add (nhg);
+  UNSET_FLAG (nhg->status, NHG_RESOLVED);
+  nhg->gen++;
+}
+
+/* Have 'requeue' queue the nodes of the routes of the client group with
+ * nexthops of their own to be processed again, which records them anew
+ * if they still have. */
+void
+zebra_nhg_requeue (struct nhg *nhg,
+                   void (*requeue) (struct hash_backet *, void *))
+{
+  struct hash *private = nhg->private;
+
+  if (! private)
+    return;
+
+  nhg->private = NULL;
+  hash_iterate (private, requeue, NULL);
+  hash_clean (private, nhg_private_unlock);
+  hash_free (private);
+}
+
+/* The FIB entry of the route node changed: unset the resolution of the
+ * groups whose gateways it covers.  Routes of other VRFs are not told
+ * apart, nor the tables other than the main one, which only costs
+ * resolving the groups again. */
+void
+zebra_nhg_route_changed (struct route_node *rn)
+{
+  rib_table_info_t *info = rn->table->info;
+  struct route_table *table;
+  struct route_node *top, *grn;
+  struct listnode *node;
+  struct nhg *nhg;
+
+  if (info->safi != SAFI_UNICAST)
+    return;
+
+  table = nhg_gate_table[info->afi];
+  if (! table->count)
+    return;
+
+  top = route_node_get (table, &rn->p);
+  for (grn = top; grn; grn = route_next_until (grn, top))
+    if (grn->info)
+      for (ALL_LIST_ELEMENTS_RO ((struct list *) grn->info, node, nhg))
+        UNSET_FLAG (nhg->status, NHG_RESOLVED);
+}
+
+static void
+nhg_unresolve (struct hash_backet *backet, void *arg)
+{
+  struct nhg *nhg = backet->data;
+
+  UNSET_FLAG (nhg->status, NHG_RESOLVED);
+}
+
+/* Have all the groups resolved again, as when interfaces change. */
+void
+zebra_nhg_unresolve_all (void)
+{
+  hash_iterate (nhg_hash, nhg_unresolve, NULL);
+}
+
+/* Mark the nexthops of the kernel object as in the FIB, and only
+ * those. */
+static void
+nhg_fib_set (struct nexthop *head)
+{
+  struct nexthop *nexthop, *tnexthop;
+  int recursing;
+  int num = 0;
+
+  for (ALL_NEXTHOPS_RO(head, nexthop, tnexthop, recursing))
+    {
+      if (num < MULTIPATH_NUM
+          && ! CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_RECURSIVE)
+          && CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE))
+        {
+          SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+          num++;
+        }
+      else
+        UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+    }
+}
+
+/* Mark the nexthops a route installed with its group uses as in the
+ * FIB, as installing it with its own nexthops would have. */
+void
+zebra_nhg_fib_set (struct rib *rib)
+{
+  nhg_fib_set (rib->nexthop);
+}
+
+/*
+ * Have the kernel object of the group hold its nexthops, as they were
+ * just resolved.  Returns 0 if the routes installed with the group need
+ * nothing more, -1 if they are to be processed again, as the nexthops
+ * cannot be installed as a nexthop object.
+ */
+int
+zebra_nhg_update (struct nhg *nhg)
+{
+  struct nhg_leg leg[MULTIPATH_NUM];
+  int num;
+
+  /* No route is installed with the group. */
+  if (! CHECK_FLAG (nhg->status, NHG_INSTALLED))
+    return 0;
+
+  num = nhg_legs (nhg->nexthop, leg);
+  if (! num)
+    return -1;
+
+  if (! nhg_legs_same (nhg, leg, num)
+      && nhg_kernel_update (nhg, leg, num) < 0)
+    return -1;
+
+  nhg_fib_set (nhg->nexthop);
+  return 0;
+}
+
+/* Called by the kernel method for each nexthop object it finds at
+ * startup, 'ours' if zebra made it, 'group' if it is a group.  Its id
+ * is not to be used, unless it is ours and swept. */
+void
+zebra_nhg_kernel_object (u_int32_t id, int ours, int group)
+{
+  struct hash **stale = group ? &nhg_stale_groups : &nhg_stale_legs;
+
+  hash_get (nhg_id_hash, (void *) (uintptr_t) id, hash_alloc_intern);
+
+  if (! ours || keep_kernel_mode)
+    return;
+
+  if (! *stale)
+    *stale = hash_create (nhg_id_key, nhg_id_cmp);
+  hash_get (*stale, (void *) (uintptr_t) id, hash_alloc_intern);
+}
+
+/* Whether a route read from the kernel uses an object that is to be
+ * swept.  The kernel removes such routes with the object, so they are
+ * not to be taken into the RIB. */
+int
+zebra_nhg_kernel_stale (u_int32_t id)
+{
+  return nhg_stale_groups
+         && hash_lookup (nhg_stale_groups, (void *) (uintptr_t) id) != NULL;
+}
+
+/* Called by the kernel method once it knows whether nexthop objects
+ * can be used, with the highest object id already in use. */
+void
+zebra_nhg_kernel_init (int supported, u_int32_t id_max)
+{
+  nhg_kernel = supported;
+  if (id_max > nhg_id_last)
+    nhg_id_last = id_max;
+}
+
+static void
+nhg_stale_delete (struct hash_backet *backet, void *arg)
+{
+  u_int32_t id = (u_int32_t) (uintptr_t) backet->data;
+
+  kernel_nexthop_delete (VRF_DEFAULT, id);
+  nhg_id_free (id);
+}
+
+static void
+nhg_stale_sweep (struct hash **stale)
+{
+  if (! *stale)
+    return;
+
+  if (IS_ZEBRA_DEBUG_RIB)
+    zlog_debug ("%s: removing %lu nexthop objects left by an earlier zebra",
+                __func__, (*stale)->count);
+
+  hash_iterate (*stale, nhg_stale_delete, NULL);
+  hash_clean (*stale, NULL);
+  hash_free (*stale);
+  *stale = NULL;
+}
+
+/* Remove the nexthop objects an earlier zebra left in the kernel, and
+ * with them the routes using them, which were not read into the RIB.
+ * The groups go first, as removing one of their nexthops would have the
+ * kernel change them. */
+void
+zebra_nhg_sweep (void)
+{
+  nhg_stale_sweep (&nhg_stale_groups);
+  nhg_stale_sweep (&nhg_stale_legs);
+}
+
+static void
+nhg_print (struct hash_backet *backet, void *arg)
+{
+  struct nhg *nhg = backet->data;
+  struct vty *vty = arg;
+  char buf[INET6_ADDRSTRLEN];
+  int i;
+
+  vty_out (vty, "Group %u, %s, vrf %u, %lu route%s installed",
+           nhg->id, zebra_route_string (nhg->type), nhg->vrf_id,
+           nhg->fib_refcnt, nhg->fib_refcnt == 1 ? "" : "s");
+  if (nhg->client_nhg)
+    vty_out (vty, ", client group %u", nhg->client_nhg);
+  vty_out (vty, "%s", VTY_NEWLINE);
+
+  for (i = 0; i < nhg->leg_num; i++)
+    {
+      if (nhg->leg[i].family)
+        vty_out (vty, "  via %s, %s",
+                 inet_ntop (nhg->leg[i].family, &nhg->leg[i].gate,
+                            buf, sizeof buf),
+                 ifindex2ifname_vrf (nhg->leg[i].ifindex, nhg->vrf_id));
+      else
+        vty_out (vty, "  is directly connected, %s",
+                 ifindex2ifname_vrf (nhg->leg[i].ifindex, nhg->vrf_id));
+      vty_out (vty, "%s, id %u%s", nhg->leg[i].onlink ? " onlink" : "",
+               nhg->leg[i].id, VTY_NEWLINE);
+    }
+}
+
+void
+zebra_nhg_print (struct vty *vty)
+{
+  vty_out (vty, "Kernel nexthop objects: %s%s",
+           nhg_kernel ? "in use" : "not available", VTY_NEWLINE);
+  vty_out (vty, "Nexthop groups: %lu%s",
+           nhg_hash->count, VTY_NEWLINE);
+  hash_iterate (nhg_hash, nhg_print, vty);
+}
+
+void
+zebra_nhg_init (void)
+{
+  nhg_hash = hash_create (nhg_hash_key, nhg_hash_cmp);
+  hash_set_name (nhg_hash, "Zebra nexthop groups");
+  nhg_id_hash = hash_create (nhg_id_key, nhg_id_cmp);
+  hash_set_name (nhg_id_hash, "Zebra nexthop object ids");
+  nhg_gate_table[AFI_IP] = route_table_init ();
+  nhg_gate_table[AFI_IP6] = route_table_init ();
+}
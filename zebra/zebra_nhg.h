@@ -0,0 +1,134 @@
+/*
+ * Zebra shared nexthop groups header
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_NHG_H
+#define _ZEBRA_NHG_H
+
+#include "nexthop.h"
+#include "table.h"
+#include "vty.h"
+#include "hash.h"
+#include "zebra/rib.h"
+
+/* One resolved nexthop of a group, as installed in the kernel. */
+struct nhg_leg
+{
+  /* Kernel nexthop object. */
+  u_int32_t id;
+
+  /* AF_INET or AF_INET6 if there is a gateway, else 0. */
+  u_char family;
+  u_char onlink;
+  union g_addr gate;
+  ifindex_t ifindex;
+};
+
+/*
+ * Routes with the same nexthops, which zebra would resolve the same way,
+ * share a nexthop group.  Those added by clients share its nexthops
+ * too, rather than each having a copy, and the nexthops are resolved
+ * once for all of them, see rib->group.  The group is installed in the
+ * kernel as a nexthop object, which the routes point to, so that when
+ * the resolved nexthops change only the group object is replaced,
+ * rather than every route using it.
+ */
+struct nhg
+{
+  /* Kernel nexthop object of the group. */
+  u_int32_t id;
+
+  /* Ribs sharing the nexthops, and ribs installed with the group. */
+  unsigned long refcnt;
+
+  /* Number of installed ribs using the kernel object. */
+  unsigned long fib_refcnt;
+
+  /* What the routes have in common. */
+  vrf_id_t vrf_id;
+  u_char family;
+  u_char type;
+  u_char flags;
+  struct nexthop *nexthop;
+  unsigned int key;
+
+  /* Client group of the routes, which then stands for their nexthops
+   * and holds a reference to the group: when the client replaces it,
+   * the group's nexthops are replaced in place, see
+   * zebra_nhg_replace(). */
+  u_int32_t client_nhg;
+  u_char nexthop_num;
+
+  /* Nodes of the routes of a client group with nexthops of their own,
+   * which have to be processed again for them to change, see
+   * zebra_nhg_requeue(). */
+  struct hash *private;
+
+  /* The resolved nexthops the kernel object holds. */
+  u_char leg_num;
+  struct nhg_leg leg[MULTIPATH_NUM];
+
+  /* How the nexthops resolved, for the routes sharing them, while
+   * NHG_RESOLVED is set: it is unset when a route they may resolve
+   * through changes, see zebra_nhg_route_changed().  'gen' changes with
+   * the result, and with the nexthops, for the routes to tell, see
+   * rib->group_gen. */
+  u_char active_num;
+  u_int32_t nexthop_mtu;
+  u_int32_t gen;
+
+  u_char status;
+#define NHG_INSTALLED		(1 << 0)
+#define NHG_RESOLVED		(1 << 1)
+};
+
+/* Whether the rib's nexthops are those of its group. */
+#define RIB_NEXTHOPS_SHARED(rib) \
+  ((rib)->group && (rib)->nexthop == (rib)->group->nexthop)
+
+/* Whether the FIB flags of the rib's nexthops are the rib's own.  Those
+ * of shared nexthops tell what the group's kernel object holds, which a
+ * route is in the FIB with only if it is installed with the group. */
+#define RIB_NEXTHOPS_FIB(rib) \
+  (! RIB_NEXTHOPS_SHARED (rib) || (rib)->nhg)
+
+extern void zebra_nhg_init (void);
+extern void zebra_nhg_kernel_object (u_int32_t id, int ours, int group);
+extern int zebra_nhg_kernel_stale (u_int32_t id);
+extern void zebra_nhg_kernel_init (int supported, u_int32_t id_max);
+extern void zebra_nhg_sweep (void);
+extern struct nhg *zebra_nhg_install (struct route_node *, struct rib *);
+extern void zebra_nhg_release (struct nhg *);
+extern void zebra_nhg_fib_set (struct rib *);
+extern void zebra_nhg_intern (struct rib *, u_char);
+extern struct nhg *zebra_nhg_client_new (struct rib *, u_char);
+extern void zebra_nhg_share (struct nhg *, struct rib *);
+extern void zebra_nhg_unref (struct nhg *);
+extern int zebra_nhg_route_private (struct route_node *, struct rib *);
+extern void zebra_nhg_private (struct route_node *, struct rib *, int);
+extern void zebra_nhg_replace (struct nhg *, struct nexthop *, u_char);
+extern int zebra_nhg_update (struct nhg *);
+extern void zebra_nhg_requeue (struct nhg *,
+                               void (*) (struct hash_backet *, void *));
+extern void zebra_nhg_route_changed (struct route_node *);
+extern void zebra_nhg_unresolve_all (void);
+extern void zebra_nhg_print (struct vty *);
+
+#endif /* _ZEBRA_NHG_H */
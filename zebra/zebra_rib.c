@@ -44,6 +44,7 @@
 #include "zebra/debug.h"
 #include "zebra/zebra_fpm.h"
 #include "zebra/zebra_rnh.h"
+#include "zebra/zebra_nhg.h"
 
 /* Default rtm_table for all clients */
 extern struct zebra_t zebrad;
@@ -890,7 +891,7 @@ static unsigned
 nexthop_active_check (struct route_node *rn, struct rib *rib,
 		      struct nexthop *nexthop, int set)
 {
-  rib_table_info_t *info = rn->table->info;
+  rib_table_info_t *info;
   struct interface *ifp;
   route_map_result_t ret = RMAP_MATCH;
   extern char *proto_rm[AFI_MAX][ZEBRA_ROUTE_MAX+1];
@@ -966,6 +967,10 @@ nexthop_active_check (struct route_node *rn, struct rib *rib,
   if (! CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE))
     return 0;
 
+  /* Resolved for no route in particular, see rib_nhg_resolve(). */
+  if (! rn)
+    return 1;
+
   /* XXX: What exactly do those checks do? Do we support
    * e.g. IPv4 routes with IPv6 nexthops or vice versa? */
   if (RIB_SYSTEM_ROUTE(rib) ||
@@ -980,7 +985,10 @@ nexthop_active_check (struct route_node *rn, struct rib *rib,
    * in every case.
    */
   if (!family)
-    family = info->afi;
+    {
+      info = rn->table->info;
+      family = info->afi;
+    }
 
   rmap = 0;
   if (rib->type >= 0 && rib->type < ZEBRA_ROUTE_MAX &&
@@ -1007,13 +1015,85 @@ nexthop_active_check (struct route_node *rn, struct rib *rib,
  * Return value is the new number of active nexthops.
  */
 
+/* Resolve the nexthops of the group for all the routes sharing them,
+ * as for no route in particular: those whose nexthops depend on the
+ * route have their own, see nexthop_active_update(). */
+static void
+rib_nhg_resolve (struct nhg *nhg)
+{
+  struct nexthop *nexthop;
+  struct rib rib;
+  unsigned int prev_active;
+  ifindex_t prev_index;
+  int changed = 0;
+
+  memset (&rib, 0, sizeof (struct rib));
+  rib.type = nhg->type;
+  rib.flags = nhg->flags;
+  rib.vrf_id = nhg->vrf_id;
+
+  nhg->active_num = 0;
+  for (nexthop = nhg->nexthop; nexthop; nexthop = nexthop->next)
+    {
+      prev_active = CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE);
+      prev_index = nexthop->ifindex;
+      if (nexthop_active_check (NULL, &rib, nexthop, 1))
+	nhg->active_num++;
+      if (prev_active != CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE)
+	  || prev_index != nexthop->ifindex)
+	changed = 1;
+    }
+  nhg->nexthop_mtu = rib.nexthop_mtu;
+
+  if (changed)
+    nhg->gen++;
+  SET_FLAG (nhg->status, NHG_RESOLVED);
+}
+
 static int
 nexthop_active_update (struct route_node *rn, struct rib *rib, int set)
 {
   struct nexthop *nexthop;
   unsigned int prev_active, new_active;
   ifindex_t prev_index;
+  int changed = 0;
   
+  /* Nexthops shared with the other routes of the group are resolved
+   * once for them all, unless the route's own are to be.  A copy of
+   * its own is given up once the group changed, and the route looked
+   * at anew. */
+  if (rib->group)
+    {
+      struct nhg *nhg = rib->group;
+
+      rib->nexthop_num = nhg->nexthop_num;
+      if (! RIB_NEXTHOPS_SHARED (rib) && rib->group_gen != nhg->gen)
+	{
+	  nexthops_free (rib->nexthop);
+	  rib->nexthop = nhg->nexthop;
+	  SET_FLAG (rib->status, RIB_ENTRY_CHANGED);
+	}
+
+      if (RIB_NEXTHOPS_SHARED (rib) && zebra_nhg_route_private (rn, rib))
+	{
+	  zebra_nhg_private (rn, rib, 0);
+	  SET_FLAG (rib->status, RIB_ENTRY_CHANGED);
+	}
+      else if (RIB_NEXTHOPS_SHARED (rib))
+	{
+	  if (! CHECK_FLAG (nhg->status, NHG_RESOLVED))
+	    rib_nhg_resolve (nhg);
+	  rib->nexthop_active_num = nhg->active_num;
+	  rib->nexthop_mtu = nhg->nexthop_mtu;
+	  if (rib->group_gen != nhg->gen)
+	    {
+	      rib->group_gen = nhg->gen;
+	      SET_FLAG (rib->status, RIB_ENTRY_CHANGED);
+	    }
+	  return rib->nexthop_active_num;
+	}
+    }
+
   rib->nexthop_active_num = 0;
 
   for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
@@ -1024,11 +1104,30 @@ nexthop_active_update (struct route_node *rn, struct rib *rib, int set)
       rib->nexthop_active_num++;
     if (prev_active != new_active ||
 	prev_index != nexthop->ifindex)
-      SET_FLAG (rib->status, RIB_ENTRY_CHANGED);
+      changed = 1;
   }
+
+  if (changed)
+    SET_FLAG (rib->status, RIB_ENTRY_CHANGED);
   return rib->nexthop_active_num;
 }
 
+/* The nexthops of a route are no longer in the FIB.  Those it shares
+ * with the other routes of its client group stay marked for the others,
+ * which are installed with the same kernel object. */
+static void
+rib_fib_unset (struct rib *rib)
+{
+  struct nexthop *nexthop, *tnexthop;
+  int recursing;
+
+  if (RIB_NEXTHOPS_SHARED (rib))
+    return;
+
+  for (ALL_NEXTHOPS_RO(rib->nexthop, nexthop, tnexthop, recursing))
+    UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+}
+
 
 
 static int
@@ -1038,6 +1137,7 @@ rib_update_kernel (struct route_node *rn, struct rib *old, struct rib *new)
   struct nexthop *nexthop, *tnexthop;
   rib_table_info_t *info = rn->table->info;
   int recursing;
+  struct nhg *old_nhg = NULL, *prev_nhg = NULL;
 
   if (info->safi != SAFI_UNICAST)
     {
@@ -1045,8 +1145,7 @@ rib_update_kernel (struct route_node *rn, struct rib *old, struct rib *new)
         for (ALL_NEXTHOPS_RO(new->nexthop, nexthop, tnexthop, recursing))
           SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
       if (old)
-        for (ALL_NEXTHOPS_RO(old->nexthop, nexthop, tnexthop, recursing))
-          UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+        rib_fib_unset (old);
       return 0;
     }
 
@@ -1056,19 +1155,68 @@ rib_update_kernel (struct route_node *rn, struct rib *old, struct rib *new)
    */
   zfpm_trigger_update (rn, "updating in kernel");
 
-  ret = kernel_route_rib (&rn->p, old, new);
+  /* The groups the routes are in the kernel with are let go only once
+   * the kernel is done with them. */
+  if (old)
+    old_nhg = old->nhg;
+  if (new && new != old)
+    {
+      prev_nhg = new->nhg;
+      new->nhg = NULL;
+    }
+
+  if (new)
+    {
+      struct nhg *nhg = zebra_nhg_install (rn, new);
+
+      /* The route already points to the group, which now holds its
+       * nexthops: nothing else to tell the kernel, whether this is the
+       * same rib re-resolved or a client replacing it with the same
+       * nexthops. */
+      if (nhg && nhg == old_nhg && !new->mtu && !new->nexthop_mtu
+          && !old->mtu && !old->nexthop_mtu)
+        {
+          zebra_nhg_release (old_nhg);
+          if (old != new)
+            {
+              old->nhg = NULL;
+              rib_fib_unset (old);
+            }
+          new->nhg = nhg;
+          zebra_nhg_fib_set (new);
+          if (prev_nhg)
+            zebra_nhg_release (prev_nhg);
+          return 0;
+        }
+      new->nhg = nhg;
+
+      /* Installed with nexthops of its own, whose FIB flags are then the
+       * route's, rather than those of the group's kernel object. */
+      if (! nhg && RIB_NEXTHOPS_SHARED (new))
+        zebra_nhg_private (rn, new, 1);
+    }
+
+  ret = kernel_route_rib (rn, old, new);
+
+  if (old && old != new)
+    old->nhg = NULL;
+  if (old_nhg)
+    zebra_nhg_release (old_nhg);
+  if (prev_nhg)
+    zebra_nhg_release (prev_nhg);
 
   /* This condition is never met, if we are using rt_socket.c */
   if (ret < 0 && new)
     {
-      for (ALL_NEXTHOPS_RO(new->nexthop, nexthop, tnexthop, recursing))
-        UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+      rib_fib_unset (new);
+      if (new->nhg)
+        {
+          zebra_nhg_release (new->nhg);
+          new->nhg = NULL;
+        }
     }
   else if (old && old != new)
-    {
-      for (ALL_NEXTHOPS_RO(old->nexthop, nexthop, tnexthop, recursing))
-        UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
-    }
+    rib_fib_unset (old);
 
   return ret;
 }
@@ -1114,6 +1262,12 @@ rib_can_delete_dest (rib_dest_t *dest)
       CHECK_FLAG (dest->flags, RIB_DEST_SENT_TO_FPM))
     return 0;
 
+  /*
+   * Nor if the kernel has yet to answer for a change made for it.
+   */
+  if (dest->kernel_pending)
+    return 0;
+
   return 1;
 }
 
@@ -1151,6 +1305,65 @@ rib_gc_dest (struct route_node *rn)
   return 1;
 }
 
+/*
+ * rib_kernel_queued
+ *
+ * Change 'seq' was made for the prefix of the given route node, to
+ * install 'rib', or to delete the route if that is NULL.  The kernel
+ * will answer for it later: keep the node and its dest until then.
+ */
+void
+rib_kernel_queued (struct route_node *rn, struct rib *rib, u_int32_t seq)
+{
+  rib_dest_t *dest = rib_dest_from_rnode (rn);
+
+  route_lock_node (rn);
+  dest->kernel_pending++;
+  if (rib)
+    rib->kernel_seq = seq;
+}
+
+/*
+ * rib_kernel_done
+ *
+ * The kernel answered for change 'seq' queued by rib_kernel_queued().
+ * If the kernel failed to install the route, it is not in the FIB after
+ * all, as when kernel_route_rib() fails right away.
+ *
+ * The rib may have been freed by now, and its memory given to another
+ * one: it is only looked at if still on the node with the change as
+ * its last one.  An earlier change is superseded by the last anyway.
+ */
+void
+rib_kernel_done (struct route_node *rn, struct rib *rib, u_int32_t seq,
+		 int error)
+{
+  rib_dest_t *dest = rib_dest_from_rnode (rn);
+  struct rib *match;
+
+  assert (dest && dest->kernel_pending);
+  dest->kernel_pending--;
+
+  if (rib)
+    RNODE_FOREACH_RIB (rn, match)
+      if (match == rib && rib->kernel_seq == seq)
+        {
+          rib->kernel_seq = 0;
+          if (! error)
+            break;
+          rib_fib_unset (rib);
+          if (rib->nhg)
+            {
+              zebra_nhg_release (rib->nhg);
+              rib->nhg = NULL;
+            }
+          break;
+        }
+
+  rib_gc_dest (rn);
+  route_unlock_node (rn);
+}
+
 /* Check if 'alternate' RIB entry is better than 'current'. */
 static struct rib *
 rib_choose_best (struct rib *current, struct rib *alternate)
@@ -1287,6 +1500,8 @@ rib_process (struct route_node *rn)
 
         if (info->safi == SAFI_UNICAST)
           zfpm_trigger_update (rn, "updating existing route");
+        zebra_rnh_route_changed (rn);
+        zebra_nhg_route_changed (rn);
     }
   else if (old_fib == new_fib && new_fib && ! RIB_SYSTEM_ROUTE (new_fib))
     {
@@ -1294,14 +1509,19 @@ rib_process (struct route_node *rn)
        * linux netlink reporting interface up before IPv4 or IPv6 protocol
        * is ready to add routes. This makes sure routes are IN the kernel.
        */
-      for (ALL_NEXTHOPS_RO(new_fib->nexthop, nexthop, tnexthop, recursing))
-        if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
-          {
-            installed = 1;
-            break;
-          }
+      if (RIB_NEXTHOPS_FIB (new_fib))
+        for (ALL_NEXTHOPS_RO(new_fib->nexthop, nexthop, tnexthop, recursing))
+          if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
+            {
+              installed = 1;
+              break;
+            }
       if (! installed)
-        rib_update_kernel (rn, NULL, new_fib);
+        {
+          rib_update_kernel (rn, NULL, new_fib);
+          zebra_rnh_route_changed (rn);
+          zebra_nhg_route_changed (rn);
+        }
     }
 
   /* Redistribute SELECTED entry */
@@ -1383,6 +1603,14 @@ process_subq (struct list * subq, u_char qindex)
 static void
 meta_queue_process_complete (struct work_queue *dummy)
 {
+  vrf_iter_t iter;
+  struct zebra_vrf *zvrf;
+
+  /* Send the route changes made while the queue was worked on. */
+  for (iter = vrf_first (); iter != VRF_ITER_INVALID; iter = vrf_next (iter))
+    if ((zvrf = vrf_iter2info (iter)) != NULL)
+      kernel_route_flush (zvrf);
+
   zebra_evaluate_rnh_table(0, AF_INET);
 #ifdef HAVE_IPV6
   zebra_evaluate_rnh_table(0, AF_INET6);
@@ -1675,7 +1903,12 @@ rib_unlink (struct route_node *rn, struct rib *rib)
     }
 
   /* free RIB and nexthops */
-  nexthops_free(rib->nexthop);
+  if (rib->nhg)
+    zebra_nhg_release (rib->nhg);
+  if (! RIB_NEXTHOPS_SHARED (rib))
+    nexthops_free(rib->nexthop);
+  if (rib->group)
+    zebra_nhg_unref (rib->group);
   XFREE (MTYPE_RIB, rib);
 
 }
@@ -2960,6 +3193,8 @@ rib_update (vrf_id_t vrf_id)
   struct route_node *rn;
   struct route_table *table;
   
+  zebra_nhg_unresolve_all ();
+
   table = zebra_vrf_table (AFI_IP, SAFI_UNICAST, vrf_id);
   if (table)
     for (rn = route_top (table); rn; rn = route_next (rn))
@@ -2974,6 +3209,53 @@ rib_update (vrf_id_t vrf_id)
 }
 
 
+static void
+rib_nhg_requeue (struct hash_backet *backet, void *arg)
+{
+  rib_queue_add (&zebrad, backet->data);
+}
+
+/*
+ * A client replaced the nexthops of one of its groups, which the routes
+ * added with the group share.  They are resolved once, for all the
+ * routes, and the kernel object the routes are installed with is made
+ * to hold them: the routes need not be processed again, but for those
+ * with nexthops of their own.  Only if the routes can no longer be
+ * selected, or now can, or the new nexthops cannot be installed as the
+ * object, are all the routes of the group looked for, and processed
+ * again.
+ */
+void
+rib_update_nhg (struct nhg *nhg)
+{
+  struct route_node *rn;
+  struct route_table *table;
+  struct rib *match;
+  u_char active_num = nhg->active_num;
+  safi_t safi;
+
+  rib_nhg_resolve (nhg);
+  zebra_nhg_requeue (nhg, rib_nhg_requeue);
+  if ((active_num == 0) == (nhg->active_num == 0)
+      && zebra_nhg_update (nhg) == 0)
+    return;
+
+  for (safi = SAFI_UNICAST; safi <= SAFI_MULTICAST; safi++)
+    {
+      table = zebra_vrf_table (family2afi (nhg->family), safi, nhg->vrf_id);
+      if (! table)
+        continue;
+
+      for (rn = route_top (table); rn; rn = route_next (rn))
+        RNODE_FOREACH_RIB (rn, match)
+          if (match->group == nhg)
+            {
+              rib_queue_add (&zebrad, rn);
+              break;
+            }
+    }
+}
+
 /* Remove all routes which comes from non main table.  */
 static void
 rib_weed_table (struct route_table *table)
@@ -3129,6 +3411,7 @@ rib_close (void)
       {
         rib_close_table (zvrf->table[AFI_IP][SAFI_UNICAST]);
         rib_close_table (zvrf->table[AFI_IP6][SAFI_UNICAST]);
+        kernel_route_wait (zvrf);
       }
 }
 
@@ -3264,7 +3547,7 @@ zebra_vrf_table_create (struct zebra_vrf *zvrf, afi_t afi, safi_t safi)
 
   assert (!zvrf->table[afi][safi]);
 
-  table = route_table_init ();
+  table = route_table_init_indexed ();
   zvrf->table[afi][safi] = table;
 
   info = XCALLOC (MTYPE_RIB_TABLE_INFO, sizeof (*info));
@@ -3297,6 +3580,8 @@ zebra_vrf_alloc (vrf_id_t vrf_id)
 
   zvrf->rnh_table[AFI_IP] = route_table_init();
   zvrf->rnh_table[AFI_IP6] = route_table_init();
+  zvrf->rnh_dirty[AFI_IP] = list_new ();
+  zvrf->rnh_dirty[AFI_IP6] = list_new ();
 
   /* Set VRF ID */
   zvrf->vrf_id = vrf_id;
@@ -3310,6 +3595,10 @@ zebra_vrf_alloc (vrf_id_t vrf_id)
   snprintf (nl_name, 64, "netlink-cmd (vrf %u)", vrf_id);
   zvrf->netlink_cmd.sock = -1;
   zvrf->netlink_cmd.name = XSTRDUP (MTYPE_NETLINK_NAME, nl_name);
+
+  snprintf (nl_name, 64, "netlink-dplane (vrf %u)", vrf_id);
+  zvrf->netlink_dplane.sock = -1;
+  zvrf->netlink_dplane.name = XSTRDUP (MTYPE_NETLINK_NAME, nl_name);
 #endif
 
   return zvrf;
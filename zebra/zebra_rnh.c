@@ -54,6 +54,16 @@
   t;                                             \
 })
 
+#define lookup_rnh_dirty(v, f)		         \
+({						 \
+  struct zebra_vrf *zvrf;                        \
+  struct list *l = NULL;                         \
+  zvrf = zebra_vrf_lookup(v);                    \
+  if (zvrf)                                      \
+    l = zvrf->rnh_dirty[family2afi(f)];	         \
+  l;                                             \
+})
+
 static void free_state(struct rib *rib);
 static void copy_state(struct rnh *rnh, struct rib *rib);
 static int compare_state(struct rib *r1, struct rib *r2);
@@ -67,6 +77,23 @@ rnh_str (struct rnh *rnh, char *buf, int size)
   return buf;
 }
 
+/* Have the nexthop evaluated by the next zebra_evaluate_rnh_table(). */
+static void
+rnh_set_dirty (struct rnh *rnh)
+{
+  struct list *dirty;
+
+  if (rnh->dirty)
+    return;
+
+  dirty = lookup_rnh_dirty(rnh->vrf_id, rnh->node->p.family);
+  if (!dirty)
+    return;
+
+  listnode_add (dirty, rnh);
+  rnh->dirty = listtail (dirty);
+}
+
 struct rnh *
 zebra_add_rnh (struct prefix *p, vrf_id_t vrfid)
 {
@@ -97,6 +124,8 @@ zebra_add_rnh (struct prefix *p, vrf_id_t vrfid)
     {
       rnh = XCALLOC(MTYPE_RNH, sizeof(struct rnh));
       rnh->client_list = list_new();
+      rnh->vrf_id = vrfid;
+      rnh->resolved_len = -1;
       route_lock_node (rn);
       rn->info = rnh;
       rnh->node = rn;
@@ -142,6 +171,9 @@ zebra_delete_rnh (struct rnh *rnh)
       zlog_debug("delete rnh %s", rnh_str(rnh, buf, INET6_ADDRSTRLEN));
     }
 
+  if (rnh->dirty)
+    list_delete_node (lookup_rnh_dirty(rnh->vrf_id, rn->p.family),
+		      rnh->dirty);
   list_free(rnh->client_list);
   free_state(rnh->state);
   XFREE(MTYPE_RNH, rn->info);
@@ -165,6 +197,9 @@ zebra_add_rnh_client (struct rnh *rnh, struct zserv *client, vrf_id_t vrf_id)
       listnode_add(rnh->client_list, client);
       send_client(rnh, client, vrf_id);
     }
+
+  /* New, or registered as connected now. */
+  rnh_set_dirty(rnh);
 }
 
 void
@@ -182,90 +217,147 @@ zebra_remove_rnh_client (struct rnh *rnh, struct zserv *client)
     zebra_delete_rnh(rnh);
 }
 
-int
-zebra_evaluate_rnh_table (vrf_id_t vrfid, int family)
+/*
+ * The FIB route for a prefix of the unicast table of a VRF changed.
+ * The nexthops it can resolve, or stop resolving, are those within the
+ * prefix that are not resolved through a more specific route: mark them
+ * to be evaluated again.  The nexthop table is a prefix tree, so they
+ * are found under the node for the prefix, without looking at others.
+ */
+void
+zebra_rnh_route_changed (struct route_node *rn)
 {
-  struct route_table *ptable;
+  rib_table_info_t *info = rn->table->info;
   struct route_table *ntable;
-  struct route_node *prn;
+  struct route_node *top;
   struct route_node *nrn;
   struct rnh *rnh;
+
+  if (info->safi != SAFI_UNICAST
+      || rn->table != info->zvrf->table[info->afi][SAFI_UNICAST])
+    return;
+
+  ntable = info->zvrf->rnh_table[info->afi];
+  if (!ntable || !ntable->count)
+    return;
+
+  top = route_node_get (ntable, &rn->p);
+  for (nrn = top; nrn; nrn = route_next_until (nrn, top))
+    if ((rnh = nrn->info) != NULL && rnh->resolved_len <= rn->p.prefixlen)
+      rnh_set_dirty(rnh);
+}
+
+static void
+zebra_evaluate_rnh (struct rnh *rnh, struct route_table *ptable,
+		    vrf_id_t vrfid)
+{
+  struct route_node *nrn = rnh->node;
+  struct route_node *prn;
+  struct route_node *parent;
   struct zserv *client;
   struct listnode *node;
-  struct rib *rib;
+  struct rib *rib = NULL;
 
-  ntable = lookup_rnh_table(vrfid, family);
-  if (!ntable)
-    {
-      zlog_debug("evaluate_rnh_table: rnh table not found\n");
-      return -1;
-    }
+  prn = route_node_match(ptable, &nrn->p);
 
-  ptable = zebra_vrf_table(family2afi(family), SAFI_UNICAST, vrfid);
-  if (!ptable)
+  /* A node may be left without routes until the kernel has answered
+   * for their removal, look past it. */
+  while (prn && !((rib_dest_t *) prn->info)->routes)
     {
-      zlog_debug("evaluate_rnh_table: prefix table not found\n");
-      return -1;
+      for (parent = prn->parent; parent; parent = parent->parent)
+	if (parent->info)
+	  break;
+      if (parent)
+	route_lock_node (parent);
+      route_unlock_node (prn);
+      prn = parent;
     }
 
-  for (nrn = route_top (ntable); nrn; nrn = route_next (nrn))
+  if (prn)
     {
-      if (!nrn->info)
-	  continue;
-      
-      rnh = nrn->info;
-      prn = route_node_match(ptable, &nrn->p);
-      if (!prn)
-	rib = NULL;
-      else
+      RNODE_FOREACH_RIB(prn, rib)
 	{
-	  RNODE_FOREACH_RIB(prn, rib)
+	  if (CHECK_FLAG (rib->status, RIB_ENTRY_REMOVED))
+	    continue;
+	  if (! CHECK_FLAG (rib->status, RIB_ENTRY_SELECTED_FIB))
+	    continue;
+
+	  if (CHECK_FLAG(rnh->flags, ZEBRA_NHT_CONNECTED))
 	    {
-	      if (CHECK_FLAG (rib->status, RIB_ENTRY_REMOVED))
-		continue;
-	      if (! CHECK_FLAG (rib->status, RIB_ENTRY_SELECTED_FIB))
-		continue;
+	      if (rib->type == ZEBRA_ROUTE_CONNECT)
+		break;
 
-	      if (CHECK_FLAG(rnh->flags, ZEBRA_NHT_CONNECTED))
+	      if (rib->type == ZEBRA_ROUTE_NHRP)
 		{
-		  if (rib->type == ZEBRA_ROUTE_CONNECT)
+		  struct nexthop *nexthop;
+		  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+		    if (nexthop->type == NEXTHOP_TYPE_IFINDEX ||
+			nexthop->type == NEXTHOP_TYPE_IFNAME)
+		      break;
+		  if (nexthop)
 		    break;
-
-		  if (rib->type == ZEBRA_ROUTE_NHRP)
-		    {
-		      struct nexthop *nexthop;
-		      for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
-			if (nexthop->type == NEXTHOP_TYPE_IFINDEX ||
-			    nexthop->type == NEXTHOP_TYPE_IFNAME)
-			  break;
-		      if (nexthop)
-			break;
-		    }
 		}
-	      else
-		break;
 	    }
+	  else
+	    break;
 	}
+    }
 
-      if (compare_state(rib, rnh->state))
+  rnh->resolved_len = prn ? prn->p.prefixlen : -1;
+
+  if (compare_state(rib, rnh->state))
+    {
+      if (IS_ZEBRA_DEBUG_NHT)
 	{
-	  if (IS_ZEBRA_DEBUG_NHT)
-	    {
-	      char bufn[INET6_ADDRSTRLEN];
-	      char bufp[INET6_ADDRSTRLEN];
-	      prefix2str(&nrn->p, bufn, INET6_ADDRSTRLEN);
-	      if (prn)
-		prefix2str(&prn->p, bufp, INET6_ADDRSTRLEN);
-	      else
-		strcpy(bufp, "null");
-	      zlog_debug("rnh %s resolved through route %s - sending "
-			 "nexthop %s event to clients", bufn, bufp,
-			 rib ? "reachable" : "unreachable");
-	    }
-	  copy_state(rnh, rib);
-	  for (ALL_LIST_ELEMENTS_RO(rnh->client_list, node, client))
-	    send_client(rnh, client, vrfid);
+	  char bufn[INET6_ADDRSTRLEN];
+	  char bufp[INET6_ADDRSTRLEN];
+	  prefix2str(&nrn->p, bufn, INET6_ADDRSTRLEN);
+	  if (prn)
+	    prefix2str(&prn->p, bufp, INET6_ADDRSTRLEN);
+	  else
+	    strcpy(bufp, "null");
+	  zlog_debug("rnh %s resolved through route %s - sending "
+		     "nexthop %s event to clients", bufn, bufp,
+		     rib ? "reachable" : "unreachable");
 	}
+      copy_state(rnh, rib);
+      for (ALL_LIST_ELEMENTS_RO(rnh->client_list, node, client))
+	send_client(rnh, client, vrfid);
+    }
+
+  if (prn)
+    route_unlock_node (prn);
+}
+
+/* Evaluate the nexthops which may resolve differently since the last
+ * time, see zebra_rnh_route_changed(). */
+int
+zebra_evaluate_rnh_table (vrf_id_t vrfid, int family)
+{
+  struct route_table *ptable;
+  struct list *dirty;
+  struct rnh *rnh;
+
+  dirty = lookup_rnh_dirty(vrfid, family);
+  if (!dirty)
+    {
+      zlog_debug("evaluate_rnh_table: rnh table not found\n");
+      return -1;
+    }
+
+  ptable = zebra_vrf_table(family2afi(family), SAFI_UNICAST, vrfid);
+  if (!ptable)
+    {
+      zlog_debug("evaluate_rnh_table: prefix table not found\n");
+      return -1;
+    }
+
+  while (listcount (dirty))
+    {
+      rnh = listgetdata (listhead (dirty));
+      list_delete_node (dirty, rnh->dirty);
+      rnh->dirty = NULL;
+      zebra_evaluate_rnh (rnh, ptable, vrfid);
     }
   return 1;
 }
@@ -34,6 +34,15 @@ struct rnh
   struct rib *state;
   struct list *client_list;
   struct route_node *node;
+  vrf_id_t vrf_id;
+
+  /* Length of the route prefix the nexthop was last resolved through,
+   * or -1 if no route matched.  Only changes to routes at least as
+   * long can change how it resolves. */
+  int resolved_len;
+
+  /* On the VRF's list of nexthops to evaluate. */
+  struct listnode *dirty;
 };
 
 extern struct rnh *zebra_add_rnh(struct prefix *p, vrf_id_t vrfid);
@@ -41,6 +50,7 @@ extern struct rnh *zebra_lookup_rnh(struct prefix *p, vrf_id_t vrfid);
 extern void zebra_delete_rnh(struct rnh *rnh);
 extern void zebra_add_rnh_client(struct rnh *rnh, struct zserv *client, vrf_id_t vrf_id_t);
 extern void zebra_remove_rnh_client(struct rnh *rnh, struct zserv *client);
+extern void zebra_rnh_route_changed(struct route_node *rn);
 extern int zebra_evaluate_rnh_table(vrf_id_t vrfid, int family);
 extern int zebra_dispatch_rnh_table(vrf_id_t vrfid, int family, struct zserv *cl);
 extern void zebra_print_rnh_table(vrf_id_t vrfid, int family, struct vty *vty);
@@ -3,6 +3,9 @@
 #include "zebra/zserv.h"
 #include "zebra/zebra_rnh.h"
 
+void zebra_rnh_route_changed (struct route_node *rn)
+{}
+
 int zebra_evaluate_rnh_table (vrf_id_t vrfid, int family)
 { return 0; }
 
@@ -32,6 +32,8 @@
 
 #include "zebra/zserv.h"
 #include "zebra/zebra_rnh.h"
+#include "zebra/zebra_nhg.h"
+#include "zebra/rt.h"
 
 static int do_show_ip_route(struct vty *vty, safi_t safi, vrf_id_t vrf_id);
 static void vty_show_ip_route_detail (struct vty *vty, struct route_node *rn,
@@ -2150,7 +2152,8 @@ vty_show_ip_route_detail (struct vty *vty, struct route_node *rn, int mcast)
         {
           vty_out (vty, "  %c%c%s",
                    CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE) ? '>' : ' ',
-                   CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB) ? '*' : ' ',
+                   RIB_NEXTHOPS_FIB (rib)
+                   && CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB) ? '*' : ' ',
                    recursing ? "  " : "");
 
           switch (nexthop->type)
@@ -2244,7 +2247,8 @@ vty_show_ip_route (struct vty *vty, struct route_node *rn, struct rib *rib)
 			 zebra_route_char (rib->type),
 			 CHECK_FLAG (rib->flags, ZEBRA_FLAG_SELECTED)
 			 ? '>' : ' ',
-			 CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
+			 RIB_NEXTHOPS_FIB (rib)
+			 && CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
 			 ? '*' : ' ',
 			 prefix2str (&rn->p, buf, sizeof buf));
 		
@@ -2259,7 +2263,8 @@ vty_show_ip_route (struct vty *vty, struct route_node *rn, struct rib *rib)
 	}
       else
 	vty_out (vty, "  %c%*c",
-		 CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
+		 RIB_NEXTHOPS_FIB (rib)
+		 && CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
 		 ? '*' : ' ',
 		 len - 3 + (2 * recursing), ' ');
 
@@ -2440,6 +2445,28 @@ DEFUN (show_ipv6_nht,
   return CMD_SUCCESS;
 }
 
+DEFUN (show_zebra_nexthop_group,
+       show_zebra_nexthop_group_cmd,
+       "show zebra nexthop-group",
+       SHOW_STR
+       "Zebra information\n"
+       "Nexthop groups shared by routes\n")
+{
+  zebra_nhg_print (vty);
+  return CMD_SUCCESS;
+}
+
+DEFUN (show_zebra_dataplane,
+       show_zebra_dataplane_cmd,
+       "show zebra dataplane",
+       SHOW_STR
+       "Zebra information\n"
+       "Programming of routes in the kernel\n")
+{
+  kernel_dataplane_show (vty);
+  return CMD_SUCCESS;
+}
+
 DEFUN (show_ip_route_tag,
        show_ip_route_tag_cmd,
        "show ip route tag <1-4294967295>",
@@ -2778,8 +2805,9 @@ vty_show_ip_route_summary (struct vty *vty, struct route_table *table)
         {
 	  rib_cnt[ZEBRA_ROUTE_TOTAL]++;
 	  rib_cnt[rib->type]++;
-	  if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
-	      || nexthop_has_fib_child(nexthop))
+	  if (RIB_NEXTHOPS_FIB (rib)
+	      && (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
+		  || nexthop_has_fib_child(nexthop)))
 	    {
 	      fib_cnt[ZEBRA_ROUTE_TOTAL]++;
 	      fib_cnt[rib->type]++;
@@ -2788,8 +2816,9 @@ vty_show_ip_route_summary (struct vty *vty, struct route_table *table)
 	      CHECK_FLAG (rib->flags, ZEBRA_FLAG_IBGP)) 
 	    {
 	      rib_cnt[ZEBRA_ROUTE_IBGP]++;
-	      if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
-		  || nexthop_has_fib_child(nexthop))
+	      if (RIB_NEXTHOPS_FIB (rib)
+		  && (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
+		      || nexthop_has_fib_child(nexthop)))
 		fib_cnt[ZEBRA_ROUTE_IBGP]++;
 	    }
 	}
@@ -2860,7 +2889,8 @@ vty_show_ip_route_summary_prefix (struct vty *vty, struct route_table *table)
           cnt++;
           rib_cnt[ZEBRA_ROUTE_TOTAL]++;
           rib_cnt[rib->type]++;
-          if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
+          if (RIB_NEXTHOPS_FIB (rib)
+              && CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
 	        {
 	         fib_cnt[ZEBRA_ROUTE_TOTAL]++;
              fib_cnt[rib->type]++;
@@ -2869,7 +2899,8 @@ vty_show_ip_route_summary_prefix (struct vty *vty, struct route_table *table)
 	          CHECK_FLAG (rib->flags, ZEBRA_FLAG_IBGP))
             {
 	         rib_cnt[ZEBRA_ROUTE_IBGP]++;
-		     if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
+		     if (RIB_NEXTHOPS_FIB (rib)
+		         && CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
 		        fib_cnt[ZEBRA_ROUTE_IBGP]++;
             }
 	     }
@@ -5365,6 +5396,8 @@ zebra_vty_init (void)
   install_element (VIEW_NODE, &show_ip_route_tag_cmd);
   install_element (VIEW_NODE, &show_ip_route_tag_vrf_cmd);
   install_element (VIEW_NODE, &show_ip_nht_cmd);
+  install_element (VIEW_NODE, &show_zebra_nexthop_group_cmd);
+  install_element (VIEW_NODE, &show_zebra_dataplane_cmd);
   install_element (VIEW_NODE, &show_ipv6_nht_cmd);
   install_element (VIEW_NODE, &show_ip_route_addr_cmd);
   install_element (VIEW_NODE, &show_ip_route_prefix_cmd);
@@ -38,6 +38,8 @@
 #include "buffer.h"
 #include "vrf.h"
 #include "nexthop.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "zebra/zserv.h"
 #include "zebra/router-id.h"
@@ -45,6 +47,7 @@
 #include "zebra/debug.h"
 #include "zebra/ipforward.h"
 #include "zebra/zebra_rnh.h"
+#include "zebra/zebra_nhg.h"
 
 /* Event list of zebra. */
 enum event { ZEBRA_SERV, ZEBRA_READ, ZEBRA_WRITE };
@@ -56,6 +59,8 @@ static void zebra_event (enum event event, int sock, struct zserv *client);
 extern struct zebra_privs_t zserv_privs;
 
 static void zebra_client_close (struct zserv *client);
+static void zserv_catchup_start (struct zserv *client);
+static void zserv_catchup_resume (struct zserv *client);
 
 static int
 zserv_delayed_close(struct thread *thread)
@@ -76,6 +81,15 @@ zserv_delayed_close(struct thread *thread)
  */
 static int route_type_oaths[ZEBRA_ROUTE_MAX];
 
+/* Output queued up for a client, in bytes, from which on it is caught
+ * up with the routes it redistributes rather than sent every change,
+ * and down to which it has to read before that starts. */
+#define ZSERV_WB_HIGH (4 * 1024 * 1024)
+#define ZSERV_WB_LOW  (1024 * 1024)
+
+/* Route nodes replayed to a client per run. */
+#define ZSERV_REPLAY_CHUNK 1000
+
 static int
 zserv_flush_data(struct thread *thread)
 {
@@ -93,7 +107,7 @@ zserv_flush_data(struct thread *thread)
       zlog_warn("%s: buffer_flush_available failed on zserv client fd %d, "
       		"closing", __func__, client->sock);
       zebra_client_close(client);
-      break;
+      return -1;
     case BUFFER_PENDING:
       client->t_write = thread_add_write(zebrad.master, zserv_flush_data,
       					 client, client->sock);
@@ -103,19 +117,22 @@ zserv_flush_data(struct thread *thread)
     }
 
   client->last_write_time = quagga_time(NULL);
+
+  if (client->catchup == ZSERV_CATCHUP_WAIT
+      && buffer_length (client->wb) <= ZSERV_WB_LOW)
+    zserv_catchup_resume (client);
   return 0;
 }
 
-int
-zebra_server_send_message(struct zserv *client)
+/* Queue the message of the first readable byte of 's' on to the client. */
+static int
+zserv_write (struct zserv *client, struct stream *s)
 {
-  if (client->t_suicide)
-    return -1;
+  size_t getp = stream_get_getp (s);
 
-  stream_set_getp(client->obuf, 0);
-  client->last_write_cmd = stream_getw_from(client->obuf, 4);
-  switch (buffer_write(client->wb, client->sock, STREAM_DATA(client->obuf),
-		       stream_get_endp(client->obuf)))
+  client->last_write_cmd = stream_getw_from(s, getp + 6);
+  switch (buffer_write(client->wb, client->sock, STREAM_DATA(s) + getp,
+		       stream_get_endp(s) - getp))
     {
     case BUFFER_ERROR:
       zlog_warn("%s: buffer_write failed to zserv client fd %d, closing",
@@ -137,9 +154,324 @@ zebra_server_send_message(struct zserv *client)
     }
 
   client->last_write_time = quagga_time(NULL);
+
+  if (buffer_length (client->wb) > client->wb_peak)
+    client->wb_peak = buffer_length (client->wb);
+  if (client->catchup != ZSERV_CATCHUP_WAIT
+      && buffer_length (client->wb) >= ZSERV_WB_HIGH)
+    zserv_catchup_start (client);
+  return 0;
+}
+
+/* Coalescing window of routes redistributed to a client, msecs. */
+#define ZSERV_REDIST_WINDOW 10
+
+/* A route message waiting to be redistributed to a client.  Only the
+ * last message for a route type and prefix is kept: an add followed by
+ * a delete, or any number of adds, goes out as the one message, in the
+ * place of the last one queued. */
+struct zserv_redist
+{
+  vrf_id_t vrf_id;
+  u_char type;
+  struct prefix p;
+
+  struct zserv_redist *next;
+  struct zserv_redist *prev;
+
+  u_int16_t len;
+  u_char *msg;
+};
+
+static unsigned int
+zserv_redist_key (void *arg)
+{
+  struct zserv_redist *r = arg;
+
+  return jhash (&r->p.u.prefix, PSIZE (r->p.prefixlen),
+		jhash_3words (r->vrf_id, r->type,
+			      (r->p.family << 8) | r->p.prefixlen, 0));
+}
+
+static int
+zserv_redist_cmp (const void *arg1, const void *arg2)
+{
+  const struct zserv_redist *r1 = arg1;
+  const struct zserv_redist *r2 = arg2;
+
+  return r1->vrf_id == r2->vrf_id && r1->type == r2->type
+    && prefix_same (&r1->p, &r2->p);
+}
+
+static void *
+zserv_redist_alloc (void *arg)
+{
+  struct zserv_redist *lookup = arg;
+  struct zserv_redist *r;
+
+  r = XCALLOC (MTYPE_ZSERV_REDIST, sizeof (struct zserv_redist));
+  r->vrf_id = lookup->vrf_id;
+  r->type = lookup->type;
+  prefix_copy (&r->p, &lookup->p);
+  return r;
+}
+
+static void
+zserv_redist_append (struct zserv *client, struct zserv_redist *r)
+{
+  r->next = NULL;
+  r->prev = client->redist_tail;
+  if (client->redist_tail)
+    client->redist_tail->next = r;
+  else
+    client->redist_head = r;
+  client->redist_tail = r;
+}
+
+static void
+zserv_redist_unlink (struct zserv *client, struct zserv_redist *r)
+{
+  if (r->prev)
+    r->prev->next = r->next;
+  else
+    client->redist_head = r->next;
+  if (r->next)
+    r->next->prev = r->prev;
+  else
+    client->redist_tail = r->prev;
+}
+
+static void
+zserv_redist_free (struct zserv *client, struct zserv_redist *r)
+{
+  zserv_redist_unlink (client, r);
+  hash_release (client->redist_hash, r);
+  XFREE (MTYPE_ZSERV_REDIST, r->msg);
+  XFREE (MTYPE_ZSERV_REDIST, r);
+}
+
+/*
+ * Send the routes queued for the client.  Several go in each
+ * ZEBRA_REDISTRIBUTE_BATCH message, which carries them as the
+ * ZEBRA_IPV{4,6}_ROUTE_{ADD,DELETE} messages they would otherwise have
+ * been sent as.  A route on its own is sent as is.
+ */
+static int
+zserv_redist_flush (struct zserv *client)
+{
+  struct zserv_redist *r;
+  struct stream *s;
+  u_int16_t count;
+
+  if (! client->redist_head || client->catchup == ZSERV_CATCHUP_WAIT)
+    return 0;
+
+  THREAD_OFF (client->t_redist);
+
+  if (! client->redist_buf)
+    client->redist_buf = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  s = client->redist_buf;
+
+  while ((r = client->redist_head))
+    {
+      stream_reset (s);
+      zserv_create_header (s, ZEBRA_REDISTRIBUTE_BATCH, VRF_DEFAULT);
+
+      for (count = 0; r && STREAM_WRITEABLE (s) >= r->len;
+	   r = client->redist_head)
+	{
+	  stream_put (s, r->msg, r->len);
+	  zserv_redist_free (client, r);
+	  count++;
+	}
+
+      stream_putw_at (s, 0, stream_get_endp (s));
+      if (count == 1)
+	stream_set_getp (s, ZEBRA_HEADER_SIZE);
+      else
+	client->redist_batch_cnt++;
+
+      if (client->t_suicide || zserv_write (client, s) < 0)
+	{
+	  zserv_redist_purge (client);
+	  return -1;
+	}
+
+      /* The rest waits for the client to catch up. */
+      if (client->catchup == ZSERV_CATCHUP_WAIT)
+	return 0;
+    }
+
+  return 0;
+}
+
+static int
+zserv_redist_timer (struct thread *thread)
+{
+  struct zserv *client = THREAD_ARG (thread);
+
+  client->t_redist = NULL;
+  zserv_redist_flush (client);
   return 0;
 }
 
+/* Queue the route message 'cmd' just built in the client's obuf, for
+ * route 'p' of type 'type', replacing any message for it still queued. */
+static int
+zserv_redist_queue (struct zserv *client, int cmd, struct prefix *p,
+		    u_char type, vrf_id_t vrf_id)
+{
+  struct zserv_redist lookup, *r;
+  struct stream *s = client->obuf;
+
+  if (client->t_suicide)
+    return -1;
+
+  /* The replay is to send it. */
+  if (client->catchup == ZSERV_CATCHUP_WAIT
+      && (cmd == ZEBRA_IPV4_ROUTE_ADD || cmd == ZEBRA_IPV6_ROUTE_ADD)
+      && ! zebra_redistribute_replayed (client, vrf_id, p))
+    {
+      client->redist_skip_cnt++;
+      return 0;
+    }
+
+  if (! client->redist_hash)
+    client->redist_hash = hash_create (zserv_redist_key, zserv_redist_cmp);
+
+  memset (&lookup, 0, sizeof (struct zserv_redist));
+  lookup.vrf_id = vrf_id;
+  lookup.type = type;
+  prefix_copy (&lookup.p, p);
+
+  /* A message replacing one still queued goes where a new one would,
+   * so that the client sees the route's messages in the order zebra
+   * made them, relative to those of other types for the prefix. */
+  r = hash_get (client->redist_hash, &lookup, zserv_redist_alloc);
+  if (r->msg)
+    {
+      client->redist_coalesced_cnt++;
+      zserv_redist_unlink (client, r);
+    }
+  zserv_redist_append (client, r);
+
+  r->len = stream_get_endp (s);
+  r->msg = XREALLOC (MTYPE_ZSERV_REDIST, r->msg, r->len);
+  memcpy (r->msg, STREAM_DATA (s), r->len);
+
+  if (! client->t_redist)
+    client->t_redist = thread_add_timer_msec (zebrad.master,
+					      zserv_redist_timer, client,
+					      ZSERV_REDIST_WINDOW);
+  return 0;
+}
+
+/* Drop the queued routes the client no longer wants, or all of them
+ * if the client is going away. */
+void
+zserv_redist_purge (struct zserv *client)
+{
+  struct zserv_redist *r, *next;
+  int all = client->t_suicide || client->sock < 0;
+
+  for (r = client->redist_head; r; r = next)
+    {
+      next = r->next;
+      if (! all
+	  && (vrf_bitmap_check (client->redist[r->type], r->vrf_id)
+	      || (is_default (&r->p)
+		  && vrf_bitmap_check (client->redist_default, r->vrf_id))))
+	continue;
+
+      zserv_redist_free (client, r);
+    }
+
+  if (! client->redist_head)
+    THREAD_OFF (client->t_redist);
+}
+
+/*
+ * The client does not read as fast as zebra writes to it.  Rather than
+ * have its output grow without bound, stop queueing up the routes
+ * redistributed to it: those added or changed are dropped, those
+ * deleted are kept in the redistribution queue, which has at most one
+ * message per route, until the client has read most of its output.
+ * It is then sent all of the routes it redistributes again, read from
+ * the RIB.  Should it fall behind during that replay, the replay
+ * pauses, and changes to routes it already went past are kept too.
+ */
+static void
+zserv_catchup_start (struct zserv *client)
+{
+  if (client->catchup == ZSERV_CATCHUP_NONE)
+    {
+      client->replay_vrf = VRF_DEFAULT;
+      client->replay_afi = AFI_IP;
+      client->replay_p.family = 0;
+      client->catchup_cnt++;
+      zlog_warn ("%s: client %s fd %d fell behind, %lu bytes queued",
+		 __func__, zebra_route_string (client->proto), client->sock,
+		 (u_long) buffer_length (client->wb));
+    }
+
+  client->catchup = ZSERV_CATCHUP_WAIT;
+  THREAD_OFF (client->t_replay);
+}
+
+static int
+zserv_replay (struct thread *thread)
+{
+  struct zserv *client = THREAD_ARG (thread);
+
+  client->t_replay = NULL;
+
+  if (zebra_redistribute_replay (client, ZSERV_REPLAY_CHUNK))
+    {
+      client->catchup = ZSERV_CATCHUP_NONE;
+      if (IS_ZEBRA_DEBUG_EVENT)
+	zlog_debug ("%s: client %s fd %d caught up", __func__,
+		    zebra_route_string (client->proto), client->sock);
+    }
+
+  if (zserv_redist_flush (client) < 0)
+    return 0;
+
+  if (client->catchup == ZSERV_CATCHUP_REPLAY)
+    client->t_replay = thread_add_background (zebrad.master, zserv_replay,
+					      client, 0);
+  return 0;
+}
+
+/* The client read most of its output: send it the route changes kept
+ * meanwhile, then replay the rest. */
+static void
+zserv_catchup_resume (struct zserv *client)
+{
+  client->catchup = ZSERV_CATCHUP_REPLAY;
+
+  if (zserv_redist_flush (client) < 0
+      || client->catchup != ZSERV_CATCHUP_REPLAY)
+    return;
+
+  if (! client->t_replay)
+    client->t_replay = thread_add_background (zebrad.master, zserv_replay,
+					      client, 0);
+}
+
+int
+zebra_server_send_message(struct zserv *client)
+{
+  if (client->t_suicide)
+    return -1;
+
+  /* Redistributed routes queued so far go first. */
+  if (zserv_redist_flush (client) < 0)
+    return -1;
+
+  stream_set_getp(client->obuf, 0);
+  return zserv_write (client, client->obuf);
+}
+
 void
 zserv_create_header (struct stream *s, uint16_t cmd, vrf_id_t vrf_id)
 {
@@ -527,7 +859,7 @@ zsend_route_multipath (int cmd, struct zserv *client, struct prefix *p,
   /* Write packet size. */
   stream_putw_at (s, 0, stream_get_endp (s));
 
-  return zebra_server_send_message(client);
+  return zserv_redist_queue (client, cmd, p, rib->type, rib->vrf_id);
 }
 
 #ifdef HAVE_IPV6
@@ -892,6 +1224,243 @@ zread_interface_delete (struct zserv *client, u_short length, vrf_id_t vrf_id)
   return 0;
 }
 
+/* A nexthop of an IPv4 route message. */
+struct zserv_nexthop
+{
+  u_char type;
+  struct in_addr gate;
+  ifindex_t ifindex;
+};
+
+/* A nexthop group registered by a client, see zapi_nexthop_group_add(). */
+struct zserv_nhg
+{
+  u_int32_t id;
+  vrf_id_t vrf_id;
+
+  /* The groups of the routes added with it, which share their
+   * nexthops, one for each VRF, type and flags of the routes. */
+  struct list *groups;
+
+  u_char nexthop_num;
+  struct zserv_nexthop nexthop[];
+};
+
+/* Read the nexthops of an IPv4 route message into 'nexthop', which has
+ * room for 255, keeping those zebra uses.  Returns their number. */
+static int
+zserv_nexthops_read (struct stream *s, struct zserv_nexthop *nexthop)
+{
+  u_char ifname_len;
+  int i, n, num = 0;
+
+  n = stream_getc (s);
+
+  for (i = 0; i < n; i++)
+    {
+      nexthop[num].type = stream_getc (s);
+
+      switch (nexthop[num].type)
+	{
+	case ZEBRA_NEXTHOP_IFINDEX:
+	  nexthop[num++].ifindex = stream_getl (s);
+	  break;
+	case ZEBRA_NEXTHOP_IFNAME:
+	  ifname_len = stream_getc (s);
+	  stream_forward_getp (s, ifname_len);
+	  break;
+	case ZEBRA_NEXTHOP_IPV4:
+	  nexthop[num++].gate.s_addr = stream_get_ipv4 (s);
+	  break;
+	case ZEBRA_NEXTHOP_IPV4_IFINDEX:
+	  nexthop[num].gate.s_addr = stream_get_ipv4 (s);
+	  nexthop[num++].ifindex = stream_getl (s);
+	  break;
+	case ZEBRA_NEXTHOP_IPV6:
+	  stream_forward_getp (s, IPV6_MAX_BYTELEN);
+	  break;
+	case ZEBRA_NEXTHOP_BLACKHOLE:
+	  num++;
+	  break;
+	}
+    }
+  return num;
+}
+
+static void
+zserv_nexthops_add (struct rib *rib, struct zserv_nexthop *nexthop, int num)
+{
+  int i;
+
+  for (i = 0; i < num; i++)
+    switch (nexthop[i].type)
+      {
+      case ZEBRA_NEXTHOP_IFINDEX:
+	rib_nexthop_ifindex_add (rib, nexthop[i].ifindex);
+	break;
+      case ZEBRA_NEXTHOP_IPV4:
+	rib_nexthop_ipv4_add (rib, &nexthop[i].gate, NULL);
+	break;
+      case ZEBRA_NEXTHOP_IPV4_IFINDEX:
+	rib_nexthop_ipv4_ifindex_add (rib, &nexthop[i].gate, NULL,
+				      nexthop[i].ifindex);
+	break;
+      case ZEBRA_NEXTHOP_BLACKHOLE:
+	rib_nexthop_blackhole_add (rib);
+	break;
+      }
+}
+
+static unsigned int
+zserv_nhg_key (void *arg)
+{
+  struct zserv_nhg *nhg = arg;
+
+  return nhg->id;
+}
+
+static int
+zserv_nhg_cmp (const void *arg1, const void *arg2)
+{
+  const struct zserv_nhg *nhg1 = arg1;
+  const struct zserv_nhg *nhg2 = arg2;
+
+  return nhg1->id == nhg2->id;
+}
+
+static void
+zserv_nhg_free (void *arg)
+{
+  struct zserv_nhg *nhg = arg;
+  struct listnode *node;
+  struct nhg *group;
+
+  if (nhg->groups)
+    {
+      for (ALL_LIST_ELEMENTS_RO (nhg->groups, node, group))
+	zebra_nhg_unref (group);
+      list_delete (nhg->groups);
+    }
+  XFREE (MTYPE_ZSERV_NHG, nhg);
+}
+
+static struct zserv_nhg *
+zserv_nhg_lookup (struct zserv *client, u_int32_t id)
+{
+  struct zserv_nhg lookup;
+
+  if (! client->nhg_hash)
+    return NULL;
+
+  lookup.id = id;
+  return hash_lookup (client->nhg_hash, &lookup);
+}
+
+/* Give the rib the nexthops of the group, shared with the other routes
+ * of its VRF, type and flags added with it. */
+static void
+zserv_nhg_rib_set (struct zserv_nhg *nhg, struct rib *rib)
+{
+  struct listnode *node;
+  struct nhg *group;
+  u_char flags = rib->flags & ZEBRA_FLAG_INTERNAL;
+
+  rib->client_nhg = nhg->id;
+
+  for (ALL_LIST_ELEMENTS_RO (nhg->groups, node, group))
+    if (group->vrf_id == rib->vrf_id && group->type == rib->type
+	&& group->flags == flags)
+      {
+	zebra_nhg_share (group, rib);
+	rib->nexthop_num = group->nexthop_num;
+	return;
+      }
+
+  zserv_nexthops_add (rib, nhg->nexthop, nhg->nexthop_num);
+  listnode_add (nhg->groups, zebra_nhg_client_new (rib, AF_INET));
+}
+
+/* Register a nexthop group of the client, replacing any with its id.
+ * The routes already added with the group share its nexthops, which are
+ * replaced in place, and so only the kernel object they are installed
+ * with has to change. */
+static int
+zread_nexthop_group_add (struct zserv *client, u_short length,
+			 vrf_id_t vrf_id)
+{
+  struct stream *s;
+  struct zserv_nexthop nexthop[256];
+  struct zserv_nhg *nhg, *old;
+  struct listnode *node;
+  struct nhg *group;
+  struct rib tmp;
+  u_int32_t id;
+  int num;
+  int changed = 0;
+
+  s = client->ibuf;
+
+  id = stream_getl (s);
+  num = zserv_nexthops_read (s, nexthop);
+
+  /* The routes' nexthop lists cannot be left empty. */
+  if (! num)
+    {
+      zlog_warn ("%s: nexthop group %u has no nexthops", __func__, id);
+      return -1;
+    }
+
+  nhg = XMALLOC (MTYPE_ZSERV_NHG, sizeof (struct zserv_nhg)
+		 + num * sizeof (struct zserv_nexthop));
+  nhg->id = id;
+  nhg->vrf_id = vrf_id;
+  nhg->groups = list_new ();
+  nhg->nexthop_num = num;
+  memcpy (nhg->nexthop, nexthop, num * sizeof (struct zserv_nexthop));
+
+  if (! client->nhg_hash)
+    client->nhg_hash = hash_create (zserv_nhg_key, zserv_nhg_cmp);
+  if ((old = hash_release (client->nhg_hash, nhg)) != NULL)
+    {
+      if (old->vrf_id == vrf_id)
+	{
+	  list_delete (nhg->groups);
+	  nhg->groups = old->groups;
+	  old->groups = NULL;
+	  changed = old->nexthop_num != num
+	    || memcmp (old->nexthop, nexthop,
+		       num * sizeof (struct zserv_nexthop));
+	}
+      zserv_nhg_free (old);
+    }
+  hash_get (client->nhg_hash, nhg, hash_alloc_intern);
+
+  if (changed)
+    for (ALL_LIST_ELEMENTS_RO (nhg->groups, node, group))
+      {
+	memset (&tmp, 0, sizeof (struct rib));
+	zserv_nexthops_add (&tmp, nexthop, num);
+	zebra_nhg_replace (group, tmp.nexthop, tmp.nexthop_num);
+	rib_update_nhg (group);
+      }
+  return 0;
+}
+
+static int
+zread_nexthop_group_delete (struct zserv *client, u_short length,
+			    vrf_id_t vrf_id)
+{
+  struct zserv_nhg *nhg;
+
+  nhg = zserv_nhg_lookup (client, stream_getl (client->ibuf));
+  if (nhg)
+    {
+      hash_release (client->nhg_hash, nhg);
+      zserv_nhg_free (nhg);
+    }
+  return 0;
+}
+
 /* This function support multiple nexthop. */
 /* 
  * Parse the ZEBRA_IPV4_ROUTE_ADD sent from client. Update rib and
@@ -900,16 +1469,12 @@ zread_interface_delete (struct zserv *client, u_short length, vrf_id_t vrf_id)
 static int
 zread_ipv4_add (struct zserv *client, u_short length, vrf_id_t vrf_id)
 {
-  int i;
   struct rib *rib;
   struct prefix_ipv4 p;
   u_char message;
-  struct in_addr nexthop;
-  u_char nexthop_num;
-  u_char nexthop_type;
+  struct zserv_nexthop nexthop[256];
+  struct zserv_nhg *nhg;
   struct stream *s;
-  ifindex_t ifindex;
-  u_char ifname_len;
   safi_t safi;	
   int ret;
 
@@ -935,42 +1500,24 @@ zread_ipv4_add (struct zserv *client, u_short length, vrf_id_t vrf_id)
   /* VRF ID */
   rib->vrf_id = vrf_id;
 
-  /* Nexthop parse. */
+  /* Nexthop parse.  The route shares them with the others with the
+   * same, see zebra_nhg_intern(). */
   if (CHECK_FLAG (message, ZAPI_MESSAGE_NEXTHOP))
     {
-      nexthop_num = stream_getc (s);
-
-      for (i = 0; i < nexthop_num; i++)
+      zserv_nexthops_add (rib, nexthop, zserv_nexthops_read (s, nexthop));
+      if (safi == SAFI_UNICAST && rib->nexthop)
+	zebra_nhg_intern (rib, AF_INET);
+    }
+  else if (CHECK_FLAG (message, ZAPI_MESSAGE_NHG))
+    {
+      nhg = zserv_nhg_lookup (client, stream_getl (s));
+      if (! nhg)
 	{
-	  nexthop_type = stream_getc (s);
-
-	  switch (nexthop_type)
-	    {
-	    case ZEBRA_NEXTHOP_IFINDEX:
-	      ifindex = stream_getl (s);
-	      rib_nexthop_ifindex_add (rib, ifindex);
-	      break;
-	    case ZEBRA_NEXTHOP_IFNAME:
-	      ifname_len = stream_getc (s);
-	      stream_forward_getp (s, ifname_len);
-	      break;
-	    case ZEBRA_NEXTHOP_IPV4:
-	      nexthop.s_addr = stream_get_ipv4 (s);
-	      rib_nexthop_ipv4_add (rib, &nexthop, NULL);
-	      break;
-	    case ZEBRA_NEXTHOP_IPV4_IFINDEX:
-	      nexthop.s_addr = stream_get_ipv4 (s);
-	      ifindex = stream_getl (s);
-	      rib_nexthop_ipv4_ifindex_add (rib, &nexthop, NULL, ifindex);
-	      break;
-	    case ZEBRA_NEXTHOP_IPV6:
-	      stream_forward_getp (s, IPV6_MAX_BYTELEN);
-	      break;
-            case ZEBRA_NEXTHOP_BLACKHOLE:
-              rib_nexthop_blackhole_add (rib);
-              break;
-            }
+	  zlog_warn ("%s: unknown nexthop group", __func__);
+	  XFREE (MTYPE_RIB, rib);
+	  return -1;
 	}
+      zserv_nhg_rib_set (nhg, rib);
     }
 
   /* Distance. */
@@ -1001,6 +1548,100 @@ zread_ipv4_add (struct zserv *client, u_short length, vrf_id_t vrf_id)
   return 0;
 }
 
+/* Zebra server IPv4 batched prefix add function, see
+ * zapi_ipv4_route_batch().  The nexthops are parsed once, and then
+ * given to the rib of each route in turn.
+ */
+static int
+zread_ipv4_add_batch (struct zserv *client, u_short length, vrf_id_t vrf_id)
+{
+  struct stream *s;
+  struct rib *rib;
+  struct prefix_ipv4 p;
+  u_char type, flags, message;
+  safi_t safi;
+  struct zserv_nexthop nexthop[256];
+  struct zserv_nhg *nhg = NULL;
+  struct nhg *group = NULL;
+  int nexthop_num = 0;
+  u_int16_t count;
+  int ret;
+
+  s = client->ibuf;
+
+  type = stream_getc (s);
+  flags = stream_getc (s);
+  message = stream_getc (s);
+  safi = stream_getw (s);
+
+  if (CHECK_FLAG (message, ZAPI_MESSAGE_NEXTHOP))
+    nexthop_num = zserv_nexthops_read (s, nexthop);
+  else if (CHECK_FLAG (message, ZAPI_MESSAGE_NHG))
+    {
+      nhg = zserv_nhg_lookup (client, stream_getl (s));
+      if (! nhg)
+	{
+	  zlog_warn ("%s: unknown nexthop group", __func__);
+	  return -1;
+	}
+    }
+
+  count = stream_getw (s);
+  client->v4_route_batch_cnt++;
+
+  while (count--)
+    {
+      rib = XCALLOC (MTYPE_RIB, sizeof (struct rib));
+      rib->type = type;
+      rib->flags = flags;
+      rib->uptime = time (NULL);
+      rib->vrf_id = vrf_id;
+
+      memset (&p, 0, sizeof (struct prefix_ipv4));
+      p.family = AF_INET;
+      p.prefixlen = stream_getc (s);
+      stream_get (&p.prefix, s, PSIZE (p.prefixlen));
+
+      /* The routes share the nexthops, as the first's group, which its
+       * rib keeps until the batch is queued. */
+      if (nhg)
+	zserv_nhg_rib_set (nhg, rib);
+      else if (group)
+	{
+	  zebra_nhg_share (group, rib);
+	  rib->nexthop_num = nexthop_num;
+	}
+      else
+	{
+	  zserv_nexthops_add (rib, nexthop, nexthop_num);
+	  nexthop_num = rib->nexthop_num;
+	  if (safi == SAFI_UNICAST && rib->nexthop)
+	    {
+	      zebra_nhg_intern (rib, AF_INET);
+	      group = rib->group;
+	    }
+	}
+
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_DISTANCE))
+	rib->distance = stream_getc (s);
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_METRIC))
+	rib->metric = stream_getl (s);
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_MTU))
+	rib->mtu = stream_getl (s);
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_TAG))
+	rib->tag = stream_getl (s);
+
+      rib->table = zebrad.rtm_table_default;
+      ret = rib_add_ipv4_multipath (&p, rib, safi);
+
+      if (ret > 0)
+	client->v4_route_add_cnt++;
+      else if (ret < 0)
+	client->v4_route_upd8_cnt++;
+    }
+  return 0;
+}
+
 /* Zebra server IPv4 prefix delete function. */
 static int
 zread_ipv4_delete (struct zserv *client, u_short length, vrf_id_t vrf_id)
@@ -1065,6 +1706,23 @@ zread_ipv4_delete (struct zserv *client, u_short length, vrf_id_t vrf_id)
 	    }
 	}
     }
+  else if (CHECK_FLAG (api.message, ZAPI_MESSAGE_NHG))
+    {
+      struct zserv_nhg *nhg = zserv_nhg_lookup (client, stream_getl (s));
+
+      for (i = 0; nhg && i < nhg->nexthop_num; i++)
+	{
+	  if (nhg->nexthop[i].type == ZEBRA_NEXTHOP_IFINDEX
+	      || nhg->nexthop[i].type == ZEBRA_NEXTHOP_IPV4_IFINDEX)
+	    ifindex = nhg->nexthop[i].ifindex;
+	  if (nhg->nexthop[i].type == ZEBRA_NEXTHOP_IPV4
+	      || nhg->nexthop[i].type == ZEBRA_NEXTHOP_IPV4_IFINDEX)
+	    {
+	      nexthop = nhg->nexthop[i].gate;
+	      nexthop_p = &nexthop;
+	    }
+	}
+    }
 
   /* Distance. */
   if (CHECK_FLAG (api.message, ZAPI_MESSAGE_DISTANCE))
@@ -1227,6 +1885,9 @@ zread_ipv6_add (struct zserv *client, u_short length, vrf_id_t vrf_id)
   else
     rib->tag = 0;
   
+  if (safi == SAFI_UNICAST && rib->nexthop)
+    zebra_nhg_intern (rib, AF_INET6);
+
   /* Table */
   rib->table=zebrad.rtm_table_default;
   ret = rib_add_ipv6_multipath (&p, rib, safi);
@@ -1437,6 +2098,12 @@ zebra_client_close (struct zserv *client)
   if (client->wb)
     buffer_free(client->wb);
 
+  if (client->nhg_hash)
+    {
+      hash_clean (client->nhg_hash, zserv_nhg_free);
+      hash_free (client->nhg_hash);
+    }
+
   /* Release threads. */
   if (client->t_read)
     thread_cancel (client->t_read);
@@ -1445,6 +2112,15 @@ zebra_client_close (struct zserv *client)
   if (client->t_suicide)
     thread_cancel (client->t_suicide);
 
+  if (client->t_replay)
+    thread_cancel (client->t_replay);
+
+  zserv_redist_purge (client);
+  if (client->redist_hash)
+    hash_free (client->redist_hash);
+  if (client->redist_buf)
+    stream_free (client->redist_buf);
+
   /* Free client structure. */
   listnode_delete (zebrad.client_list, client);
   XFREE (0, client);
@@ -1610,6 +2286,15 @@ zebra_client_read (struct thread *thread)
     case ZEBRA_IPV4_ROUTE_ADD:
       zread_ipv4_add (client, length, vrf_id);
       break;
+    case ZEBRA_IPV4_ROUTE_ADD_BATCH:
+      zread_ipv4_add_batch (client, length, vrf_id);
+      break;
+    case ZEBRA_NEXTHOP_GROUP_ADD:
+      zread_nexthop_group_add (client, length, vrf_id);
+      break;
+    case ZEBRA_NEXTHOP_GROUP_DELETE:
+      zread_nexthop_group_delete (client, length, vrf_id);
+      break;
     case ZEBRA_IPV4_ROUTE_DELETE:
       zread_ipv4_delete (client, length, vrf_id);
       break;
@@ -1950,6 +2635,22 @@ zebra_show_client_detail (struct vty *vty, struct zserv *client)
 	   VTY_NEWLINE);
   vty_out (vty, "Interface Down Notifications: %d%s", client->ifdown_cnt,
 	   VTY_NEWLINE);
+  vty_out (vty, "IPv4 Route Batches: %d%s", client->v4_route_batch_cnt,
+	   VTY_NEWLINE);
+  vty_out (vty, "Nexthop Groups: %lu%s",
+	   client->nhg_hash ? client->nhg_hash->count : 0, VTY_NEWLINE);
+  vty_out (vty, "Redist Batches: %d, Coalesced: %d, Queued: %lu%s",
+	   client->redist_batch_cnt, client->redist_coalesced_cnt,
+	   client->redist_hash ? client->redist_hash->count : 0, VTY_NEWLINE);
+  vty_out (vty, "Output Queue: %lu bytes, peak %lu, limit %d/%d, %s%s",
+	   (u_long) buffer_length (client->wb), (u_long) client->wb_peak,
+	   ZSERV_WB_LOW, ZSERV_WB_HIGH,
+	   client->catchup == ZSERV_CATCHUP_WAIT ? "behind"
+	   : client->catchup == ZSERV_CATCHUP_REPLAY ? "catching up"
+	   : "in sync", VTY_NEWLINE);
+  vty_out (vty, "Catch-ups: %d, Changes Skipped: %d, Routes Replayed: %d%s",
+	   client->catchup_cnt, client->redist_skip_cnt, client->replay_cnt,
+	   VTY_NEWLINE);
 
   vty_out (vty, "%s", VTY_NEWLINE);
   return;
@@ -33,6 +33,11 @@
 /* Default configuration filename. */
 #define DEFAULT_CONFIG_FILE "zebra.conf"
 
+/* Catch-up state of a client's output, see zserv_catchup_start(). */
+#define ZSERV_CATCHUP_NONE    0
+#define ZSERV_CATCHUP_WAIT    1
+#define ZSERV_CATCHUP_REPLAY  2
+
 /* Client structure. */
 struct zserv
 {
@@ -71,6 +76,29 @@ struct zserv
   /* client's protocol */
   u_char proto;
 
+  /* Nexthop groups registered by the client, by id. */
+  struct hash *nhg_hash;
+
+  /* Routes to redistribute to the client, by prefix, and in the order
+   * they were first queued, waiting out the coalescing window. */
+  struct hash *redist_hash;
+  struct zserv_redist *redist_head;
+  struct zserv_redist *redist_tail;
+  struct stream *redist_buf;
+  struct thread *t_redist;
+
+  /* Whether the client fell behind, and is to be sent the routes it
+   * redistributes again rather than the changes it missed. */
+  u_char catchup;
+  struct thread *t_replay;
+
+  /* Where the replay got to: routes up to and including replay_p of
+   * the replay_afi table of VRF replay_vrf were sent, none of the table
+   * yet if replay_p.family is 0. */
+  vrf_id_t replay_vrf;
+  afi_t replay_afi;
+  struct prefix replay_p;
+
   /* Statistics */
   u_int32_t redist_v4_add_cnt;
   u_int32_t redist_v4_del_cnt;
@@ -79,6 +107,7 @@ struct zserv
   u_int32_t v4_route_add_cnt;
   u_int32_t v4_route_upd8_cnt;
   u_int32_t v4_route_del_cnt;
+  u_int32_t v4_route_batch_cnt;
   u_int32_t v6_route_add_cnt;
   u_int32_t v6_route_del_cnt;
   u_int32_t v6_route_upd8_cnt;
@@ -88,6 +117,12 @@ struct zserv
   u_int32_t ifdown_cnt;
   u_int32_t ifadd_cnt;
   u_int32_t ifdel_cnt;
+  u_int32_t redist_batch_cnt;
+  u_int32_t redist_coalesced_cnt;
+  u_int32_t redist_skip_cnt;
+  u_int32_t replay_cnt;
+  u_int32_t catchup_cnt;
+  size_t wb_peak;
 
   time_t connect_time;
   time_t last_read_time;
@@ -134,6 +169,7 @@ extern int zsend_interface_delete (struct zserv *, struct interface *);
 extern int zsend_interface_address (int, struct zserv *, struct interface *,
                                     struct connected *);
 extern int zsend_interface_update (int, struct zserv *, struct interface *);
+extern void zserv_redist_purge (struct zserv *);
 extern int zsend_route_multipath (int, struct zserv *, struct prefix *, 
                                   struct rib *);
 extern int zsend_router_id_update (struct zserv *, struct prefix *,